@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <type_traits>
+
+#include <folly/lang/Align.h>
+
+namespace folly {
+
+/// ChaseLevDeque is an unbounded work-stealing deque: a single owner thread
+/// pushes and pops items at the bottom, in LIFO order, while any number of
+/// thieves steal items from the top, in FIFO order.
+///
+/// The owner's push() and pop() touch only owner-written state (plus one
+/// fence in pop()), and only contend with thieves for the very last item.
+/// This is the deque of D. Chase and Y. Lev, "Dynamic Circular Work-Stealing
+/// Deque" (SPAA 2005), with the memory orderings of N. M. Lê et al.,
+/// "Correct and Efficient Work-Stealing for Weak Memory Models" (PPoPP 2013).
+///
+/// T must be trivially copyable and lock-free as a std::atomic, since a
+/// thief may read a slot the owner is overwriting and then discard it.
+/// Typically it is a pointer.
+///
+/// The ring buffer doubles when full and never shrinks. Buffers that are
+/// replaced are kept until the deque is destroyed, because a thief may still
+/// be reading from them; the total is at most twice the largest buffer.
+template <typename T>
+class ChaseLevDeque {
+  static_assert(std::is_trivially_copyable_v<T>);
+  static_assert(std::atomic<T>::is_always_lock_free);
+
+ public:
+  explicit ChaseLevDeque(size_t initialCapacity = 64)
+      : buffer_(Buffer::create(initialCapacity, nullptr).release()) {}
+
+  ChaseLevDeque(const ChaseLevDeque&) = delete;
+  ChaseLevDeque& operator=(const ChaseLevDeque&) = delete;
+
+  ~ChaseLevDeque() { delete buffer_.load(std::memory_order_relaxed); }
+
+  /// Owner only. Pushes at the bottom.
+  void push(T item) {
+    auto b = bottom_.load(std::memory_order_relaxed);
+    auto t = top_.load(std::memory_order_acquire);
+    auto* buffer = buffer_.load(std::memory_order_relaxed);
+    if (b - t > buffer->mask) {
+      buffer = grow(buffer, t, b);
+    }
+    buffer->at(b).store(item, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_.store(b + 1, std::memory_order_relaxed);
+  }
+
+  /// Owner only. Pops the most recently pushed item, if any.
+  std::optional<T> pop() {
+    auto b = bottom_.load(std::memory_order_relaxed) - 1;
+    auto* buffer = buffer_.load(std::memory_order_relaxed);
+    bottom_.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto t = top_.load(std::memory_order_relaxed);
+    if (t > b) {
+      // Empty.
+      bottom_.store(b + 1, std::memory_order_relaxed);
+      return std::nullopt;
+    }
+    auto item = buffer->at(b).load(std::memory_order_relaxed);
+    if (t == b) {
+      // The last item: race the thieves for it.
+      bool won = top_.compare_exchange_strong(
+          t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+      bottom_.store(b + 1, std::memory_order_relaxed);
+      if (!won) {
+        return std::nullopt;
+      }
+    }
+    return item;
+  }
+
+  /// Any thread. Steals the least recently pushed item. Returns nullopt if
+  /// the deque is empty, or if another thread took that item first, in
+  /// which case the caller may retry.
+  std::optional<T> steal() {
+    auto t = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto b = bottom_.load(std::memory_order_acquire);
+    if (t >= b) {
+      return std::nullopt;
+    }
+    auto* buffer = buffer_.load(std::memory_order_acquire);
+    auto item = buffer->at(t).load(std::memory_order_relaxed);
+    if (!top_.compare_exchange_strong(
+            t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+      return std::nullopt;
+    }
+    return item;
+  }
+
+  /// Any thread. The number of items, which may be stale by the time it is
+  /// returned.
+  size_t size() const {
+    auto b = bottom_.load(std::memory_order_relaxed);
+    auto t = top_.load(std::memory_order_relaxed);
+    return b > t ? static_cast<size_t>(b - t) : 0;
+  }
+
+  bool empty() const { return size() == 0; }
+
+ private:
+  struct Buffer {
+    // A power of 2, minus 1.
+    int64_t mask;
+    // The buffer this one replaced, freed along with it.
+    std::unique_ptr<Buffer> retired;
+    std::unique_ptr<std::atomic<T>[]> slots;
+
+    static std::unique_ptr<Buffer> create(
+        size_t capacity, std::unique_ptr<Buffer> retired) {
+      size_t size = 1;
+      while (size < capacity) {
+        size <<= 1;
+      }
+      auto buffer = std::make_unique<Buffer>();
+      buffer->mask = static_cast<int64_t>(size - 1);
+      buffer->retired = std::move(retired);
+      buffer->slots = std::make_unique<std::atomic<T>[]>(size);
+      return buffer;
+    }
+
+    std::atomic<T>& at(int64_t i) { return slots[i & mask]; }
+  };
+
+  Buffer* grow(Buffer* buffer, int64_t t, int64_t b) {
+    auto capacity = static_cast<size_t>(buffer->mask + 1) * 2;
+    auto* bigger = Buffer::create(capacity, std::unique_ptr<Buffer>(buffer))
+                       .release();
+    for (auto i = t; i < b; ++i) {
+      bigger->at(i).store(
+          buffer->at(i).load(std::memory_order_relaxed),
+          std::memory_order_relaxed);
+    }
+    buffer_.store(bigger, std::memory_order_release);
+    return bigger;
+  }
+
+  alignas(hardware_destructive_interference_size) std::atomic<int64_t> top_{0};
+  alignas(hardware_destructive_interference_size) std::atomic<int64_t> bottom_{
+      0};
+  std::atomic<Buffer*> buffer_;
+};
+
+} // namespace folly
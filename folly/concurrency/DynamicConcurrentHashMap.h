@@ -0,0 +1,1026 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+#include <folly/Optional.h>
+#include <folly/ScopeGuard.h>
+#include <folly/concurrency/detail/ConcurrentHashMap-detail.h>
+#include <folly/lang/Bits.h>
+#include <folly/synchronization/Hazptr.h>
+#include <folly/synchronization/detail/Sleeper.h>
+
+namespace folly {
+
+/**
+ * A ConcurrentHashMap whose number of shards follows its size.
+ *
+ * ConcurrentHashMap has a fixed number of shards, 1 << ShardBits: a small
+ * map pays for all of them, and a large one under heavy write load still
+ * contends on each. Here a map starts with a few shards; a shard that grows
+ * past kShardSplitSize elements splits in two, and two sibling shards that
+ * shrink below kShardMergeSize elements together merge back, between
+ * min_shards and max_shards. A resize moves one shard at a time, so the
+ * table never rehashes as a whole.
+ *
+ * Shards are picked by the top bits of the (mixed) hash, through a
+ * directory with one entry per possible shard of the deepest split, as in
+ * extendible hashing: a shard that did not split as often as others fills
+ * several consecutive entries.
+ *
+ * Readers do not wait for resizes: a find() that raced with a resize of
+ * its shard looks again in the shards that replaced it, which the moved
+ * shard points to before they are published. Writers to a shard wait while
+ * it is resized; writers to other shards do not. Resizes are serialized by a map-wide lock, taken by the
+ * writer that crosses a threshold.
+ *
+ * The interface is a subset of ConcurrentHashMap's, with the same caveats.
+ * In addition:
+ *
+ * * Keys and values must be copyable, since a resize copies the elements
+ *   of a shard to new shards.
+ *
+ * * Inserting or erasing may throw after the map was modified, if resizing
+ *   the shard fails (e.g. bad_alloc, or a throwing hash function). The map
+ *   is left as if the resize had not started.
+ *
+ * * Iterators hold a hazard pointer to their shard as well. Iterating
+ *   concurrently with resizes sees each element at most once; like
+ *   ConcurrentHashMap, it may or may not see concurrent modifications.
+ *
+ * * A resized shard is retired as one object, with all of its elements,
+ *   and freed once hazard pointer reclamation gets to it. Until then a
+ *   growing map may hold up to twice its elements.
+ *
+ * * The directory only grows, up to 8 bytes per shard of max_shards.
+ *
+ * * The map is not movable.
+ */
+template <
+    typename KeyType,
+    typename ValueType,
+    typename HashFn = std::hash<KeyType>,
+    typename KeyEqual = std::equal_to<KeyType>,
+    typename Allocator = std::allocator<uint8_t>,
+    template <typename> class Atom = std::atomic,
+    class Mutex = std::mutex,
+    template <
+        typename,
+        typename,
+        uint8_t,
+        typename,
+        typename,
+        typename,
+        template <typename> class,
+        class> class Impl = detail::concurrenthashmap::bucket::BucketTable>
+class DynamicConcurrentHashMap {
+  // Segments use the low bits of the hash for their buckets, and shards the
+  // high bits of mix(hash), so no bits are reserved for sharding.
+  using SegmentT = detail::ConcurrentHashMapSegment<
+      KeyType,
+      ValueType,
+      0,
+      HashFn,
+      KeyEqual,
+      Allocator,
+      Atom,
+      Mutex,
+      Impl>;
+  template <typename K, typename T>
+  using EnableHeterogeneousFind = std::enable_if_t<
+      detail::EligibleForHeterogeneousFind<KeyType, HashFn, KeyEqual, K>::value,
+      T>;
+
+  static_assert(
+      std::is_copy_constructible<KeyType>::value &&
+          std::is_copy_constructible<ValueType>::value,
+      "DynamicConcurrentHashMap copies elements when resizing shards");
+
+ public:
+  class ConstIterator;
+
+  using key_type = KeyType;
+  using mapped_type = ValueType;
+  using value_type = std::pair<const KeyType, ValueType>;
+  using size_type = std::size_t;
+  using hasher = HashFn;
+  using key_equal = KeyEqual;
+  using const_iterator = ConstIterator;
+
+  // A shard splits once it has more elements than this.
+  static constexpr size_t kShardSplitSize = 4096;
+  // Two sibling shards merge once they have fewer elements than this.
+  static constexpr size_t kShardMergeSize = kShardSplitSize / 4;
+  static constexpr size_t kDefaultMaxShards = 4096;
+  static constexpr size_t kMaxShards = size_t(1) << 16;
+
+ private:
+  template <typename K, typename T>
+  using EnableHeterogeneousInsert = std::enable_if_t<
+      ::folly::detail::
+          EligibleForHeterogeneousInsert<KeyType, HashFn, KeyEqual, K>::value,
+      T>;
+
+  template <typename K>
+  using IsIter = std::is_same<ConstIterator, remove_cvref_t<K>>;
+
+  template <typename K, typename T>
+  using EnableHeterogeneousErase = std::enable_if_t<
+      ::folly::detail::EligibleForHeterogeneousFind<
+          KeyType,
+          HashFn,
+          KeyEqual,
+          std::conditional_t<IsIter<K>::value, KeyType, K>>::value &&
+          !IsIter<K>::value,
+      T>;
+
+  struct Shard;
+
+ public:
+  /*
+   * Construct a DynamicConcurrentHashMap with enough shards for size
+   * elements, and room for size elements. min_shards and max_shards are
+   * rounded up to the next power of two, and max_shards may be at most
+   * kMaxShards.
+   */
+  explicit DynamicConcurrentHashMap(
+      size_t size = 8,
+      size_t min_shards = 1,
+      size_t max_shards = kDefaultMaxShards)
+      : minDepth_(folly::findLastSet(folly::nextPowTwo(min_shards) - 1)),
+        maxDepth_(folly::findLastSet(folly::nextPowTwo(max_shards) - 1)) {
+    CHECK_LE(max_shards, kMaxShards);
+    CHECK_LE(minDepth_, maxDepth_);
+    auto depth = depthFor(size);
+    auto* dir = new Directory(depth);
+    dirs_.emplace_back(dir);
+    for (uint64_t prefix = 0; prefix < (uint64_t(1) << depth); ++prefix) {
+      auto* shard = makeShard(prefix, depth, size >> depth);
+      dir->shards[prefix].store(shard, std::memory_order_relaxed);
+    }
+    dir_.store(dir, std::memory_order_release);
+  }
+
+  DynamicConcurrentHashMap(const DynamicConcurrentHashMap&) = delete;
+  DynamicConcurrentHashMap& operator=(const DynamicConcurrentHashMap&) =
+      delete;
+
+  ~DynamicConcurrentHashMap() {
+    auto* dir = dir_.load(std::memory_order_acquire);
+    for (uint64_t pos = 0; pos < kPositions;) {
+      auto* shard = dir->at(pos).load(std::memory_order_relaxed);
+      pos = shard->end();
+      ShardDeleter()(shard);
+    }
+    // cohort_ is destroyed last, and reclaims the retired shards.
+  }
+
+  bool empty() const noexcept {
+    auto hptr = make_hazard_pointer<Atom>();
+    for (uint64_t pos = 0; pos < kPositions;) {
+      auto* shard = protectShard(pos, hptr);
+      if (!shard->segment.empty()) {
+        return false;
+      }
+      pos = shard->end();
+    }
+    return true;
+  }
+
+  ConstIterator find(const KeyType& k) const { return findImpl(k); }
+
+  template <typename K, EnableHeterogeneousFind<K, int> = 0>
+  ConstIterator find(const K& k) const {
+    return findImpl(k);
+  }
+
+  bool contains(const KeyType& k) const = delete;
+
+  ConstIterator cend() const noexcept { return ConstIterator(nullptr); }
+
+  ConstIterator cbegin() const noexcept { return ConstIterator(this, 0); }
+
+  ConstIterator end() const noexcept { return cend(); }
+
+  ConstIterator begin() const noexcept { return cbegin(); }
+
+  std::pair<ConstIterator, bool> insert(
+      std::pair<key_type, mapped_type>&& foo) {
+    return insert(std::move(foo.first), std::move(foo.second));
+  }
+
+  template <typename Key, EnableHeterogeneousInsert<Key, int> = 0>
+  std::pair<ConstIterator, bool> insert(std::pair<Key, mapped_type>&& foo) {
+    return insert(std::move(foo.first), std::move(foo.second));
+  }
+
+  template <typename Key, typename Value>
+  std::pair<ConstIterator, bool> insert(Key&& k, Value&& v) {
+    auto h = HashFn{}(k);
+    return insertImpl(h, [&](SegmentT& seg, ConstIterator& res) {
+      return seg.insert(
+          res.it_, h, std::forward<Key>(k), std::forward<Value>(v));
+    });
+  }
+
+  template <typename Key, typename... Args>
+  std::pair<ConstIterator, bool> try_emplace(Key&& k, Args&&... args) {
+    auto h = HashFn{}(k);
+    return insertImpl(h, [&](SegmentT& seg, ConstIterator& res) {
+      return seg.try_emplace(
+          res.it_, h, std::forward<Key>(k), std::forward<Args>(args)...);
+    });
+  }
+
+  template <typename... Args>
+  std::pair<ConstIterator, bool> emplace(Args&&... args) {
+    using Node = typename SegmentT::Node;
+    detail::concurrenthashmap::AllocNodeGuard<Node, Allocator> g(
+        Allocator(), &cohort_, std::forward<Args>(args)...);
+    auto h = HashFn{}(g.node->getItem().first);
+    auto res = insertImpl(h, [&](SegmentT& seg, ConstIterator& it) {
+      return seg.emplace(it.it_, h, g.node->getItem().first, g.node);
+    });
+    if (res.second) {
+      g.dismiss();
+    }
+    return res;
+  }
+
+  /*
+   * The bool component will always be true if the map has been updated via
+   * either insertion or assignment. Note that this is different from the
+   * std::map::insert_or_assign interface.
+   */
+  template <typename Key, typename Value>
+  std::pair<ConstIterator, bool> insert_or_assign(Key&& k, Value&& v) {
+    auto h = HashFn{}(k);
+    return insertImpl(h, [&](SegmentT& seg, ConstIterator& res) {
+      return seg.insert_or_assign(
+          res.it_, h, std::forward<Key>(k), std::forward<Value>(v));
+    });
+  }
+
+  template <typename Key, typename Value, typename Predicate>
+  std::pair<ConstIterator, bool> insert_or_assign_if(
+      Key&& k, Value&& desired, Predicate&& predicate) {
+    auto h = HashFn{}(k);
+    return insertImpl(h, [&](SegmentT& seg, ConstIterator& res) {
+      return seg.insert_or_assign_if(
+          res.it_,
+          h,
+          std::forward<Key>(k),
+          std::forward<Value>(desired),
+          std::forward<Predicate>(predicate));
+    });
+  }
+
+  template <typename Key, typename Value>
+  folly::Optional<ConstIterator> assign(Key&& k, Value&& v) {
+    auto h = HashFn{}(k);
+    return assignImpl(h, [&](SegmentT& seg, ConstIterator& res) {
+      return seg.assign(
+          res.it_, h, std::forward<Key>(k), std::forward<Value>(v));
+    });
+  }
+
+  // Assign to desired if and only if the predicate returns true
+  // for the current value.
+  template <typename Key, typename Value, typename Predicate>
+  folly::Optional<ConstIterator> assign_if(
+      Key&& k, Value&& desired, Predicate&& predicate) {
+    auto h = HashFn{}(k);
+    return assignImpl(h, [&](SegmentT& seg, ConstIterator& res) {
+      return seg.assign_if(
+          res.it_,
+          h,
+          std::forward<Key>(k),
+          std::forward<Value>(desired),
+          std::forward<Predicate>(predicate));
+    });
+  }
+
+  // Assign to desired if and only if current value is equal to expected
+  template <typename Key, typename Value>
+  folly::Optional<ConstIterator> assign_if_equal(
+      Key&& k, const ValueType& expected, Value&& desired) {
+    auto h = HashFn{}(k);
+    return assignImpl(h, [&](SegmentT& seg, ConstIterator& res) {
+      return seg.assign_if_equal(
+          res.it_,
+          h,
+          std::forward<Key>(k),
+          expected,
+          std::forward<Value>(desired));
+    });
+  }
+
+  // Copying wrappers around insert and find.
+  // Only available for copyable types.
+  const ValueType operator[](const KeyType& key) {
+    auto item = insert(key, ValueType());
+    return item.first->second;
+  }
+
+  template <typename Key, EnableHeterogeneousInsert<Key, int> = 0>
+  const ValueType operator[](const Key& key) {
+    auto item = insert(key, ValueType());
+    return item.first->second;
+  }
+
+  const ValueType at(const KeyType& key) const { return atImpl(key); }
+
+  template <typename K, EnableHeterogeneousFind<K, int> = 0>
+  const ValueType at(const K& key) const {
+    return atImpl(key);
+  }
+
+  size_type erase(const key_type& k) {
+    return eraseImpl(k, [&](SegmentT& seg, size_t h) {
+      return seg.erase(h, k);
+    });
+  }
+
+  template <typename K, EnableHeterogeneousErase<K, int> = 0>
+  size_type erase(const K& k) {
+    return eraseImpl(k, [&](SegmentT& seg, size_t h) {
+      return seg.erase(h, k);
+    });
+  }
+
+  // Calls the hash function, and therefore may throw. Like
+  // ConcurrentHashMap::erase(pos), this erases the key of pos, whichever
+  // element has it now.
+  ConstIterator erase(ConstIterator& pos) {
+    auto h = HashFn{}(pos->first);
+    ConstIterator res(this);
+    auto* shard = write(h, res.hptr_, [&](SegmentT& seg) {
+      if (&seg == &pos.shard_->segment) {
+        seg.erase(res.it_, pos.it_, h);
+      } else {
+        seg.erase(h, pos->first);
+      }
+    });
+    // Before res.hptr_ stops protecting shard.
+    maybeMerge(*shard);
+    if (shard == pos.shard_) {
+      res.shard_ = shard;
+      res.pos_ = pos.pos_;
+    } else {
+      // The shard of pos was moved. It still has the key; carry on from
+      // there, so that the iteration goes on in the same order.
+      res = std::move(pos);
+      ++res.it_;
+    }
+    res.settle();
+    return res;
+  }
+
+  // Erase if and only if key k is equal to expected
+  size_type erase_if_equal(const key_type& k, const ValueType& expected) {
+    return erase_key_if(k, detail::concurrenthashmap::EqualTo1{expected});
+  }
+
+  template <typename K, EnableHeterogeneousErase<K, int> = 0>
+  size_type erase_if_equal(const K& k, const ValueType& expected) {
+    return erase_key_if(k, detail::concurrenthashmap::EqualTo1{expected});
+  }
+
+  // Erase if predicate evaluates to true on the existing value
+  template <typename Predicate>
+  size_type erase_key_if(const key_type& k, Predicate&& predicate) {
+    return eraseImpl(k, [&](SegmentT& seg, size_t h) {
+      return seg.erase_key_if(h, k, std::forward<Predicate>(predicate));
+    });
+  }
+
+  template <
+      typename K,
+      typename Predicate,
+      EnableHeterogeneousErase<K, int> = 0>
+  size_type erase_key_if(const K& k, Predicate&& predicate) {
+    return eraseImpl(k, [&](SegmentT& seg, size_t h) {
+      return seg.erase_key_if(h, k, std::forward<Predicate>(predicate));
+    });
+  }
+
+  // Replaces all shards by min_shards empty ones. Writers wait until it
+  // returns; readers see the elements until then.
+  void clear() {
+    std::lock_guard<Mutex> g(resizeMutex_);
+    auto* dir = dir_.load(std::memory_order_relaxed);
+    std::vector<Shard*> old;
+    for (uint64_t pos = 0; pos < kPositions;) {
+      auto* shard = dir->at(pos).load(std::memory_order_relaxed);
+      freeze(*shard);
+      old.push_back(shard);
+      pos = shard->end();
+    }
+    std::vector<Shard*> fresh;
+    auto guard = makeGuard([&] {
+      for (auto* shard : fresh) {
+        ShardDeleter()(shard);
+      }
+      for (auto* shard : old) {
+        unfreeze(*shard);
+      }
+    });
+    for (uint64_t prefix = 0; prefix < (uint64_t(1) << minDepth_); ++prefix) {
+      fresh.push_back(makeShard(prefix, minDepth_, 0));
+    }
+    guard.dismiss();
+    for (auto* shard : old) {
+      shard->successors[0].store(
+          fresh[shard->prefix >> (shard->depth - minDepth_)],
+          std::memory_order_release);
+      shard->moved.store(true, std::memory_order_seq_cst);
+    }
+    for (auto* shard : fresh) {
+      publish(*dir, *shard);
+    }
+    for (auto* shard : old) {
+      shard->retire();
+    }
+  }
+
+  // Splits shards ahead of time so that count elements fit without
+  // further resizes, and rehashes them for their share of count.
+  void reserve(size_t count) {
+    std::lock_guard<Mutex> g(resizeMutex_);
+    auto depth = depthFor(count);
+    for (uint64_t pos = 0; pos < kPositions;) {
+      auto* shard = dir_.load(std::memory_order_relaxed)
+                        ->at(pos)
+                        .load(std::memory_order_relaxed);
+      if (shard->depth < depth) {
+        split(*shard, std::max(shard->segment.size(), count >> shard->depth));
+        continue;
+      }
+      if (count >> shard->depth) {
+        // Frozen, the shard has no writers, which rehash requires.
+        freeze(*shard);
+        SCOPE_EXIT {
+          unfreeze(*shard);
+        };
+        shard->segment.rehash(count >> shard->depth);
+      }
+      pos = shard->end();
+    }
+  }
+
+  // This is a rolling size, and is not exact at any moment in time.
+  size_t size() const noexcept {
+    size_t res = 0;
+    auto hptr = make_hazard_pointer<Atom>();
+    for (uint64_t pos = 0; pos < kPositions;) {
+      auto* shard = protectShard(pos, hptr);
+      res += shard->segment.size();
+      pos = shard->end();
+    }
+    return res;
+  }
+
+  // The number of shards, which may change at any time.
+  size_t shard_count() const noexcept {
+    size_t res = 0;
+    auto hptr = make_hazard_pointer<Atom>();
+    for (uint64_t pos = 0; pos < kPositions;) {
+      ++res;
+      pos = protectShard(pos, hptr)->end();
+    }
+    return res;
+  }
+
+  class ConstIterator {
+   public:
+    friend class DynamicConcurrentHashMap;
+
+    const value_type& operator*() const { return *it_; }
+
+    const value_type* operator->() const { return &*it_; }
+
+    ConstIterator& operator++() {
+      ++it_;
+      settle();
+      return *this;
+    }
+
+    bool operator==(const ConstIterator& o) const {
+      return it_ == o.it_ && shard_ == o.shard_;
+    }
+
+    bool operator!=(const ConstIterator& o) const { return !(*this == o); }
+
+    ConstIterator& operator=(const ConstIterator& o) = delete;
+
+    ConstIterator& operator=(ConstIterator&& o) noexcept {
+      if (this != &o) {
+        it_ = std::move(o.it_);
+        hptr_ = std::move(o.hptr_);
+        shard_ = std::exchange(o.shard_, nullptr);
+        pos_ = std::exchange(o.pos_, 0);
+        parent_ = std::exchange(o.parent_, nullptr);
+      }
+      return *this;
+    }
+
+    ConstIterator(const ConstIterator& o) = delete;
+
+    ConstIterator(ConstIterator&& o) noexcept
+        : it_(std::move(o.it_)),
+          hptr_(std::move(o.hptr_)),
+          shard_(std::exchange(o.shard_, nullptr)),
+          pos_(std::exchange(o.pos_, 0)),
+          parent_(std::exchange(o.parent_, nullptr)) {}
+
+    // An iterator to be positioned by a find or a write.
+    explicit ConstIterator(const DynamicConcurrentHashMap* parent)
+        : hptr_(make_hazard_pointer<Atom>()), parent_(parent) {}
+
+   private:
+    // cbegin iterator
+    ConstIterator(const DynamicConcurrentHashMap* parent, uint64_t pos)
+        : it_(nullptr),
+          hptr_(make_hazard_pointer<Atom>()),
+          pos_(pos),
+          parent_(parent) {
+      shard_ = parent_->protectShard(pos_, hptr_);
+      it_ = shard_->segment.cbegin();
+      settle();
+    }
+
+    // cend iterator
+    explicit ConstIterator(std::nullptr_t) : it_(nullptr) {}
+
+    void setEnd() {
+      shard_ = nullptr;
+      hptr_.reset_protection();
+    }
+
+    // Moves on to the next shard at the end of this one. A merge may have
+    // brought elements that were already visited, from positions before
+    // pos_, into the shard; those are skipped.
+    void settle() {
+      while (true) {
+        if (shard_->begin() < pos_) {
+          while (it_ != shard_->segment.cend() &&
+                 position(HashFn{}(it_->first)) < pos_) {
+            ++it_;
+          }
+        }
+        if (it_ != shard_->segment.cend()) {
+          return;
+        }
+        pos_ = shard_->end();
+        if (pos_ == kPositions) {
+          setEnd();
+          return;
+        }
+        shard_ = parent_->protectShard(pos_, hptr_);
+        it_ = shard_->segment.cbegin();
+      }
+    }
+
+    typename SegmentT::Iterator it_;
+    hazptr_holder<Atom> hptr_;
+    // The shard of it_, protected by hptr_, or nullptr at the end.
+    Shard* shard_{nullptr};
+    // Elements at lower positions were visited already.
+    uint64_t pos_{0};
+    const DynamicConcurrentHashMap* parent_{nullptr};
+  };
+
+ private:
+  using ShardAllocator =
+      typename std::allocator_traits<Allocator>::template rebind_alloc<Shard>;
+
+  struct ShardDeleter {
+    void operator()(Shard* shard) const {
+      shard->~Shard();
+      ShardAllocator().deallocate(shard, 1);
+    }
+  };
+
+  // A shard holds the elements whose position (see position()) is in
+  // [begin(), end()), i.e. starts with the depth bits of prefix.
+  struct Shard : hazptr_obj_base<Shard, Atom, ShardDeleter> {
+    Shard(
+        uint64_t p,
+        uint8_t d,
+        size_t initialBuckets,
+        hazptr_obj_cohort<Atom>* cohort)
+        : segment(initialBuckets, SegmentT::kDefaultLoadFactor, 0, cohort),
+          prefix(p),
+          depth(d) {
+      this->set_cohort_tag(cohort);
+    }
+
+    uint64_t begin() const { return prefix << (32 - depth); }
+    uint64_t end() const { return (prefix + 1) << (32 - depth); }
+
+    SegmentT segment;
+    const uint64_t prefix;
+    const uint8_t depth;
+    // The writers in segment, plus kFrozen while a resize copies it; a
+    // moved shard stays frozen.
+    Atom<uint32_t> writers{0};
+    // Whether the shard was replaced in the directory.
+    Atom<bool> moved{false};
+    // The shards that replaced it, set before moved: the halves of a split,
+    // or the one shard of a merge or a clear().
+    Atom<Shard*> successors[2]{nullptr, nullptr};
+
+    // The successor that holds pos.
+    Atom<Shard*>& successor(uint64_t pos) {
+      if (successors[1].load(std::memory_order_acquire) == nullptr) {
+        return successors[0];
+      }
+      return successors[(pos >> (31 - depth)) & 1];
+    }
+  };
+
+  static constexpr uint32_t kFrozen = uint32_t(1) << 31;
+
+  using ShardPtrAllocator = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<Atom<Shard*>>;
+
+  // 1 << depth entries; the shard of position pos is at pos >> (32 - depth).
+  // Replaced directories are kept until destruction, since readers may still
+  // be looking up shards in them.
+  struct Directory {
+    explicit Directory(uint8_t d)
+        : depth(d), shards(ShardPtrAllocator().allocate(size_t(1) << d)) {
+      for (size_t i = 0; i < (size_t(1) << depth); ++i) {
+        new (&shards[i]) Atom<Shard*>(nullptr);
+      }
+    }
+
+    ~Directory() {
+      for (size_t i = 0; i < (size_t(1) << depth); ++i) {
+        shards[i].~Atom<Shard*>();
+      }
+      ShardPtrAllocator().deallocate(shards, size_t(1) << depth);
+    }
+
+    Atom<Shard*>& at(uint64_t pos) { return shards[pos >> (32 - depth)]; }
+
+    const uint8_t depth;
+    Atom<Shard*>* const shards;
+  };
+
+  // Positions are 32 bits, which is plenty for kMaxShards.
+  static constexpr uint64_t kPositions = uint64_t(1) << 32;
+
+  // The top bits of a 64-bit multiplicative hash depend on all bits of h,
+  // which keeps shards balanced for the identity hashes of std::hash.
+  static uint64_t position(size_t h) {
+    return (uint64_t(h) * 0x9e3779b97f4a7c15) >> 32;
+  }
+
+  uint8_t depthFor(size_t size) const {
+    uint8_t depth = minDepth_;
+    while (depth < maxDepth_ && (size >> depth) > kShardSplitSize / 2) {
+      ++depth;
+    }
+    return depth;
+  }
+
+  Shard* makeShard(uint64_t prefix, uint8_t depth, size_t initialBuckets) {
+    auto* shard = ShardAllocator().allocate(1);
+    return new (shard) Shard(prefix, depth, initialBuckets, &cohort_);
+  }
+
+  // Returns the current shard of pos, protected by hptr.
+  Shard* protectShard(uint64_t pos, hazptr_holder<Atom>& hptr) const {
+    while (true) {
+      auto* dir = dir_.load(std::memory_order_acquire);
+      auto* shard = hptr.protect(dir->at(pos));
+      // Shards are retired after they leave the current directory, but they
+      // stay in the directories it replaced.
+      if (dir_.load(std::memory_order_acquire) == dir) {
+        return shard;
+      }
+    }
+  }
+
+  // Returns the successor of moved, protected by hptr, that holds pos, or
+  // the current shard of pos if the resize was published since.
+  Shard* protectSuccessor(
+      Shard& moved, uint64_t pos, hazptr_holder<Atom>& hptr) const {
+    auto next = make_hazard_pointer<Atom>();
+    auto* shard = next.protect(moved.successor(pos));
+    // shard is retired once it is moved in turn, after it was published. So
+    // it was not while moved, still protected by hptr, or shard itself is
+    // in the directory.
+    auto* dir = dir_.load(std::memory_order_acquire);
+    auto* current = dir->at(pos).load(std::memory_order_acquire);
+    if (dir_.load(std::memory_order_acquire) != dir ||
+        (current != &moved && current != shard)) {
+      return protectShard(pos, hptr);
+    }
+    hptr = std::move(next);
+    return shard;
+  }
+
+  // Runs fn on the segment of h as one of its writers, and returns its
+  // shard, protected by hptr.
+  template <typename Fn>
+  Shard* write(size_t h, hazptr_holder<Atom>& hptr, Fn&& fn) {
+    auto pos = position(h);
+    Shard* shard;
+    while (true) {
+      shard = protectShard(pos, hptr);
+      if (!(shard->writers.fetch_add(1, std::memory_order_acquire) &
+            kFrozen)) {
+        break;
+      }
+      shard->writers.fetch_sub(1, std::memory_order_release);
+      // Wait for the resize to end, and retry on the new shard.
+      folly::detail::Sleeper sleeper;
+      while ((shard->writers.load(std::memory_order_acquire) & kFrozen) &&
+             !shard->moved.load(std::memory_order_acquire)) {
+        sleeper.wait();
+      }
+    }
+    SCOPE_EXIT {
+      shard->writers.fetch_sub(1, std::memory_order_release);
+    };
+    fn(shard->segment);
+    return shard;
+  }
+
+  template <typename Fn>
+  std::pair<ConstIterator, bool> insertImpl(size_t h, Fn&& fn) {
+    std::pair<ConstIterator, bool> res(
+        std::piecewise_construct,
+        std::forward_as_tuple(this),
+        std::forward_as_tuple(false));
+    auto* shard = write(h, res.first.hptr_, [&](SegmentT& seg) {
+      res.second = fn(seg, res.first);
+    });
+    res.first.shard_ = shard;
+    res.first.pos_ = shard->begin();
+    maybeSplit(*shard);
+    return res;
+  }
+
+  template <typename Fn>
+  folly::Optional<ConstIterator> assignImpl(size_t h, Fn&& fn) {
+    ConstIterator res(this);
+    bool assigned = false;
+    auto* shard = write(h, res.hptr_, [&](SegmentT& seg) {
+      assigned = fn(seg, res);
+    });
+    if (!assigned) {
+      return none;
+    }
+    res.shard_ = shard;
+    res.pos_ = shard->begin();
+    return res;
+  }
+
+  template <typename K, typename Fn>
+  size_type eraseImpl(const K& k, Fn&& fn) {
+    auto h = HashFn{}(k);
+    auto hptr = make_hazard_pointer<Atom>();
+    size_type res = 0;
+    auto* shard = write(h, hptr, [&](SegmentT& seg) { res = fn(seg, h); });
+    if (res) {
+      maybeMerge(*shard);
+    }
+    return res;
+  }
+
+  template <typename K>
+  ConstIterator findImpl(const K& k) const {
+    auto h = HashFn{}(k);
+    auto pos = position(h);
+    ConstIterator res(this);
+    auto* shard = protectShard(pos, res.hptr_);
+    while (true) {
+      bool found = shard->segment.find(res.it_, h, k);
+      // A moved shard misses the writes made since; look in its successor.
+      if (!shard->moved.load(std::memory_order_seq_cst)) {
+        if (!found) {
+          return cend();
+        }
+        res.shard_ = shard;
+        res.pos_ = shard->begin();
+        return res;
+      }
+      shard = protectSuccessor(*shard, pos, res.hptr_);
+    }
+  }
+
+  template <typename K>
+  const ValueType atImpl(const K& k) const {
+    auto item = find(k);
+    if (item == cend()) {
+      throw_exception<std::out_of_range>("at(): key not in map");
+    }
+    return item->second;
+  }
+
+  // Stops new writers of shard, and waits for the current ones.
+  static void freeze(Shard& shard) {
+    shard.writers.fetch_or(kFrozen, std::memory_order_acq_rel);
+    folly::detail::Sleeper sleeper;
+    while (shard.writers.load(std::memory_order_acquire) != kFrozen) {
+      sleeper.wait();
+    }
+  }
+
+  static void unfreeze(Shard& shard) {
+    shard.writers.fetch_and(~kFrozen, std::memory_order_release);
+  }
+
+  static void publish(Directory& dir, Shard& shard) {
+    for (auto pos = shard.begin(); pos < shard.end();
+         pos += uint64_t(1) << (32 - dir.depth)) {
+      dir.at(pos).store(&shard, std::memory_order_release);
+    }
+  }
+
+  // Copies the elements of from to the shards of to that hold them, which
+  // must have no writers.
+  template <size_t N>
+  static void copy(Shard& from, Shard* (&to)[N]) {
+    typename SegmentT::Iterator it;
+    for (auto e = from.segment.cbegin(); e != from.segment.cend(); ++e) {
+      auto h = HashFn{}(e->first);
+      auto pos = position(h);
+      auto* dst = *std::find_if(to, to + N, [pos](Shard* s) {
+        return pos >= s->begin() && pos < s->end();
+      });
+      dst->segment.try_emplace(it, h, e->first, e->second);
+    }
+  }
+
+  // Replaces from by to in the current directory, and retires from. Writers
+  // of the moved shards retry once they are marked moved, and readers that
+  // see it look in their successors, so the marking comes first: any write
+  // to the new shards happens after it.
+  template <size_t N, size_t M>
+  void replace(Shard* (&from)[N], Shard* (&to)[M]) {
+    for (auto* shard : from) {
+      for (size_t i = 0; i < M; ++i) {
+        shard->successors[i].store(to[i], std::memory_order_release);
+      }
+      shard->moved.store(true, std::memory_order_seq_cst);
+    }
+    auto* dir = dir_.load(std::memory_order_relaxed);
+    for (auto* shard : to) {
+      publish(*dir, *shard);
+    }
+    for (auto* shard : from) {
+      shard->retire();
+    }
+  }
+
+  void maybeSplit(Shard& shard) {
+    if (shard.segment.size() > kShardSplitSize && shard.depth < maxDepth_) {
+      std::lock_guard<Mutex> g(resizeMutex_);
+      if (!shard.moved.load(std::memory_order_relaxed) &&
+          shard.segment.size() > kShardSplitSize) {
+        split(shard, shard.segment.size());
+      }
+    }
+  }
+
+  // Must hold resizeMutex_.
+  void split(Shard& shard, size_t size) {
+    auto* dir = dir_.load(std::memory_order_relaxed);
+    if (shard.depth == dir->depth) {
+      growDirectory();
+    }
+    freeze(shard);
+    Shard* halves[2] = {nullptr, nullptr};
+    auto guard = makeGuard([&] {
+      for (auto* half : halves) {
+        if (half) {
+          ShardDeleter()(half);
+        }
+      }
+      unfreeze(shard);
+    });
+    for (uint64_t i = 0; i < 2; ++i) {
+      halves[i] = makeShard(shard.prefix * 2 + i, shard.depth + 1, size / 2);
+    }
+    copy(shard, halves);
+    guard.dismiss();
+    Shard* from[1] = {&shard};
+    replace(from, halves);
+  }
+
+  void maybeMerge(Shard& shard) {
+    if (shard.segment.size() >= kShardMergeSize / 2 ||
+        shard.depth <= minDepth_) {
+      return;
+    }
+    std::lock_guard<Mutex> g(resizeMutex_);
+    if (shard.moved.load(std::memory_order_relaxed)) {
+      return;
+    }
+    auto* dir = dir_.load(std::memory_order_relaxed);
+    auto* sibling = dir->at((shard.prefix ^ 1) << (32 - shard.depth))
+                        .load(std::memory_order_relaxed);
+    if (sibling->depth != shard.depth ||
+        shard.segment.size() + sibling->segment.size() >= kShardMergeSize) {
+      return;
+    }
+    Shard* halves[2] = {&shard, sibling};
+    if (shard.prefix & 1) {
+      std::swap(halves[0], halves[1]);
+    }
+    freeze(*halves[0]);
+    freeze(*halves[1]);
+    Shard* merged[1] = {nullptr};
+    auto guard = makeGuard([&] {
+      if (merged[0]) {
+        ShardDeleter()(merged[0]);
+      }
+      unfreeze(*halves[0]);
+      unfreeze(*halves[1]);
+    });
+    merged[0] = makeShard(
+        shard.prefix / 2,
+        shard.depth - 1,
+        halves[0]->segment.size() + halves[1]->segment.size());
+    copy(*halves[0], merged);
+    copy(*halves[1], merged);
+    guard.dismiss();
+    replace(halves, merged);
+  }
+
+  // Must hold resizeMutex_.
+  void growDirectory() {
+    auto* old = dir_.load(std::memory_order_relaxed);
+    CHECK_LT(old->depth, maxDepth_);
+    auto* dir = new Directory(old->depth + 1);
+    dirs_.emplace_back(dir);
+    for (size_t i = 0; i < (size_t(1) << old->depth); ++i) {
+      auto* shard = old->shards[i].load(std::memory_order_relaxed);
+      dir->shards[2 * i].store(shard, std::memory_order_relaxed);
+      dir->shards[2 * i + 1].store(shard, std::memory_order_relaxed);
+    }
+    dir_.store(dir, std::memory_order_release);
+  }
+
+  // Declared first, to be destroyed last.
+  mutable hazptr_obj_cohort<Atom> cohort_;
+  const uint8_t minDepth_;
+  const uint8_t maxDepth_;
+  Atom<Directory*> dir_{nullptr};
+  // Guarded by resizeMutex_.
+  std::vector<std::unique_ptr<Directory>> dirs_;
+  Mutex resizeMutex_;
+};
+
+template <
+    typename KeyType,
+    typename ValueType,
+    typename HashFn = std::hash<KeyType>,
+    typename KeyEqual = std::equal_to<KeyType>,
+    typename Allocator = std::allocator<uint8_t>,
+    template <typename> class Atom = std::atomic,
+    class Mutex = std::mutex>
+using DynamicConcurrentHashMapSIMD = DynamicConcurrentHashMap<
+    KeyType,
+    ValueType,
+    HashFn,
+    KeyEqual,
+    Allocator,
+    Atom,
+    Mutex,
+#if (                                                        \
+    FOLLY_SSE_PREREQ(4, 2) ||                                \
+    (FOLLY_AARCH64 && FOLLY_F14_CRC_INTRINSIC_AVAILABLE)) && \
+    FOLLY_F14_VECTOR_INTRINSICS_AVAILABLE
+    detail::concurrenthashmap::simd::SIMDTable
+#else
+    // fallback to regular impl
+    detail::concurrenthashmap::bucket::BucketTable
+#endif
+    >;
+
+} // namespace folly
@@ -26,6 +26,7 @@
 #include <folly/container/HeterogeneousAccess.h>
 #include <folly/container/detail/F14Mask.h>
 #include <folly/lang/Align.h>
+#include <folly/lang/Builtin.h>
 #include <folly/lang/Exception.h>
 #include <folly/synchronization/Hazptr.h>
 
@@ -503,6 +504,19 @@ class alignas(64) BucketTable {
     return false;
   }
 
+  // Prefetches the bucket that a find() of hash h starts from. The buckets
+  // are not protected: if they are replaced meanwhile, the prefetch is only
+  // wasted.
+  void prefetch(size_t h) {
+    auto seqlock = seqlock_.load(std::memory_order_acquire);
+    auto bcount = bucket_count_.load(std::memory_order_acquire);
+    auto buckets = buckets_.load(std::memory_order_acquire);
+    if (buckets && !(seqlock & 1) &&
+        seqlock == seqlock_.load(std::memory_order_acquire)) {
+      FOLLY_BUILTIN_PREFETCH(&buckets->array()[getIdx(bcount, h)], 0, 3);
+    }
+  }
+
   template <typename K, typename MatchFunc>
   std::size_t erase(size_t h, const K& key, Iterator* iter, MatchFunc match) {
     Node* node{nullptr};
@@ -1518,6 +1532,20 @@ class alignas(64) SIMDTable {
     return false;
   }
 
+  // Prefetches the chunk that a find() of hash h starts from. The chunks
+  // are not protected: if they are replaced meanwhile, the prefetch is only
+  // wasted.
+  void prefetch(size_t h) {
+    auto seqlock = seqlock_.load(std::memory_order_acquire);
+    auto ccount = chunk_count_.load(std::memory_order_acquire);
+    auto chunks = chunks_.load(std::memory_order_acquire);
+    if (chunks && !(seqlock & 1) &&
+        seqlock == seqlock_.load(std::memory_order_acquire)) {
+      auto chunk = chunks->getChunk(splitHash(h).first, ccount);
+      FOLLY_BUILTIN_PREFETCH(chunk, 0, 3);
+    }
+  }
+
   template <typename K, typename MatchFunc>
   std::size_t erase(size_t h, const K& key, Iterator* iter, MatchFunc match) {
     const HashPair hp = splitHash(h);
@@ -2074,6 +2102,8 @@ class alignas(64) ConcurrentHashMapSegment {
     return impl_.find(res, h, k);
   }
 
+  void prefetch(size_t h) { impl_.prefetch(h); }
+
   // Listed separately because we need a prev pointer.
   template <typename K>
   size_type erase(size_t h, const K& key) {
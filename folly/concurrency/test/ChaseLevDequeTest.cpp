@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/concurrency/ChaseLevDeque.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <folly/portability/GTest.h>
+
+using folly::ChaseLevDeque;
+
+TEST(ChaseLevDeque, PopIsLifoStealIsFifo) {
+  ChaseLevDeque<int> deque;
+  EXPECT_TRUE(deque.empty());
+  EXPECT_EQ(deque.pop(), std::nullopt);
+  EXPECT_EQ(deque.steal(), std::nullopt);
+
+  for (int i = 0; i < 4; ++i) {
+    deque.push(i);
+  }
+  EXPECT_EQ(deque.size(), 4);
+  EXPECT_EQ(deque.pop(), 3);
+  EXPECT_EQ(deque.steal(), 0);
+  EXPECT_EQ(deque.pop(), 2);
+  EXPECT_EQ(deque.steal(), 1);
+  EXPECT_TRUE(deque.empty());
+  EXPECT_EQ(deque.pop(), std::nullopt);
+  EXPECT_EQ(deque.steal(), std::nullopt);
+}
+
+TEST(ChaseLevDeque, Grow) {
+  ChaseLevDeque<int> deque(2);
+  // Wrap around the initial buffer before growing it.
+  deque.push(-1);
+  deque.push(-2);
+  EXPECT_EQ(deque.steal(), -1);
+  constexpr int kN = 1000;
+  for (int i = 0; i < kN; ++i) {
+    deque.push(i);
+  }
+  EXPECT_EQ(deque.size(), kN + 1);
+  EXPECT_EQ(deque.steal(), -2);
+  for (int i = kN - 1; i >= 0; --i) {
+    EXPECT_EQ(deque.pop(), i);
+  }
+  EXPECT_TRUE(deque.empty());
+}
+
+// The owner pushes and pops while thieves steal: every item must be taken
+// exactly once.
+TEST(ChaseLevDeque, ConcurrentSteal) {
+  constexpr size_t kItems = 200000;
+  constexpr size_t kThieves = 3;
+  ChaseLevDeque<size_t> deque(4);
+  std::vector<std::atomic<int>> taken(kItems);
+  std::atomic<bool> done{false};
+  auto take = [&](size_t item) {
+    ASSERT_LT(item, kItems);
+    EXPECT_EQ(taken[item].fetch_add(1, std::memory_order_relaxed), 0);
+  };
+
+  std::vector<std::thread> thieves;
+  for (size_t i = 0; i < kThieves; ++i) {
+    thieves.emplace_back([&] {
+      while (!done.load(std::memory_order_acquire) || !deque.empty()) {
+        if (auto item = deque.steal()) {
+          take(*item);
+        }
+      }
+    });
+  }
+
+  for (size_t i = 0; i < kItems; ++i) {
+    deque.push(i);
+    // Pop some back, leaving a short deque to fight over.
+    if (i % 3 == 0) {
+      if (auto item = deque.pop()) {
+        take(*item);
+      }
+    }
+  }
+  done.store(true, std::memory_order_release);
+  for (auto& thief : thieves) {
+    thief.join();
+  }
+  while (auto item = deque.pop()) {
+    take(*item);
+  }
+
+  for (size_t i = 0; i < kItems; ++i) {
+    EXPECT_EQ(taken[i].load(), 1) << i;
+  }
+}
@@ -16,6 +16,7 @@
 
 #include <folly/concurrency/ConcurrentHashMap.h>
 
+#include <array>
 #include <atomic>
 #include <limits>
 #include <memory>
@@ -1090,6 +1091,36 @@ TYPED_TEST_P(ConcurrentHashMapTest, HeterogeneousInsert) {
       "there shouldn't be an erase() overload for this string map with an int param");
 }
 
+TYPED_TEST_P(ConcurrentHashMapTest, FindManyInsertMany) {
+  CHM<uint64_t, uint64_t> map;
+  // Spans more than one group of prefetches.
+  std::vector<std::pair<uint64_t, uint64_t>> items;
+  for (uint64_t i = 0; i < 100; ++i) {
+    items.emplace_back(i * 2, i);
+  }
+  items.emplace_back(0, 1000);
+  std::array<bool, 101> inserted;
+  EXPECT_EQ(100, map.insertMany(items, inserted));
+  EXPECT_TRUE(inserted.front());
+  EXPECT_FALSE(inserted.back());
+  EXPECT_EQ(0, map.at(0));
+  EXPECT_EQ(100, map.size());
+
+  std::vector<uint64_t> keys;
+  for (uint64_t i = 0; i < 200; ++i) {
+    keys.push_back(i);
+  }
+  std::vector<folly::Optional<uint64_t>> out(keys.size());
+  EXPECT_EQ(100, map.findMany(keys, out));
+  for (uint64_t i = 0; i < 200; ++i) {
+    if (i % 2 == 0) {
+      EXPECT_EQ(i / 2, out[i].value());
+    } else {
+      EXPECT_FALSE(out[i].has_value());
+    }
+  }
+}
+
 TYPED_TEST_P(ConcurrentHashMapTest, InsertOrAssignIterator) {
   CHM<int, int> map;
   auto [itr1, insert1] = map.insert_or_assign(1, 1);
@@ -1288,6 +1319,7 @@ REGISTER_TYPED_TEST_SUITE_P(
     IteratorLoop,
     HeterogeneousLookup,
     HeterogeneousInsert,
+    FindManyInsertMany,
     InsertOrAssignIterator,
     EraseClonedNonCopyable,
     ConcurrentInsertClear,
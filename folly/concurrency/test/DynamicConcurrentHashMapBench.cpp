@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/concurrency/ConcurrentHashMap.h>
+#include <folly/concurrency/DynamicConcurrentHashMap.h>
+#include <folly/portability/GFlags.h>
+
+FOLLY_GFLAGS_DEFINE_uint32(threads, 4, "writer threads");
+FOLLY_GFLAGS_DEFINE_uint64(
+    max_keys,
+    10 * 1000 * 1000,
+    "size of the largest map in the footprint table");
+
+using namespace folly;
+
+// Compares DynamicConcurrentHashMap with ConcurrentHashMap and its fixed 256
+// shards. Before the benchmarks, main prints the memory footprint of both
+// maps from 1K keys up to --max_keys (pass 100000000 for the full range, it
+// takes several GB). The write benchmarks overwrite random keys of a map of
+// a given size from --threads threads, and fill an empty map, which for
+// DynamicConcurrentHashMap includes splitting its shards. Each iteration is
+// one write.
+namespace {
+
+std::atomic<size_t> allocatedBytes{0};
+
+template <typename T>
+struct CountingAllocator {
+  using value_type = T;
+
+  CountingAllocator() = default;
+  template <typename U>
+  explicit CountingAllocator(const CountingAllocator<U>&) {}
+
+  T* allocate(size_t n) {
+    allocatedBytes += n * sizeof(T);
+    return std::allocator<T>().allocate(n);
+  }
+
+  void deallocate(T* p, size_t n) {
+    allocatedBytes -= n * sizeof(T);
+    std::allocator<T>().deallocate(p, n);
+  }
+
+  template <typename U>
+  bool operator==(const CountingAllocator<U>&) const {
+    return true;
+  }
+  template <typename U>
+  bool operator!=(const CountingAllocator<U>&) const {
+    return false;
+  }
+};
+
+using Fixed = ConcurrentHashMap<
+    uint64_t,
+    uint64_t,
+    std::hash<uint64_t>,
+    std::equal_to<uint64_t>,
+    CountingAllocator<uint8_t>>;
+using Dynamic = DynamicConcurrentHashMap<
+    uint64_t,
+    uint64_t,
+    std::hash<uint64_t>,
+    std::equal_to<uint64_t>,
+    CountingAllocator<uint8_t>>;
+
+// Returns the bytes per key of a map of keys keys, and its shard count.
+template <typename Map>
+std::pair<double, size_t> footprint(size_t keys) {
+  auto before = allocatedBytes.load();
+  Map map;
+  for (uint64_t i = 0; i < keys; ++i) {
+    map.insert(i, i);
+  }
+  // Reclaims what the map retired; tagged objects that can be reclaimed go
+  // back to the map, which frees them on its next retire.
+  hazptr_cleanup();
+  for (int i = 0; i < 2; ++i) {
+    map.erase(0);
+    map.insert(0, 0);
+  }
+  double bytes = allocatedBytes.load() - before;
+  if constexpr (std::is_same_v<Map, Dynamic>) {
+    return {bytes / keys, map.shard_count()};
+  } else {
+    return {bytes / keys, 256};
+  }
+}
+
+void printFootprint() {
+  std::printf(
+      "%12s %18s %18s %14s\n",
+      "keys",
+      "fixed bytes/key",
+      "dynamic bytes/key",
+      "dynamic shards");
+  for (size_t keys = 1000; keys <= FLAGS_max_keys; keys *= 10) {
+    auto fixed = footprint<Fixed>(keys);
+    auto dynamic = footprint<Dynamic>(keys);
+    std::printf(
+        "%12zu %18.1f %18.1f %14zu\n",
+        keys,
+        fixed.first,
+        dynamic.first,
+        dynamic.second);
+  }
+}
+
+template <typename Fn>
+void runThreads(Fn fn) {
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < FLAGS_threads; ++t) {
+    threads.emplace_back([&fn, t] { fn(t); });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+template <typename Map>
+void overwrite(size_t iters, size_t keys) {
+  BenchmarkSuspender suspender;
+  auto map = std::make_unique<Map>(keys);
+  for (uint64_t i = 0; i < keys; ++i) {
+    map->insert(i, i);
+  }
+  suspender.dismiss();
+
+  runThreads([&](size_t t) {
+    std::minstd_rand rng(t);
+    for (size_t i = t; i < iters; i += FLAGS_threads) {
+      map->insert_or_assign(rng() % keys, i);
+    }
+  });
+
+  suspender.rehire();
+  map.reset();
+}
+
+void overwriteFixed(size_t iters, size_t keys) {
+  overwrite<Fixed>(iters, keys);
+}
+
+void overwriteDynamic(size_t iters, size_t keys) {
+  overwrite<Dynamic>(iters, keys);
+}
+
+template <typename Map>
+void fill(size_t iters) {
+  BenchmarkSuspender suspender;
+  auto map = std::make_unique<Map>();
+  suspender.dismiss();
+
+  runThreads([&](size_t t) {
+    for (uint64_t i = t; i < iters; i += FLAGS_threads) {
+      map->insert(i, i);
+    }
+  });
+
+  suspender.rehire();
+  map.reset();
+}
+
+} // namespace
+
+BENCHMARK_NAMED_PARAM(overwriteFixed, 1K, 1000)
+BENCHMARK_RELATIVE_NAMED_PARAM(overwriteDynamic, 1K, 1000)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_NAMED_PARAM(overwriteFixed, 64K, 64 * 1000)
+BENCHMARK_RELATIVE_NAMED_PARAM(overwriteDynamic, 64K, 64 * 1000)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_NAMED_PARAM(overwriteFixed, 4M, 4 * 1000 * 1000)
+BENCHMARK_RELATIVE_NAMED_PARAM(overwriteDynamic, 4M, 4 * 1000 * 1000)
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(fillFixed, iters) {
+  fill<Fixed>(iters);
+}
+
+BENCHMARK_RELATIVE(fillDynamic, iters) {
+  fill<Dynamic>(iters);
+}
+
+int main(int argc, char** argv) {
+  folly::gflags::ParseCommandLineFlags(&argc, &argv, true);
+  printFootprint();
+  folly::runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,318 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/concurrency/DynamicConcurrentHashMap.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+
+template <typename T>
+class DynamicConcurrentHashMapTest : public ::testing::Test {};
+TYPED_TEST_SUITE_P(DynamicConcurrentHashMapTest);
+
+template <template <
+    typename,
+    typename,
+    uint8_t,
+    typename,
+    typename,
+    typename,
+    template <typename> class,
+    class> class Impl>
+struct MapFactory {
+  template <typename KeyType, typename ValueType>
+  using MapT = DynamicConcurrentHashMap<
+      KeyType,
+      ValueType,
+      std::hash<KeyType>,
+      std::equal_to<KeyType>,
+      std::allocator<uint8_t>,
+      std::atomic,
+      std::mutex,
+      Impl>;
+};
+
+#define DCHM typename TypeParam::template MapT
+
+namespace {
+constexpr size_t kSplit = DynamicConcurrentHashMap<int, int>::kShardSplitSize;
+} // namespace
+
+TYPED_TEST_P(DynamicConcurrentHashMapTest, MapTest) {
+  DCHM<uint64_t, uint64_t> map;
+  EXPECT_TRUE(map.empty());
+  EXPECT_EQ(map.find(1), map.cend());
+  EXPECT_TRUE(map.insert(1, 0).second);
+  EXPECT_FALSE(map.insert(1, 1).second);
+  EXPECT_EQ(0, map.find(1)->second);
+  EXPECT_TRUE(map.insert_or_assign(1, 2).second);
+  EXPECT_EQ(2, map.at(1));
+  EXPECT_FALSE(map.assign(2, 0).has_value());
+  EXPECT_EQ(3, map.assign_if_equal(1, 2, 3).value()->second);
+  EXPECT_FALSE(map.assign_if_equal(1, 2, 4).has_value());
+  EXPECT_TRUE(map.try_emplace(2, 5).second);
+  EXPECT_TRUE(map.emplace(3, 6).second);
+  EXPECT_EQ(3, map.size());
+  EXPECT_EQ(0, map.erase_if_equal(3, 7));
+  EXPECT_EQ(1, map.erase(3));
+  EXPECT_EQ(0, map.erase(3));
+  EXPECT_EQ(2, map.size());
+  EXPECT_THROW(map.at(3), std::out_of_range);
+  map.clear();
+  EXPECT_TRUE(map.empty());
+  EXPECT_EQ(1, map.shard_count());
+}
+
+TYPED_TEST_P(DynamicConcurrentHashMapTest, StringKeys) {
+  DCHM<std::string, std::string> map;
+  for (size_t i = 0; i < 4 * kSplit; ++i) {
+    map.insert(std::to_string(i), std::to_string(i * 2));
+  }
+  EXPECT_GT(map.shard_count(), 1);
+  for (size_t i = 0; i < 4 * kSplit; ++i) {
+    auto it = map.find(std::to_string(i));
+    ASSERT_NE(it, map.cend());
+    EXPECT_EQ(std::to_string(i * 2), it->second);
+  }
+}
+
+TYPED_TEST_P(DynamicConcurrentHashMapTest, SplitAndMerge) {
+  DCHM<uint64_t, uint64_t> map;
+  EXPECT_EQ(1, map.shard_count());
+  constexpr size_t kSize = 16 * kSplit;
+  for (uint64_t i = 0; i < kSize; ++i) {
+    map.insert(i, i);
+  }
+  EXPECT_EQ(kSize, map.size());
+  EXPECT_GE(map.shard_count(), 8);
+  for (uint64_t i = 0; i < kSize; ++i) {
+    auto it = map.find(i);
+    ASSERT_NE(it, map.cend());
+    EXPECT_EQ(i, it->second);
+  }
+  for (uint64_t i = 0; i < kSize; ++i) {
+    EXPECT_EQ(1, map.erase(i));
+  }
+  EXPECT_TRUE(map.empty());
+  EXPECT_EQ(1, map.shard_count());
+}
+
+TYPED_TEST_P(DynamicConcurrentHashMapTest, ShardLimits) {
+  DCHM<uint64_t, uint64_t> map(8, 4, 8);
+  EXPECT_EQ(4, map.shard_count());
+  for (uint64_t i = 0; i < 64 * kSplit; ++i) {
+    map.insert(i, i);
+  }
+  EXPECT_EQ(8, map.shard_count());
+  for (uint64_t i = 0; i < 64 * kSplit; ++i) {
+    map.erase(i);
+  }
+  EXPECT_EQ(4, map.shard_count());
+}
+
+TYPED_TEST_P(DynamicConcurrentHashMapTest, Reserve) {
+  DCHM<uint64_t, uint64_t> map;
+  map.insert(1, 1);
+  map.reserve(64 * kSplit);
+  EXPECT_GE(map.shard_count(), 64);
+  EXPECT_EQ(1, map.find(1)->second);
+  DCHM<uint64_t, uint64_t> sized(64 * kSplit);
+  EXPECT_EQ(map.shard_count(), sized.shard_count());
+}
+
+TYPED_TEST_P(DynamicConcurrentHashMapTest, Iterate) {
+  DCHM<uint64_t, uint64_t> map;
+  constexpr size_t kSize = 8 * kSplit;
+  for (uint64_t i = 0; i < kSize; ++i) {
+    map.insert(i, i);
+  }
+  std::unordered_set<uint64_t> seen;
+  for (auto it = map.cbegin(); it != map.cend(); ++it) {
+    EXPECT_TRUE(seen.insert(it->first).second);
+  }
+  EXPECT_EQ(kSize, seen.size());
+  for (auto it = map.cbegin(); it != map.cend();) {
+    it = map.erase(it);
+  }
+  EXPECT_TRUE(map.empty());
+}
+
+// Erasing through an iterator whose shard was split since goes on in the
+// moved shard, while the erasures merge the halves back.
+TYPED_TEST_P(DynamicConcurrentHashMapTest, EraseAfterSplit) {
+  DCHM<uint64_t, uint64_t> map;
+  for (uint64_t i = 0; i < kSplit; ++i) {
+    map.insert(i, i);
+  }
+  EXPECT_EQ(1, map.shard_count());
+  auto it = map.cbegin();
+  map.insert(kSplit, kSplit);
+  EXPECT_EQ(2, map.shard_count());
+  std::unordered_set<uint64_t> erased;
+  while (it != map.cend()) {
+    EXPECT_TRUE(erased.insert(it->first).second) << it->first;
+    it = map.erase(it);
+  }
+  // The iteration may or may not see the last insertion.
+  for (uint64_t i = 0; i < kSplit; ++i) {
+    EXPECT_EQ(1, erased.count(i)) << i;
+  }
+  EXPECT_EQ(erased.count(kSplit) ? 0 : 1, map.size());
+  EXPECT_EQ(1, map.shard_count());
+}
+
+// A find() concurrent with resizes finds every element that is in the map
+// throughout.
+TYPED_TEST_P(DynamicConcurrentHashMapTest, FindWhileResizing) {
+  DCHM<uint64_t, uint64_t> map;
+  constexpr uint64_t kStable = 4 * kSplit;
+  for (uint64_t i = 0; i < kStable; ++i) {
+    map.insert(i, i);
+  }
+  std::atomic<bool> stop{false};
+  std::thread writer([&] {
+    while (!stop.load()) {
+      for (uint64_t i = 0; i < 16 * kSplit; ++i) {
+        map.insert(kStable + i, i);
+      }
+      for (uint64_t i = 0; i < 16 * kSplit; ++i) {
+        map.erase(kStable + i);
+      }
+    }
+  });
+  for (int round = 0; round < 20; ++round) {
+    for (uint64_t i = 0; i < kStable; ++i) {
+      auto found = map.find(i);
+      EXPECT_TRUE(found != map.cend() && found->second == i) << i;
+    }
+  }
+  stop = true;
+  writer.join();
+}
+
+// An iteration concurrent with resizes sees every element that is in the
+// map throughout, and none twice.
+TYPED_TEST_P(DynamicConcurrentHashMapTest, IterateWhileResizing) {
+  DCHM<uint64_t, uint64_t> map;
+  constexpr uint64_t kStable = 4 * kSplit;
+  for (uint64_t i = 0; i < kStable; ++i) {
+    map.insert(i, i);
+  }
+  std::atomic<bool> stop{false};
+  std::thread writer([&] {
+    // Grows and shrinks the map with keys that are not checked.
+    while (!stop.load()) {
+      for (uint64_t i = 0; i < 16 * kSplit; ++i) {
+        map.insert(kStable + i, i);
+      }
+      for (uint64_t i = 0; i < 16 * kSplit; ++i) {
+        map.erase(kStable + i);
+      }
+    }
+  });
+  for (int round = 0; round < 20; ++round) {
+    std::unordered_set<uint64_t> seen;
+    for (auto it = map.cbegin(); it != map.cend(); ++it) {
+      EXPECT_TRUE(seen.insert(it->first).second) << it->first;
+    }
+    for (uint64_t i = 0; i < kStable; ++i) {
+      EXPECT_EQ(1, seen.count(i)) << i;
+    }
+  }
+  stop = true;
+  writer.join();
+}
+
+TYPED_TEST_P(DynamicConcurrentHashMapTest, ConcurrentWrites) {
+  DCHM<uint64_t, uint64_t> map;
+  constexpr size_t kThreads = 4;
+  constexpr uint64_t kPerThread = 8 * kSplit;
+  constexpr uint64_t kOld = 64;
+  for (uint64_t i = 0; i < kOld; ++i) {
+    map.insert(kThreads * kPerThread + i, 0);
+  }
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&, t] {
+      for (uint64_t i = t; i < kThreads * kPerThread; i += kThreads) {
+        EXPECT_TRUE(map.insert(i, i).second);
+        // Keys are found right after their insert, and stay found while
+        // shards are moved.
+        auto it = map.find(i);
+        ASSERT_NE(it, map.cend());
+        EXPECT_EQ(i, it->second);
+      }
+      for (uint64_t i = t; i < kThreads * kPerThread; i += kThreads) {
+        EXPECT_EQ(i + 1, map.assign(i, i + 1).value()->second);
+      }
+    });
+  }
+  // Readers never miss the keys that were there before, while their shards
+  // are moved.
+  std::thread reader([&] {
+    for (int round = 0; round < 1000; ++round) {
+      for (uint64_t i = 0; i < kOld; ++i) {
+        EXPECT_NE(map.find(kThreads * kPerThread + i), map.cend());
+      }
+    }
+  });
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  reader.join();
+  EXPECT_EQ(kThreads * kPerThread + kOld, map.size());
+  for (uint64_t i = 0; i < kThreads * kPerThread; ++i) {
+    EXPECT_EQ(i + 1, map.at(i));
+  }
+}
+
+REGISTER_TYPED_TEST_SUITE_P(
+    DynamicConcurrentHashMapTest,
+    MapTest,
+    StringKeys,
+    SplitAndMerge,
+    ShardLimits,
+    Reserve,
+    Iterate,
+    EraseAfterSplit,
+    FindWhileResizing,
+    IterateWhileResizing,
+    ConcurrentWrites);
+
+using folly::detail::concurrenthashmap::bucket::BucketTable;
+
+#if (                                                        \
+    FOLLY_SSE_PREREQ(4, 2) ||                                \
+    (FOLLY_AARCH64 && FOLLY_F14_CRC_INTRINSIC_AVAILABLE)) && \
+    FOLLY_F14_VECTOR_INTRINSICS_AVAILABLE
+using folly::detail::concurrenthashmap::simd::SIMDTable;
+using MapFactoryTypes =
+    ::testing::Types<MapFactory<BucketTable>, MapFactory<SIMDTable>>;
+#else
+using MapFactoryTypes = ::testing::Types<MapFactory<BucketTable>>;
+#endif
+
+INSTANTIATE_TYPED_TEST_SUITE_P(
+    MapFactoryTypesInstantiation,
+    DynamicConcurrentHashMapTest,
+    MapFactoryTypes);
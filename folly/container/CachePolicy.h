@@ -0,0 +1,288 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include <folly/hash/Hash.h>
+#include <folly/lang/Bits.h>
+
+/**
+ * Admission and eviction policies for the folly cache maps
+ * (EvictingCacheMap, the WeightedEvictingCacheMap family and
+ * GenerationalCacheMap), passed as their TPolicy template parameter.
+ *
+ * A policy sees keys only as hashes, and answers two questions for its cache:
+ * which of two entries is more worth keeping, and whether an entry is worth
+ * admitting at all. A policy provides:
+ *
+ *   // Whether the cache should split its entries into a small admission
+ *   // window and a main segment (W-TinyLFU). LRU order within each.
+ *   static constexpr bool kSegmented;
+ *
+ *   // Whether the policy ever tracks or rejects entries. Caches skip every
+ *   // call into a policy that does not, so that it costs nothing.
+ *   static constexpr bool kAdmits;
+ *
+ *   // Number of entries the policy should be sized for. Called with the
+ *   // configured capacity, and with the current size by caches without a
+ *   // fixed one; only ever grows the policy's state.
+ *   void reserve(std::size_t entries);
+ *
+ *   // A hit on, or an insertion of, the key with this hash.
+ *   void recordAccess(std::size_t hash);
+ *
+ *   // Whether `candidate` should displace `victim` from the main segment.
+ *   bool admit(std::size_t candidate, std::size_t victim);
+ *
+ *   // For caches that have no single victim to compare against: whether a
+ *   // new entry is frequent enough to be stored at all.
+ *   bool admit(std::size_t candidate);
+ *
+ *   // Size of the admission window for a cache of `entries` entries.
+ *   std::size_t windowSize(std::size_t entries) const;
+ *
+ * recordAccess() and both admit() overloads may be called concurrently (from
+ * GenerationalCacheMap); reserve() may not.
+ */
+
+namespace folly {
+
+/**
+ * Plain LRU: every entry is admitted and the least recently used is evicted.
+ * The default, and free: caches compile away every call into it.
+ */
+struct LruCachePolicy {
+  static constexpr bool kSegmented = false;
+  static constexpr bool kAdmits = false;
+
+  void reserve(std::size_t) noexcept {}
+  void recordAccess(std::size_t) noexcept {}
+  bool admit(std::size_t, std::size_t) const noexcept { return true; }
+  bool admit(std::size_t) const noexcept { return true; }
+  std::size_t windowSize(std::size_t) const noexcept { return 0; }
+};
+
+/**
+ * An approximate, aging frequency counter: a Count-Min sketch of 4-bit
+ * counters (after Caffeine's FrequencySketch).
+ *
+ * Counters are packed 16 to a 64-bit word and the 4 counters for a key all sit
+ * in one 64-byte block, so each operation touches a single cache line. Counts
+ * saturate at 15. After 10 increments per reserved entry, every counter is
+ * halved, so the sketch reflects recent rather than all-time popularity.
+ *
+ * Increments are relaxed loads and stores rather than read-modify-writes, so
+ * concurrent increments of the same counter can be lost. That is harmless for
+ * an estimate that is approximate anyway, and keeps the sketch cheap enough to
+ * share between threads.
+ */
+class FrequencySketch {
+ public:
+  static constexpr uint8_t kMaxFrequency = 15;
+
+  FrequencySketch() = default;
+  explicit FrequencySketch(std::size_t entries) { reserve(entries); }
+
+  FrequencySketch(FrequencySketch&& that) noexcept { *this = std::move(that); }
+  FrequencySketch& operator=(FrequencySketch&& that) noexcept {
+    table_ = std::move(that.table_);
+    numBlocks_ = std::exchange(that.numBlocks_, 0);
+    sampleSize_ = std::exchange(that.sampleSize_, 0);
+    additions_.store(
+        that.additions_.exchange(0, std::memory_order_relaxed),
+        std::memory_order_relaxed);
+    return *this;
+  }
+
+  /**
+   * Size the sketch for `entries` keys; never shrinks. Not thread-safe.
+   *
+   * Growing keeps the current estimates: a key's block is chosen by the low
+   * bits of its hash, so each new block starts as a copy of the old block
+   * that the same keys mapped to. Counts shared by the keys that the wider
+   * table now separates stay inflated until they age out.
+   */
+  void reserve(std::size_t entries) {
+    entries = std::max<std::size_t>(entries, 1);
+    auto blocks = nextPowTwo((entries + kWordsPerBlock - 1) / kWordsPerBlock);
+    if (blocks <= numBlocks_) {
+      return;
+    }
+    auto oldWords = numBlocks_ * kWordsPerBlock;
+    auto table =
+        std::make_unique<std::atomic<uint64_t>[]>(blocks * kWordsPerBlock);
+    for (std::size_t i = 0; i < blocks * kWordsPerBlock; ++i) {
+      table[i].store(
+          oldWords ? table_[i % oldWords].load(std::memory_order_relaxed) : 0,
+          std::memory_order_relaxed);
+    }
+    table_ = std::move(table);
+    numBlocks_ = blocks;
+    sampleSize_ = 10 * std::max(entries, blocks * kWordsPerBlock);
+  }
+
+  bool empty() const noexcept { return numBlocks_ == 0; }
+
+  /** Estimated number of recent occurrences of `hash`, at most 15. */
+  uint8_t estimate(std::size_t hash) const noexcept {
+    if (empty()) {
+      return 0;
+    }
+    auto slots = locate(hash);
+    uint8_t freq = kMaxFrequency;
+    for (int i = 0; i < 4; ++i) {
+      auto word = table_[slots.word[i]].load(std::memory_order_relaxed);
+      freq = std::min(freq, counterAt(word, slots.shift[i]));
+    }
+    return freq;
+  }
+
+  /** Count one occurrence of `hash`. */
+  void increment(std::size_t hash) noexcept {
+    if (empty()) {
+      return;
+    }
+    auto slots = locate(hash);
+    bool added = false;
+    for (int i = 0; i < 4; ++i) {
+      auto& cell = table_[slots.word[i]];
+      auto word = cell.load(std::memory_order_relaxed);
+      if (counterAt(word, slots.shift[i]) < kMaxFrequency) {
+        cell.store(
+            word + (uint64_t{1} << slots.shift[i]), std::memory_order_relaxed);
+        added = true;
+      }
+    }
+    if (added) {
+      // Not a fetch_add, for the same reason; a lost addition only delays
+      // aging slightly.
+      auto additions = additions_.load(std::memory_order_relaxed) + 1;
+      additions_.store(additions, std::memory_order_relaxed);
+      if (additions >= sampleSize_) {
+        age();
+      }
+    }
+  }
+
+  /** Reset every counter to zero. Not thread-safe. */
+  void clear() noexcept {
+    for (std::size_t i = 0; i < numBlocks_ * kWordsPerBlock; ++i) {
+      table_[i].store(0, std::memory_order_relaxed);
+    }
+    additions_.store(0, std::memory_order_relaxed);
+  }
+
+ private:
+  static constexpr std::size_t kWordsPerBlock = 8;
+
+  struct Slots {
+    std::size_t word[4];
+    unsigned shift[4];
+  };
+
+  static uint8_t counterAt(uint64_t word, unsigned shift) noexcept {
+    return static_cast<uint8_t>((word >> shift) & 0xf);
+  }
+
+  // Picks the block from the low half of the mixed hash and, from the high
+  // half, one counter in each of the 4 word pairs of that block.
+  Slots locate(std::size_t hash) const noexcept {
+    uint64_t h = hash::twang_mix64(hash);
+    auto block = (h & (numBlocks_ - 1)) * kWordsPerBlock;
+    auto bits = static_cast<uint32_t>(h >> 32);
+    Slots slots;
+    for (unsigned i = 0; i < 4; ++i) {
+      unsigned b = bits >> (i * 8);
+      slots.word[i] = block + i * 2 + (b & 1);
+      slots.shift[i] = ((b >> 1) & 0xf) * 4;
+    }
+    return slots;
+  }
+
+  // Halves every counter. Racing increments may be lost, as above.
+  void age() noexcept {
+    for (std::size_t i = 0; i < numBlocks_ * kWordsPerBlock; ++i) {
+      auto word = table_[i].load(std::memory_order_relaxed);
+      table_[i].store(
+          (word >> 1) & 0x7777777777777777ULL, std::memory_order_relaxed);
+    }
+    additions_.store(sampleSize_ / 2, std::memory_order_relaxed);
+  }
+
+  std::unique_ptr<std::atomic<uint64_t>[]> table_;
+  std::size_t numBlocks_{0};
+  std::size_t sampleSize_{0};
+  std::atomic<std::size_t> additions_{0};
+};
+
+/**
+ * W-TinyLFU (Einziger, Friedman and Manes, "TinyLFU: A Highly Efficient Cache
+ * Admission Policy"). New entries go into a small LRU window, which absorbs
+ * bursts of recency; an entry leaving the window only enters the main segment
+ * if the frequency sketch says it is more popular than the main segment's LRU
+ * victim. A one-pass scan therefore flows through the window without
+ * displacing the established working set.
+ *
+ * @param windowPercent share of the cache given to the window. 1% is the
+ *     usual choice; raise it for recency-heavy workloads.
+ * @param minAdmitFrequency threshold for admit(candidate), used by caches
+ *     that cannot name a victim: 2 admits a key on its second recent miss.
+ */
+class TinyLfuCachePolicy {
+ public:
+  static constexpr bool kSegmented = true;
+  static constexpr bool kAdmits = true;
+
+  explicit TinyLfuCachePolicy(
+      unsigned windowPercent = 1, uint8_t minAdmitFrequency = 2)
+      : windowPercent_(std::min(windowPercent, 100u)),
+        minAdmitFrequency_(minAdmitFrequency) {}
+
+  void reserve(std::size_t entries) { sketch_.reserve(entries); }
+
+  void recordAccess(std::size_t hash) noexcept { sketch_.increment(hash); }
+
+  // Ties go to the victim: displacing an equally popular entry only churns.
+  bool admit(std::size_t candidate, std::size_t victim) const noexcept {
+    return sketch_.estimate(candidate) > sketch_.estimate(victim);
+  }
+
+  bool admit(std::size_t candidate) const noexcept {
+    return sketch_.estimate(candidate) >= minAdmitFrequency_;
+  }
+
+  // Never empty: the window always holds at least the most recent entry, so
+  // an insertion cannot evict the entry it just inserted.
+  std::size_t windowSize(std::size_t entries) const noexcept {
+    return std::max<std::size_t>(entries * windowPercent_ / 100, 1);
+  }
+
+  const FrequencySketch& sketch() const noexcept { return sketch_; }
+
+ private:
+  FrequencySketch sketch_;
+  unsigned windowPercent_;
+  uint8_t minAdmitFrequency_;
+};
+
+} // namespace folly
@@ -0,0 +1,522 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <folly/concurrency/ConcurrentHashMap.h>
+#include <folly/container/HeterogeneousAccess.h>
+#include <folly/hash/Hash.h>
+#include <folly/lang/Align.h>
+#include <folly/lang/Bits.h>
+#include <folly/lang/Exception.h>
+
+namespace folly {
+
+/**
+ * A concurrent, bounded cache with CLOCK (second chance) eviction and
+ * lock-free lookups. It is meant as a drop-in for the common pattern of
+ * wrapping an EvictingCacheMap in Synchronized<>, where every hit takes an
+ * exclusive lock only to reorder the LRU list.
+ *
+ * Entries are stored in a single ConcurrentHashMap, so lookups are protected
+ * by hazard pointers and take no lock. Recency is tracked with one reference
+ * bit per entry instead of a list: a hit sets the bit (and only writes it if it
+ * was clear, so a hot entry costs readers no shared writes at all), and the
+ * eviction sweep gives each referenced entry a second chance by clearing the
+ * bit and moving it to the back of the queue. The bit lives in a small record
+ * shared by the entry and the eviction queue, so the sweep can skip referenced
+ * entries without a hash map lookup each.
+ *
+ * The eviction queues are sharded by key hash. Each shard owns a FIFO of the
+ * keys it admitted, a mutex that serializes its writers, and its share of
+ * `maxSize`. Writers of different shards never contend with each other, and
+ * writers never block readers.
+ *
+ * Differences from EvictingCacheMap:
+ *  - Eviction is approximately LRU, and is done per shard: the cache as a
+ *    whole may evict an entry while a less recently used one in another shard
+ *    survives. Each shard holds at most ceil(maxSize / numShards) entries, so
+ *    with maxSize smaller than the shard count the effective bound is the
+ *    shard count.
+ *  - Lookups return a ConstRef that keeps the entry alive (like a
+ *    ConcurrentHashMap::ConstIterator), or a copy via get(); there is no
+ *    iteration in recency order.
+ *  - TValue must be copy-constructible: a prune or erase hook receives a copy
+ *    of the value, since concurrent readers may still hold the entry, and
+ *    whether a hook is set is only known at runtime.
+ *
+ * Prune hooks have the same signature and semantics as EvictingCacheMap's
+ * PruneHookCall: they are invoked for evictions, not for erase() nor at
+ * destruction. They run on the thread whose insertion caused the eviction,
+ * after the shard lock has been released, once per evicted entry.
+ *
+ * NOTE: maxSize==0 disables automatic evictions, as for EvictingCacheMap.
+ */
+template <
+    class TKey,
+    class TValue,
+    class THash = HeterogeneousAccessHash<TKey>,
+    class TKeyEqual = HeterogeneousAccessEqualTo<TKey>>
+class ConcurrentEvictingCacheMap {
+  static_assert(
+      std::is_copy_constructible_v<TValue>,
+      "ConcurrentEvictingCacheMap hands evicted values to hooks by copy");
+
+ private:
+  struct Entry;
+  using Map = ConcurrentHashMap<TKey, Entry, THash, TKeyEqual>;
+
+ public:
+  using PruneHookCall = std::function<void(TKey, TValue&&)>;
+
+  using key_type = TKey;
+  using mapped_type = TValue;
+  using hasher = THash;
+
+  static constexpr std::size_t kDefaultNumShards = 64;
+
+  /**
+   * A found value, kept alive for as long as the ConstRef is held. Converts to
+   * false if the key was absent.
+   */
+  class ConstRef {
+   public:
+    ConstRef(ConstRef&&) = default;
+    ConstRef& operator=(ConstRef&&) = default;
+    ConstRef(const ConstRef&) = delete;
+    ConstRef& operator=(const ConstRef&) = delete;
+
+    explicit operator bool() const { return value_ != nullptr; }
+    const TValue& operator*() const { return *value_; }
+    const TValue* operator->() const { return value_; }
+    const TValue* get() const { return value_; }
+
+   private:
+    friend class ConcurrentEvictingCacheMap;
+
+    ConstRef(typename Map::ConstIterator it, const TValue* value)
+        : it_(std::move(it)), value_(value) {}
+
+    // Holds the hazard pointer protecting the node behind value_.
+    typename Map::ConstIterator it_;
+    const TValue* value_;
+  };
+
+  /**
+   * Construct a ConcurrentEvictingCacheMap
+   * @param maxSize approximate maximum number of entries, spread evenly over
+   *     the shards. 0 disables automatic eviction.
+   * @param numShards number of eviction shards, rounded up to a power of two.
+   *     More shards reduce writer contention at the cost of eviction accuracy.
+   */
+  explicit ConcurrentEvictingCacheMap(
+      std::size_t maxSize, std::size_t numShards = kDefaultNumShards)
+      : shardMask_(nextPowTwo(std::max<std::size_t>(numShards, 1)) - 1),
+        shards_(std::make_unique<Shard[]>(shardMask_ + 1)),
+        map_(std::max<std::size_t>(maxSize, 8)),
+        maxSize_(maxSize) {}
+
+  ConcurrentEvictingCacheMap(const ConcurrentEvictingCacheMap&) = delete;
+  ConcurrentEvictingCacheMap& operator=(const ConcurrentEvictingCacheMap&) =
+      delete;
+  ConcurrentEvictingCacheMap(ConcurrentEvictingCacheMap&&) = delete;
+  ConcurrentEvictingCacheMap& operator=(ConcurrentEvictingCacheMap&&) = delete;
+
+  /**
+   * Adjust the max size, evicting as needed to ensure the new max is not
+   * exceeded. 0 removes the limit.
+   * @param pruneHook eviction callback to use INSTEAD OF the configured one
+   */
+  void setMaxSize(std::size_t maxSize, PruneHookCall pruneHook = nullptr) {
+    maxSize_.store(maxSize, std::memory_order_relaxed);
+    if (maxSize == 0) {
+      return;
+    }
+    auto cap = shardCapacity(maxSize);
+    for (std::size_t i = 0; i <= shardMask_; ++i) {
+      auto& shard = shards_[i];
+      Evicted evicted;
+      PruneHookCall hook;
+      {
+        std::lock_guard<std::mutex> g(shard.mutex);
+        if (shard.size > cap) {
+          hook = pruneHook ? pruneHook : shard.pruneHook;
+          evictLocked(shard, shard.size - cap, !!hook, evicted);
+        }
+      }
+      invokeHook(hook, evicted);
+    }
+  }
+
+  std::size_t getMaxSize() const {
+    return maxSize_.load(std::memory_order_relaxed);
+  }
+
+  std::size_t numShards() const { return shardMask_ + 1; }
+
+  /**
+   * Check for existence of a specific key. This operation has no effect on
+   * eviction order.
+   */
+  bool exists(const TKey& key) const { return map_.find(key) != map_.cend(); }
+
+  /**
+   * Get the value associated with a specific key, marking it recently used.
+   * Takes no lock.
+   * @return a ConstRef to the value, empty if the key does not exist
+   */
+  ConstRef find(const TKey& key) const {
+    auto it = map_.find(key);
+    if (it == map_.cend()) {
+      return ConstRef(std::move(it), nullptr);
+    }
+    it->second.touch();
+    const auto* value = &it->second.value;
+    return ConstRef(std::move(it), value);
+  }
+
+  /**
+   * Get the value associated with a specific key without marking it recently
+   * used.
+   */
+  ConstRef findWithoutPromotion(const TKey& key) const {
+    auto it = map_.find(key);
+    const auto* value = it == map_.cend() ? nullptr : &it->second.value;
+    return ConstRef(std::move(it), value);
+  }
+
+  /**
+   * Get a copy of the value associated with a specific key, marking it
+   * recently used.
+   * @throw std::out_of_range exception of the key does not exist
+   */
+  TValue get(const TKey& key) const {
+    auto ref = find(key);
+    if (!ref) {
+      throw_exception<std::out_of_range>("Key does not exist");
+    }
+    return *ref;
+  }
+
+  /**
+   * Set a key-value pair in the cache
+   * @param promote whether an existing entry should be marked recently used
+   * @param pruneHook eviction callback to use INSTEAD OF the configured one
+   */
+  void set(
+      const TKey& key,
+      TValue value,
+      bool promote = true,
+      PruneHookCall pruneHook = nullptr) {
+    auto& shard = shardFor(key);
+    Evicted evicted;
+    PruneHookCall hook = std::move(pruneHook);
+    {
+      std::lock_guard<std::mutex> g(shard.mutex);
+      auto it = map_.find(key);
+      if (it != map_.cend()) {
+        // Writers of this key are serialized by the shard lock, so the entry
+        // cannot change under us; readers keep seeing the old value until the
+        // replacement is published. The replacement shares the clock slot, so
+        // it keeps its place in the eviction order.
+        auto slot = it->second.slot;
+        if (promote) {
+          slot->touch();
+        }
+        map_.assign(key, Entry(std::move(slot), std::move(value)));
+        return;
+      }
+      admitLocked(shard, key, std::move(value));
+      evictExcessLocked(shard, hook || shard.pruneHook, evicted);
+      // Only copy the shard's hook when there is something to report.
+      if (!hook && !evicted.empty()) {
+        hook = shard.pruneHook;
+      }
+    }
+    invokeHook(hook, evicted);
+  }
+
+  /**
+   * Insert a new key-value pair if no element exists for key
+   * @param pruneHook eviction callback to use INSTEAD OF the configured one
+   * @return whether the insertion took place
+   */
+  bool insert(
+      const TKey& key, TValue value, PruneHookCall pruneHook = nullptr) {
+    auto& shard = shardFor(key);
+    Evicted evicted;
+    PruneHookCall hook = std::move(pruneHook);
+    {
+      std::lock_guard<std::mutex> g(shard.mutex);
+      if (map_.find(key) != map_.cend()) {
+        return false;
+      }
+      admitLocked(shard, key, std::move(value));
+      evictExcessLocked(shard, hook || shard.pruneHook, evicted);
+      // Only copy the shard's hook when there is something to report.
+      if (!hook && !evicted.empty()) {
+        hook = shard.pruneHook;
+      }
+    }
+    invokeHook(hook, evicted);
+    return true;
+  }
+
+  /**
+   * Erase the key-value pair associated with key if it exists. Prune hook is
+   * not called unless one passed in here.
+   * @return true if the key existed and was erased, else false
+   */
+  bool erase(const TKey& key, PruneHookCall eraseHook = nullptr) {
+    auto& shard = shardFor(key);
+    Evicted evicted;
+    {
+      std::lock_guard<std::mutex> g(shard.mutex);
+      auto it = map_.find(key);
+      if (it == map_.cend()) {
+        return false;
+      }
+      if (eraseHook) {
+        evicted.emplace_back(key, it->second.value);
+      }
+      // The key's slot is left in the clock as a tombstone, which the sweep
+      // skips; compact once they outnumber live entries so that erase-heavy
+      // workloads without evictions do not grow the queue.
+      it->second.slot->live = false;
+      map_.erase(key);
+      shrinkLocked(shard);
+      if (shard.clock.size() > 2 * shard.size + 16) {
+        compactLocked(shard);
+      }
+    }
+    invokeHook(eraseHook, evicted);
+    return true;
+  }
+
+  /**
+   * Evict up to pruneSize entries, spread over the shards.
+   * @param pruneHook eviction callback to use INSTEAD OF the configured one
+   */
+  void prune(std::size_t pruneSize, PruneHookCall pruneHook = nullptr) {
+    auto n = numShards();
+    for (std::size_t i = 0; i < n && pruneSize > 0; ++i) {
+      auto& shard = shards_[i];
+      // Spread the remainder so that a small pruneSize still touches the
+      // shards that hold entries.
+      auto share = std::max<std::size_t>(pruneSize / (n - i), 1);
+      Evicted evicted;
+      PruneHookCall hook;
+      {
+        std::lock_guard<std::mutex> g(shard.mutex);
+        hook = pruneHook ? pruneHook : shard.pruneHook;
+        evictLocked(shard, std::min(share, shard.size), !!hook, evicted);
+        pruneSize -= std::min(pruneSize, share);
+      }
+      invokeHook(hook, evicted);
+    }
+  }
+
+  /**
+   * Remove all entries (as if all evicted)
+   * @param pruneHook eviction callback to use INSTEAD OF the configured one
+   */
+  void clear(PruneHookCall pruneHook = nullptr) {
+    for (std::size_t i = 0; i <= shardMask_; ++i) {
+      auto& shard = shards_[i];
+      Evicted evicted;
+      PruneHookCall hook;
+      {
+        std::lock_guard<std::mutex> g(shard.mutex);
+        hook = pruneHook ? pruneHook : shard.pruneHook;
+        evictLocked(shard, shard.size, !!hook, evicted);
+      }
+      invokeHook(hook, evicted);
+    }
+  }
+
+  /**
+   * Set the prune hook on every shard. Evictions already collected by a
+   * concurrent writer may still be reported to the previous hook.
+   */
+  void setPruneHook(PruneHookCall pruneHook) {
+    for (std::size_t i = 0; i <= shardMask_; ++i) {
+      std::lock_guard<std::mutex> g(shards_[i].mutex);
+      shards_[i].pruneHook = pruneHook;
+    }
+  }
+
+  PruneHookCall getPruneHook() const {
+    std::lock_guard<std::mutex> g(shards_[0].mutex);
+    return shards_[0].pruneHook;
+  }
+
+  /** Approximate under concurrent modification. */
+  std::size_t size() const {
+    std::size_t total = 0;
+    for (std::size_t i = 0; i <= shardMask_; ++i) {
+      total += shards_[i].sizeApprox.load(std::memory_order_relaxed);
+    }
+    return total;
+  }
+
+  bool empty() const { return size() == 0; }
+
+ private:
+  // Shared between an entry (and any entry that replaces it via set()) and
+  // the shard's clock. Readers only ever write `referenced`.
+  struct Slot {
+    explicit Slot(const TKey& k) : key(k) {}
+
+    // Checking first keeps the cache line shared across readers of a hot key.
+    void touch() {
+      if (!referenced.load(std::memory_order_relaxed)) {
+        referenced.store(true, std::memory_order_relaxed);
+      }
+    }
+
+    const TKey key;
+    std::atomic<bool> referenced{false};
+    // Cleared when the entry is erased, turning the clock's reference into a
+    // tombstone; guarded by the shard mutex.
+    bool live{true};
+  };
+
+  struct Entry {
+    template <typename... Args>
+    explicit Entry(std::shared_ptr<Slot> s, Args&&... args)
+        : value(std::forward<Args>(args)...), slot(std::move(s)) {}
+
+    void touch() const { slot->touch(); }
+
+    TValue value;
+    std::shared_ptr<Slot> slot;
+  };
+
+  using Evicted = std::vector<std::pair<TKey, TValue>>;
+
+  struct alignas(hardware_destructive_interference_size) Shard {
+    mutable std::mutex mutex;
+    // Admission order, with second chances re-appended; guarded by mutex.
+    std::deque<std::shared_ptr<Slot>> clock;
+    std::size_t size{0};
+    PruneHookCall pruneHook;
+    // Mirrors size for lock-free readers of size().
+    std::atomic<std::size_t> sizeApprox{0};
+  };
+
+  Shard& shardFor(const TKey& key) {
+    return shards_[hash::twang_mix64(THash()(key)) & shardMask_];
+  }
+
+  std::size_t shardCapacity(std::size_t maxSize) const {
+    return (maxSize + shardMask_) / (shardMask_ + 1);
+  }
+
+  void admitLocked(Shard& shard, const TKey& key, TValue&& value) {
+    auto slot = std::make_shared<Slot>(key);
+    map_.try_emplace(key, slot, std::move(value));
+    shard.clock.push_back(std::move(slot));
+    ++shard.size;
+    shard.sizeApprox.store(shard.size, std::memory_order_relaxed);
+  }
+
+  void shrinkLocked(Shard& shard) {
+    --shard.size;
+    shard.sizeApprox.store(shard.size, std::memory_order_relaxed);
+  }
+
+  void evictExcessLocked(Shard& shard, bool collect, Evicted& evicted) {
+    auto maxSize = maxSize_.load(std::memory_order_relaxed);
+    if (maxSize == 0) {
+      return;
+    }
+    auto cap = shardCapacity(maxSize);
+    if (shard.size > cap) {
+      evictLocked(shard, shard.size - cap, collect, evicted);
+    }
+  }
+
+  // Runs the clock hand until `count` live entries have been evicted. Each
+  // referenced entry gets one second chance per visit; once the hand has gone
+  // around a whole lap without evicting (readers re-referencing everything as
+  // fast as it is cleared) the reference bits are ignored so the sweep ends.
+  void evictLocked(
+      Shard& shard, std::size_t count, bool collect, Evicted& evicted) {
+    std::size_t spared = 0;
+    while (count > 0 && !shard.clock.empty()) {
+      auto slot = std::move(shard.clock.front());
+      shard.clock.pop_front();
+      if (!slot->live) {
+        continue; // tombstone
+      }
+      if (spared <= shard.clock.size() &&
+          slot->referenced.exchange(false, std::memory_order_relaxed)) {
+        ++spared;
+        shard.clock.push_back(std::move(slot));
+        continue;
+      }
+      slot->live = false;
+      if (collect) {
+        auto it = map_.find(slot->key);
+        evicted.emplace_back(slot->key, it->second.value);
+        map_.erase(it);
+      } else {
+        map_.erase(slot->key);
+      }
+      shrinkLocked(shard);
+      spared = 0;
+      --count;
+    }
+  }
+
+  void compactLocked(Shard& shard) {
+    auto& clock = shard.clock;
+    clock.erase(
+        std::remove_if(
+            clock.begin(),
+            clock.end(),
+            [](const std::shared_ptr<Slot>& slot) { return !slot->live; }),
+        clock.end());
+  }
+
+  static void invokeHook(const PruneHookCall& hook, Evicted& evicted) {
+    if (!hook) {
+      return;
+    }
+    for (auto& kv : evicted) {
+      // NOTE: might throw; the remaining evicted entries are destroyed
+      // without being reported, as with EvictingCacheMap::prune.
+      hook(std::move(kv.first), std::move(kv.second));
+    }
+  }
+
+  const std::size_t shardMask_;
+  std::unique_ptr<Shard[]> shards_;
+  Map map_;
+  std::atomic<std::size_t> maxSize_;
+};
+
+} // namespace folly
@@ -25,6 +25,7 @@
 #include <boost/iterator/iterator_adaptor.hpp>
 
 #include <folly/CppAttributes.h>
+#include <folly/container/CachePolicy.h>
 #include <folly/container/F14Set.h>
 #include <folly/container/HeterogeneousAccess.h>
 #include <folly/lang/Exception.h>
@@ -59,17 +60,32 @@ namespace folly {
  *
  * NOTE: Previous versions of this structure used a hash table size that was
  * fixed at creation time, but that limitation is no longer present.
+ *
+ * Eviction policy: TPolicy (see CachePolicy.h) defaults to LruCachePolicy,
+ * which is plain LRU as described above. With a segmented policy such as
+ * TinyLfuCachePolicy (W-TinyLFU), entries are additionally split into a small
+ * admission window, which every new entry enters, and a main segment, each in
+ * LRU order. An entry pushed out of the window only displaces the main
+ * segment's LRU entry if the policy's frequency sketch rates it higher,
+ * otherwise it is the one evicted; so a scan of keys that are each used once
+ * cannot flush the frequently used ones. Iteration order is still overall
+ * recency, and the most recently used entry is still never evicted while
+ * other entries remain. Costs one extra hash per hit and insert, an extra
+ * list hook per entry, and the policy's sketch.
  */
 template <
     class TKey,
     class TValue,
     class THash = HeterogeneousAccessHash<TKey>,
-    class TKeyEqual = HeterogeneousAccessEqualTo<TKey>>
+    class TKeyEqual = HeterogeneousAccessEqualTo<TKey>,
+    class TPolicy = LruCachePolicy>
 class EvictingCacheMap {
  private:
   // typedefs for brevity
+  static constexpr bool kSegmented = TPolicy::kSegmented;
   struct Node;
   struct NodeList;
+  struct Segments;
   struct KeyHasher;
   struct KeyValueEqual;
   using NodeMap = F14VectorSet<Node*, KeyHasher, KeyValueEqual>;
@@ -115,6 +131,7 @@ class EvictingCacheMap {
   using key_type = TKey;
   using mapped_type = TValue;
   using hasher = THash;
+  using policy_type = TPolicy;
 
   /*
    * Approximate size of memory used by each entry added to the cache,
@@ -154,24 +171,35 @@ class EvictingCacheMap {
    *     maxSize, the map will begin to evict.
    * @param clearSize the number of elements to clear at a time when automatic
    *     eviction on insert is triggered.
+   * @param policy the eviction policy, e.g. a configured TinyLfuCachePolicy
    */
   explicit EvictingCacheMap(
       std::size_t maxSize,
       std::size_t clearSize = 1,
       const THash& keyHash = THash(),
-      const TKeyEqual& keyEqual = TKeyEqual())
+      const TKeyEqual& keyEqual = TKeyEqual(),
+      TPolicy policy = TPolicy())
       : keyHash_(keyHash),
         keyEqual_(keyEqual),
         index_(maxSize + /*transient*/ 1, keyHash_, keyEqual_),
         maxSize_(maxSize),
-        clearSize_(clampClearSize(clearSize)) {}
+        clearSize_(clampClearSize(clearSize)),
+        policy_(std::move(policy)) {
+    policy_.reserve(maxSize);
+  }
 
   EvictingCacheMap(const EvictingCacheMap&) = delete;
   EvictingCacheMap& operator=(const EvictingCacheMap&) = delete;
   EvictingCacheMap(EvictingCacheMap&&) = default;
   EvictingCacheMap& operator=(EvictingCacheMap&&) = default;
 
-  ~EvictingCacheMap() { assert(lru_.size() == index_.size()); }
+  ~EvictingCacheMap() {
+    assert(lru_.size() == index_.size());
+    // Unlink from the segments before lru_ destroys the nodes.
+    if constexpr (kSegmented) {
+      segments_.clear();
+    }
+  }
 
   /**
    * Adjust the max size of EvictingCacheMap, evicting as needed to ensure the
@@ -189,6 +217,7 @@ class EvictingCacheMap {
       prune(std::max(size() - maxSize, clearSize_), pruneHook);
     }
     maxSize_ = maxSize;
+    policy_.reserve(maxSize);
   }
 
   std::size_t getMaxSize() const { return maxSize_; }
@@ -481,6 +510,8 @@ class EvictingCacheMap {
 
   PruneHookCall getPruneHook() { return pruneHook_; }
 
+  const TPolicy& getPolicy() const { return policy_; }
+
   /**
    * Prune the minimum of pruneSize and size() from the back of the LRU.
    * Will throw if pruneHook throws.
@@ -491,9 +522,10 @@ class EvictingCacheMap {
     auto& ph = (nullptr == pruneHook) ? pruneHook_ : pruneHook;
 
     for (std::size_t i = 0; i < pruneSize && !lru_.empty(); i++) {
-      auto* node = &(*lru_.rbegin());
+      auto* node = selectVictim();
       std::unique_ptr<Node> node_owner(node);
 
+      unlinkSegment(node);
       lru_.erase(lru_.iterator_to(*node));
       index_.erase(node);
       if (ph) {
@@ -546,9 +578,20 @@ class EvictingCacheMap {
   }
 
  private:
+  // Links a node into the window or the main segment, for segmented policies.
+  struct SegmentTag;
+  using SegmentHookBase = boost::intrusive::list_base_hook<
+      boost::intrusive::tag<SegmentTag>,
+      boost::intrusive::link_mode<boost::intrusive::safe_link>>;
+  struct SegmentHook : SegmentHookBase {
+    bool inMain = false;
+  };
+  struct NoSegmentHook {};
+
   struct Node
       : public boost::intrusive::list_base_hook<
-            boost::intrusive::link_mode<boost::intrusive::safe_link>> {
+            boost::intrusive::link_mode<boost::intrusive::safe_link>>,
+        public std::conditional_t<kSegmented, SegmentHook, NoSegmentHook> {
     template <typename K>
     Node(const K& key, TValue&& value) : pr(key, std::move(value)) {}
 
@@ -589,6 +632,34 @@ class EvictingCacheMap {
     }
   };
 
+  using SegmentList = boost::intrusive::list<
+      Node,
+      boost::intrusive::base_hook<SegmentHookBase>>;
+
+  // Does not own the nodes, which are always also in lru_. Moving clears the
+  // destination first, so that the nodes it linked are unlinked before the
+  // lru_ move that follows (see member order) destroys them.
+  struct Segments {
+    Segments() = default;
+    Segments(Segments&& that) noexcept { *this = std::move(that); }
+    Segments& operator=(Segments&& that) noexcept {
+      clear();
+      window.swap(that.window);
+      main.swap(that.main);
+      return *this;
+    }
+    ~Segments() { clear(); }
+
+    void clear() {
+      window.clear();
+      main.clear();
+    }
+
+    SegmentList window;
+    SegmentList main;
+  };
+  struct NoSegments {};
+
   struct KeyHasher : THash {
     static_assert(std::is_nothrow_copy_constructible_v<THash>);
     template <typename K>
@@ -663,7 +734,9 @@ class EvictingCacheMap {
     if (!ptr) {
       return self.end();
     }
+    self.recordAccess(ptr);
     self.lru_.splice(self.lru_.begin(), self.lru_, self.lru_.iterator_to(*ptr));
+    self.promoteInSegment(ptr);
     return self_iterator_t<Self>(self.lru_.iterator_to(*ptr));
   }
 
@@ -690,6 +763,7 @@ class EvictingCacheMap {
       PruneHookCall eraseHook) {
     std::unique_ptr<Node> node_owner(ptr);
     index_.erase(ptr);
+    unlinkSegment(ptr);
     auto next_base_iter = lru_.erase(base_iter);
     if (eraseHook) {
       // NOTE: might throw, so we are in an exception-safe state
@@ -714,13 +788,16 @@ class EvictingCacheMap {
     Node* ptr = findInIndex(key);
     if (ptr) {
       ptr->pr.second = std::move(value);
+      recordAccess(ptr);
       if (promote) {
         lru_.splice(lru_.begin(), lru_, lru_.iterator_to(*ptr));
+        promoteInSegment(ptr);
       }
     } else {
       auto node = new Node(key, std::move(value));
       index_.insert(node);
       lru_.push_front(*node);
+      linkNew(node);
 
       // no evictions if maxSize_ is 0 i.e. unlimited capacity
       if (maxSize_ > 0 && size() > maxSize_) {
@@ -751,6 +828,7 @@ class EvictingCacheMap {
 
     // Complete insertion
     lru_.push_front(*nodeOwner.release());
+    linkNew(node);
 
     // no evictions if maxSize_ is 0 i.e. unlimited capacity
     if (maxSize_ > 0 && size() > maxSize_) {
@@ -770,6 +848,92 @@ class EvictingCacheMap {
     }
   }
 
+  // Policy bookkeeping. All of these compile to nothing unless the policy is
+  // segmented.
+
+  void recordAccess(Node* node) {
+    if constexpr (kSegmented) {
+      policy_.recordAccess(keyHash_(node));
+    }
+  }
+
+  SegmentList& segmentOf(Node* node) {
+    return node->inMain ? segments_.main : segments_.window;
+  }
+
+  // Every new entry starts in the window.
+  void linkNew(Node* node) {
+    if constexpr (kSegmented) {
+      recordAccess(node);
+      segments_.window.push_front(*node);
+      if (maxSize_ == 0) {
+        // No configured capacity to size the policy by, so track the size.
+        policy_.reserve(lru_.size());
+      }
+    }
+  }
+
+  void promoteInSegment(Node* node) {
+    if constexpr (kSegmented) {
+      auto& segment = segmentOf(node);
+      segment.splice(segment.begin(), segment, segment.iterator_to(*node));
+    }
+  }
+
+  void unlinkSegment(Node* node) {
+    if constexpr (kSegmented) {
+      auto& segment = segmentOf(node);
+      segment.erase(segment.iterator_to(*node));
+    }
+  }
+
+  void moveToMain(Node* node) {
+    segments_.window.erase(segments_.window.iterator_to(*node));
+    node->inMain = true;
+    segments_.main.push_front(*node);
+  }
+
+  // The next entry to evict. Plain LRU evicts the tail. W-TinyLFU has the
+  // window's LRU entry (the candidate) compete with the main segment's (the
+  // victim): the policy's loser is evicted, and a winning candidate moves
+  // into the main segment. Only once the window has nothing left to offer
+  // besides the most recent entry, e.g. on the second of several evictions
+  // for one insertion, is the victim evicted unopposed.
+  Node* selectVictim() {
+    if constexpr (!kSegmented) {
+      return &*lru_.rbegin();
+    } else {
+      auto& window = segments_.window;
+      auto& main = segments_.main;
+      auto windowCap =
+          std::max<std::size_t>(policy_.windowSize(lru_.size()), 1);
+      // Entries beyond the window's share that never competed, typically
+      // because the cache just filled up, move to the main segment unopposed.
+      while (window.size() > windowCap + 1) {
+        moveToMain(&window.back());
+      }
+      if (main.empty()) {
+        return &window.back();
+      }
+      Node* victim = &main.back();
+      if (window.size() > 1) {
+        Node* candidate = &window.back();
+        if (victim != &lru_.front() &&
+            policy_.admit(keyHash_(candidate), keyHash_(victim))) {
+          moveToMain(candidate);
+          return victim;
+        }
+        return candidate;
+      }
+      if (victim == &lru_.front() && lru_.size() > 1) {
+        // Like LRU, never evict the most recently used entry while there is
+        // any other.
+        victim = &window.back();
+      }
+      return victim;
+    }
+  }
+
   // A zero clear size doesn't make sense. If you want to disable clearing, set
   // maxSize to 0.
   static std::size_t clampClearSize(std::size_t clearSize) {
@@ -780,9 +944,13 @@ class EvictingCacheMap {
   KeyHasher keyHash_;
   KeyValueEqual keyEqual_;
   NodeMap index_;
+  // Must precede lru_; see Segments.
+  [[FOLLY_ATTR_NO_UNIQUE_ADDRESS]]
+  std::conditional_t<kSegmented, Segments, NoSegments> segments_;
   NodeList lru_;
   std::size_t maxSize_;
   std::size_t clearSize_;
+  [[FOLLY_ATTR_NO_UNIQUE_ADDRESS]] TPolicy policy_;
 };
 
 } // namespace folly
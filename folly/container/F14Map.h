@@ -24,10 +24,13 @@
  * See F14.md
  */
 
+#include <algorithm>
+#include <array>
 #include <concepts>
 #include <cstddef>
 #include <initializer_list>
 #include <ranges>
+#include <span>
 #include <stdexcept>
 #include <tuple>
 
@@ -423,6 +426,34 @@ class F14BasicMap {
     insert(ilist.begin(), ilist.end());
   }
 
+  /**
+   * Add many elements at once.
+   * @methodset Modifiers
+   *
+   * insertMany(items, out) sets out[i] to insert(items[i]), and requires
+   * out.size() >= items.size(). It first reserves room for all the items,
+   * so the iterators in out stay valid until the next insert, then pipelines
+   * the inserts like findMany().
+   */
+  void insertMany(
+      std::span<std::pair<key_type, mapped_type> const> items,
+      std::span<std::pair<iterator, bool>> out) {
+    FOLLY_SAFE_DCHECK(out.size() >= items.size());
+    reserve(size() + items.size());
+    std::array<F14HashToken, kBatchGroupSize> tokens;
+    for (std::size_t i = 0; i < items.size(); i += tokens.size()) {
+      auto n = std::min(tokens.size(), items.size() - i);
+      for (std::size_t j = 0; j < n; ++j) {
+        tokens[j] = prehash(items[i + j].first);
+        prefetch(tokens[j]);
+      }
+      for (std::size_t j = 0; j < n; ++j) {
+        auto& item = items[i + j];
+        out[i + j] = try_emplace_token(tokens[j], item.first, item.second);
+      }
+    }
+  }
+
   /// Insert if the key is missing, overwrite using operator= if present.
   /// @methodset Modifiers
   template <typename M>
@@ -903,6 +934,42 @@ class F14BasicMap {
     return table_.makeConstIter(table_.find(token, key));
   }
 
+  /**
+   * @overloadbrief Get the iterators for many keys.
+   * @methodset Lookup
+   *
+   * findMany(keys, out) sets out[i] to find(keys[i]), and requires
+   * out.size() >= keys.size(). It pipelines the lookups: it prehashes a
+   * group of keys and prefetches the chunks they start from before probing
+   * for any of them, so that their cache misses overlap. On a map much
+   * larger than the CPU caches this is faster than a loop of find(),
+   * especially for maps that store their items in the chunks, like
+   * F14ValueMap.
+   */
+  void findMany(std::span<key_type const> keys, std::span<iterator> out) {
+    findMany(*this, keys, out);
+  }
+
+  /// @copydoc findMany
+  void findMany(
+      std::span<key_type const> keys, std::span<const_iterator> out) const {
+    findMany(*this, keys, out);
+  }
+
+  /// @copydoc findMany
+  template <typename K>
+  EnableHeterogeneousFind<K, void> findMany(
+      std::span<K const> keys, std::span<iterator> out) {
+    findMany(*this, keys, out);
+  }
+
+  /// @copydoc findMany
+  template <typename K>
+  EnableHeterogeneousFind<K, void> findMany(
+      std::span<K const> keys, std::span<const_iterator> out) const {
+    findMany(*this, keys, out);
+  }
+
   /**
    * @overloadbrief Checks if the container contains an element with the
    * specific key.
@@ -1093,6 +1160,27 @@ class F14BasicMap {
     return iter->second;
   }
 
+  // The number of keys that findMany() and insertMany() prehash and prefetch
+  // before probing for any of them.
+  static constexpr std::size_t kBatchGroupSize = 16;
+
+  template <typename Self, typename K, typename Iter>
+  static void findMany(
+      Self& self, std::span<K const> keys, std::span<Iter> out) {
+    FOLLY_SAFE_DCHECK(out.size() >= keys.size());
+    std::array<F14HashToken, kBatchGroupSize> tokens;
+    for (std::size_t i = 0; i < keys.size(); i += tokens.size()) {
+      auto n = std::min(tokens.size(), keys.size() - i);
+      for (std::size_t j = 0; j < n; ++j) {
+        tokens[j] = self.prehash(keys[i + j]);
+        self.prefetch(tokens[j]);
+      }
+      for (std::size_t j = 0; j < n; ++j) {
+        out[i + j] = self.find(tokens[j], keys[i + j]);
+      }
+    }
+  }
+
   template <typename Self, typename K>
   static auto equal_range(Self& self, K const& key) {
     auto first = self.find(key);
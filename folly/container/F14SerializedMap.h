@@ -0,0 +1,375 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include <folly/Likely.h>
+#include <folly/Portability.h>
+#include <folly/Range.h>
+#include <folly/container/detail/F14Table.h>
+#include <folly/hash/Hash.h>
+#include <folly/lang/Align.h>
+#include <folly/lang/Bits.h>
+#include <folly/lang/Exception.h>
+#include <folly/system/MemoryMapping.h>
+
+#if FOLLY_F14_VECTOR_INTRINSICS_AVAILABLE
+
+namespace folly {
+
+namespace f14 {
+namespace detail {
+
+// The offset and size of a string key in the blob of an image.
+struct SerializedStringRef {
+  uint64_t offset;
+  uint64_t size;
+};
+
+template <typename Key, typename Mapped>
+struct SerializedItem {
+  std::conditional_t<
+      std::is_same_v<Key, std::string>,
+      SerializedStringRef,
+      Key>
+      key;
+  Mapped value;
+};
+
+struct SerializedMapHeader {
+  // "F14SMAP1", which also rejects images of the other endianness.
+  static constexpr uint64_t kMagic = 0x3150414d53343146;
+  static constexpr uint32_t kVersion = 1;
+
+  uint64_t magic;
+  uint32_t version;
+  uint32_t itemSize;
+  uint32_t itemAlign;
+  uint32_t chunkStride;
+  uint64_t size;
+  uint64_t chunkShift;
+  uint64_t chunksOffset;
+  uint64_t blobOffset;
+  uint64_t blobSize;
+};
+
+} // namespace detail
+} // namespace f14
+
+/**
+ * A read-only hash map that can be memory-mapped and searched in place.
+ *
+ * serialize() lays out the elements of a map as F14 chunks, with the same
+ * tags and overflow counts as F14Table, in a single buffer (the image) that
+ * holds no pointers. An F14SerializedMap views an image, e.g. a
+ * MemoryMapping of a file it was written to: opening one only checks its
+ * header, so it takes no time however large the map, and pages are read
+ * when lookups first touch them. find() probes the chunks with the same
+ * SIMD tag matching as F14Table.
+ *
+ *   folly::writeFile(F14SerializedMap<uint64_t, Row>::serialize(rows), path);
+ *   ...
+ *   F14SerializedMap<uint64_t, Row> rows(MemoryMapping(path));
+ *   if (auto row = rows.find(id)) {
+ *     ...
+ *   }
+ *
+ * Keys and values are stored in the chunks by value, so they must be
+ * trivially copyable, except that keys may be std::strings, which are
+ * stored in a blob after the chunks and looked up by std::string_view.
+ *
+ * Images are only portable between programs built for the same
+ * architecture, with the same Key, Mapped and Hasher. The header records
+ * the layout of items and chunks, which catches most mismatches, but not
+ * a different hash function: Hasher must hash the same way in every
+ * process, as folly::hasher does.
+ *
+ * An image that is corrupted past its header may return wrong results, but
+ * find() bounds-checks the strings it compares.
+ */
+template <
+    typename Key,
+    typename Mapped,
+    typename Hasher = hasher<std::conditional_t<
+        std::is_same_v<Key, std::string>,
+        std::string_view,
+        Key>>>
+class F14SerializedMap {
+  static constexpr bool kStringKeys = std::is_same_v<Key, std::string>;
+
+  static_assert(
+      kStringKeys || std::is_trivially_copyable_v<Key>,
+      "F14SerializedMap keys must be trivially copyable or std::string");
+  static_assert(
+      std::is_trivially_copyable_v<Mapped>,
+      "F14SerializedMap values must be trivially copyable");
+  static_assert(sizeof(std::size_t) == sizeof(uint64_t));
+  static_assert(kIsLittleEndian);
+
+  using Item = f14::detail::SerializedItem<Key, Mapped>;
+  using Chunk = f14::detail::F14Chunk<Item>;
+  using Header = f14::detail::SerializedMapHeader;
+
+  static constexpr std::size_t kChunksOffset =
+      align_ceil(sizeof(Header), hardware_destructive_interference_size);
+  static_assert(kChunksOffset % Chunk::kRequiredChunkAlignment == 0);
+
+ public:
+  using key_type = Key;
+  using mapped_type = Mapped;
+  using lookup_type = std::conditional_t<kStringKeys, std::string_view, Key>;
+  using hasher = Hasher;
+
+  /**
+   * Returns the image of a map, given as a range of pairs of keys and
+   * values, e.g. an F14ValueMap. The keys must be distinct.
+   */
+  template <typename Range>
+  static std::string serialize(Range const& elements) {
+    std::size_t size = 0;
+    std::size_t blobSize = 0;
+    for (auto const& element : elements) {
+      ++size;
+      if constexpr (kStringKeys) {
+        blobSize += std::string_view(element.first).size();
+      }
+    }
+
+    std::size_t chunkShift = 0;
+    while ((std::size_t(Chunk::kDesiredCapacity) << chunkShift) < size) {
+      ++chunkShift;
+    }
+    std::size_t chunkMask = (std::size_t(1) << chunkShift) - 1;
+
+    Header header{};
+    header.magic = Header::kMagic;
+    header.version = Header::kVersion;
+    header.itemSize = sizeof(Item);
+    header.itemAlign = alignof(Item);
+    header.chunkStride = Chunk::kChunkStride;
+    header.size = size;
+    header.chunkShift = chunkShift;
+    header.chunksOffset = kChunksOffset;
+    header.blobOffset = kChunksOffset + (chunkMask + 1) * Chunk::kChunkStride;
+    header.blobSize = blobSize;
+
+    // Chunks are written byte by byte, since the buffer of a string need not
+    // be aligned for them.
+    std::string image(header.blobOffset + blobSize, '\0');
+    std::memcpy(image.data(), &header, sizeof(header));
+    auto chunks = image.data() + kChunksOffset;
+    auto blob = image.data() + header.blobOffset;
+    std::size_t blobPos = 0;
+    for (auto const& element : elements) {
+      lookup_type key(element.first);
+      auto [index, tag] = splitHash(key);
+      char* chunk;
+      std::size_t slot;
+      while (true) {
+        chunk = chunks + (index & chunkMask) * Chunk::kChunkStride;
+        auto tags = chunk + offsetof(Chunk, tags_);
+        slot = std::find(tags, tags + Chunk::kCapacity, '\0') - tags;
+        if (slot < Chunk::kCapacity) {
+          break;
+        }
+        auto& overflow = reinterpret_cast<uint8_t&>(
+            chunk[offsetof(Chunk, outboundOverflowCount_)]);
+        if (overflow != Chunk::kOutboundOverflowMax) {
+          ++overflow;
+        }
+        index += probeDelta(tag);
+      }
+      chunk[offsetof(Chunk, tags_) + slot] = static_cast<char>(tag);
+
+      alignas(Item) unsigned char raw[sizeof(Item)] = {};
+      if constexpr (kStringKeys) {
+        std::memcpy(blob + blobPos, key.data(), key.size());
+        new (raw) Item{{blobPos, key.size()}, element.second};
+        blobPos += key.size();
+      } else {
+        new (raw) Item{key, element.second};
+      }
+      std::memcpy(
+          chunk + Chunk::kItemsOffset + slot * sizeof(Item), raw, sizeof(Item));
+    }
+    return image;
+  }
+
+  /**
+   * Views an image, which must outlive this map and not change. Throws
+   * std::runtime_error if it is not an image of this type of map, and
+   * std::invalid_argument if it is not aligned to 16 bytes.
+   */
+  explicit F14SerializedMap(ByteRange image) : image_(image) { open(); }
+
+  /// Views the image in a mapping, e.g. of a file, and owns the mapping.
+  explicit F14SerializedMap(MemoryMapping mapping)
+      : mapping_(std::move(mapping)), image_(mapping_->range()) {
+    open();
+  }
+
+  std::size_t size() const { return size_; }
+
+  bool empty() const { return size_ == 0; }
+
+  /// Returns the value of key, or nullptr if it is not in the map.
+  Mapped const* find(lookup_type const& key) const {
+    auto [index, tag] = splitHash(key);
+    auto needleV = loadNeedleV(tag);
+    for (std::size_t tries = chunkMask_ + 1; tries > 0; --tries) {
+      auto chunk = Chunk::chunkRawAt(chunks_, index & chunkMask_);
+      auto [hits, nonzero] = chunk->tagMatchIter(needleV);
+      if (nonzero) {
+        do {
+          auto& item = chunk->citem(hits.next());
+          if (FOLLY_LIKELY(keyMatches(key, item.key))) {
+            return &item.value;
+          }
+        } while (hits.hasNext());
+      }
+      if (FOLLY_LIKELY(chunk->outboundOverflowCount() == 0)) {
+        break;
+      }
+      index += probeDelta(tag);
+    }
+    return nullptr;
+  }
+
+  bool contains(lookup_type const& key) const { return find(key) != nullptr; }
+
+  Mapped const& at(lookup_type const& key) const {
+    auto value = find(key);
+    if (!value) {
+      throw_exception<std::out_of_range>("at() did not find key");
+    }
+    return *value;
+  }
+
+  /// Calls fn(key, value) for each element, in no particular order.
+  template <typename Fn>
+  void forEach(Fn fn) const {
+    for (std::size_t i = 0; i <= chunkMask_; ++i) {
+      auto chunk = Chunk::chunkRawAt(chunks_, i);
+      auto occupied = chunk->occupiedIter();
+      while (occupied.hasNext()) {
+        auto& item = chunk->citem(occupied.next());
+        if constexpr (kStringKeys) {
+          fn(string(item.key), item.value);
+        } else {
+          fn(item.key, item.value);
+        }
+      }
+    }
+  }
+
+ private:
+  // Like F14Table::splitHash, but the same on every platform: the index
+  // comes from the low bits of the hash and the tag from its top byte.
+  static std::pair<std::size_t, std::size_t> splitHash(lookup_type const& key) {
+    std::size_t hash = Hasher{}(key);
+    if constexpr (!IsAvalanchingHasher<Hasher, lookup_type>::value) {
+      hash = hash::twang_mix64(hash);
+    }
+    return {hash, std::max(std::size_t{1}, hash >> 56)};
+  }
+
+  static std::size_t probeDelta(std::size_t tag) { return 2 * tag + 1; }
+
+  static auto loadNeedleV(std::size_t needle) {
+#if FOLLY_NEON
+    return vdupq_n_u8(static_cast<uint8_t>(needle));
+#elif FOLLY_SSE >= 2
+    return _mm_set1_epi8(static_cast<uint8_t>(needle));
+#else
+    return needle;
+#endif
+  }
+
+  std::string_view string(f14::detail::SerializedStringRef ref) const {
+    return {blob_ + ref.offset, ref.size};
+  }
+
+  template <typename K>
+  bool keyMatches(lookup_type const& key, K const& stored) const {
+    if constexpr (kStringKeys) {
+      return stored.size == key.size() && stored.offset <= blobSize_ &&
+          stored.size <= blobSize_ - stored.offset &&
+          string(stored) == key;
+    } else {
+      return stored == key;
+    }
+  }
+
+  void open() {
+    if (reinterpret_cast<uintptr_t>(image_.data()) %
+            Chunk::kRequiredChunkAlignment !=
+        0) {
+      throw_exception<std::invalid_argument>(
+          "F14SerializedMap image is not aligned");
+    }
+    Header header;
+    if (image_.size() < sizeof(header)) {
+      throw_exception<std::runtime_error>("F14SerializedMap image too small");
+    }
+    std::memcpy(&header, image_.data(), sizeof(header));
+    if (header.magic != Header::kMagic ||
+        header.version != Header::kVersion) {
+      throw_exception<std::runtime_error>("not an F14SerializedMap image");
+    }
+    if (header.itemSize != sizeof(Item) || header.itemAlign != alignof(Item) ||
+        header.chunkStride != Chunk::kChunkStride) {
+      throw_exception<std::runtime_error>(
+          "F14SerializedMap image of different key or value types");
+    }
+    if (header.chunksOffset != kChunksOffset || header.chunkShift >= 48 ||
+        header.blobOffset !=
+            kChunksOffset + (uint64_t(1) << header.chunkShift) *
+                    Chunk::kChunkStride ||
+        header.blobOffset > image_.size() ||
+        header.blobSize > image_.size() - header.blobOffset) {
+      throw_exception<std::runtime_error>("corrupt F14SerializedMap image");
+    }
+    size_ = header.size;
+    chunkMask_ = (std::size_t(1) << header.chunkShift) - 1;
+    chunks_ = reinterpret_cast<Chunk const*>(image_.data() + kChunksOffset);
+    blob_ = reinterpret_cast<char const*>(image_.data() + header.blobOffset);
+    blobSize_ = header.blobSize;
+  }
+
+  std::optional<MemoryMapping> mapping_;
+  ByteRange image_;
+  std::size_t size_{0};
+  std::size_t chunkMask_{0};
+  Chunk const* chunks_{nullptr};
+  char const* blob_{nullptr};
+  std::size_t blobSize_{0};
+};
+
+} // namespace folly
+
+#endif // FOLLY_F14_VECTOR_INTRINSICS_AVAILABLE
@@ -22,10 +22,12 @@
 #include <functional>
 #include <memory>
 #include <mutex>
+#include <type_traits>
 #include <utility>
 
 #include <folly/SharedMutex.h>
 #include <folly/concurrency/ConcurrentHashMap.h>
+#include <folly/container/CachePolicy.h>
 #include <folly/synchronization/Hazptr.h>
 
 namespace folly {
@@ -82,12 +84,21 @@ namespace folly {
  * enough insert rate.
  *
  * Value must be copy-constructible, since promotion copies it.
+ *
+ * TPolicy (see CachePolicy.h) can gate insertions. With TinyLfuCachePolicy a
+ * set() that would create an entry first records the key in the policy's
+ * frequency sketch and is dropped unless the key has been set recently enough
+ * (its minAdmitFrequency); so a scan of one-off keys stops filling the recent
+ * generation and forcing rotations that discard the working set. Replacing an
+ * existing entry and promotion are never gated, and lookups do not touch the
+ * policy, so the hit path stays free of shared writes.
  */
 template <
     typename Key,
     typename Value,
     typename HashFn = std::hash<Key>,
-    typename KeyEqual = std::equal_to<Key>>
+    typename KeyEqual = std::equal_to<Key>,
+    typename TPolicy = LruCachePolicy>
 class GenerationalCacheMap {
  private:
   using Map = ConcurrentHashMap<Key, Value, HashFn, KeyEqual>;
@@ -114,10 +125,12 @@ class GenerationalCacheMap {
   };
 
  public:
-  explicit GenerationalCacheMap(size_t capacity)
+  explicit GenerationalCacheMap(size_t capacity, TPolicy policy = TPolicy())
       : rotateAt_(std::max<size_t>(capacity / 2, 1)),
-        version_(
-            new Version(std::make_shared<Map>(), std::make_shared<Map>())) {}
+        version_(new Version(std::make_shared<Map>(), std::make_shared<Map>())),
+        policy_(std::move(policy)) {
+    policy_.reserve(capacity);
+  }
 
   GenerationalCacheMap(const GenerationalCacheMap&) = delete;
   GenerationalCacheMap(GenerationalCacheMap&&) = delete;
@@ -202,7 +215,8 @@ class GenerationalCacheMap {
   /**
    * Associates `value` with `key`, replacing whatever was there.
    *
-   * Best effort: the entry may be evicted at any later point.
+   * Best effort: the entry may be evicted at any later point, or with an
+   * admission policy not be created at all.
    */
   void set(const Key& key, Value value) {
     auto holder = make_hazard_pointer();
@@ -214,6 +228,9 @@ class GenerationalCacheMap {
     // updated. Two setters racing can both see the key absent and both count
     // it, rotating marginally early; the counter is approximate anyway.
     const bool created = recent.find(key) == recent.cend();
+    if (created && !admit(key)) {
+      return;
+    }
     recent.insert_or_assign(key, std::move(value));
     if (created) {
       countInsertion(version);
@@ -241,6 +258,19 @@ class GenerationalCacheMap {
   }
 
  private:
+  // Records an attempt to create an entry for `key` and asks the policy
+  // whether to go ahead. Free with policies that admit anything, such as the
+  // default one.
+  bool admit(const Key& key) {
+    if constexpr (!TPolicy::kAdmits) {
+      return true;
+    } else {
+      const auto hash = HashFn()(key);
+      policy_.recordAccess(hash);
+      return policy_.admit(hash);
+    }
+  }
+
   // Accounts for an entry just added to `version`'s recent generation, rotating
   // if that filled it. Writers read `version` a moment before calling, but a
   // rotation may have landed in between, in which case the entry went into a
@@ -300,6 +330,7 @@ class GenerationalCacheMap {
   std::atomic<size_t> recentSize_{0};
   std::atomic<uint64_t> rotations_{0};
   SharedMutex rotateMutex_;
+  [[FOLLY_ATTR_NO_UNIQUE_ADDRESS]] TPolicy policy_;
 };
 
 } // namespace folly
@@ -51,6 +51,10 @@ namespace folly {
  * constraints from EvictingCacheMap. (Must either match TKey or
  * EligibleForHeterogeneousFind/Insert.)
  *
+ * TPolicy selects the eviction policy as for EvictingCacheMap, e.g.
+ * TinyLfuCachePolicy. Its window and frequency sketch are sized by entry
+ * count, not weight.
+ *
  * This implementation has not been highly optimized and is a wrapper around
  * EvictingCacheMap.
  */
@@ -59,10 +63,11 @@ template <
     class TValue,
     class TWeightFn,
     class THash = HeterogeneousAccessHash<TKey>,
-    class TKeyEqual = HeterogeneousAccessEqualTo<TKey>>
+    class TKeyEqual = HeterogeneousAccessEqualTo<TKey>,
+    class TPolicy = LruCachePolicy>
 class ImplicitlyWeightedEvictingCacheMap {
  private: // typedefs
-  using ECM = EvictingCacheMap<TKey, TValue, THash, TKeyEqual>;
+  using ECM = EvictingCacheMap<TKey, TValue, THash, TKeyEqual, TPolicy>;
 
  public:
   using PruneHookCall = std::function<void(TKey, TValue&&)>;
@@ -71,8 +76,9 @@ class ImplicitlyWeightedEvictingCacheMap {
       std::size_t maxTotalWeight,
       const TWeightFn& weightFn = TWeightFn(),
       const THash& keyHash = THash(),
-      const TKeyEqual& keyEqual = TKeyEqual())
-      : ecm_(/* no max size*/ 0, 1, keyHash, keyEqual),
+      const TKeyEqual& keyEqual = TKeyEqual(),
+      TPolicy policy = TPolicy())
+      : ecm_(/* no max size*/ 0, 1, keyHash, keyEqual, std::move(policy)),
         weightFn_(weightFn),
         maxTotalWeight_(maxTotalWeight),
         currentTotalWeight_(0) {
@@ -355,7 +361,12 @@ class ImplicitlyWeightedEvictingCacheMap {
     }
   }
 
-  template <class _TKey, class _TValue, class _THash, class _TKeyEqual>
+  template <
+      class _TKey,
+      class _TValue,
+      class _THash,
+      class _TKeyEqual,
+      class _TPolicy>
   friend class WeightedEvictingCacheMap;
 
  private: // data
@@ -396,7 +407,8 @@ template <
     class TKey,
     class TValue,
     class THash = HeterogeneousAccessHash<TKey>,
-    class TKeyEqual = HeterogeneousAccessEqualTo<TKey>>
+    class TKeyEqual = HeterogeneousAccessEqualTo<TKey>,
+    class TPolicy = LruCachePolicy>
 class WeightedEvictingCacheMap {
  public: // types
   struct ValueAndWeight {
@@ -419,7 +431,8 @@ class WeightedEvictingCacheMap {
       ValueAndWeight,
       WeightFn,
       THash,
-      TKeyEqual>;
+      TKeyEqual,
+      TPolicy>;
 
  public:
   using PruneHookCall = std::function<void(TKey, TValue&&, size_t)>;
@@ -427,8 +440,10 @@ class WeightedEvictingCacheMap {
   explicit WeightedEvictingCacheMap(
       std::size_t maxTotalWeight,
       const THash& keyHash = THash(),
-      const TKeyEqual& keyEqual = TKeyEqual())
-      : iwecm_(maxTotalWeight, WeightFn(), keyHash, keyEqual) {}
+      const TKeyEqual& keyEqual = TKeyEqual(),
+      TPolicy policy = TPolicy())
+      : iwecm_(
+            maxTotalWeight, WeightFn(), keyHash, keyEqual, std::move(policy)) {}
 
   // Like EvictingCacheMap
   WeightedEvictingCacheMap(const WeightedEvictingCacheMap&) = delete;
@@ -17,6 +17,7 @@
 #pragma once
 
 #include <algorithm>
+#include <span>
 #include <type_traits>
 #include <unordered_map>
 
@@ -161,6 +162,16 @@ class F14BasicMap : public std::unordered_map<K, M, H, E, A> {
     insert(ilist.begin(), ilist.end());
   }
 
+  void insertMany(
+      std::span<std::pair<key_type, mapped_type> const> items,
+      std::span<std::pair<iterator, bool>> out) {
+    FOLLY_SAFE_DCHECK(out.size() >= items.size());
+    this->reserve(this->size() + items.size());
+    for (std::size_t i = 0; i < items.size(); ++i) {
+      out[i] = this->try_emplace(items[i].first, items[i].second);
+    }
+  }
+
   template <typename M2>
   std::pair<iterator, bool> insert_or_assign(key_type const& key, M2&& obj) {
     auto rv = try_emplace(key, std::forward<M2>(obj));
@@ -615,6 +626,27 @@ class F14BasicMap : public std::unordered_map<K, M, H, E, A> {
     return find(key);
   }
 
+  void findMany(std::span<key_type const> keys, std::span<iterator> out) {
+    findMany(*this, keys, out);
+  }
+
+  void findMany(
+      std::span<key_type const> keys, std::span<const_iterator> out) const {
+    findMany(*this, keys, out);
+  }
+
+  template <typename K2>
+  EnableHeterogeneousFind<K2, void> findMany(
+      std::span<K2 const> keys, std::span<iterator> out) {
+    findMany(*this, keys, out);
+  }
+
+  template <typename K2>
+  EnableHeterogeneousFind<K2, void> findMany(
+      std::span<K2 const> keys, std::span<const_iterator> out) const {
+    findMany(*this, keys, out);
+  }
+
   bool contains(F14HashToken const&, key_type const& key) const {
     return contains(key);
   }
@@ -624,6 +656,16 @@ class F14BasicMap : public std::unordered_map<K, M, H, E, A> {
       F14HashToken const&, K2 const& key) const {
     return contains(key);
   }
+
+ private:
+  template <typename Self, typename K2, typename Iter>
+  static void findMany(
+      Self& self, std::span<K2 const> keys, std::span<Iter> out) {
+    FOLLY_SAFE_DCHECK(out.size() >= keys.size());
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+      out[i] = self.find(keys[i]);
+    }
+  }
 };
 } // namespace detail
 } // namespace f14
@@ -650,7 +650,7 @@ struct alignas(constexpr_max(kRequiredVectorAlignment, alignof(ItemType)))
  private:
   template <typename ChunkType>
   static ChunkType* chunkRawAtImpl(ChunkType* base, std::size_t i) {
-    auto* bytePtr = reinterpret_cast<char*>(base);
+    auto* bytePtr = reinterpret_cast<like_t<ChunkType, char>*>(base);
     auto offset = static_cast<std::ptrdiff_t>(i) *
         static_cast<std::ptrdiff_t>(kChunkStride);
     return reinterpret_cast<ChunkType*>(bytePtr + offset);
@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/container/CachePolicy.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/container/EvictingCacheMap.h>
+#include <folly/hash/Hash.h>
+#include <folly/portability/GFlags.h>
+
+DEFINE_int64(universe, 1000 * 1000, "number of distinct keys in the traces");
+DEFINE_int64(capacity, 10 * 1000, "cache capacity");
+DEFINE_int64(trace_length, 4 * 1000 * 1000, "accesses per trace");
+DEFINE_double(zipf_s, 0.9, "skew of the Zipfian popularity distribution");
+
+// Replays synthetic access traces through EvictingCacheMap with each policy,
+// as a cache in front of an expensive lookup: find, and set on a miss. Reports
+// time per access and, as the hit_rate counter, the percentage of hits, which
+// is what a policy is for; the time shows what its bookkeeping costs.
+//
+//  - zipf: independent draws from a Zipfian distribution, the usual model of
+//    key popularity.
+//  - scan: the same, with every other 100k stretch replaced by a scan of keys
+//    that are never used again, as a batch job sharing the cache would cause.
+//    LRU lets each scan flush the popular keys; TinyLFU should not.
+
+using namespace folly;
+
+namespace {
+
+using TinyLfuMap = EvictingCacheMap<
+    uint64_t,
+    uint64_t,
+    HeterogeneousAccessHash<uint64_t>,
+    HeterogeneousAccessEqualTo<uint64_t>,
+    TinyLfuCachePolicy>;
+using LruMap = EvictingCacheMap<uint64_t, uint64_t>;
+
+std::vector<uint64_t> makeZipfTrace(bool withScans) {
+  std::vector<double> cdf(FLAGS_universe);
+  double sum = 0;
+  for (int64_t i = 0; i < FLAGS_universe; ++i) {
+    sum += 1 / std::pow(i + 1, FLAGS_zipf_s);
+    cdf[i] = sum;
+  }
+  std::mt19937_64 rng(12345);
+  std::uniform_real_distribution<double> uniform(0, sum);
+  constexpr int64_t kStretch = 100 * 1000;
+  uint64_t scanKey = FLAGS_universe;
+  std::vector<uint64_t> trace(FLAGS_trace_length);
+  for (int64_t i = 0; i < FLAGS_trace_length; ++i) {
+    uint64_t rank;
+    if (withScans && (i / kStretch) % 2 == 1) {
+      rank = scanKey++;
+    } else {
+      auto it = std::lower_bound(cdf.begin(), cdf.end(), uniform(rng));
+      rank = std::min<uint64_t>(it - cdf.begin(), FLAGS_universe - 1);
+    }
+    // Popular keys should not also be numerically adjacent.
+    trace[i] = hash::twang_mix64(rank);
+  }
+  return trace;
+}
+
+const std::vector<uint64_t>& zipfTrace() {
+  static const auto trace = makeZipfTrace(false);
+  return trace;
+}
+
+const std::vector<uint64_t>& scanTrace() {
+  static const auto trace = makeZipfTrace(true);
+  return trace;
+}
+
+template <typename Map>
+void replay(
+    UserCounters& counters, size_t iters, const std::vector<uint64_t>& trace) {
+  BenchmarkSuspender suspender;
+  Map map(FLAGS_capacity);
+  // Warm the cache (and the policy) with one pass over the trace.
+  for (auto key : trace) {
+    if (map.find(key) == map.end()) {
+      map.set(key, key);
+    }
+  }
+  suspender.dismiss();
+
+  size_t hits = 0;
+  for (size_t i = 0; i < iters; ++i) {
+    auto key = trace[i % trace.size()];
+    auto it = map.find(key);
+    if (it != map.end()) {
+      ++hits;
+      doNotOptimizeAway(it->second);
+    } else {
+      map.set(key, key);
+    }
+  }
+  counters["hit_rate"] = UserMetric(100.0 * hits / std::max<size_t>(iters, 1));
+}
+
+} // namespace
+
+BENCHMARK_COUNTERS(zipf_lru, counters, iters) {
+  replay<LruMap>(counters, iters, zipfTrace());
+}
+
+BENCHMARK_COUNTERS_RELATIVE(zipf_tinylfu, counters, iters) {
+  replay<TinyLfuMap>(counters, iters, zipfTrace());
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK_COUNTERS(scan_lru, counters, iters) {
+  replay<LruMap>(counters, iters, scanTrace());
+}
+
+BENCHMARK_COUNTERS_RELATIVE(scan_tinylfu, counters, iters) {
+  replay<TinyLfuMap>(counters, iters, scanTrace());
+}
+
+int main(int argc, char** argv) {
+  folly::gflags::ParseCommandLineFlags(&argc, &argv, true);
+  runBenchmarks();
+}
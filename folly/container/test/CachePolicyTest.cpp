@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/container/CachePolicy.h>
+
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+
+TEST(FrequencySketch, EmptyUntilReserved) {
+  FrequencySketch sketch;
+  EXPECT_TRUE(sketch.empty());
+  sketch.increment(1);
+  EXPECT_EQ(0, sketch.estimate(1));
+
+  sketch.reserve(16);
+  EXPECT_FALSE(sketch.empty());
+  sketch.increment(1);
+  EXPECT_EQ(1, sketch.estimate(1));
+}
+
+TEST(FrequencySketch, CountsAndSaturates) {
+  FrequencySketch sketch(1024);
+  for (int i = 0; i < 5; ++i) {
+    sketch.increment(42);
+  }
+  EXPECT_EQ(5, sketch.estimate(42));
+  EXPECT_EQ(0, sketch.estimate(43));
+
+  for (int i = 0; i < 100; ++i) {
+    sketch.increment(42);
+  }
+  EXPECT_EQ(FrequencySketch::kMaxFrequency, sketch.estimate(42));
+
+  sketch.clear();
+  EXPECT_EQ(0, sketch.estimate(42));
+}
+
+TEST(FrequencySketch, NeverUnderestimates) {
+  // Count-Min only overestimates, through collisions.
+  FrequencySketch sketch(512);
+  for (size_t key = 0; key < 512; ++key) {
+    for (size_t i = 0; i < key % 8; ++i) {
+      sketch.increment(key);
+    }
+  }
+  size_t exact = 0;
+  for (size_t key = 0; key < 512; ++key) {
+    EXPECT_GE(sketch.estimate(key), key % 8);
+    exact += sketch.estimate(key) == key % 8;
+  }
+  EXPECT_GT(exact, 400);
+}
+
+TEST(FrequencySketch, AgingHalvesCounts) {
+  FrequencySketch sketch(64);
+  for (int i = 0; i < 12; ++i) {
+    sketch.increment(7);
+  }
+  EXPECT_EQ(12, sketch.estimate(7));
+  // Enough distinct additions to cross the sample size (10 per counter word,
+  // at least 10 per entry) triggers aging at least once.
+  for (size_t key = 1000; key < 1000 + 64 * 10; ++key) {
+    sketch.increment(key);
+  }
+  EXPECT_LE(sketch.estimate(7), 6);
+  EXPECT_GE(sketch.estimate(7), 3);
+}
+
+TEST(FrequencySketch, ReserveOnlyGrows) {
+  FrequencySketch sketch(1024);
+  sketch.increment(5);
+  sketch.reserve(16);
+  EXPECT_EQ(1, sketch.estimate(5)) << "shrinking is a no-op";
+  sketch.reserve(1 << 16);
+  EXPECT_EQ(1, sketch.estimate(5)) << "growing keeps the counts";
+  EXPECT_EQ(0, sketch.estimate(6));
+}
+
+TEST(TinyLfuCachePolicy, Admission) {
+  TinyLfuCachePolicy policy(1, 2);
+  policy.reserve(100);
+  EXPECT_FALSE(policy.admit(1));
+  policy.recordAccess(1);
+  EXPECT_FALSE(policy.admit(1));
+  policy.recordAccess(1);
+  EXPECT_TRUE(policy.admit(1));
+
+  policy.recordAccess(2);
+  EXPECT_TRUE(policy.admit(1, 2));
+  EXPECT_FALSE(policy.admit(2, 1));
+  policy.recordAccess(2);
+  EXPECT_FALSE(policy.admit(1, 2)) << "ties go to the victim";
+}
+
+TEST(TinyLfuCachePolicy, WindowSize) {
+  TinyLfuCachePolicy onePercent;
+  EXPECT_EQ(1, onePercent.windowSize(0));
+  EXPECT_EQ(1, onePercent.windowSize(50));
+  EXPECT_EQ(10, onePercent.windowSize(1000));
+
+  TinyLfuCachePolicy quarter(25);
+  EXPECT_EQ(250, quarter.windowSize(1000));
+}
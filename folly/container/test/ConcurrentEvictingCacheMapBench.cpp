@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/container/ConcurrentEvictingCacheMap.h>
+
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+#include <folly/BenchmarkUtil.h>
+#include <folly/Synchronized.h>
+#include <folly/container/EvictingCacheMap.h>
+#include <folly/portability/GFlags.h>
+#include <folly/synchronization/test/Barrier.h>
+
+DEFINE_int32(reps, 5, "number of reps");
+DEFINE_int32(ops, 1000 * 1000, "number of operations per thread per rep");
+DEFINE_int64(capacity, 100 * 1000, "cache capacity");
+DEFINE_int32(max_threads, 128, "largest thread count to run");
+
+// Compares ConcurrentEvictingCacheMap against the pattern it replaces,
+// Synchronized<EvictingCacheMap>, at 1 to --max_threads threads. Reported
+// times are per operation per thread, so flat numbers mean linear scaling.
+
+namespace {
+
+using Locked = folly::Synchronized<folly::EvictingCacheMap<uint64_t, uint64_t>>;
+using Concurrent = folly::ConcurrentEvictingCacheMap<uint64_t, uint64_t>;
+
+template <typename Func>
+uint64_t run_once(int nthr, const Func& fn) {
+  folly::test::Barrier b(nthr + 1);
+  std::vector<std::thread> thr(nthr);
+  for (int tid = 0; tid < nthr; ++tid) {
+    thr[tid] = std::thread([&, tid] {
+      b.wait();
+      b.wait();
+      fn(tid);
+    });
+  }
+  b.wait();
+  auto tbegin = std::chrono::steady_clock::now();
+  b.wait();
+  for (int i = 0; i < nthr; ++i) {
+    thr[i].join();
+  }
+  auto tend = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(tend - tbegin)
+      .count();
+}
+
+template <typename RepFunc>
+void runBench(const std::string& name, int ops, const RepFunc& repFn) {
+  uint64_t min = UINTMAX_MAX;
+  uint64_t max = 0;
+  uint64_t sum = 0;
+  for (int r = 0; r < FLAGS_reps; ++r) {
+    uint64_t dur = repFn();
+    sum += dur;
+    min = std::min(min, dur);
+    max = std::max(max, dur);
+  }
+  uint64_t avg = sum / FLAGS_reps;
+  std::cout << name;
+  std::cout << "   " << std::setw(5) << (max + ops / 2) / ops << " ns";
+  std::cout << "   " << std::setw(5) << (avg + ops / 2) / ops << " ns";
+  std::cout << "   " << std::setw(5) << (min + ops / 2) / ops << " ns";
+  std::cout << std::endl;
+}
+
+// xorshift, so that key generation is not the bottleneck.
+uint64_t nextKey(uint64_t& state, uint64_t range) {
+  state ^= state << 13;
+  state ^= state >> 7;
+  state ^= state << 17;
+  return state % range;
+}
+
+bool lookup(Locked& cache, uint64_t key) {
+  // get() promotes, so even a hit needs the exclusive lock.
+  auto locked = cache.wlock();
+  auto it = locked->find(key);
+  if (it != locked->end()) {
+    folly::doNotOptimizeAway(it->second);
+    return true;
+  }
+  return false;
+}
+
+bool lookup(Concurrent& cache, uint64_t key) {
+  auto ref = cache.find(key);
+  if (ref) {
+    folly::doNotOptimizeAway(*ref);
+  }
+  return !!ref;
+}
+
+void insert(Locked& cache, uint64_t key) {
+  cache.wlock()->set(key, key);
+}
+
+void insert(Concurrent& cache, uint64_t key) {
+  cache.set(key, key);
+}
+
+std::unique_ptr<Locked> makeCache(Locked*, size_t capacity) {
+  return std::make_unique<Locked>(std::in_place, capacity);
+}
+
+std::unique_ptr<Concurrent> makeCache(Concurrent*, size_t capacity) {
+  return std::make_unique<Concurrent>(capacity);
+}
+
+// Each thread looks keys up in [0, keyRange), inserting on a miss. With
+// keyRange below capacity this is the all-hit read path; above it, the
+// miss rate and so the share of evicting writes grows.
+template <typename Cache>
+void bench_lookup(int nthr, uint64_t keyRange, const std::string& name) {
+  int ops = FLAGS_ops;
+  auto repFn = [&] {
+    auto cache = makeCache(static_cast<Cache*>(nullptr), FLAGS_capacity);
+    for (uint64_t k = 0; k < std::min<uint64_t>(keyRange, FLAGS_capacity);
+         ++k) {
+      insert(*cache, k);
+    }
+    return run_once(nthr, [&](int tid) {
+      uint64_t state = 0x9e3779b97f4a7c15ULL * (tid + 1);
+      for (int i = 0; i < ops; ++i) {
+        auto key = nextKey(state, keyRange);
+        if (!lookup(*cache, key)) {
+          insert(*cache, key);
+        }
+      }
+    });
+  };
+  runBench(name, ops, repFn);
+}
+
+void dottedLine() {
+  std::cout << ".............................................................."
+            << std::endl;
+}
+
+void benches() {
+  std::cout << "=============================================================="
+            << std::endl;
+  std::cout << "Test name                          Max time  Avg time  Min time"
+            << std::endl;
+  const uint64_t cap = FLAGS_capacity;
+  for (int nthr = 1; nthr <= FLAGS_max_threads; nthr *= 2) {
+    std::cout << "========================= " << std::setw(3) << nthr
+              << " threads" << " =========================" << std::endl;
+    bench_lookup<Locked>(nthr, cap / 2, "Synchronized<ECM> all hits      ");
+    bench_lookup<Concurrent>(nthr, cap / 2, "ConcurrentECM     all hits      ");
+    dottedLine();
+    bench_lookup<Locked>(
+        nthr, cap * 11 / 10, "Synchronized<ECM> ~10% misses   ");
+    bench_lookup<Concurrent>(
+        nthr, cap * 11 / 10, "ConcurrentECM     ~10% misses   ");
+    dottedLine();
+    bench_lookup<Locked>(nthr, cap * 2, "Synchronized<ECM> ~50% misses   ");
+    bench_lookup<Concurrent>(nthr, cap * 2, "ConcurrentECM     ~50% misses   ");
+  }
+  std::cout << "=============================================================="
+            << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  folly::gflags::ParseCommandLineFlags(&argc, &argv, true);
+  benches();
+}
@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/container/ConcurrentEvictingCacheMap.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <folly/portability/GTest.h>
+
+using folly::ConcurrentEvictingCacheMap;
+
+namespace {
+
+// Tests that check eviction order use a single shard, which makes it
+// deterministic.
+using Map = ConcurrentEvictingCacheMap<int, int>;
+
+} // namespace
+
+TEST(ConcurrentEvictingCacheMapTest, SetGetErase) {
+  Map map(10, 1);
+  EXPECT_TRUE(map.empty());
+
+  map.set(1, 10);
+  EXPECT_TRUE(map.exists(1));
+  EXPECT_EQ(10, map.get(1));
+  EXPECT_EQ(10, *map.find(1));
+  EXPECT_EQ(1, map.size());
+
+  map.set(1, 20);
+  EXPECT_EQ(20, map.get(1));
+  EXPECT_EQ(1, map.size()) << "replacing must not add an entry";
+
+  EXPECT_FALSE(map.insert(1, 30));
+  EXPECT_EQ(20, map.get(1));
+  EXPECT_TRUE(map.insert(2, 30));
+  EXPECT_EQ(2, map.size());
+
+  EXPECT_TRUE(map.erase(1));
+  EXPECT_FALSE(map.erase(1));
+  EXPECT_FALSE(map.exists(1));
+  EXPECT_FALSE(static_cast<bool>(map.find(1)));
+  EXPECT_THROW(map.get(1), std::out_of_range);
+  EXPECT_EQ(1, map.size());
+}
+
+TEST(ConcurrentEvictingCacheMapTest, EvictsInAdmissionOrderWhenUnreferenced) {
+  Map map(3, 1);
+  std::vector<int> pruned;
+  map.setPruneHook([&](int key, int&& value) {
+    EXPECT_EQ(key * 10, value);
+    pruned.push_back(key);
+  });
+
+  for (int i = 0; i < 6; ++i) {
+    map.set(i, i * 10);
+  }
+  EXPECT_EQ(3, map.size());
+  EXPECT_EQ((std::vector<int>{0, 1, 2}), pruned);
+  for (int i = 3; i < 6; ++i) {
+    EXPECT_TRUE(map.exists(i));
+  }
+}
+
+TEST(ConcurrentEvictingCacheMapTest, ReferencedEntryGetsSecondChance) {
+  Map map(3, 1);
+  map.set(0, 0);
+  map.set(1, 1);
+  map.set(2, 2);
+
+  // A hit marks 0 recently used, so admitting 3 evicts 1 instead.
+  EXPECT_TRUE(static_cast<bool>(map.find(0)));
+  map.set(3, 3);
+  EXPECT_TRUE(map.exists(0));
+  EXPECT_FALSE(map.exists(1));
+
+  // Lookups without promotion do not protect an entry.
+  EXPECT_TRUE(static_cast<bool>(map.findWithoutPromotion(2)));
+  map.set(4, 4);
+  EXPECT_FALSE(map.exists(2));
+}
+
+TEST(ConcurrentEvictingCacheMapTest, EraseHookAndPruneHookOverride) {
+  Map map(2, 1);
+  int erased = -1;
+  EXPECT_TRUE(map.erase(7, [&](int, int&&) { erased = 7; }) == false);
+  map.set(7, 70);
+  EXPECT_TRUE(map.erase(7, [&](int key, int&& value) {
+    erased = key + value;
+  }));
+  EXPECT_EQ(77, erased);
+
+  int defaultHookCalls = 0;
+  int overrideHookCalls = 0;
+  map.setPruneHook([&](int, int&&) { ++defaultHookCalls; });
+  map.set(1, 1);
+  map.set(2, 2);
+  map.set(3, 3, true, [&](int, int&&) { ++overrideHookCalls; });
+  EXPECT_EQ(0, defaultHookCalls);
+  EXPECT_EQ(1, overrideHookCalls);
+  map.set(4, 4);
+  EXPECT_EQ(1, defaultHookCalls);
+}
+
+TEST(ConcurrentEvictingCacheMapTest, ReinsertAfterEraseIsNotATombstone) {
+  Map map(2, 1);
+  std::vector<int> pruned;
+  map.setPruneHook([&](int key, int&&) { pruned.push_back(key); });
+
+  map.set(1, 1);
+  map.set(2, 2);
+  map.erase(1);
+  map.set(1, 1);
+  // The clock still holds the erased incarnation of 1 at the front, which
+  // must be skipped rather than evicting the fresh one.
+  map.set(3, 3);
+  EXPECT_EQ(std::vector<int>{2}, pruned);
+  EXPECT_TRUE(map.exists(1));
+  EXPECT_TRUE(map.exists(3));
+}
+
+TEST(ConcurrentEvictingCacheMapTest, SetMaxSizePruneAndClear) {
+  Map map(0, 4);
+  for (int i = 0; i < 100; ++i) {
+    map.set(i, i);
+  }
+  EXPECT_EQ(100, map.size()) << "maxSize 0 disables eviction";
+
+  size_t pruned = 0;
+  map.setMaxSize(40, [&](int, int&&) { ++pruned; });
+  EXPECT_EQ(40, map.getMaxSize());
+  EXPECT_LE(map.size(), 40);
+  EXPECT_EQ(100 - map.size(), pruned);
+
+  auto before = map.size();
+  map.prune(8);
+  EXPECT_EQ(before - 8, map.size());
+
+  map.clear();
+  EXPECT_TRUE(map.empty());
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_FALSE(map.exists(i));
+  }
+}
+
+TEST(ConcurrentEvictingCacheMapTest, ShardedCapacityBound) {
+  ConcurrentEvictingCacheMap<int, std::string> map(64, 8);
+  EXPECT_EQ(8, map.numShards());
+  for (int i = 0; i < 10000; ++i) {
+    map.set(i, std::to_string(i));
+  }
+  EXPECT_LE(map.size(), 64);
+  EXPECT_GE(map.size(), 8);
+}
+
+TEST(ConcurrentEvictingCacheMapTest, ConcurrentReadersAndWriters) {
+  constexpr int kThreads = 8;
+  constexpr int kKeys = 2048;
+  constexpr int kIters = 20000;
+  Map map(kKeys / 2, 16);
+  std::atomic<size_t> pruned{0};
+  map.setPruneHook([&](int key, int&& value) {
+    EXPECT_EQ(key, value);
+    pruned.fetch_add(1);
+  });
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < kIters; ++i) {
+        int key = (i * 7919 + t * 104729) % kKeys;
+        if (auto ref = map.find(key)) {
+          EXPECT_EQ(key, *ref);
+        } else if (i % 3 == 0) {
+          map.erase(key);
+        } else {
+          map.set(key, key);
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_LE(map.size(), kKeys / 2);
+  EXPECT_GT(pruned.load(), 0);
+}
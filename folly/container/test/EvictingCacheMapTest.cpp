@@ -17,6 +17,7 @@
 #include <folly/container/EvictingCacheMap.h>
 
 #include <set>
+#include <vector>
 
 #include <folly/portability/GTest.h>
 
@@ -889,3 +890,101 @@ TEST(EvictingCacheMap, SetClearSizeZeroClampingTest) {
   map.set(10, 10);
   EXPECT_EQ(5, map.size());
 }
+
+namespace {
+using TinyLfuMap = EvictingCacheMap<
+    int,
+    int,
+    HeterogeneousAccessHash<int>,
+    HeterogeneousAccessEqualTo<int>,
+    TinyLfuCachePolicy>;
+} // namespace
+
+TEST(EvictingCacheMap, TinyLfuBasics) {
+  TinyLfuMap map(10);
+  std::vector<int> pruned;
+  map.setPruneHook([&](int key, int&& value) {
+    EXPECT_EQ(key, value);
+    pruned.push_back(key);
+  });
+  for (int i = 0; i < 100; ++i) {
+    map.set(i, i);
+    EXPECT_TRUE(map.exists(i)) << "the newest entry is never evicted";
+    EXPECT_LE(map.size(), 10);
+  }
+  EXPECT_EQ(10, map.size());
+  EXPECT_EQ(90, pruned.size());
+
+  // Iteration is still in overall recency order.
+  int oldest = map.rbegin()->first;
+  map.get(oldest);
+  EXPECT_EQ(oldest, map.begin()->first);
+  EXPECT_EQ(99, std::next(map.begin())->first);
+  EXPECT_EQ(10, std::distance(map.begin(), map.end()));
+
+  EXPECT_TRUE(map.erase(oldest));
+  EXPECT_EQ(9, map.size());
+  map.prune(3);
+  EXPECT_EQ(6, map.size());
+  map.setMaxSize(2);
+  EXPECT_EQ(2, map.size());
+  map.clear();
+  EXPECT_TRUE(map.empty());
+}
+
+TEST(EvictingCacheMap, TinyLfuResistsScans) {
+  constexpr int kSize = 100;
+  EvictingCacheMap<int, int> lru(kSize);
+  TinyLfuMap tinyLfu(kSize);
+
+  auto access = [](auto& map, int key) {
+    if (map.find(key) == map.end()) {
+      map.set(key, key);
+    }
+  };
+  // A working set that is used repeatedly...
+  for (int round = 0; round < 5; ++round) {
+    for (int key = 0; key < kSize / 2; ++key) {
+      access(lru, key);
+      access(tinyLfu, key);
+    }
+  }
+  // ...then a scan of keys that are each used once.
+  for (int key = 1000; key < 1000 + 10 * kSize; ++key) {
+    access(lru, key);
+    access(tinyLfu, key);
+  }
+
+  int lruKept = 0;
+  int tinyLfuKept = 0;
+  for (int key = 0; key < kSize / 2; ++key) {
+    lruKept += lru.exists(key);
+    tinyLfuKept += tinyLfu.exists(key);
+  }
+  EXPECT_EQ(0, lruKept);
+  EXPECT_GE(tinyLfuKept, kSize / 2 - 2);
+}
+
+TEST(EvictingCacheMap, TinyLfuMoveAndUnbounded) {
+  TinyLfuMap map(0, 1, {}, {}, TinyLfuCachePolicy(20));
+  for (int i = 0; i < 1000; ++i) {
+    map.set(i, i);
+  }
+  EXPECT_EQ(1000, map.size()) << "maxSize 0 disables eviction";
+
+  TinyLfuMap moved(std::move(map));
+  EXPECT_EQ(1000, moved.size());
+  moved.setMaxSize(100);
+  EXPECT_EQ(100, moved.size());
+  EXPECT_TRUE(moved.exists(999));
+
+  TinyLfuMap assigned(5);
+  assigned.set(-1, -1);
+  assigned = std::move(moved);
+  EXPECT_EQ(100, assigned.size());
+  EXPECT_FALSE(assigned.exists(-1));
+  for (int i = 1000; i < 1100; ++i) {
+    assigned.set(i, i);
+    EXPECT_EQ(100, assigned.size());
+  }
+}
@@ -22,6 +22,8 @@
 #include <type_traits>
 #include <typeinfo>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include <glog/logging.h>
 
@@ -2749,3 +2751,49 @@ TEST(F14Map, insertRange) {
   testInsertRange<F14VectorMap>();
   testInsertRange<F14FastMap>();
 }
+
+template <template <class...> class TMap>
+void testFindManyInsertMany() {
+  using M = TMap<int, int>;
+  M m;
+  // Spans more than one group of prefetches.
+  std::vector<std::pair<int, int>> items;
+  for (int i = 0; i < 100; ++i) {
+    items.emplace_back(i * 2, i);
+  }
+  items.emplace_back(0, 1000);
+  std::vector<std::pair<typename M::iterator, bool>> inserted(items.size());
+  m.insertMany(items, inserted);
+  EXPECT_EQ(100, m.size());
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_TRUE(inserted[i].second);
+    EXPECT_EQ(i * 2, inserted[i].first->first);
+  }
+  EXPECT_FALSE(inserted.back().second);
+  EXPECT_TRUE(inserted.back().first == inserted.front().first);
+
+  std::vector<int> keys;
+  for (int i = 0; i < 200; ++i) {
+    keys.push_back(i);
+  }
+  std::vector<typename M::const_iterator> found(keys.size());
+  std::as_const(m).findMany(keys, found);
+  for (int i = 0; i < 200; ++i) {
+    if (i % 2 == 0) {
+      EXPECT_EQ(i / 2, found[i]->second);
+    } else {
+      EXPECT_TRUE(found[i] == m.cend());
+    }
+  }
+  std::vector<typename M::iterator> mutableFound(keys.size());
+  m.findMany(keys, mutableFound);
+  mutableFound[2]->second = -1;
+  EXPECT_EQ(-1, m.at(2));
+}
+
+TEST(F14Map, findManyInsertMany) {
+  testFindManyInsertMany<F14ValueMap>();
+  testFindManyInsertMany<F14NodeMap>();
+  testFindManyInsertMany<F14VectorMap>();
+  testFindManyInsertMany<F14FastMap>();
+}
@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/FileUtil.h>
+#include <folly/container/F14Map.h>
+#include <folly/container/F14SerializedMap.h>
+#include <folly/portability/GFlags.h>
+#include <folly/testing/TestUtil.h>
+
+FOLLY_GFLAGS_DEFINE_uint64(entries, uint64_t(1) << 22, "entries per map");
+
+using namespace folly;
+
+// Compares two ways for a process to start with a map of --entries
+// elements: reading a file of flat records and inserting them into an
+// F14ValueMap, and memory-mapping an F14SerializedMap image. Each startup
+// ends with one lookup, and is one iteration. Both files stay in the page
+// cache, so this measures the cost of building the map, not of I/O. The
+// lookup benchmarks compare find() on both maps once they are built, for
+// random keys that are all in the map.
+namespace {
+
+struct Row {
+  uint64_t id;
+  uint64_t timestamp;
+  double score;
+};
+
+struct Record {
+  uint64_t key;
+  Row row;
+};
+
+using Serialized = F14SerializedMap<uint64_t, Row>;
+
+// Reads a file of Records into a map.
+F14ValueMap<uint64_t, Row> rebuild(char const* path) {
+  std::string file;
+  readFile(path, file);
+  F14ValueMap<uint64_t, Row> map;
+  map.reserve(file.size() / sizeof(Record));
+  for (size_t pos = 0; pos < file.size(); pos += sizeof(Record)) {
+    Record record;
+    std::memcpy(&record, file.data() + pos, sizeof(Record));
+    map.emplace(record.key, record.row);
+  }
+  return map;
+}
+
+struct Data {
+  Data() {
+    std::mt19937_64 rng(0);
+    std::vector<Record> records;
+    records.reserve(FLAGS_entries);
+    for (uint64_t i = 0; i < FLAGS_entries; ++i) {
+      records.push_back(Record{rng(), Row{i, rng(), i / 3.0}});
+      keys.push_back(records.back().key);
+    }
+    writeFile(
+        ByteRange(
+            reinterpret_cast<unsigned char const*>(records.data()),
+            records.size() * sizeof(Record)),
+        recordFile.path().c_str());
+    writeFile(
+        Serialized::serialize(rebuild(recordFile.path().c_str())),
+        imageFile.path().c_str());
+    std::shuffle(keys.begin(), keys.end(), rng);
+  }
+
+  test::TemporaryFile recordFile;
+  test::TemporaryFile imageFile;
+  std::vector<uint64_t> keys;
+};
+
+Data& data() {
+  BenchmarkSuspender suspender;
+  static Data data;
+  return data;
+}
+
+Serialized open() {
+  return Serialized(MemoryMapping(data().imageFile.path().c_str()));
+}
+
+} // namespace
+
+BENCHMARK(startupRebuild, iters) {
+  auto& keys = data().keys;
+  for (size_t i = 0; i < iters; ++i) {
+    auto map = rebuild(data().recordFile.path().c_str());
+    doNotOptimizeAway(map.find(keys[i % keys.size()])->second.id);
+  }
+}
+
+BENCHMARK_RELATIVE(startupMapImage, iters) {
+  auto& keys = data().keys;
+  for (size_t i = 0; i < iters; ++i) {
+    auto map = open();
+    doNotOptimizeAway(map.find(keys[i % keys.size()])->id);
+  }
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(findRebuilt, iters) {
+  BenchmarkSuspender suspender;
+  auto map = rebuild(data().recordFile.path().c_str());
+  auto& keys = data().keys;
+  suspender.dismiss();
+  uint64_t sum = 0;
+  for (size_t i = 0; i < iters; ++i) {
+    sum += map.find(keys[i % keys.size()])->second.id;
+  }
+  doNotOptimizeAway(sum);
+}
+
+BENCHMARK_RELATIVE(findMapImage, iters) {
+  BenchmarkSuspender suspender;
+  auto map = open();
+  auto& keys = data().keys;
+  suspender.dismiss();
+  uint64_t sum = 0;
+  for (size_t i = 0; i < iters; ++i) {
+    sum += map.find(keys[i % keys.size()])->id;
+  }
+  doNotOptimizeAway(sum);
+}
+
+int main(int argc, char** argv) {
+  folly::gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
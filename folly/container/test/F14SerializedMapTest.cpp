@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/container/F14SerializedMap.h>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <folly/FileUtil.h>
+#include <folly/container/F14Map.h>
+#include <folly/portability/GTest.h>
+#include <folly/testing/TestUtil.h>
+
+#if FOLLY_F14_VECTOR_INTRINSICS_AVAILABLE
+
+using namespace folly;
+
+namespace {
+
+struct Row {
+  uint64_t id;
+  double score;
+  uint32_t flags;
+};
+
+// Copies an image into memory aligned like a mapping.
+struct AlignedImage {
+  explicit AlignedImage(std::string const& image, std::size_t skew = 0)
+      : buffer((image.size() + skew) / 16 + 1) {
+    std::memcpy(
+        reinterpret_cast<char*>(buffer.data()) + skew,
+        image.data(),
+        image.size());
+    range = ByteRange(
+        reinterpret_cast<unsigned char const*>(buffer.data()) + skew,
+        image.size());
+  }
+
+  struct alignas(16) Block {
+    char bytes[16];
+  };
+  std::vector<Block> buffer;
+  ByteRange range;
+};
+
+} // namespace
+
+TEST(F14SerializedMap, mappedFile) {
+  F14ValueMap<int, Row> rows;
+  for (int i = 0; i < 100000; ++i) {
+    rows[i * 7] = Row{uint64_t(i), i / 2.0, uint32_t(i % 3)};
+  }
+  test::TemporaryFile file;
+  writeFile(F14SerializedMap<int, Row>::serialize(rows), file.path().c_str());
+
+  F14SerializedMap<int, Row> map(MemoryMapping(file.path().c_str()));
+  EXPECT_EQ(rows.size(), map.size());
+  for (auto& [key, row] : rows) {
+    auto found = map.find(key);
+    ASSERT_NE(nullptr, found) << key;
+    EXPECT_EQ(row.id, found->id);
+    EXPECT_EQ(row.score, found->score);
+    EXPECT_EQ(row.flags, found->flags);
+  }
+  for (int i = 0; i < 100000; ++i) {
+    EXPECT_FALSE(map.contains(i * 7 + 1));
+  }
+  EXPECT_EQ(1, map.at(7).id);
+  EXPECT_THROW(map.at(8), std::out_of_range);
+}
+
+TEST(F14SerializedMap, stringKeys) {
+  F14NodeMap<std::string, uint64_t> words;
+  for (uint64_t i = 0; i < 10000; ++i) {
+    words[std::string(i % 50, 'x') + std::to_string(i)] = i;
+  }
+  words[""] = 12345;
+  AlignedImage image(F14SerializedMap<std::string, uint64_t>::serialize(words));
+  F14SerializedMap<std::string, uint64_t> map(image.range);
+  EXPECT_EQ(words.size(), map.size());
+  for (auto& [word, i] : words) {
+    ASSERT_TRUE(map.contains(word)) << word;
+    EXPECT_EQ(i, map.at(word));
+  }
+  EXPECT_FALSE(map.contains("x"));
+  EXPECT_FALSE(map.contains("10000"));
+}
+
+TEST(F14SerializedMap, empty) {
+  std::vector<std::pair<uint64_t, uint64_t>> none;
+  AlignedImage image(F14SerializedMap<uint64_t, uint64_t>::serialize(none));
+  F14SerializedMap<uint64_t, uint64_t> map(image.range);
+  EXPECT_TRUE(map.empty());
+  EXPECT_EQ(nullptr, map.find(0));
+  size_t visited = 0;
+  map.forEach([&](auto, auto) { ++visited; });
+  EXPECT_EQ(0, visited);
+}
+
+TEST(F14SerializedMap, forEach) {
+  std::vector<std::pair<std::string, int>> elements;
+  for (int i = 0; i < 1000; ++i) {
+    elements.emplace_back(std::to_string(i), i);
+  }
+  AlignedImage image(F14SerializedMap<std::string, int>::serialize(elements));
+  F14SerializedMap<std::string, int> map(image.range);
+  std::vector<int> seen(elements.size());
+  map.forEach([&](std::string_view key, int value) {
+    EXPECT_EQ(std::to_string(value), key);
+    ++seen.at(value);
+  });
+  EXPECT_EQ(std::vector<int>(elements.size(), 1), seen);
+}
+
+TEST(F14SerializedMap, badImages) {
+  std::vector<std::pair<uint64_t, uint64_t>> elements{{1, 2}, {3, 4}};
+  auto serialized = F14SerializedMap<uint64_t, uint64_t>::serialize(elements);
+
+  AlignedImage truncated(serialized.substr(0, serialized.size() - 1));
+  EXPECT_THROW(
+      (F14SerializedMap<uint64_t, uint64_t>(truncated.range)),
+      std::runtime_error);
+  AlignedImage header(serialized.substr(0, 8));
+  EXPECT_THROW(
+      (F14SerializedMap<uint64_t, uint64_t>(header.range)), std::runtime_error);
+  AlignedImage misaligned(serialized, 8);
+  EXPECT_THROW(
+      (F14SerializedMap<uint64_t, uint64_t>(misaligned.range)),
+      std::invalid_argument);
+
+  AlignedImage image(serialized);
+  EXPECT_THROW(
+      (F14SerializedMap<uint64_t, Row>(image.range)), std::runtime_error);
+  EXPECT_THROW(
+      (F14SerializedMap<std::string, uint64_t>(image.range)),
+      std::runtime_error);
+  F14SerializedMap<uint64_t, uint64_t> map(image.range);
+  EXPECT_EQ(4, map.at(3));
+}
+
+#endif // FOLLY_F14_VECTOR_INTRINSICS_AVAILABLE
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <span>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/Optional.h>
+#include <folly/concurrency/ConcurrentHashMap.h>
+#include <folly/container/F14Map.h>
+#include <folly/portability/GFlags.h>
+
+FOLLY_GFLAGS_DEFINE_uint64(
+    entries,
+    uint64_t(1) << 24,
+    "entries per map; the default makes the maps much larger than the LLC");
+FOLLY_GFLAGS_DEFINE_uint32(batch, 1024, "keys per findMany() call");
+
+using namespace folly;
+
+// Compares a loop of find() with findMany() on maps of --entries random
+// keys, for random keys half of which are in the map. Each iteration is one
+// lookup, so iters/s is lookups per second.
+namespace {
+
+constexpr size_t kLookupKeys = size_t(1) << 20;
+
+struct Data {
+  Data() {
+    std::mt19937_64 rng(0);
+    std::vector<uint64_t> present;
+    present.reserve(FLAGS_entries);
+    f14.reserve(FLAGS_entries);
+    for (uint64_t i = 0; i < FLAGS_entries; ++i) {
+      auto key = rng();
+      present.push_back(key);
+      f14.emplace(key, i);
+      chm.insert(key, i);
+    }
+    keys.reserve(kLookupKeys);
+    for (size_t i = 0; i < kLookupKeys; ++i) {
+      keys.push_back(i % 2 ? rng() : present[rng() % present.size()]);
+    }
+  }
+
+  F14FastMap<uint64_t, uint64_t> f14;
+  ConcurrentHashMap<uint64_t, uint64_t> chm;
+  std::vector<uint64_t> keys;
+};
+
+Data& data() {
+  BenchmarkSuspender suspender;
+  static Data data;
+  return data;
+}
+
+// Calls fn(keys) over batches of the lookup keys, for iters keys in total.
+template <typename Fn>
+void forEachBatch(size_t iters, Fn fn) {
+  std::span<const uint64_t> keys = data().keys;
+  for (size_t i = 0; i < iters;) {
+    auto offset = i % keys.size();
+    auto n = std::min<size_t>(
+        {FLAGS_batch, keys.size() - offset, iters - i});
+    fn(keys.subspan(offset, n));
+    i += n;
+  }
+}
+
+} // namespace
+
+BENCHMARK(f14Find, iters) {
+  auto& map = data().f14;
+  size_t found = 0;
+  forEachBatch(iters, [&](std::span<const uint64_t> keys) {
+    for (auto key : keys) {
+      found += map.find(key) != map.end();
+    }
+  });
+  doNotOptimizeAway(found);
+}
+
+BENCHMARK_RELATIVE(f14FindMany, iters) {
+  auto& map = data().f14;
+  std::vector<F14FastMap<uint64_t, uint64_t>::const_iterator> out(
+      FLAGS_batch);
+  size_t found = 0;
+  forEachBatch(iters, [&](std::span<const uint64_t> keys) {
+    std::as_const(map).findMany(keys, out);
+    for (size_t i = 0; i < keys.size(); ++i) {
+      found += out[i] != map.cend();
+    }
+  });
+  doNotOptimizeAway(found);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(concurrentHashMapFind, iters) {
+  auto& map = data().chm;
+  size_t found = 0;
+  forEachBatch(iters, [&](std::span<const uint64_t> keys) {
+    for (auto key : keys) {
+      found += map.find(key) != map.cend();
+    }
+  });
+  doNotOptimizeAway(found);
+}
+
+BENCHMARK_RELATIVE(concurrentHashMapFindMany, iters) {
+  auto& map = data().chm;
+  std::vector<Optional<uint64_t>> out(FLAGS_batch);
+  size_t found = 0;
+  forEachBatch(iters, [&](std::span<const uint64_t> keys) {
+    found += map.findMany(keys, out);
+  });
+  doNotOptimizeAway(found);
+}
+
+int main(int argc, char** argv) {
+  folly::gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
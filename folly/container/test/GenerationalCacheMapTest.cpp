@@ -192,3 +192,75 @@ TEST(GenerationalCacheMapTest, ConcurrentUse) {
   // thread in flight when the waiting kicks in.
   EXPECT_LE(map.size(), 2 * kCapacity + 16 * kThreads);
 }
+
+TEST(GenerationalCacheMapTest, TinyLfuAdmitsOnSecondInsertion) {
+  using TinyLfuMap = GenerationalCacheMap<
+      uint64_t,
+      uint64_t,
+      std::hash<uint64_t>,
+      std::equal_to<uint64_t>,
+      folly::TinyLfuCachePolicy>;
+  constexpr uint64_t kCapacity = 512;
+  constexpr uint64_t kWorkingSet = 64;
+  TinyLfuMap map(kCapacity);
+
+  map.set(1, 10);
+  EXPECT_FALSE(map.find(1)) << "a first insertion is not admitted";
+  map.set(1, 10);
+  ASSERT_TRUE(map.find(1));
+  EXPECT_EQ(10, *map.find(1));
+  map.set(1, 11);
+  EXPECT_EQ(11, *map.find(1)) << "replacing is never gated";
+
+  for (int round = 0; round < 3; ++round) {
+    for (uint64_t i = 0; i < kWorkingSet; ++i) {
+      if (!map.find(0x2000000 + i)) {
+        map.set(0x2000000 + i, i);
+      }
+    }
+  }
+  // Keys that are never seen again are mostly not admitted, so they cannot
+  // rotate the working set out. (Mostly: sketch collisions let a few through,
+  // more as the scan outgrows the sketch.)
+  for (uint64_t i = 0; i < 2 * kCapacity; ++i) {
+    map.set(0x1000000 + i, i);
+  }
+  EXPECT_EQ(0, map.rotations());
+  for (uint64_t i = 0; i < kWorkingSet; ++i) {
+    EXPECT_TRUE(map.find(0x2000000 + i));
+  }
+}
+
+namespace {
+
+// Admits only even keys, and has no segments.
+struct EvenKeysPolicy {
+  static constexpr bool kSegmented = false;
+  static constexpr bool kAdmits = true;
+
+  void reserve(std::size_t) {}
+  void recordAccess(std::size_t) {}
+  bool admit(std::size_t, std::size_t) const { return true; }
+  bool admit(std::size_t candidate) const { return candidate % 2 == 0; }
+  std::size_t windowSize(std::size_t) const { return 0; }
+};
+
+struct IdentityHash {
+  size_t operator()(uint64_t key) const { return key; }
+};
+
+} // namespace
+
+TEST(GenerationalCacheMapTest, UnsegmentedPolicyGatesInsertions) {
+  GenerationalCacheMap<
+      uint64_t,
+      uint64_t,
+      IdentityHash,
+      std::equal_to<uint64_t>,
+      EvenKeysPolicy>
+      map(64);
+  map.set(2, 20);
+  map.set(3, 30);
+  EXPECT_TRUE(map.find(2));
+  EXPECT_FALSE(map.find(3));
+}
@@ -821,3 +821,41 @@ TEST(WeightedEvictingCacheMap, PruneHook) {
   EXPECT_EQ(std::get<1>(prunedValues[1]), 5);
   EXPECT_EQ(std::get<2>(prunedValues[1]), 6);
 }
+
+TEST(WeightedEvictingCacheMap, TinyLfu) {
+  WeightedEvictingCacheMap<
+      int,
+      int,
+      HeterogeneousAccessHash<int>,
+      HeterogeneousAccessEqualTo<int>,
+      TinyLfuCachePolicy>
+      // Varying weights mean some insertions evict more than one entry,
+      // which a window bigger than the default keeps supplied with candidates.
+      map(200, {}, {}, TinyLfuCachePolicy(10));
+  auto access = [&](int key, size_t weight) {
+    if (map.find(key) == map.end()) {
+      map.set(key, key, weight);
+    }
+  };
+  // Fifty popular entries of weight 2, then a scan of one-off entries.
+  for (int round = 0; round < 5; ++round) {
+    for (int key = 0; key < 50; ++key) {
+      access(key, 2);
+    }
+  }
+  for (int key = 1000; key < 2000; ++key) {
+    access(key, 1 + key % 3);
+    EXPECT_LE(map.getCurrentTotalWeight(), 200);
+    EXPECT_TRUE(map.exists(key));
+  }
+  int kept = 0;
+  for (int key = 0; key < 50; ++key) {
+    kept += map.exists(key);
+  }
+  EXPECT_GE(kept, 45);
+
+  auto moved = std::move(map);
+  EXPECT_LE(moved.getCurrentTotalWeight(), 200);
+  moved.setMaxTotalWeight(20);
+  EXPECT_LE(moved.getCurrentTotalWeight(), 20);
+}
@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <memory>
+
+#include <folly/Benchmark.h>
+#include <folly/coro/BlockingWait.h>
+#include <folly/coro/Collect.h>
+#include <folly/coro/CurrentExecutor.h>
+#include <folly/coro/Generator.h>
+#include <folly/coro/Task.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/executors/WorkStealingThreadPoolExecutor.h>
+#include <folly/portability/GFlags.h>
+
+FOLLY_GFLAGS_DEFINE_uint32(threads, 4, "threads of each executor");
+
+using namespace folly;
+
+// A deep co_await chain: each level reschedules on its executor, as if it
+// awaited something that completed on the same worker, and then awaits the
+// next level. Every level is one continuation added from a worker thread,
+// and each iteration is one level. The latency benchmarks run one chain at
+// a time; the throughput benchmarks run many chains at once.
+namespace {
+
+constexpr size_t kDepth = 1000;
+constexpr size_t kChains = 64;
+
+coro::Task<size_t> chain(size_t depth) {
+  if (depth == 0) {
+    co_return 0;
+  }
+  co_await coro::co_reschedule_on_current_executor;
+  co_return 1 + co_await chain(depth - 1);
+}
+
+std::unique_ptr<Executor> makeCPU() {
+  return std::make_unique<CPUThreadPoolExecutor>(FLAGS_threads);
+}
+
+std::unique_ptr<Executor> makeWorkStealing(bool lifoSlot) {
+  return std::make_unique<WorkStealingThreadPoolExecutor>(
+      FLAGS_threads,
+      std::make_shared<NamedThreadFactory>("WorkStealingTP"),
+      WorkStealingThreadPoolExecutor::Options().setLifoSlot(lifoSlot));
+}
+
+template <class MakeExecutor>
+void latency(size_t iters, MakeExecutor makeExecutor) {
+  BenchmarkSuspender suspender;
+  auto executor = makeExecutor();
+  suspender.dismiss();
+
+  for (size_t done = 0; done < iters; done += kDepth) {
+    auto depth = std::min(kDepth, iters - done);
+    doNotOptimizeAway(
+        coro::blockingWait(co_withExecutor(executor.get(), chain(depth))));
+  }
+
+  suspender.rehire();
+  executor.reset();
+}
+
+template <class MakeExecutor>
+void throughput(size_t iters, MakeExecutor makeExecutor) {
+  BenchmarkSuspender suspender;
+  auto executor = makeExecutor();
+  suspender.dismiss();
+
+  for (size_t done = 0; done < iters; done += kChains * kDepth) {
+    auto depth = std::max<size_t>(
+        std::min(kChains * kDepth, iters - done) / kChains, 1);
+    coro::blockingWait(co_withExecutor(
+        executor.get(),
+        coro::collectAllRange(
+            [depth]() -> coro::Generator<coro::Task<size_t>&&> {
+              for (size_t i = 0; i < kChains; ++i) {
+                co_yield chain(depth);
+              }
+            }())));
+  }
+
+  suspender.rehire();
+  executor.reset();
+}
+
+} // namespace
+
+BENCHMARK(latencyCPU, iters) {
+  latency(iters, makeCPU);
+}
+
+BENCHMARK_RELATIVE(latencyWorkStealing, iters) {
+  latency(iters, [] { return makeWorkStealing(false); });
+}
+
+BENCHMARK_RELATIVE(latencyWorkStealingLifoSlot, iters) {
+  latency(iters, [] { return makeWorkStealing(true); });
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(throughputCPU, iters) {
+  throughput(iters, makeCPU);
+}
+
+BENCHMARK_RELATIVE(throughputWorkStealing, iters) {
+  throughput(iters, [] { return makeWorkStealing(false); });
+}
+
+BENCHMARK_RELATIVE(throughputWorkStealingLifoSlot, iters) {
+  throughput(iters, [] { return makeWorkStealing(true); });
+}
+
+int main(int argc, char** argv) {
+  folly::gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -16,10 +16,15 @@
 
 #include <folly/executors/IOThreadPoolExecutor.h>
 
+#include <algorithm>
+
 #include <glog/logging.h>
 
+#include <folly/String.h>
 #include <folly/detail/MemoryIdler.h>
+#include <folly/net/NetOps.h>
 #include <folly/portability/GFlags.h>
+#include <folly/portability/Sockets.h>
 #include <folly/system/ThreadId.h>
 
 FOLLY_GFLAGS_DEFINE_bool(
@@ -126,7 +131,14 @@ IOThreadPoolExecutor::IOThreadPoolExecutor(
       isWaitForAll_(options.waitForAll),
       nextThread_(0),
       eventBaseManager_(ebm),
-      maxReadAtOnce_(options.maxReadAtOnce) {
+      maxReadAtOnce_(options.maxReadAtOnce),
+      busyPoll_(options.busyPoll),
+      numaTopology_(std::move(options.numaTopology)),
+      pinThreadsToNumaNode_(options.pinThreadsToNumaNode) {
+  if (numaTopology_ && numaTopology_->numNodes() > 0) {
+    numaNodeThreads_ =
+        std::make_unique<std::atomic<size_t>[]>(numaTopology_->numNodes());
+  }
   setNumThreads(maxThreads);
   registerThreadPoolExecutor(this);
   if (options.enableThreadIdCollection) {
@@ -195,6 +207,41 @@ IOThreadPoolExecutor::pickThread() {
   return std::static_pointer_cast<IOThread>(thread);
 }
 
+std::shared_ptr<IOThreadPoolExecutor::IOThread>
+IOThreadPoolExecutor::pickThreadForCpu(
+    size_t cpu, std::optional<unsigned int> napiId) {
+  auto node =
+      numaTopology_ ? numaTopology_->nodeOf(cpu) : NumaTopology::kUnknownNode;
+  if (node == NumaTopology::kUnknownNode) {
+    return pickThread();
+  }
+  auto& ths = threadList_.get();
+  auto onNode = [node](const ThreadPtr& thread) {
+    return static_cast<const IOThread&>(*thread).numaNode == node;
+  };
+  size_t n = std::count_if(ths.begin(), ths.end(), onNode);
+  if (n == 0) {
+    // Fewer threads than nodes.
+    return pickThread();
+  }
+  // Keep the connections of a NIC queue, or else of a cpu, on one thread.
+  // cpus go by their index in the node, since their ids may interleave
+  // across nodes (0, 2, 4, ... on node 0), which would leave out threads.
+  size_t k;
+  if (napiId) {
+    k = *napiId % n;
+  } else {
+    auto& cpus = numaTopology_->cpusByNode[node];
+    k = (std::lower_bound(cpus.begin(), cpus.end(), cpu) - cpus.begin()) % n;
+  }
+  for (const auto& thread : ths) {
+    if (onNode(thread) && k-- == 0) {
+      return std::static_pointer_cast<IOThread>(thread);
+    }
+  }
+  return pickThread();
+}
+
 EventBase* IOThreadPoolExecutor::getEventBase() {
   ensureActiveThreads();
   std::shared_lock r{threadListLock_};
@@ -204,6 +251,43 @@ EventBase* IOThreadPoolExecutor::getEventBase() {
   return pickThread()->eventBase;
 }
 
+EventBase* IOThreadPoolExecutor::getEventBaseForCpu(
+    size_t cpu, std::optional<unsigned int> napiId) {
+  ensureActiveThreads();
+  std::shared_lock r{threadListLock_};
+  if (threadList_.get().empty()) {
+    throw std::runtime_error("No threads available");
+  }
+  return pickThreadForCpu(cpu, napiId)->eventBase;
+}
+
+EventBase* IOThreadPoolExecutor::getEventBaseForSocket(NetworkSocket fd) {
+  if (!numaTopology_) {
+    return getEventBase();
+  }
+  std::optional<unsigned int> napiId;
+#ifdef SO_INCOMING_NAPI_ID
+  unsigned int id = 0;
+  socklen_t idLen = sizeof(id);
+  // 0 if the connection did not arrive through a NAPI device (loopback).
+  if (netops::getsockopt(fd, SOL_SOCKET, SO_INCOMING_NAPI_ID, &id, &idLen) ==
+          0 &&
+      id != 0) {
+    napiId = id;
+  }
+#endif
+#ifdef SO_INCOMING_CPU
+  int cpu = -1;
+  socklen_t cpuLen = sizeof(cpu);
+  if (netops::getsockopt(fd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &cpuLen) ==
+          0 &&
+      cpu >= 0) {
+    return getEventBaseForCpu(size_t(cpu), napiId);
+  }
+#endif
+  return getEventBase();
+}
+
 std::vector<Executor::KeepAlive<EventBase>>
 IOThreadPoolExecutor::getAllEventBases() {
   ensureMaxActiveThreads();
@@ -221,8 +305,22 @@ EventBaseManager* IOThreadPoolExecutor::getEventBaseManager() {
   return eventBaseManager_;
 }
 
+// threadListLock_ is writelocked
 std::shared_ptr<ThreadPoolExecutor::Thread> IOThreadPoolExecutor::makeThread() {
-  return std::make_shared<IOThread>();
+  auto thread = std::make_shared<IOThread>();
+  if (numaNodeThreads_) {
+    // Give the new thread to the node with the fewest.
+    size_t node = 0;
+    for (size_t i = 1; i < numaTopology_->numNodes(); ++i) {
+      if (numaNodeThreads_[i].load(std::memory_order_relaxed) <
+          numaNodeThreads_[node].load(std::memory_order_relaxed)) {
+        node = i;
+      }
+    }
+    numaNodeThreads_[node].fetch_add(1, std::memory_order_relaxed);
+    thread->numaNode = node;
+  }
+  return thread;
 }
 
 void IOThreadPoolExecutor::threadRun(ThreadPtr thread) {
@@ -230,10 +328,20 @@ void IOThreadPoolExecutor::threadRun(ThreadPtr thread) {
 
   const auto& ioThread = *thisThread_ =
       std::static_pointer_cast<IOThread>(thread);
+  if (numaNodeThreads_ && pinThreadsToNumaNode_) {
+    // Before creating the EventBase, so that it is allocated node-local.
+    if (!numaTopology_->pinCurrentThreadToNode(ioThread->numaNode)) {
+      VLOG(1) << "IOThreadPoolExecutor: failed to pin thread to NUMA node "
+              << ioThread->numaNode << ": " << errnoStr(errno);
+    }
+  }
   ioThread->eventBase = eventBaseManager_->getEventBase();
   if (maxReadAtOnce_) {
     ioThread->eventBase->setMaxReadAtOnce(*maxReadAtOnce_);
   }
+  if (busyPoll_) {
+    ioThread->eventBase->setBusyPoll(*busyPoll_);
+  }
 
   auto tid = folly::getOSThreadID();
   if (threadIdCollector_) {
@@ -304,6 +412,10 @@ void IOThreadPoolExecutor::threadRun(ThreadPtr thread) {
   std::lock_guard guard(ioThread->eventBaseShutdownMutex_);
   ioThread->eventBase = nullptr;
   eventBaseManager_->clearEventBase();
+  if (numaNodeThreads_) {
+    numaNodeThreads_[ioThread->numaNode].fetch_sub(
+        1, std::memory_order_relaxed);
+  }
 }
 
 // threadListLock_ is writelocked
@@ -21,7 +21,9 @@
 #include <folly/executors/QueueObserver.h>
 #include <folly/executors/ThreadPoolExecutor.h>
 #include <folly/io/async/EventBaseManager.h>
+#include <folly/net/NetworkSocket.h>
 #include <folly/synchronization/RelaxedAtomic.h>
+#include <folly/system/NumaTopology.h>
 
 FOLLY_GFLAGS_DECLARE_int32(folly_iothreadpoolexecutor_max_read_at_once);
 
@@ -104,10 +106,33 @@ class IOThreadPoolExecutor : public IOThreadPoolExecutorBase {
       this->maxReadAtOnce = w;
       return *this;
     }
+    Options& setBusyPoll(EventBase::BusyPollOptions b) {
+      this->busyPoll = b;
+      return *this;
+    }
+    Options& setNumaTopology(NumaTopology t) {
+      this->numaTopology = std::move(t);
+      return *this;
+    }
+    Options& setPinThreadsToNumaNode(bool b) {
+      this->pinThreadsToNumaNode = b;
+      return *this;
+    }
 
     bool waitForAll;
     bool enableThreadIdCollection;
     std::optional<uint32_t> maxReadAtOnce;
+    // Busy polling for the event bases, see EventBase::BusyPollOptions.
+    std::optional<EventBase::BusyPollOptions> busyPoll;
+    // If set, the threads are spread evenly over the nodes of this topology
+    // (usually NumaTopology::system()), and getEventBaseForCpu() and
+    // getEventBaseForSocket() place connections on a thread of the node
+    // they arrive on.
+    std::optional<NumaTopology> numaTopology;
+    // With numaTopology, whether to pin each thread to the cpus of its node.
+    // The thread's EventBase and backend are created after pinning, so they
+    // are allocated from node-local memory (on first touch).
+    bool pinThreadsToNumaNode{true};
   };
 
   explicit IOThreadPoolExecutor(
@@ -142,6 +167,25 @@ class IOThreadPoolExecutor : public IOThreadPoolExecutorBase {
 
   static folly::EventBase* getEventBase(ThreadPoolExecutor::ThreadHandle* h);
 
+  /**
+   * Returns the EventBase to handle a connection whose packets are received
+   * on `cpu`, and optionally from the NIC queue with NAPI ID `napiId`: one
+   * of a thread on the same NUMA node as `cpu`. The connections of a cpu,
+   * or of a NIC queue if known, all go to the same thread.
+   *
+   * Without Options::numaTopology, or for a cpu of no node, picks an
+   * EventBase round-robin like getEventBase().
+   */
+  folly::EventBase* getEventBaseForCpu(
+      size_t cpu, std::optional<unsigned int> napiId = std::nullopt);
+
+  /**
+   * getEventBaseForCpu() for the SO_INCOMING_CPU and SO_INCOMING_NAPI_ID of
+   * a connected (e.g. just accepted) socket. Falls back to round-robin
+   * where the kernel does not report them.
+   */
+  folly::EventBase* getEventBaseForSocket(NetworkSocket fd);
+
   folly::EventBaseManager* getEventBaseManager() override;
 
   // Returns nullptr unless explicitly enabled through constructor
@@ -155,6 +199,8 @@ class IOThreadPoolExecutor : public IOThreadPoolExecutorBase {
     std::atomic<size_t> pendingTasks{0};
     folly::EventBase* eventBase{nullptr};
     std::mutex eventBaseShutdownMutex_;
+    // With Options::numaTopology, the node this thread serves.
+    size_t numaNode{NumaTopology::kUnknownNode};
   };
 
   void handleObserverRegisterThread(
@@ -165,6 +211,8 @@ class IOThreadPoolExecutor : public IOThreadPoolExecutorBase {
  private:
   ThreadPtr makeThread() override;
   std::shared_ptr<IOThread> pickThread();
+  std::shared_ptr<IOThread> pickThreadForCpu(
+      size_t cpu, std::optional<unsigned int> napiId);
   void threadRun(ThreadPtr thread) override;
   void stopThreads(size_t n) override;
   size_t getPendingTaskCountImpl() const override final;
@@ -174,6 +222,11 @@ class IOThreadPoolExecutor : public IOThreadPoolExecutorBase {
   folly::EventBaseManager* eventBaseManager_;
   std::unique_ptr<ThreadIdWorkerProvider> threadIdCollector_;
   const std::optional<uint32_t> maxReadAtOnce_;
+  const std::optional<EventBase::BusyPollOptions> busyPoll_;
+  const std::optional<NumaTopology> numaTopology_;
+  const bool pinThreadsToNumaNode_;
+  // The number of live threads of each node, to place new ones.
+  std::unique_ptr<std::atomic<size_t>[]> numaNodeThreads_;
 };
 
 FOLLY_POP_WARNING
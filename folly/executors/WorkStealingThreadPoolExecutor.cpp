@@ -0,0 +1,383 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/executors/WorkStealingThreadPoolExecutor.h>
+
+#include <cerrno>
+#include <shared_mutex>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include <folly/Random.h>
+#include <folly/ScopeGuard.h>
+#include <folly/String.h>
+#include <folly/portability/Asm.h>
+
+namespace folly {
+
+namespace {
+
+// A worker takes from the injection queue before its own deque once every
+// this many tasks (a prime, so it doesn't resonate with task patterns).
+constexpr size_t kInjectionQueueInterval = 61;
+
+// A worker runs at most this many tasks from its LIFO slot in a row, so
+// that two tasks that keep adding each other can't starve its deque.
+constexpr size_t kMaxLifoSlotRuns = 3;
+
+// Rounds of looking for a task before going to sleep. Idle workers steal
+// from LIFO slots only in the second half.
+constexpr size_t kSpinRounds = 16;
+
+} // namespace
+
+WorkStealingThreadPoolExecutor::WorkStealingThreadPoolExecutor(
+    size_t numThreads,
+    std::shared_ptr<ThreadFactory> threadFactory,
+    Options options)
+    : ThreadPoolExecutor(numThreads, numThreads, std::move(threadFactory)),
+      numaTopology_(
+          options.numaTopology && options.numaTopology->numNodes() > 0
+              ? std::move(options.numaTopology)
+              : std::nullopt),
+      pinThreadsToNumaNode_(options.pinThreadsToNumaNode),
+      lifoSlot_(options.lifoSlot) {
+  setNumThreads(numThreads);
+  registerThreadPoolExecutor(this);
+}
+
+WorkStealingThreadPoolExecutor::~WorkStealingThreadPoolExecutor() {
+  deregisterThreadPoolExecutor(this);
+  stop();
+  destroyTaskObservers();
+  CHECK_EQ(threadsToStop_.load(), 0);
+  // stop() leaves behind the tasks that did not start.
+  while (auto task = injectionQueue_.try_dequeue()) {
+    delete *task;
+  }
+  for (auto& worker : workers_) {
+    delete worker->lifoSlot.exchange(nullptr, std::memory_order_acquire);
+    while (auto task = worker->deque.pop()) {
+      delete *task;
+    }
+  }
+}
+
+void WorkStealingThreadPoolExecutor::add(Func func) {
+  add(std::move(func), std::chrono::milliseconds(0));
+}
+
+void WorkStealingThreadPoolExecutor::add(
+    Func func, std::chrono::milliseconds expiration, Func expireCallback) {
+  auto task = std::make_unique<Task>(
+      std::move(func),
+      folly::RequestContext::saveContext(),
+      expiration,
+      std::move(expireCallback));
+  registerTaskEnqueue(*task);
+
+  // As in CPUThreadPoolExecutor, the executor may be gone once the task is
+  // enqueued, unless we hold a KeepAlive.
+  bool mayNeedToAddThreads = activeThreads_.load(std::memory_order_relaxed) <
+      maxThreads_.load(std::memory_order_relaxed);
+  folly::Executor::KeepAlive<> ka = mayNeedToAddThreads
+      ? getKeepAliveToken(this)
+      : folly::Executor::KeepAlive<>{};
+
+  enqueue(task.release());
+
+  if (mayNeedToAddThreads) {
+    ensureActiveThreads();
+  }
+}
+
+size_t WorkStealingThreadPoolExecutor::getTaskQueueSize() const {
+  std::shared_lock r{threadListLock_};
+  return getPendingTaskCountImpl();
+}
+
+WorkStealingThreadPoolExecutor::Worker*&
+WorkStealingThreadPoolExecutor::threadWorker() {
+  static thread_local Worker* worker = nullptr;
+  return worker;
+}
+
+WorkStealingThreadPoolExecutor::Worker*
+WorkStealingThreadPoolExecutor::currentWorker() const {
+  auto* worker = threadWorker();
+  // A task may add to another pool.
+  return worker != nullptr && worker->pool == this ? worker : nullptr;
+}
+
+void WorkStealingThreadPoolExecutor::enqueue(Task* task) {
+  if (auto* worker = currentWorker()) {
+    if (lifoSlot_) {
+      task = worker->lifoSlot.exchange(task, std::memory_order_acq_rel);
+    }
+    if (task != nullptr) {
+      worker->deque.push(task);
+    }
+  } else {
+    injectionQueue_.enqueue(task);
+  }
+  notifyIdleWorker();
+}
+
+void WorkStealingThreadPoolExecutor::notifyIdleWorker() {
+  // Pairs with the fences in waitForTask(): either we see the spinning or
+  // sleeping worker here, or it sees the task we just enqueued. A spinning
+  // worker will find the task, and wake another worker if it was the last
+  // one spinning, so we need not. Nor do we if a worker was woken and has
+  // yet to run, or every add() would pay for a futex wake until it does.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (numSpinning_.load(std::memory_order_relaxed) == 0 &&
+      numSleeping_.load(std::memory_order_relaxed) > 0 &&
+      !wakePending_.load(std::memory_order_relaxed) &&
+      !wakePending_.exchange(true, std::memory_order_relaxed)) {
+    idleEvent_.notify();
+  }
+}
+
+auto WorkStealingThreadPoolExecutor::findTask(
+    Worker& worker, bool injectionQueueFirst) -> Task* {
+  if (injectionQueueFirst) {
+    if (auto task = injectionQueue_.try_dequeue()) {
+      return *task;
+    }
+  }
+  if (worker.lifoSlotRuns < kMaxLifoSlotRuns &&
+      worker.lifoSlot.load(std::memory_order_relaxed) != nullptr) {
+    if (auto* task =
+            worker.lifoSlot.exchange(nullptr, std::memory_order_acquire)) {
+      ++worker.lifoSlotRuns;
+      return task;
+    }
+  }
+  worker.lifoSlotRuns = 0;
+  if (auto task = worker.deque.pop()) {
+    return *task;
+  }
+  if (auto task = injectionQueue_.try_dequeue()) {
+    return *task;
+  }
+  return steal(worker, /* fromLifoSlots */ false);
+}
+
+auto WorkStealingThreadPoolExecutor::steal(Worker& thief, bool fromLifoSlots)
+    -> Task* {
+  const auto& victims = *victims_.load(std::memory_order_acquire);
+  auto n = victims.size();
+  auto start = folly::Random::rand32(static_cast<uint32_t>(n));
+  // With a topology, first the workers of the thief's node, then the others.
+  size_t passes = numaTopology_ ? 2 : 1;
+  for (size_t pass = 0; pass < passes; ++pass) {
+    for (size_t i = 0; i < n; ++i) {
+      auto& victim = *victims[(start + i) % n];
+      if (&victim == &thief ||
+          (numaTopology_ &&
+           (victim.numaNode == thief.numaNode) != (pass == 0))) {
+        continue;
+      }
+      if (auto task = victim.deque.steal()) {
+        return *task;
+      }
+      if (fromLifoSlots &&
+          victim.lifoSlot.load(std::memory_order_relaxed) != nullptr) {
+        if (auto* task =
+                victim.lifoSlot.exchange(nullptr, std::memory_order_acquire)) {
+          return task;
+        }
+      }
+    }
+  }
+  return nullptr;
+}
+
+auto WorkStealingThreadPoolExecutor::waitForTask(Worker& worker) -> Task* {
+  while (true) {
+    numSpinning_.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    for (size_t i = 0; i < kSpinRounds; ++i) {
+      auto* task = findTask(worker, false);
+      if (task == nullptr && i >= kSpinRounds / 2) {
+        task = steal(worker, /* fromLifoSlots */ true);
+      }
+      if (task != nullptr) {
+        // There may be more tasks, which producers left to us.
+        if (numSpinning_.fetch_sub(1, std::memory_order_relaxed) == 1) {
+          notifyIdleWorker();
+        }
+        return task;
+      }
+      if (shouldStopThread(/* idle */ true)) {
+        numSpinning_.fetch_sub(1, std::memory_order_relaxed);
+        return nullptr;
+      }
+      asm_volatile_pause();
+    }
+
+    numSleeping_.fetch_add(1, std::memory_order_relaxed);
+    numSpinning_.fetch_sub(1, std::memory_order_relaxed);
+    auto key = idleEvent_.prepareWait();
+    // A wake sent before prepareWait() may have been lost. From here on,
+    // one can't be.
+    wakePending_.store(false, std::memory_order_relaxed);
+    // Pairs with the fence in notifyIdleWorker().
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto* task = findTask(worker, false);
+    if (task == nullptr) {
+      task = steal(worker, /* fromLifoSlots */ true);
+    }
+    if (task != nullptr || shouldStopThread(/* idle */ true)) {
+      idleEvent_.cancelWait();
+      numSleeping_.fetch_sub(1, std::memory_order_relaxed);
+      return task;
+    }
+    idleEvent_.wait(key);
+    numSleeping_.fetch_sub(1, std::memory_order_relaxed);
+    wakePending_.store(false, std::memory_order_relaxed);
+  }
+}
+
+// Does not need threadListLock_ lock.
+bool WorkStealingThreadPoolExecutor::shouldStopThread(bool idle) {
+  auto threadsToStop = threadsToStop_.load(std::memory_order_relaxed);
+  do {
+    if (threadsToStop == 0 ||
+        // If we're joining, only stop threads that have run out of work.
+        (!idle && isJoin_.load(std::memory_order_acquire))) {
+      return false;
+    }
+  } while (!threadsToStop_.compare_exchange_weak(
+      threadsToStop, threadsToStop - 1, std::memory_order_relaxed));
+  return true;
+}
+
+// threadListLock_ is writelocked
+ThreadPoolExecutor::ThreadPtr WorkStealingThreadPoolExecutor::makeThread() {
+  auto thread = std::make_shared<WorkStealingThread>();
+  for (auto& worker : workers_) {
+    if (!worker->claimed.exchange(true, std::memory_order_acquire)) {
+      thread->worker = worker.get();
+      return thread;
+    }
+  }
+
+  // Interleaved, so that any number of threads is spread over the nodes.
+  auto node = numaTopology_ ? workers_.size() % numaTopology_->numNodes() : 0;
+  auto& worker = workers_.emplace_back(std::make_unique<Worker>(this, node));
+  worker->claimed.store(true, std::memory_order_relaxed);
+  thread->worker = worker.get();
+
+  auto victims = std::make_unique<WorkerList>();
+  victims->reserve(workers_.size());
+  for (auto& w : workers_) {
+    victims->push_back(w.get());
+  }
+  victims_.store(victims.get(), std::memory_order_release);
+  victimLists_.push_back(std::move(victims));
+  return thread;
+}
+
+// threadListLock_ must be writelocked.
+void WorkStealingThreadPoolExecutor::stopThread(const ThreadPtr& thread) {
+  for (auto& o : observers_) {
+    o->threadStopped(thread.get());
+  }
+  stoppedThreadProcessedTasks_ += thread->processedTasks;
+  thread->processedTasks = 0;
+  static_cast<WorkStealingThread&>(*thread).releaseWorker();
+  threadList_.remove(thread);
+  stoppedThreads_.add(folly::copy(thread));
+}
+
+void WorkStealingThreadPoolExecutor::threadRun(ThreadPtr thread) {
+  this->threadPoolHook_.registerThread();
+  ExecutorBlockingGuard guard{
+      ExecutorBlockingGuard::TrackTag{}, this, getName()};
+
+  thread->initBaton.post();
+  thread->readyBaton.wait();
+  auto& wsThread = static_cast<WorkStealingThread&>(*thread);
+  if (thread->cancelledBeforeReady) {
+    wsThread.releaseWorker();
+    return;
+  }
+
+  auto& worker = *wsThread.worker;
+  if (numaTopology_ && pinThreadsToNumaNode_ &&
+      !numaTopology_->pinCurrentThreadToNode(worker.numaNode)) {
+    VLOG(1) << "WorkStealingThreadPoolExecutor: failed to pin thread to NUMA "
+            << "node " << worker.numaNode << ": " << errnoStr(errno);
+  }
+
+  threadWorker() = &worker;
+  {
+    SCOPE_EXIT {
+      threadWorker() = nullptr;
+    };
+    for (size_t tick = 1;; ++tick) {
+      auto* task = findTask(worker, tick % kInjectionQueueInterval == 0);
+      if (task == nullptr) {
+        task = waitForTask(worker);
+        if (task == nullptr) {
+          break;
+        }
+      }
+      runTask(thread, std::move(*std::unique_ptr<Task>(task)));
+      if (shouldStopThread(/* idle */ false)) {
+        break;
+      }
+    }
+  }
+
+  // Hand the tasks left in our deque to the other workers.
+  bool handedOff = false;
+  if (auto* task =
+          worker.lifoSlot.exchange(nullptr, std::memory_order_acquire)) {
+    injectionQueue_.enqueue(task);
+    handedOff = true;
+  }
+  while (auto task = worker.deque.pop()) {
+    injectionQueue_.enqueue(*task);
+    handedOff = true;
+  }
+  if (handedOff) {
+    idleEvent_.notifyAll();
+  }
+
+  std::unique_lock w{threadListLock_};
+  stopThread(thread);
+}
+
+// threadListLock_ is writelocked
+void WorkStealingThreadPoolExecutor::stopThreads(size_t n) {
+  threadsToStop_ += n;
+  idleEvent_.notifyAll();
+}
+
+// threadListLock_ is read (or write) locked.
+size_t WorkStealingThreadPoolExecutor::getPendingTaskCountImpl() const {
+  size_t pending = injectionQueue_.size();
+  for (auto& worker : workers_) {
+    pending += worker->deque.size() +
+        (worker->lifoSlot.load(std::memory_order_relaxed) != nullptr);
+  }
+  return pending;
+}
+
+} // namespace folly
@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include <folly/concurrency/ChaseLevDeque.h>
+#include <folly/concurrency/UnboundedQueue.h>
+#include <folly/executors/ThreadPoolExecutor.h>
+#include <folly/synchronization/EventCount.h>
+#include <folly/system/NumaTopology.h>
+
+namespace folly {
+
+/**
+ * A thread pool for CPU bound tasks that schedules by work stealing.
+ *
+ * @note Each worker owns a ChaseLevDeque. Tasks added from a worker, e.g. the
+ * children of a task that forks, are pushed on that worker's deque, and the
+ * worker runs its own tasks most recent first, while they are still warm in
+ * its cache. Tasks added from other threads go to a shared injection queue.
+ * A worker that runs out of tasks takes from the injection queue, and then
+ * steals the oldest tasks of other workers, starting from a random one.
+ * Unlike CPUThreadPoolExecutor, workers that fork do not contend on a shared
+ * queue and semaphore, which makes this pool a better fit for many small
+ * tasks over many threads.
+ *
+ * @note With Options::lifoSlot, the task most recently added from a worker
+ * goes in its LIFO slot, and the task it replaces on its deque. The worker
+ * runs the slot next, a few times in a row at most, and idle workers steal
+ * from it only after they failed to find other work for a while. This suits
+ * coroutines: when a coroutine running on a worker completes one that is
+ * awaiting it there, e.g. by posting a coro::Baton, the continuation runs
+ * right after it on the same thread, instead of migrating to another one.
+ *
+ * @note Workers that find nothing to run spin briefly, then sleep until a
+ * task is added. Idle threads do not time out.
+ *
+ * @note Tasks run in no particular order: a worker checks the injection queue
+ * before its own deque only once every few tasks, so that a forking workload
+ * cannot starve outside submitters.
+ *
+ * @note Priorities are not supported.
+ *
+ * @note stop() may discard tasks that have not started.
+ */
+class WorkStealingThreadPoolExecutor : public ThreadPoolExecutor {
+ public:
+  struct Options {
+    Options() : pinThreadsToNumaNode(true), lifoSlot(false) {}
+
+    Options& setNumaTopology(NumaTopology t) {
+      this->numaTopology = std::move(t);
+      return *this;
+    }
+    Options& setPinThreadsToNumaNode(bool b) {
+      this->pinThreadsToNumaNode = b;
+      return *this;
+    }
+    Options& setLifoSlot(bool b) {
+      this->lifoSlot = b;
+      return *this;
+    }
+
+    // If set, the workers are spread evenly over the nodes of this topology
+    // (usually NumaTopology::system()), and steal from workers of their own
+    // node before those of other nodes.
+    std::optional<NumaTopology> numaTopology;
+    // With numaTopology, whether to pin each worker to the cpus of its node.
+    bool pinThreadsToNumaNode;
+    // Whether the task most recently added from a worker runs next on that
+    // worker, ahead of its deque. See the class comment.
+    bool lifoSlot;
+  };
+
+  explicit WorkStealingThreadPoolExecutor(
+      size_t numThreads,
+      std::shared_ptr<ThreadFactory> threadFactory =
+          std::make_shared<NamedThreadFactory>("WorkStealingTP"),
+      Options options = Options());
+
+  ~WorkStealingThreadPoolExecutor() override;
+
+  void add(Func func) override;
+  void add(
+      Func func,
+      std::chrono::milliseconds expiration,
+      Func expireCallback = nullptr) override;
+
+  // The number of tasks waiting to run, approximately.
+  size_t getTaskQueueSize() const;
+
+ private:
+  struct alignas(cacheline_align_v) Worker {
+    Worker(const WorkStealingThreadPoolExecutor* p, size_t node)
+        : pool(p), numaNode(node) {}
+
+    ChaseLevDeque<Task*> deque;
+    std::atomic<Task*> lifoSlot{nullptr};
+    // Owner only: the tasks run from lifoSlot in a row.
+    size_t lifoSlotRuns{0};
+    const WorkStealingThreadPoolExecutor* const pool;
+    const size_t numaNode;
+    // Whether a thread owns this worker.
+    std::atomic<bool> claimed{false};
+  };
+
+  struct WorkStealingThread : public Thread {
+    ~WorkStealingThread() override { releaseWorker(); }
+
+    void releaseWorker() {
+      if (worker != nullptr) {
+        std::exchange(worker, nullptr)
+            ->claimed.store(false, std::memory_order_release);
+      }
+    }
+
+    Worker* worker{nullptr};
+  };
+
+  ThreadPtr makeThread() override;
+  void threadRun(ThreadPtr thread) override;
+  void stopThreads(size_t n) override;
+  size_t getPendingTaskCountImpl() const override final;
+
+  // The worker of the calling thread, if it is one.
+  static Worker*& threadWorker();
+  Worker* currentWorker() const;
+  void enqueue(Task* task);
+  void notifyIdleWorker();
+  Task* findTask(Worker& worker, bool injectionQueueFirst);
+  Task* steal(Worker& thief, bool fromLifoSlots);
+  // Spins, then sleeps, until there is a task; spins again when woken.
+  // Returns nullptr if the thread is to stop.
+  Task* waitForTask(Worker& worker);
+  bool shouldStopThread(bool idle);
+  void stopThread(const ThreadPtr& thread);
+
+  using WorkerList = std::vector<Worker*>;
+
+  // Workers outlive their threads, so that thieves never see a deque go
+  // away: a stopping thread hands its tasks to the injection queue and
+  // releases its worker, which the next new thread claims. There are as many
+  // workers as the most threads the pool ever had. Guarded by
+  // threadListLock_.
+  std::vector<std::unique_ptr<Worker>> workers_;
+  // The workers to steal from, replaced by a bigger list when workers_
+  // grows. Replaced lists are kept until destruction, since thieves may
+  // still be scanning them.
+  std::atomic<const WorkerList*> victims_{nullptr};
+  std::vector<std::unique_ptr<const WorkerList>> victimLists_;
+
+  UMPMCQueue<Task*, /* MayBlock */ false> injectionQueue_;
+  const std::optional<NumaTopology> numaTopology_;
+  const bool pinThreadsToNumaNode_;
+  const bool lifoSlot_;
+
+  // Workers sleep on idleEvent_. Producers pay for a notification only when
+  // a worker is sleeping, none is spinning, and none was woken already.
+  EventCount idleEvent_;
+  std::atomic<size_t> numSpinning_{0};
+  std::atomic<size_t> numSleeping_{0};
+  std::atomic<bool> wakePending_{false};
+  std::atomic<size_t> threadsToStop_{0};
+};
+
+} // namespace folly
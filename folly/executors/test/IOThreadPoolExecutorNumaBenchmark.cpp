@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/executors/IOThreadPoolExecutor.h>
+#include <folly/net/NetOps.h>
+#include <folly/portability/GFlags.h>
+#include <folly/portability/Sockets.h>
+#include <folly/synchronization/Latch.h>
+#include <folly/system/NumaTopology.h>
+
+FOLLY_GFLAGS_DEFINE_uint32(
+    numa_nodes,
+    0,
+    "Simulate this many NUMA nodes over --numa_cpus cpus; 0 uses the "
+    "system's topology");
+FOLLY_GFLAGS_DEFINE_uint32(numa_cpus, 16, "cpus of the simulated topology");
+FOLLY_GFLAGS_DEFINE_uint32(threads, 4, "IO threads");
+
+using namespace folly;
+
+// Places connections, identified by their receiving cpu, on the IO threads
+// of an IOThreadPoolExecutor: round-robin, or on a thread of the cpu's NUMA
+// node. The place* benchmarks measure the cost of placing a connection; the
+// serve* benchmarks run a task per connection that works on a per-thread
+// buffer, which is node-local when the threads are pinned. On a single-node
+// machine, pass --numa_nodes to see the placement decisions of a simulated
+// topology (the threads then can't all be pinned, and the throughput of
+// both modes is the same).
+namespace {
+
+constexpr size_t kBatch = 256;
+constexpr size_t kBufferSize = 256 * 1024;
+
+NumaTopology topology() {
+  return FLAGS_numa_nodes > 0
+      ? NumaTopology::uniform(FLAGS_numa_cpus, FLAGS_numa_nodes)
+      : NumaTopology::system();
+}
+
+std::unique_ptr<IOThreadPoolExecutor> makeExecutor(bool numa) {
+  IOThreadPoolExecutor::Options options;
+  if (numa) {
+    options.setNumaTopology(topology());
+  }
+  auto executor = std::make_unique<IOThreadPoolExecutor>(
+      FLAGS_threads,
+      std::make_shared<NamedThreadFactory>("IOThreadPool"),
+      EventBaseManager::get(),
+      std::move(options));
+  executor->getAllEventBases();
+  return executor;
+}
+
+size_t numCpus() {
+  return std::max<size_t>(topology().nodeByCpu.size(), 1);
+}
+
+void printPlacement() {
+  auto executor = makeExecutor(true);
+  auto evbs = executor->getAllEventBases();
+  std::map<EventBase*, size_t> threadOf;
+  for (size_t i = 0; i < evbs.size(); ++i) {
+    threadOf[evbs[i].get()] = i;
+  }
+  auto t = topology();
+  std::cout << "Placement over " << t.numNodes() << " node(s), "
+            << FLAGS_threads << " thread(s):\n";
+  for (size_t cpu = 0; cpu < t.nodeByCpu.size(); ++cpu) {
+    std::cout << "  cpu " << cpu << " (node " << t.nodeOf(cpu)
+              << ") -> thread "
+              << threadOf[executor->getEventBaseForCpu(cpu)] << "\n";
+  }
+  std::cout << std::endl;
+}
+
+void serve(size_t iters, bool numa) {
+  BenchmarkSuspender suspender;
+  auto executor = makeExecutor(numa);
+  auto cpus = numCpus();
+  suspender.dismiss();
+
+  for (size_t done = 0; done < iters; done += kBatch) {
+    size_t n = std::min(kBatch, iters - done);
+    Latch latch(n);
+    for (size_t i = 0; i < n; ++i) {
+      auto cpu = (done + i) % cpus;
+      auto* evb = numa ? executor->getEventBaseForCpu(cpu)
+                       : executor->getEventBase();
+      evb->runInEventBaseThread([&latch] {
+        // First touched, so allocated, by the IO thread itself.
+        thread_local std::unique_ptr<char[]> buffer(new char[kBufferSize]);
+        std::memset(buffer.get(), 1, kBufferSize);
+        doNotOptimizeAway(buffer[kBufferSize - 1]);
+        latch.count_down();
+      });
+    }
+    latch.wait();
+  }
+
+  suspender.rehire();
+  executor.reset();
+}
+
+} // namespace
+
+BENCHMARK(placeRoundRobin, iters) {
+  BenchmarkSuspender suspender;
+  auto executor = makeExecutor(false);
+  suspender.dismiss();
+  for (size_t i = 0; i < iters; ++i) {
+    doNotOptimizeAway(executor->getEventBase());
+  }
+}
+
+BENCHMARK_RELATIVE(placeNumaCpu, iters) {
+  BenchmarkSuspender suspender;
+  auto executor = makeExecutor(true);
+  auto cpus = numCpus();
+  suspender.dismiss();
+  for (size_t i = 0; i < iters; ++i) {
+    doNotOptimizeAway(executor->getEventBaseForCpu(i % cpus));
+  }
+}
+
+// Includes the getsockopt() calls for SO_INCOMING_CPU and
+// SO_INCOMING_NAPI_ID.
+BENCHMARK_RELATIVE(placeNumaSocket, iters) {
+  BenchmarkSuspender suspender;
+  auto executor = makeExecutor(true);
+  NetworkSocket fds[2];
+  CHECK_EQ(netops::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  suspender.dismiss();
+  for (size_t i = 0; i < iters; ++i) {
+    doNotOptimizeAway(executor->getEventBaseForSocket(fds[0]));
+  }
+  suspender.rehire();
+  netops::close(fds[0]);
+  netops::close(fds[1]);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(serveRoundRobin, iters) {
+  serve(iters, false);
+}
+
+BENCHMARK_RELATIVE(serveNuma, iters) {
+  serve(iters, true);
+}
+
+int main(int argc, char** argv) {
+  folly::gflags::ParseCommandLineFlags(&argc, &argv, true);
+  printPlacement();
+  folly::runBenchmarks();
+  return 0;
+}
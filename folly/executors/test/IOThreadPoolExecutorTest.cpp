@@ -17,6 +17,11 @@
 #include <folly/executors/IOThreadPoolExecutor.h>
 #include <folly/executors/test/IOThreadPoolExecutorBaseTestLib.h>
 
+#include <set>
+
+#include <folly/net/NetOps.h>
+#include <folly/portability/Sockets.h>
+
 namespace folly {
 namespace test {
 
@@ -48,6 +53,81 @@ TEST(IOThreadPoolExecutor, MaxReadAtOnce) {
   }
 }
 
+TEST(IOThreadPoolExecutor, NumaPlacement) {
+  // Two nodes of 4 cpus, 3 threads per node. Pinning to a simulated topology
+  // may fail, but that only affects performance.
+  auto executor = IOThreadPoolExecutor{
+      6,
+      std::make_shared<NamedThreadFactory>("IOThreadPool"),
+      EventBaseManager::get(),
+      IOThreadPoolExecutor::Options{}.setNumaTopology(
+          NumaTopology::uniform(8, 2))};
+  executor.getAllEventBases();
+
+  std::set<EventBase*> node0;
+  std::set<EventBase*> node1;
+  for (size_t cpu = 0; cpu < 8; ++cpu) {
+    auto* evb = executor.getEventBaseForCpu(cpu);
+    // Stable per cpu.
+    EXPECT_EQ(evb, executor.getEventBaseForCpu(cpu));
+    (cpu < 4 ? node0 : node1).insert(evb);
+  }
+  EXPECT_EQ(node0.size(), 3);
+  EXPECT_EQ(node1.size(), 3);
+  for (auto* evb : node0) {
+    EXPECT_EQ(node1.count(evb), 0);
+  }
+
+  // A NIC queue maps to one thread of the node, whatever the cpu.
+  auto* queueEvb = executor.getEventBaseForCpu(5, 7);
+  EXPECT_EQ(node1.count(queueEvb), 1);
+  EXPECT_EQ(executor.getEventBaseForCpu(6, 7), queueEvb);
+
+  // Unknown cpus are placed round-robin.
+  EXPECT_NE(executor.getEventBaseForCpu(100), nullptr);
+}
+
+TEST(IOThreadPoolExecutor, NumaPlacementInterleavedCpus) {
+  // Cpu ids alternate between the two nodes, as on many dual-socket
+  // machines, so all the cpus of a node are even or all are odd.
+  auto executor = IOThreadPoolExecutor{
+      4,
+      std::make_shared<NamedThreadFactory>("IOThreadPool"),
+      EventBaseManager::get(),
+      IOThreadPoolExecutor::Options{}
+          .setNumaTopology(NumaTopology({{0, 2, 4, 6}, {1, 3, 5, 7}}))
+          .setPinThreadsToNumaNode(false)};
+  executor.getAllEventBases();
+
+  std::set<EventBase*> node0;
+  std::set<EventBase*> node1;
+  for (size_t cpu = 0; cpu < 8; ++cpu) {
+    (cpu % 2 ? node1 : node0).insert(executor.getEventBaseForCpu(cpu));
+  }
+  // Each node's cpus spread over both of its threads.
+  EXPECT_EQ(node0.size(), 2);
+  EXPECT_EQ(node1.size(), 2);
+  for (auto* evb : node0) {
+    EXPECT_EQ(node1.count(evb), 0);
+  }
+}
+
+TEST(IOThreadPoolExecutor, NumaPlacementSocket) {
+  auto executor = IOThreadPoolExecutor{
+      2,
+      std::make_shared<NamedThreadFactory>("IOThreadPool"),
+      EventBaseManager::get(),
+      IOThreadPoolExecutor::Options{}
+          .setNumaTopology(NumaTopology::uniform(1))
+          .setPinThreadsToNumaNode(false)};
+  NetworkSocket fds[2];
+  ASSERT_EQ(netops::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  // No incoming cpu for a unix socket pair: falls back to round-robin.
+  EXPECT_NE(executor.getEventBaseForSocket(fds[0]), nullptr);
+  netops::close(fds[0]);
+  netops::close(fds[1]);
+}
+
 INSTANTIATE_TYPED_TEST_SUITE_P(
     IOThreadPoolExecutorTest,
     IOThreadPoolExecutorBaseTest,
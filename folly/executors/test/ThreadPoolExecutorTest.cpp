@@ -28,6 +28,7 @@
 #include <folly/executors/IOThreadPoolExecutor.h>
 #include <folly/executors/ThreadPoolExecutor.h>
 #include <folly/executors/VirtualExecutor.h>
+#include <folly/executors/WorkStealingThreadPoolExecutor.h>
 #include <folly/executors/task_queue/LifoSemMPMCQueue.h>
 #include <folly/executors/task_queue/UnboundedBlockingQueue.h>
 #include <folly/executors/thread_factory/InitThreadFactory.h>
@@ -100,8 +101,10 @@ FOLLY_KEEP std::unique_ptr<QueueObserverFactory> make_queue_observer_factory(
 template <typename T>
 class ThreadPoolExecutorTypedTest : public ::testing::Test {};
 
-using ValueTypes =
-    ::testing::Types<CPUThreadPoolExecutor, IOThreadPoolExecutor>;
+using ValueTypes = ::testing::Types<
+    CPUThreadPoolExecutor,
+    IOThreadPoolExecutor,
+    WorkStealingThreadPoolExecutor>;
 
 TYPED_TEST_SUITE(ThreadPoolExecutorTypedTest, ValueTypes);
 
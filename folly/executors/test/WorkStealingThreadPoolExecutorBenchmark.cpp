@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <memory>
+
+#include <folly/Benchmark.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/executors/WorkStealingThreadPoolExecutor.h>
+#include <folly/portability/GFlags.h>
+#include <folly/synchronization/Latch.h>
+
+FOLLY_GFLAGS_DEFINE_uint32(threads, 4, "threads of each executor");
+
+using namespace folly;
+
+// Compares WorkStealingThreadPoolExecutor with CPUThreadPoolExecutor on
+// tasks too small for the scheduling to be hidden behind the work: a
+// recursive fork-join, where every task adds its children from a worker
+// thread, and a fan-out of independent tasks, added from outside the pool
+// or from a single task running on it. Each iteration is one task.
+namespace {
+
+constexpr size_t kBatch = 1024;
+
+template <class TPE>
+std::unique_ptr<TPE> makeExecutor() {
+  return std::make_unique<TPE>(FLAGS_threads);
+}
+
+// Adds two tasks per level; the 2^depth leaves count down the latch.
+void fork(Executor& executor, size_t depth, Latch& leaves) {
+  if (depth == 0) {
+    leaves.count_down();
+    return;
+  }
+  for (int i = 0; i < 2; ++i) {
+    executor.add([&executor, depth, &leaves] {
+      fork(executor, depth - 1, leaves);
+    });
+  }
+}
+
+template <class TPE>
+void forkJoin(size_t iters) {
+  BenchmarkSuspender suspender;
+  auto executor = makeExecutor<TPE>();
+  // About iters tasks in total, in trees of up to 2 * kBatch tasks.
+  size_t depth = 1;
+  while ((size_t(4) << depth) <= std::min(iters, 2 * kBatch)) {
+    ++depth;
+  }
+  suspender.dismiss();
+
+  for (size_t done = 0; done < iters; done += (size_t(2) << depth) - 2) {
+    Latch leaves(size_t(1) << depth);
+    fork(*executor, depth, leaves);
+    leaves.wait();
+  }
+
+  suspender.rehire();
+  executor.reset();
+}
+
+template <class TPE>
+void fanOut(size_t iters, bool fromWorker) {
+  BenchmarkSuspender suspender;
+  auto executor = makeExecutor<TPE>();
+  suspender.dismiss();
+
+  for (size_t done = 0; done < iters; done += kBatch) {
+    size_t n = std::min(kBatch, iters - done);
+    Latch latch(n);
+    auto addAll = [&executor, &latch, n] {
+      for (size_t i = 0; i < n; ++i) {
+        executor->add([&latch] { latch.count_down(); });
+      }
+    };
+    if (fromWorker) {
+      executor->add(addAll);
+    } else {
+      addAll();
+    }
+    latch.wait();
+  }
+
+  suspender.rehire();
+  executor.reset();
+}
+
+} // namespace
+
+BENCHMARK(forkJoinCPU, iters) {
+  forkJoin<CPUThreadPoolExecutor>(iters);
+}
+
+BENCHMARK_RELATIVE(forkJoinWorkStealing, iters) {
+  forkJoin<WorkStealingThreadPoolExecutor>(iters);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(fanOutExternalCPU, iters) {
+  fanOut<CPUThreadPoolExecutor>(iters, false);
+}
+
+BENCHMARK_RELATIVE(fanOutExternalWorkStealing, iters) {
+  fanOut<WorkStealingThreadPoolExecutor>(iters, false);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(fanOutFromWorkerCPU, iters) {
+  fanOut<CPUThreadPoolExecutor>(iters, true);
+}
+
+BENCHMARK_RELATIVE(fanOutFromWorkerWorkStealing, iters) {
+  fanOut<WorkStealingThreadPoolExecutor>(iters, true);
+}
+
+int main(int argc, char** argv) {
+  folly::gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/executors/WorkStealingThreadPoolExecutor.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <folly/portability/GTest.h>
+#include <folly/synchronization/Baton.h>
+#include <folly/synchronization/Latch.h>
+
+using namespace folly;
+
+namespace {
+
+// Adds two tasks per level, down to 2^depth leaves.
+void fork(Executor& executor, size_t depth, Latch& leaves) {
+  if (depth == 0) {
+    leaves.count_down();
+    return;
+  }
+  for (int i = 0; i < 2; ++i) {
+    executor.add([&executor, depth, &leaves] {
+      fork(executor, depth - 1, leaves);
+    });
+  }
+}
+
+} // namespace
+
+TEST(WorkStealingThreadPoolExecutorTest, ForkJoin) {
+  for (bool lifoSlot : {false, true}) {
+    WorkStealingThreadPoolExecutor executor(
+        4,
+        std::make_shared<NamedThreadFactory>("WorkStealingTP"),
+        WorkStealingThreadPoolExecutor::Options().setLifoSlot(lifoSlot));
+    constexpr size_t kDepth = 14;
+    Latch leaves(size_t(1) << kDepth);
+    fork(executor, kDepth, leaves);
+    leaves.wait();
+    executor.join();
+    EXPECT_EQ(
+        (size_t(2) << kDepth) - 2, executor.getPoolStats().processedTaskCount);
+  }
+}
+
+TEST(WorkStealingThreadPoolExecutorTest, LocalTasksRunLifo) {
+  WorkStealingThreadPoolExecutor executor(1);
+  std::vector<int> order;
+  Baton<> done;
+  executor.add([&] {
+    for (int i = 0; i < 3; ++i) {
+      executor.add([&, i] {
+        order.push_back(i);
+        if (order.size() == 3) {
+          done.post();
+        }
+      });
+    }
+  });
+  done.wait();
+  EXPECT_EQ((std::vector<int>{2, 1, 0}), order);
+}
+
+// Two tasks that keep adding each other run from the LIFO slot, but only a
+// few times in a row before the worker takes from its deque.
+TEST(WorkStealingThreadPoolExecutorTest, LifoSlotDoesNotStarveDeque) {
+  WorkStealingThreadPoolExecutor executor(
+      1,
+      std::make_shared<NamedThreadFactory>("WorkStealingTP"),
+      WorkStealingThreadPoolExecutor::Options().setLifoSlot(true));
+  std::atomic<size_t> pings{0};
+  std::atomic<size_t> pingsBeforeOther{0};
+  Baton<> done;
+  std::function<void()> ping = [&] {
+    if (++pings < 100) {
+      executor.add(ping);
+    } else {
+      done.post();
+    }
+  };
+  executor.add([&] {
+    executor.add([&] { pingsBeforeOther = pings.load(); });
+    executor.add(ping);
+  });
+  done.wait();
+  EXPECT_GT(pingsBeforeOther.load(), 0);
+  EXPECT_LT(pingsBeforeOther.load(), 10);
+}
+
+// A task added from a worker of another pool must run on this pool.
+TEST(WorkStealingThreadPoolExecutorTest, AddFromOtherPool) {
+  WorkStealingThreadPoolExecutor a(1);
+  WorkStealingThreadPoolExecutor b(1);
+  std::thread::id aThread, bThread;
+  Baton<> done;
+  a.add([&] {
+    aThread = std::this_thread::get_id();
+    b.add([&] {
+      bThread = std::this_thread::get_id();
+      done.post();
+    });
+  });
+  done.wait();
+  EXPECT_NE(aThread, bThread);
+}
+
+// Other workers steal the tasks of a worker that is busy, even the one in
+// its LIFO slot.
+TEST(WorkStealingThreadPoolExecutorTest, Steal) {
+  for (bool lifoSlot : {false, true}) {
+    WorkStealingThreadPoolExecutor executor(
+        2,
+        std::make_shared<NamedThreadFactory>("WorkStealingTP"),
+        WorkStealingThreadPoolExecutor::Options().setLifoSlot(lifoSlot));
+    Baton<> stolen;
+    Baton<> release;
+    executor.add([&] {
+      executor.add([&] { stolen.post(); });
+      // Blocks this worker until its task was stolen.
+      stolen.wait();
+      release.post();
+    });
+    release.wait();
+  }
+}
+
+TEST(WorkStealingThreadPoolExecutorTest, NumaTopology) {
+  WorkStealingThreadPoolExecutor executor(
+      4,
+      std::make_shared<NamedThreadFactory>("WorkStealingTP"),
+      WorkStealingThreadPoolExecutor::Options()
+          .setNumaTopology(NumaTopology::uniform(4, 2))
+          .setPinThreadsToNumaNode(false));
+  constexpr size_t kDepth = 10;
+  Latch leaves(size_t(1) << kDepth);
+  fork(executor, kDepth, leaves);
+  leaves.wait();
+}
+
+TEST(WorkStealingThreadPoolExecutorTest, StopDiscardsPendingTasks) {
+  auto executor = std::make_unique<WorkStealingThreadPoolExecutor>(1);
+  std::atomic<size_t> ran{0};
+  Baton<> started;
+  Baton<> proceed;
+  executor->add([&] {
+    for (int i = 0; i < 100; ++i) {
+      executor->add([&] { ++ran; });
+    }
+    started.post();
+    proceed.wait();
+  });
+  started.wait();
+  std::thread stopper([&] { executor->stop(); });
+  // stop() makes the worker exit once this task is done.
+  /* sleep override */ std::this_thread::sleep_for(
+      std::chrono::milliseconds(10));
+  proceed.post();
+  stopper.join();
+  EXPECT_LT(ran.load(), 100);
+  executor.reset();
+}
@@ -0,0 +1,582 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/io/async/AsyncIoUringUDPSocket.h>
+
+#include <cstring>
+
+#include <folly/String.h>
+#include <folly/io/async/IoUringBackend.h>
+#include <folly/io/async/IoUringEventBaseLocal.h>
+
+namespace folly {
+
+#if FOLLY_HAS_LIBURING
+
+namespace {
+// Space the kernel needs in each provided buffer ahead of the payload of a
+// multishot recvmsg.
+constexpr size_t kRecvmsgHeaderSize = sizeof(struct io_uring_recvmsg_out) +
+    sizeof(sockaddr_storage)
+#ifdef FOLLY_HAVE_MSG_ERRQUEUE
+    + AsyncUDPSocket::ReadCallback::OnDataAvailableParams::kCmsgSpace
+#endif
+    ;
+
+// Used when the provided buffer ring is exhausted, or its buffers are too
+// small for GRO. Large enough for any datagram, including GRO ones.
+constexpr size_t kFallbackBufferSize = 64 * 1024;
+
+// Provided buffers need room for at least a full Ethernet MTU datagram.
+constexpr size_t kMinProvidedBufferSize = kRecvmsgHeaderSize + 1500;
+
+// With GRO, the kernel coalesces segments into datagrams of up to 64KB, so
+// smaller provided buffers would truncate them.
+constexpr size_t kMinGroProvidedBufferSize =
+    kRecvmsgHeaderSize + kFallbackBufferSize;
+} // namespace
+
+/*
+ * RecvRequest
+ */
+
+class AsyncIoUringUDPSocket::RecvRequest : public IoSqeBase {
+ public:
+  RecvRequest(
+      AsyncIoUringUDPSocket* socket,
+      IoUringBackend* backend,
+      IoUringBufferProvider* bufferProvider,
+      NetworkSocket fd)
+      : IoSqeBase(IoSqeBase::Type::Read),
+        socket_(socket),
+        backend_(backend),
+        bufferProvider_(bufferProvider),
+        fd_(fd) {}
+
+  void rearm() { backend_->submitSoon(*this); }
+
+  bool useProvidedBuffers() {
+    return bufferProvider_->available() &&
+        (bufferProvider_->sizePerBuffer() >= kMinGroProvidedBufferSize ||
+         socket_->getGRO() <= 0);
+  }
+
+  // Whether the armed multishot request reads into provided buffers that
+  // would no longer be picked.
+  bool stale() { return inFlight() && !fallback_ && !useProvidedBuffers(); }
+
+  /*
+   * IoSqeBase
+   */
+  void processSubmit(struct io_uring_sqe* sqe) noexcept override {
+    msg_ = {};
+    msg_.msg_namelen = sizeof(sockaddr_storage);
+#ifdef FOLLY_HAVE_MSG_ERRQUEUE
+    msg_.msg_controllen =
+        ReadCallback::OnDataAvailableParams::kCmsgSpace;
+#endif
+    if (useProvidedBuffers()) {
+      fallback_ = false;
+      ::io_uring_prep_recvmsg_multishot(sqe, fd_.toFd(), &msg_, MSG_TRUNC);
+      sqe->buf_group = bufferProvider_->gid();
+      sqe->flags |= IOSQE_BUFFER_SELECT;
+      return;
+    }
+
+    // Read a single datagram into a buffer of our own until the ring has
+    // buffers again, or for as long as GRO datagrams do not fit in them.
+    fallback_ = true;
+    if (!fallbackBuffer_) {
+      fallbackBuffer_.reset(new uint8_t[kFallbackBufferSize]);
+#ifdef FOLLY_HAVE_MSG_ERRQUEUE
+      fallbackControl_.reset(
+          new char[ReadCallback::OnDataAvailableParams::kCmsgSpace]);
+#endif
+    }
+#ifdef FOLLY_HAVE_MSG_ERRQUEUE
+    std::memset(
+        fallbackControl_.get(),
+        0,
+        ReadCallback::OnDataAvailableParams::kCmsgSpace);
+#endif
+    fallbackIov_.iov_base = fallbackBuffer_.get();
+    fallbackIov_.iov_len = kFallbackBufferSize;
+    msg_.msg_name = &fallbackName_;
+    msg_.msg_iov = &fallbackIov_;
+    msg_.msg_iovlen = 1;
+    msg_.msg_control = fallbackControl_.get();
+    ::io_uring_prep_recvmsg(sqe, fd_.toFd(), &msg_, MSG_TRUNC);
+  }
+
+  void callback(const struct io_uring_cqe* cqe) noexcept override {
+    const int res = cqe->res;
+    if (res < 0) {
+      if (res == -ENOBUFS) {
+        // The multishot request ended, and the next one falls back to our
+        // own buffer unless the ring was refilled in the meantime.
+        bufferProvider_->enobuf();
+        rearm();
+      } else if (res != -ECANCELED) {
+        // The socket may delete this request.
+        socket_->onRecvError(-res);
+      }
+      return;
+    }
+
+    if (fallback_) {
+      // The socket may delete this request, so re-arm it first, with new
+      // buffers.
+      auto data = std::move(fallbackBuffer_);
+      auto control = std::move(fallbackControl_);
+      auto name = fallbackName_;
+      auto msg = msg_;
+      msg.msg_name = &name;
+      msg.msg_control = control.get();
+      rearm();
+      socket_->onRecv(
+          msg,
+          ByteRange(data.get(), std::min(size_t(res), kFallbackBufferSize)),
+          size_t(res));
+      return;
+    }
+
+    auto buf = bufferProvider_->getIoBuf(cqe);
+    if (!(cqe->flags & IORING_CQE_F_MORE)) {
+      rearm();
+    }
+    if (buf->isChained()) {
+      buf->coalesce();
+    }
+    auto* out =
+        ::io_uring_recvmsg_validate(buf->writableData(), res, &msg_);
+    if (!out) {
+      return;
+    }
+    struct msghdr msg = {};
+    msg.msg_name = ::io_uring_recvmsg_name(out);
+    msg.msg_namelen = std::min<socklen_t>(out->namelen, msg_.msg_namelen);
+    msg.msg_control = ::io_uring_recvmsg_cmsg_firsthdr(out, &msg_);
+    msg.msg_controllen = msg.msg_control ? out->controllen : 0;
+    msg.msg_flags = static_cast<int>(out->flags);
+    auto* payload =
+        static_cast<const uint8_t*>(::io_uring_recvmsg_payload(out, &msg_));
+    auto payloadLen = ::io_uring_recvmsg_payload_length(out, res, &msg_);
+    socket_->onRecv(msg, ByteRange(payload, payloadLen), out->payloadlen);
+  }
+
+  void callbackCancelled(const struct io_uring_cqe* cqe) noexcept override {
+    if (cqe->res >= 0 && (cqe->flags & IORING_CQE_F_BUFFER)) {
+      // Hand the buffer back to the ring.
+      bufferProvider_->getIoBuf(cqe);
+    }
+    if (!(cqe->flags & IORING_CQE_F_MORE)) {
+      delete this;
+    }
+  }
+
+ private:
+  AsyncIoUringUDPSocket* socket_;
+  IoUringBackend* backend_;
+  IoUringBufferProvider* bufferProvider_;
+  NetworkSocket fd_;
+  struct msghdr msg_ = {};
+
+  bool fallback_{false};
+  std::unique_ptr<uint8_t[]> fallbackBuffer_;
+  std::unique_ptr<char[]> fallbackControl_;
+  sockaddr_storage fallbackName_;
+  struct iovec fallbackIov_;
+};
+
+/*
+ * SendRequest
+ */
+
+class AsyncIoUringUDPSocket::SendRequest : public IoSqeBase {
+ public:
+  explicit SendRequest(AsyncIoUringUDPSocket* socket)
+      : IoSqeBase(IoSqeBase::Type::Write), socket_(socket) {}
+
+  /**
+   * Copy the datagram, its destination and its control messages out of
+   * `msg`.
+   *
+   * @returns the size of the datagram.
+   */
+  size_t prepare(NetworkSocket fd, const struct msghdr& msg, int flags) {
+    fd_ = fd;
+    flags_ = flags;
+
+    size_t len = 0;
+    for (size_t i = 0; i < size_t(msg.msg_iovlen); ++i) {
+      len += msg.msg_iov[i].iov_len;
+    }
+    if (len > dataCapacity_) {
+      data_.reset(new uint8_t[len]);
+      dataCapacity_ = len;
+    }
+    size_t offset = 0;
+    for (size_t i = 0; i < size_t(msg.msg_iovlen); ++i) {
+      if (msg.msg_iov[i].iov_len > 0) {
+        std::memcpy(
+            data_.get() + offset,
+            msg.msg_iov[i].iov_base,
+            msg.msg_iov[i].iov_len);
+        offset += msg.msg_iov[i].iov_len;
+      }
+    }
+    iov_.iov_base = data_.get();
+    iov_.iov_len = len;
+
+    msg_ = {};
+    msg_.msg_iov = &iov_;
+    msg_.msg_iovlen = 1;
+    if (msg.msg_name && msg.msg_namelen > 0) {
+      std::memcpy(&name_, msg.msg_name, msg.msg_namelen);
+      msg_.msg_name = &name_;
+      msg_.msg_namelen = msg.msg_namelen;
+    }
+    if (msg.msg_control && msg.msg_controllen > 0) {
+      control_.assign(
+          static_cast<const char*>(msg.msg_control),
+          static_cast<const char*>(msg.msg_control) + msg.msg_controllen);
+      msg_.msg_control = control_.data();
+      msg_.msg_controllen = msg.msg_controllen;
+    }
+    return len;
+  }
+
+  /**
+   * Let go of the socket. The request deletes itself on completion.
+   */
+  void orphan() { socket_ = nullptr; }
+
+  /*
+   * IoSqeBase
+   */
+  void processSubmit(struct io_uring_sqe* sqe) noexcept override {
+    ::io_uring_prep_sendmsg(sqe, fd_.toFd(), &msg_, unsigned(flags_));
+  }
+
+  void callback(const struct io_uring_cqe* cqe) noexcept override {
+    if (!socket_) {
+      delete this;
+      return;
+    }
+    socket_->onSendComplete(this, cqe->res);
+  }
+
+  void callbackCancelled(const struct io_uring_cqe* cqe) noexcept override {
+    callback(cqe);
+  }
+
+ private:
+  AsyncIoUringUDPSocket* socket_;
+  NetworkSocket fd_;
+  int flags_{0};
+  struct msghdr msg_ = {};
+  struct iovec iov_ = {};
+  sockaddr_storage name_;
+  std::vector<char> control_;
+  std::unique_ptr<uint8_t[]> data_;
+  size_t dataCapacity_{0};
+};
+
+IoUringBackend* AsyncIoUringUDPSocket::getBackend(EventBase* evb) {
+  auto* backend = IoUringEventBaseLocal::try_get(evb);
+  if (!backend) {
+    backend = dynamic_cast<IoUringBackend*>(evb->getBackend());
+  }
+  return backend;
+}
+
+bool AsyncIoUringUDPSocket::supports(EventBase* evb) {
+  auto* backend = getBackend(evb);
+  return backend && backend->hasBufferProvider() &&
+      backend->bufferProvider()->sizePerBuffer() >= kMinProvidedBufferSize;
+}
+
+bool AsyncIoUringUDPSocket::startIoUringRead() {
+  if (!backend_ || readCallback_->shouldOnlyNotify()) {
+    return false;
+  }
+
+  recvRequest_ = std::make_unique<RecvRequest>(
+      this, backend_, backend_->bufferProvider(), getNetworkSocket());
+  recvRequest_->rearm();
+  return true;
+}
+
+void AsyncIoUringUDPSocket::stopIoUringRead() {
+  if (!recvRequest_) {
+    return;
+  }
+
+  if (recvRequest_->inFlight()) {
+    backend_->cancel(recvRequest_.release());
+  } else {
+    recvRequest_.reset();
+  }
+}
+
+bool AsyncIoUringUDPSocket::setGRO(bool bVal) {
+  if (!AsyncUDPSocket::setGRO(bVal)) {
+    return false;
+  }
+  // GRO datagrams may not fit in the provided buffers of the armed request.
+  if (recvRequest_ && recvRequest_->stale()) {
+    stopIoUringRead();
+    startIoUringRead();
+  }
+  return true;
+}
+
+void AsyncIoUringUDPSocket::flushSendRequests() {
+  // Queued sends refer to the fd by number, so they must reach the kernel
+  // before the fd is closed.
+  if (backend_ && freeSendRequests_.size() < sendRequests_.size()) {
+    backend_->submitOutstanding();
+  }
+}
+
+void AsyncIoUringUDPSocket::releaseSendRequests() {
+  for (auto& request : sendRequests_) {
+    if (request->inFlight()) {
+      request->orphan();
+      (void)request.release();
+    }
+  }
+  sendRequests_.clear();
+  freeSendRequests_.clear();
+}
+
+ssize_t AsyncIoUringUDPSocket::queueSend(
+    NetworkSocket socket, const struct msghdr& msg, int flags) {
+#ifdef MSG_ZEROCOPY
+  flags &= ~MSG_ZEROCOPY;
+#endif
+  SendRequest* request;
+  if (freeSendRequests_.empty()) {
+    sendRequests_.push_back(std::make_unique<SendRequest>(this));
+    request = sendRequests_.back().get();
+  } else {
+    request = freeSendRequests_.back();
+    freeSendRequests_.pop_back();
+  }
+  auto len = request->prepare(socket, msg, flags);
+  backend_->submitSoon(*request);
+  return ssize_t(len);
+}
+
+void AsyncIoUringUDPSocket::onRecv(
+    struct msghdr& msg, ByteRange payload, size_t datagramLen) noexcept {
+  if (!readCallback_ || datagramLen == 0) {
+    return;
+  }
+
+  void* buf{nullptr};
+  size_t len{0};
+  readCallback_->getReadBuffer(&buf, &len);
+  if (buf == nullptr || len == 0) {
+    AsyncSocketException ex(
+        AsyncSocketException::BAD_ARGS,
+        "AsyncUDPSocket::getReadBuffer() returned empty buffer");
+
+    auto cob = readCallback_;
+    readCallback_ = nullptr;
+    stopIoUringRead();
+    cob->onReadError(ex);
+    return;
+  }
+
+  ReadCallback::OnDataAvailableParams params;
+  fromMsg(params, msg);
+  clientAddress_.setFromSockaddr(
+      reinterpret_cast<sockaddr*>(msg.msg_name), msg.msg_namelen);
+  len = std::min(len, payload.size());
+  std::memcpy(buf, payload.data(), len);
+  readCallback_->onDataAvailable(
+      clientAddress_, len, datagramLen > len, std::move(params));
+}
+
+void AsyncIoUringUDPSocket::onRecvError(int err) noexcept {
+  // As in AsyncUDPSocket, errors queued for the error callback are not
+  // errors of the read.
+  if (drainErrMessages() > 0) {
+    if (recvRequest_ && isBound()) {
+      recvRequest_->rearm();
+    }
+    return;
+  }
+
+  AsyncSocketException ex(
+      AsyncSocketException::INTERNAL_ERROR, "::recvmsg() failed", err);
+
+  // In case of UDP we can continue reading from the socket even if the
+  // current request fails, after the read callback is installed again.
+  auto cob = readCallback_;
+  readCallback_ = nullptr;
+  stopIoUringRead();
+  if (cob) {
+    cob->onReadError(ex);
+  }
+}
+
+void AsyncIoUringUDPSocket::onSendComplete(
+    SendRequest* request, int res) noexcept {
+  if (res < 0) {
+    ++numSendErrors_;
+    VLOG(4) << "AsyncIoUringUDPSocket: sendmsg failed: " << errnoStr(-res);
+  }
+  freeSendRequests_.push_back(request);
+}
+
+#else
+
+class AsyncIoUringUDPSocket::RecvRequest {};
+class AsyncIoUringUDPSocket::SendRequest {};
+
+IoUringBackend* AsyncIoUringUDPSocket::getBackend(EventBase* /*evb*/) {
+  return nullptr;
+}
+
+bool AsyncIoUringUDPSocket::supports(EventBase* /*evb*/) {
+  return false;
+}
+
+bool AsyncIoUringUDPSocket::startIoUringRead() {
+  return false;
+}
+
+void AsyncIoUringUDPSocket::stopIoUringRead() {}
+
+bool AsyncIoUringUDPSocket::setGRO(bool bVal) {
+  return AsyncUDPSocket::setGRO(bVal);
+}
+
+void AsyncIoUringUDPSocket::flushSendRequests() {}
+
+void AsyncIoUringUDPSocket::releaseSendRequests() {}
+
+ssize_t AsyncIoUringUDPSocket::queueSend(
+    NetworkSocket /*socket*/, const struct msghdr& /*msg*/, int /*flags*/) {
+  folly::terminate_with<std::runtime_error>("io_uring not supported");
+}
+
+void AsyncIoUringUDPSocket::onRecv(
+    struct msghdr& /*msg*/,
+    ByteRange /*payload*/,
+    size_t /*datagramLen*/) noexcept {}
+
+void AsyncIoUringUDPSocket::onRecvError(int /*err*/) noexcept {}
+
+void AsyncIoUringUDPSocket::onSendComplete(
+    SendRequest* /*request*/, int /*res*/) noexcept {}
+
+#endif
+
+AsyncIoUringUDPSocket::AsyncIoUringUDPSocket(EventBase* evb)
+    : AsyncUDPSocket(evb),
+      backend_(evb && supports(evb) ? getBackend(evb) : nullptr) {}
+
+AsyncIoUringUDPSocket::~AsyncIoUringUDPSocket() {
+  // AsyncUDPSocket's destructor would only run its own close().
+  if (isBound()) {
+    close();
+  }
+  stopIoUringRead();
+  releaseSendRequests();
+}
+
+void AsyncIoUringUDPSocket::resumeRead(ReadCallback* cob) {
+  if (!backend_) {
+    AsyncUDPSocket::resumeRead(cob);
+    return;
+  }
+
+  CHECK(!readCallback_) << "Another read callback already installed";
+  CHECK(isBound()) << "UDP server socket not yet bind to an address";
+
+  readCallback_ = CHECK_NOTNULL(cob);
+  if (!startIoUringRead()) {
+    readCallback_ = nullptr;
+    AsyncUDPSocket::resumeRead(cob);
+  }
+}
+
+void AsyncIoUringUDPSocket::pauseRead() {
+  stopIoUringRead();
+  AsyncUDPSocket::pauseRead();
+}
+
+void AsyncIoUringUDPSocket::close() {
+  stopIoUringRead();
+  flushSendRequests();
+  AsyncUDPSocket::close();
+}
+
+void AsyncIoUringUDPSocket::detachEventBase() {
+  stopIoUringRead();
+  releaseSendRequests();
+  backend_ = nullptr;
+  AsyncUDPSocket::detachEventBase();
+}
+
+void AsyncIoUringUDPSocket::attachEventBase(EventBase* evb) {
+  // Keep AsyncUDPSocket from registering for reads if the new EventBase
+  // supports io_uring.
+  auto* cob = std::exchange(readCallback_, nullptr);
+  AsyncUDPSocket::attachEventBase(evb);
+  backend_ = supports(evb) ? getBackend(evb) : nullptr;
+  if (backend_ && getZeroCopy()) {
+    AsyncUDPSocket::setZeroCopy(false);
+  }
+  if (cob) {
+    resumeRead(cob);
+  }
+}
+
+bool AsyncIoUringUDPSocket::setZeroCopy(bool enable) {
+  if (enable && backend_) {
+    return false;
+  }
+  return AsyncUDPSocket::setZeroCopy(enable);
+}
+
+ssize_t AsyncIoUringUDPSocket::sendmsg(
+    NetworkSocket socket, const struct msghdr* message, int flags) {
+  if (!backend_) {
+    return AsyncUDPSocket::sendmsg(socket, message, flags);
+  }
+  return queueSend(socket, *message, flags);
+}
+
+int AsyncIoUringUDPSocket::sendmmsg(
+    NetworkSocket socket,
+    struct mmsghdr* msgvec,
+    unsigned int vlen,
+    int flags) {
+  if (!backend_) {
+    return AsyncUDPSocket::sendmmsg(socket, msgvec, vlen, flags);
+  }
+  for (unsigned int i = 0; i < vlen; ++i) {
+    msgvec[i].msg_len =
+        static_cast<unsigned int>(queueSend(socket, msgvec[i].msg_hdr, flags));
+  }
+  return static_cast<int>(vlen);
+}
+
+} // namespace folly
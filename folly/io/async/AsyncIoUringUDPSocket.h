@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <folly/Range.h>
+#include <folly/io/async/AsyncUDPSocket.h>
+#include <folly/io/async/Liburing.h>
+
+namespace folly {
+
+class IoUringBackend;
+
+/**
+ * An AsyncUDPSocket that does its IO through the io_uring backend of its
+ * EventBase, and can be used anywhere an AsyncUDPSocket is.
+ *
+ * Reading keeps a single multishot recvmsg request armed, which picks a
+ * buffer from the backend's provided buffer ring for every datagram, so
+ * datagrams are received without a syscall each. The GRO segment size,
+ * timestamps, TOS and destination address are parsed from the control
+ * messages as AsyncUDPSocket does, and each datagram is then copied into
+ * the buffer returned by the ReadCallback. With GRO enabled, coalesced
+ * datagrams can be up to 64KB, so unless the provided buffers are that
+ * large, each datagram is read with a single recvmsg into a buffer of the
+ * socket's own instead. Enabling GRO while reading re-arms the request.
+ *
+ * Writing queues a sendmsg request per datagram (including GSO ones, with
+ * their control messages) instead of calling sendmsg() or sendmmsg(), so
+ * all the writes made in one loop iteration go to the kernel in a single
+ * io_uring_enter(). The data is copied into the request so that the caller
+ * can release its buffers as soon as the write returns, and the write
+ * returns the number of bytes (or datagrams) queued. As with a non-blocking
+ * socket with a full send buffer, a datagram that the kernel later fails to
+ * send is dropped; see getNumSendErrors().
+ *
+ * When the EventBase is not backed by an IoUringBackend with provided
+ * buffers (see supports()), or the ReadCallback only wants to be notified,
+ * the socket falls back to the AsyncUDPSocket implementation. Zero copy
+ * writes are not supported on the io_uring path.
+ */
+class AsyncIoUringUDPSocket : public AsyncUDPSocket {
+ public:
+  explicit AsyncIoUringUDPSocket(EventBase* evb);
+  ~AsyncIoUringUDPSocket() override;
+
+  /**
+   * Whether sockets on `evb` read and write through io_uring.
+   */
+  static bool supports(EventBase* evb);
+
+  /**
+   * Whether reads are currently done through io_uring.
+   */
+  bool isIoUringReading() const { return recvRequest_ != nullptr; }
+
+  /**
+   * The number of queued datagrams that the kernel failed to send.
+   */
+  size_t getNumSendErrors() const { return numSendErrors_; }
+
+  void resumeRead(ReadCallback* cob) override;
+  void pauseRead() override;
+  void close() override;
+
+  void detachEventBase() override;
+  void attachEventBase(EventBase* evb) override;
+
+  bool setZeroCopy(bool enable) override;
+  bool setGRO(bool bVal) override;
+
+ protected:
+  ssize_t sendmsg(
+      NetworkSocket socket, const struct msghdr* message, int flags) override;
+
+  int sendmmsg(
+      NetworkSocket socket,
+      struct mmsghdr* msgvec,
+      unsigned int vlen,
+      int flags) override;
+
+ private:
+  class RecvRequest;
+  class SendRequest;
+
+  static IoUringBackend* getBackend(EventBase* evb);
+
+  bool startIoUringRead();
+  void stopIoUringRead();
+  void flushSendRequests();
+  void releaseSendRequests();
+
+  ssize_t queueSend(NetworkSocket socket, const struct msghdr& msg, int flags);
+
+  void onRecv(
+      struct msghdr& msg, ByteRange payload, size_t datagramLen) noexcept;
+  void onRecvError(int err) noexcept;
+  void onSendComplete(SendRequest* request, int res) noexcept;
+
+  // Null if the EventBase is not backed by a suitable IoUringBackend.
+  IoUringBackend* backend_{nullptr};
+  // Requests still in flight when the socket lets go of them delete
+  // themselves once the backend is done with them.
+  std::unique_ptr<RecvRequest> recvRequest_;
+  // All the send requests, reused once they complete.
+  std::vector<std::unique_ptr<SendRequest>> sendRequests_;
+  std::vector<SendRequest*> freeSendRequests_;
+  size_t numSendErrors_{0};
+  // Temp space to receive client address
+  SocketAddress clientAddress_;
+};
+
+} // namespace folly
@@ -102,6 +102,21 @@ void* initsslBioMethod() {
   return nullptr;
 }
 
+#if FOLLY_OPENSSL_HAS_KTLS
+// Once OpenSSL has handed a direction of the connection to the kernel, the
+// records it still reads and writes carry their type as ancillary data, which
+// only the socket BIO methods that ours were copied from know how to handle.
+int socketBioWrite(BIO* b, const char* in, int inl) {
+  static const auto write = BIO_meth_get_write(BIO_s_socket());
+  return write(b, in, inl);
+}
+
+int socketBioRead(BIO* b, char* out, int outl) {
+  static const auto read = BIO_meth_get_read(BIO_s_socket());
+  return read(b, out, outl);
+}
+#endif
+
 } // namespace
 
 namespace folly {
@@ -1672,6 +1687,13 @@ AsyncSocket::WriteResult AsyncSSLSocket::performWrite(
         WRITE_ERROR, std::make_unique<SSLException>(SSLError::EARLY_WRITE));
   }
 
+  if (kernelTLS_ && isKernelTLSSendEnabled()) {
+    // The kernel splits the stream into records and encrypts them, so the
+    // buffers go to it as they are, without SSL_write() or minWriteSize_.
+    return AsyncSocket::performWrite(
+        vec, count, flags, countWritten, partialWritten, std::move(writeTag));
+  }
+
   // Declare a buffer used to hold small write requests.  It could point to a
   // memory block either on stack or on heap. If it is on heap, we release it
   // manually when scope exits
@@ -1872,6 +1894,18 @@ int AsyncSSLSocket::bioWrite(BIO* b, const char* in, int inl) {
   AsyncSSLSocket* sslSock = reinterpret_cast<AsyncSSLSocket*>(appData);
   CHECK(sslSock);
 
+#if FOLLY_OPENSSL_HAS_KTLS
+  if (BIO_get_ktls_send(b)) {
+    // Application data bypasses OpenSSL (see performWrite()), so this is an
+    // alert or a post-handshake message, such as a session ticket.
+    auto result = socketBioWrite(b, in, inl);
+    if (result > 0) {
+      sslSock->rawBytesWritten_ += result;
+    }
+    return result;
+  }
+#endif
+
   // if EOR is tracked, correct if needed
   WriteFlags flags = sslSock->currWriteFlags_;
   if (sslSock->trackEor_ &&
@@ -1921,6 +1955,10 @@ int AsyncSSLSocket::bioRead(BIO* b, char* out, int outl) {
     queue.trimStart(len);
     sslSock->preReceivedData_ = queue.move();
     return static_cast<int>(len);
+#if FOLLY_OPENSSL_HAS_KTLS
+  } else if (BIO_get_ktls_recv(b)) {
+    return socketBioRead(b, out, outl);
+#endif
   } else {
     auto result = int(netops::recv(OpenSSLUtils::getBioFd(b), out, outl, 0));
     if (result <= 0 && OpenSSLUtils::getBioShouldRetryWrite(result)) {
@@ -2019,6 +2057,40 @@ void AsyncSSLSocket::enableClientHelloParsing() {
   clientHelloInfo_ = std::make_unique<ssl::ClientHelloInfo>();
 }
 
+void AsyncSSLSocket::enableKernelTLS() {
+  DCHECK(!handshakeComplete_);
+  kernelTLS_ = true;
+#if FOLLY_OPENSSL_HAS_KTLS
+  if (ssl_) {
+    SSL_set_options(ssl_.get(), SSL_OP_ENABLE_KTLS);
+  }
+#endif
+}
+
+bool AsyncSSLSocket::isKernelTLSSendEnabled() const {
+#if FOLLY_OPENSSL_HAS_KTLS
+  BIO* b;
+  return ssl_ && (b = SSL_get_wbio(ssl_.get())) && BIO_get_ktls_send(b);
+#else
+  return false;
+#endif
+}
+
+bool AsyncSSLSocket::canSendFile() const {
+  return (sslState_ == STATE_UNENCRYPTED ||
+          (kernelTLS_ && isKernelTLSSendEnabled())) &&
+      AsyncSocket::canSendFile();
+}
+
+bool AsyncSSLSocket::isKernelTLSRecvEnabled() const {
+#if FOLLY_OPENSSL_HAS_KTLS
+  BIO* b;
+  return ssl_ && (b = SSL_get_rbio(ssl_.get())) && BIO_get_ktls_recv(b);
+#else
+  return false;
+#endif
+}
+
 void AsyncSSLSocket::resetClientHelloParsing(SSL* ssl) {
   SSL_set_msg_callback(ssl, nullptr);
   SSL_set_msg_callback_arg(ssl, nullptr);
@@ -2338,6 +2410,12 @@ void AsyncSSLSocket::createSSL() {
 
   SSL_set_ex_data(ssl_.get(), getSSLExDataIndex(), this);
 
+#if FOLLY_OPENSSL_HAS_KTLS
+  if (kernelTLS_) {
+    SSL_set_options(ssl_.get(), SSL_OP_ENABLE_KTLS);
+  }
+#endif
+
   if (!applyVerificationOptions(ssl_)) {
     sslState_ = STATE_ERROR;
     static const Indestructible<AsyncSocketException> ex(
@@ -427,6 +427,31 @@ class AsyncSSLSocket : public AsyncSocket {
 
   void enableClientHelloParsing();
 
+  /**
+   * Let OpenSSL hand the record layer to the kernel (kTLS) once the handshake
+   * has negotiated keys for a cipher the kernel supports, such as AES-GCM or
+   * ChaCha20-Poly1305. Must be called before the handshake starts.
+   *
+   * Once the kernel encrypts, writes skip SSL_write() and go through the plain
+   * AsyncSocket write path, so buffers are handed to the kernel without being
+   * copied and encrypted in userspace. Reads still go through SSL_read(), which
+   * gets records that the kernel already decrypted.
+   *
+   * If the kernel or OpenSSL lacks kTLS, or the cipher is not supported, the
+   * socket keeps doing TLS in userspace; see isKernelTLSSendEnabled().
+   */
+  void enableKernelTLS();
+
+  /**
+   * Whether the kernel encrypts what is written to this socket.
+   */
+  bool isKernelTLSSendEnabled() const;
+
+  /**
+   * Whether the kernel decrypts what is read from this socket.
+   */
+  bool isKernelTLSRecvEnabled() const;
+
   /**
    * Accept an SSL connection on the socket.
    *
@@ -934,6 +959,10 @@ class AsyncSSLSocket : public AsyncSocket {
       uint32_t* partialWritten,
       WriteRequestTag writeTag) override;
 
+  // Only when performWrite() bypasses SSL_write(): before TLS starts, or once
+  // the kernel encrypts.
+  bool canSendFile() const override;
+
   ssize_t performWriteIovec(
       const iovec* vec,
       uint32_t count,
@@ -1028,6 +1057,7 @@ class AsyncSSLSocket : public AsyncSocket {
   static int sslVerifyCallback(int preverifyOk, X509_STORE_CTX* ctx);
 
   bool parseClientHello_{false};
+  bool kernelTLS_{false};
   bool cacheAddrOnFailure_{false};
   bool certCacheHit_{false};
   std::unique_ptr<ssl::ClientHelloInfo> clientHelloInfo_;
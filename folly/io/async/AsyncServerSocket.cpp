@@ -22,6 +22,10 @@
 
 #include <sys/types.h>
 
+#if defined(__linux__)
+#include <linux/filter.h>
+#endif
+
 #include <cerrno>
 #include <cstring>
 
@@ -32,6 +36,7 @@
 #include <folly/String.h>
 #include <folly/detail/SocketFastOpen.h>
 #include <folly/io/async/EventBase.h>
+#include <folly/io/async/IoUringAccept.h>
 #include <folly/io/async/NotificationQueue.h>
 #include <folly/portability/Fcntl.h>
 #include <folly/portability/Sockets.h>
@@ -127,6 +132,62 @@ class AsyncServerSocket::BackoffTimeout : public AsyncTimeout {
   AsyncServerSocket* socket_;
 };
 
+/*
+ * AsyncServerSocket::IoUringAcceptor
+ */
+class AsyncServerSocket::IoUringAcceptor : public IoUringAcceptCallback {
+ public:
+  IoUringAcceptor(
+      AsyncServerSocket* parent,
+      NetworkSocket socket,
+      sa_family_t addressFamily)
+      : parent_(parent), socket_(socket), addressFamily_(addressFamily) {}
+
+  ~IoUringAcceptor() override {
+    if (handle_ && handle_->cancel()) {
+      handle_.release();
+    }
+  }
+
+  bool start(EventBase* eventBase) {
+    handle_ = IoUringAcceptHandle::create(eventBase, socket_, this);
+    return handle_ != nullptr;
+  }
+
+  void acceptSuccess(NetworkSocket fd) noexcept override {
+    sockaddr_storage addrStorage = {};
+    socklen_t addrLen = sizeof(addrStorage);
+    auto saddr = reinterpret_cast<sockaddr*>(&addrStorage);
+    saddr->sa_family = addressFamily_;
+    if (addressFamily_ == AF_UNIX) {
+      addrLen = sizeof(struct sockaddr_un);
+    }
+    netops::getpeername(fd, saddr, &addrLen);
+
+    SocketAddress address;
+    address.setFromSockaddr(saddr, addrLen);
+    DestructorGuard dg(parent_);
+    parent_->onSocketAccepted(fd, 0, std::move(address), addressFamily_);
+  }
+
+  void acceptError(int err) noexcept override {
+    // Either call may destroy this acceptor.
+    if (err == EINVAL) {
+      parent_->ioUringAcceptUnsupported();
+      return;
+    }
+    DestructorGuard dg(parent_);
+    parent_->onSocketAccepted(
+        NetworkSocket(), err, SocketAddress(), addressFamily_);
+  }
+
+ private:
+  AsyncServerSocket* parent_;
+  NetworkSocket socket_;
+  sa_family_t addressFamily_;
+  IoUringAcceptHandle::UniquePtr handle_;
+};
+
 /*
  * AsyncServerSocket methods
  */
@@ -189,6 +250,7 @@ int AsyncServerSocket::stopAccepting(int shutdownFlags) {
 
   // When destroy is called, unregister and close the socket immediately.
   accepting_ = false;
+  ioUringAcceptors_.clear();
 
   // Close the sockets in reverse order as they were opened to avoid
   // the condition where another process concurrently tries to open
@@ -837,9 +899,7 @@ void AsyncServerSocket::removeAcceptCallback(
   // If we are supposed to be accepting but the last accept callback
   // was removed, unregister for events until a callback is added.
   if (accepting_ && callbacks_.empty()) {
-    for (auto& handler : sockets_) {
-      handler.unregisterHandler();
-    }
+    unregisterAcceptHandlers();
   }
 }
 
@@ -855,10 +915,8 @@ void AsyncServerSocket::startAccepting() {
     return;
   }
 
-  for (auto& handler : sockets_) {
-    if (!handler.registerHandler(EventHandler::READ | EventHandler::PERSIST)) {
-      throw std::runtime_error("failed to register for accept events");
-    }
+  if (!registerAcceptHandlers()) {
+    throw std::runtime_error("failed to register for accept events");
   }
 }
 
@@ -867,9 +925,7 @@ void AsyncServerSocket::pauseAccepting() {
     eventBase_->dcheckIsInEventBaseThread();
   }
   accepting_ = false;
-  for (auto& handler : sockets_) {
-    handler.unregisterHandler();
-  }
+  unregisterAcceptHandlers();
 
   // If we were in the accept backoff state, disable the backoff timeout
   if (backoffTimeout_) {
@@ -877,6 +933,48 @@ void AsyncServerSocket::pauseAccepting() {
   }
 }
 
+bool AsyncServerSocket::registerAcceptHandlers() {
+  if (ioUringAccept_ && ioUringAcceptors_.empty()) {
+    for (auto& handler : sockets_) {
+      auto acceptor = std::make_unique<IoUringAcceptor>(
+          this, handler.socket_, handler.addressFamily_);
+      if (!acceptor->start(eventBase_)) {
+        // Not an io_uring EventBase; accept through the EventHandlers.
+        ioUringAcceptors_.clear();
+        break;
+      }
+      ioUringAcceptors_.push_back(std::move(acceptor));
+    }
+    if (!ioUringAcceptors_.empty()) {
+      return true;
+    }
+  }
+
+  for (auto& handler : sockets_) {
+    if (!handler.registerHandler(EventHandler::READ | EventHandler::PERSIST)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void AsyncServerSocket::unregisterAcceptHandlers() {
+  ioUringAcceptors_.clear();
+  for (auto& handler : sockets_) {
+    handler.unregisterHandler();
+  }
+}
+
+void AsyncServerSocket::ioUringAcceptUnsupported() {
+  LOG(WARNING) << "io_uring multishot accept is not supported by the kernel; "
+               << "falling back to accept()";
+  ioUringAccept_ = false;
+  unregisterAcceptHandlers();
+  if (accepting_ && !callbacks_.empty() && !registerAcceptHandlers()) {
+    dispatchError("failed to register for accept events", EINVAL);
+  }
+}
+
 NetworkSocket AsyncServerSocket::createSocket(
     int family, const SocketOptionMap& socketOptions) {
   auto fd = netops::socket(family, SOCK_STREAM, 0);
@@ -950,6 +1048,37 @@ void AsyncServerSocket::setListenerTos(uint32_t tos) {
   listenerTos_ = tos;
 }
 
+void AsyncServerSocket::attachReusePortCpuSteering() {
+#if defined(__linux__) && defined(SO_ATTACH_REUSEPORT_CBPF)
+  // Return the index of the CPU the packet is being processed on, which the
+  // kernel uses as the index of the socket in the SO_REUSEPORT group.
+  sock_filter code[] = {
+      {BPF_LD | BPF_W | BPF_ABS, 0, 0, uint32_t(SKF_AD_OFF + SKF_AD_CPU)},
+      {BPF_RET | BPF_A, 0, 0, 0},
+  };
+  sock_fprog prog = {};
+  prog.len = sizeof(code) / sizeof(code[0]);
+  prog.filter = code;
+
+  for (auto& handler : sockets_) {
+    if (handler.socket_ == NetworkSocket()) {
+      continue;
+    }
+    if (netops::setsockopt(
+            handler.socket_,
+            SOL_SOCKET,
+            SO_ATTACH_REUSEPORT_CBPF,
+            &prog,
+            sizeof(prog)) != 0) {
+      folly::throwSystemError(errno, "failed to attach reuse port steering");
+    }
+  }
+#else
+  folly::throwSystemErrorExplicit(
+      ENOTSUP, "reuse port steering is not supported on this platform");
+#endif
+}
+
 void AsyncServerSocket::setupSocket(
     NetworkSocket fd, int family, const SocketOptionMap& socketOptions) {
   // Apply caller-provided PRE_BIND socket options.
@@ -1107,129 +1236,139 @@ void AsyncServerSocket::handlerReady(
 #else
     auto clientSocket = netops::accept(fd, saddr, &addrLen);
 #endif
+    int errnoCopy = errno;
 
     address.setFromSockaddr(saddr, addrLen);
 
-    if (clientSocket != NetworkSocket() && connectionEventCallback_) {
-      connectionEventCallback_->onConnectionAccepted(clientSocket, address);
+    if (!onSocketAccepted(
+            clientSocket, errnoCopy, std::move(address), addressFamily)) {
+      return;
     }
+  }
+}
 
-    // Connection accepted, get the SYN packet from the client if
-    // TOS reflect is enabled
-    if (kSupportReflectTos && clientSocket != NetworkSocket() && tosReflect_) {
-      std::array<uint32_t, 64> buffer;
-      socklen_t len = sizeof(buffer);
-      int ret = netops::getsockopt(
-          clientSocket, IPPROTO_TCP, TCP_SAVED_SYN, &buffer, &len);
-
-      if (ret == 0) {
-        uint32_t tosWord = folly::Endian::big(buffer[0]);
-        if (addressFamily == AF_INET6) {
-          tosWord = (tosWord & 0x0FC00000) >> 20;
-          // Set the TOS on the return socket only if it is non-zero
-          if (tosWord) {
-            ret = netops::setsockopt(
-                clientSocket,
-                IPPROTO_IPV6,
-                IPV6_TCLASS,
-                &tosWord,
-                sizeof(tosWord));
-          }
-        } else if (addressFamily == AF_INET) {
-          tosWord = (tosWord & 0x00FC0000) >> 16;
-          if (tosWord) {
-            ret = netops::setsockopt(
-                clientSocket, IPPROTO_IP, IP_TOS, &tosWord, sizeof(tosWord));
-          }
-        }
+bool AsyncServerSocket::onSocketAccepted(
+    NetworkSocket clientSocket,
+    int errnoValue,
+    SocketAddress&& address,
+    sa_family_t addressFamily) noexcept {
+  if (clientSocket != NetworkSocket() && connectionEventCallback_) {
+    connectionEventCallback_->onConnectionAccepted(clientSocket, address);
+  }
+
+  // Connection accepted, get the SYN packet from the client if
+  // TOS reflect is enabled
+  if (kSupportReflectTos && clientSocket != NetworkSocket() && tosReflect_) {
+    std::array<uint32_t, 64> buffer;
+    socklen_t len = sizeof(buffer);
+    int ret = netops::getsockopt(
+        clientSocket, IPPROTO_TCP, TCP_SAVED_SYN, &buffer, &len);
 
-        if (ret != 0) {
-          LOG(ERROR) << "Unable to set TOS for accepted socket "
-                     << clientSocket;
+    if (ret == 0) {
+      uint32_t tosWord = folly::Endian::big(buffer[0]);
+      if (addressFamily == AF_INET6) {
+        tosWord = (tosWord & 0x0FC00000) >> 20;
+        // Set the TOS on the return socket only if it is non-zero
+        if (tosWord) {
+          ret = netops::setsockopt(
+              clientSocket,
+              IPPROTO_IPV6,
+              IPV6_TCLASS,
+              &tosWord,
+              sizeof(tosWord));
         }
-      } else {
-        LOG(ERROR) << "Unable to get SYN packet for accepted socket "
+      } else if (addressFamily == AF_INET) {
+        tosWord = (tosWord & 0x00FC0000) >> 16;
+        if (tosWord) {
+          ret = netops::setsockopt(
+              clientSocket, IPPROTO_IP, IP_TOS, &tosWord, sizeof(tosWord));
+        }
+      }
+
+      if (ret != 0) {
+        LOG(ERROR) << "Unable to set TOS for accepted socket "
                    << clientSocket;
       }
+    } else {
+      LOG(ERROR) << "Unable to get SYN packet for accepted socket "
+                 << clientSocket;
     }
+  }
 
-    std::chrono::time_point<std::chrono::steady_clock> nowMs =
-        std::chrono::steady_clock::now();
-    auto timeSinceLastAccept = std::max<int64_t>(
-        0,
-        nowMs.time_since_epoch().count() -
-            lastAccepTimestamp_.time_since_epoch().count());
-    lastAccepTimestamp_ = nowMs;
-    if (acceptRate_ < 1) {
-      acceptRate_ *= 1 + acceptRateAdjustSpeed_ * timeSinceLastAccept;
-      if (acceptRate_ >= 1) {
-        acceptRate_ = 1;
-      } else if (rand() > acceptRate_ * RAND_MAX) {
-        ++numDroppedConnections_;
-        if (clientSocket != NetworkSocket()) {
-          closeNoInt(clientSocket);
-          if (connectionEventCallback_) {
-            connectionEventCallback_->onConnectionDropped(
-                clientSocket,
-                address,
-                fmt::format(
-                    "Server is rate limiting new connections. Current accept rate is {}",
-                    acceptRate_));
-          }
+  std::chrono::time_point<std::chrono::steady_clock> nowMs =
+      std::chrono::steady_clock::now();
+  auto timeSinceLastAccept = std::max<int64_t>(
+      0,
+      nowMs.time_since_epoch().count() -
+          lastAccepTimestamp_.time_since_epoch().count());
+  lastAccepTimestamp_ = nowMs;
+  if (acceptRate_ < 1) {
+    acceptRate_ *= 1 + acceptRateAdjustSpeed_ * timeSinceLastAccept;
+    if (acceptRate_ >= 1) {
+      acceptRate_ = 1;
+    } else if (rand() > acceptRate_ * RAND_MAX) {
+      ++numDroppedConnections_;
+      if (clientSocket != NetworkSocket()) {
+        closeNoInt(clientSocket);
+        if (connectionEventCallback_) {
+          connectionEventCallback_->onConnectionDropped(
+              clientSocket,
+              address,
+              fmt::format(
+                  "Server is rate limiting new connections. Current accept rate is {}",
+                  acceptRate_));
         }
-        continue;
       }
+      return true;
     }
+  }
 
-    if (clientSocket == NetworkSocket()) {
-      if (errno == EAGAIN) {
-        // No more sockets to accept right now.
-        // Check for this code first, since it's the most common.
-        return;
-      } else if (errno == EMFILE || errno == ENFILE) {
-        // We're out of file descriptors.  Perhaps we're accepting connections
-        // too quickly. Pause accepting briefly to back off and give the server
-        // a chance to recover.
-        LOG(ERROR) << "accept failed: out of file descriptors; entering accept "
-                      "back-off state";
-        enterBackoff();
-
-        // Dispatch the error message
-        dispatchError("accept() failed", errno);
-      } else {
-        dispatchError("accept() failed", errno);
-      }
-      if (connectionEventCallback_) {
-        connectionEventCallback_->onConnectionAcceptError(errno);
-      }
-      return;
+  if (clientSocket == NetworkSocket()) {
+    if (errnoValue == EAGAIN) {
+      // No more sockets to accept right now.
+      // Check for this code first, since it's the most common.
+      return false;
+    } else if (errnoValue == EMFILE || errnoValue == ENFILE) {
+      // We're out of file descriptors.  Perhaps we're accepting connections
+      // too quickly. Pause accepting briefly to back off and give the server
+      // a chance to recover.
+      LOG(ERROR) << "accept failed: out of file descriptors; entering accept "
+                    "back-off state";
+      enterBackoff();
+
+      // Dispatch the error message
+      dispatchError("accept() failed", errnoValue);
+    } else {
+      dispatchError("accept() failed", errnoValue);
+    }
+    if (connectionEventCallback_) {
+      connectionEventCallback_->onConnectionAcceptError(errnoValue);
     }
+    return false;
+  }
 
 #if !FOLLY_HAVE_ACCEPT4
-    // Explicitly set the new connection to non-blocking mode
-    if (netops::set_socket_non_blocking(clientSocket) != 0) {
-      closeNoInt(clientSocket);
-      std::string errorMsg =
-          "Failed to set accepted socket to non-blocking mode.";
-      dispatchError(errorMsg.c_str(), errno);
-      if (connectionEventCallback_) {
-        connectionEventCallback_->onConnectionDropped(
-            clientSocket,
-            address,
-            fmt::format("{} errno ({})", std::move(errorMsg), errno));
-      }
-      return;
+  // Explicitly set the new connection to non-blocking mode
+  if (netops::set_socket_non_blocking(clientSocket) != 0) {
+    closeNoInt(clientSocket);
+    std::string errorMsg =
+        "Failed to set accepted socket to non-blocking mode.";
+    dispatchError(errorMsg.c_str(), errno);
+    if (connectionEventCallback_) {
+      connectionEventCallback_->onConnectionDropped(
+          clientSocket,
+          address,
+          fmt::format("{} errno ({})", std::move(errorMsg), errno));
     }
+    return false;
+  }
 #endif
 
-    // Inform the callback about the new connection
-    dispatchSocket(clientSocket, std::move(address));
+  // Inform the callback about the new connection
+  dispatchSocket(clientSocket, std::move(address));
 
-    // If we aren't accepting any more, break out of the loop
-    if (!accepting_ || callbacks_.empty()) {
-      break;
-    }
-  }
+  // Keep accepting unless we were paused or lost our last callback
+  return accepting_ && !callbacks_.empty();
 }
 
 void AsyncServerSocket::dispatchSocket(
@@ -1377,9 +1516,7 @@ void AsyncServerSocket::enterBackoff() {
   // The backoff timer is scheduled to re-enable accepts.
   // Go ahead and disable accepts for now.  We leave accepting_ set to true,
   // since that tracks the desired state requested by the user.
-  for (auto& handler : sockets_) {
-    handler.unregisterHandler();
-  }
+  unregisterAcceptHandlers();
   if (connectionEventCallback_) {
     connectionEventCallback_->onBackoffStarted();
   }
@@ -1403,18 +1540,16 @@ void AsyncServerSocket::backoffTimeoutExpired() {
   }
 
   // Register the handler.
-  for (auto& handler : sockets_) {
-    if (!handler.registerHandler(EventHandler::READ | EventHandler::PERSIST)) {
-      // We're hosed.  We could just re-schedule backoffTimeout_ to
-      // re-try again after a little bit.  However, we don't want to
-      // loop retrying forever if we can't re-enable accepts.  Just
-      // abort the entire program in this state; things are really bad
-      // and restarting the entire server is probably the best remedy.
-      LOG(ERROR)
-          << "failed to re-enable AsyncServerSocket accepts after backoff; "
-          << "crashing now";
-      abort();
-    }
+  if (!registerAcceptHandlers()) {
+    // We're hosed.  We could just re-schedule backoffTimeout_ to
+    // re-try again after a little bit.  However, we don't want to
+    // loop retrying forever if we can't re-enable accepts.  Just
+    // abort the entire program in this state; things are really bad
+    // and restarting the entire server is probably the best remedy.
+    LOG(ERROR)
+        << "failed to re-enable AsyncServerSocket accepts after backoff; "
+        << "crashing now";
+    abort();
   }
   if (connectionEventCallback_) {
     connectionEventCallback_->onBackoffEnded();
@@ -718,6 +718,34 @@ class AsyncServerSocket : public DelayedDestruction, public AsyncSocketBase {
    */
   void setListenerTos(uint32_t tos);
 
+  /**
+   * Steer each new connection to the SO_REUSEPORT listener whose index in
+   * the reuse port group matches the CPU that received the SYN. Combined
+   * with one listener per IO thread (bound in thread order) and RX queues
+   * pinned to those CPUs, a connection is accepted and served on the CPU
+   * that handles its packets. Only supported on Linux; must be called after
+   * bind() on a socket with reuse port enabled.
+   */
+  void attachReusePortCpuSteering();
+
+  /**
+   * Accept connections with io_uring multishot accept instead of waiting
+   * for readiness and calling accept(), if the EventBase is backed by an
+   * IoUringBackend; otherwise this has no effect. Falls back to accept() if
+   * the kernel does not support multishot accept. Accepted connections go
+   * through the same AcceptCallbacks, but maxAcceptAtOnce does not apply.
+   *
+   * To shard accepts across IO threads, create one AsyncServerSocket per
+   * IO thread EventBase, bind each to the same address with reuse port
+   * enabled, and add an AcceptCallback with a null EventBase so that
+   * connections are handed over on the thread that accepted them.
+   *
+   * Must be called before startAccepting().
+   */
+  void setIoUringAcceptEnabled(bool enabled) { ioUringAccept_ = enabled; }
+
+  bool getIoUringAcceptEnabled() const { return ioUringAccept_; }
+
   /**
    * Get default TOS for listener socket
    */
@@ -980,9 +1008,19 @@ class AsyncServerSocket : public DelayedDestruction, public AsyncSocketBase {
   };
 
   class BackoffTimeout;
+  class IoUringAcceptor;
 
   virtual void handlerReady(
       uint16_t events, NetworkSocket fd, sa_family_t family) noexcept;
+  // Handles the result of one accept. Returns whether to keep accepting.
+  bool onSocketAccepted(
+      NetworkSocket clientSocket,
+      int errnoValue,
+      SocketAddress&& address,
+      sa_family_t addressFamily) noexcept;
+  bool registerAcceptHandlers();
+  void unregisterAcceptHandlers();
+  void ioUringAcceptUnsupported();
 
   NetworkSocket createSocket(
       int family, const SocketOptionMap& socketOptions = emptySocketOptionMap);
@@ -1103,6 +1141,8 @@ class AsyncServerSocket : public DelayedDestruction, public AsyncSocketBase {
   bool tosReflect_{false};
   uint32_t listenerTos_{0};
   bool zeroCopyVal_{false};
+  bool ioUringAccept_{false};
+  std::vector<std::unique_ptr<IoUringAcceptor>> ioUringAcceptors_;
   folly::observer::AtomicObserver<std::chrono::nanoseconds> queueTimeout_{
       folly::observer::makeStaticObserver(std::chrono::nanoseconds::zero())};
 };
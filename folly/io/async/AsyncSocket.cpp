@@ -25,6 +25,7 @@
 #include <boost/preprocessor/control/if.hpp>
 
 #include <folly/Exception.h>
+#include <folly/FileUtil.h>
 #include <folly/Overload.h>
 #include <folly/Portability.h>
 #include <folly/SocketAddress.h>
@@ -44,7 +45,9 @@
 #if defined(__linux__)
 #include <linux/if_packet.h>
 #include <linux/sockios.h>
+#include <signal.h>
 #include <sys/ioctl.h>
+#include <sys/sendfile.h>
 #endif
 
 using ZeroCopyMemStore = folly::AsyncReader::ReadCallback::ZeroCopyMemStore;
@@ -153,10 +156,19 @@ using ZeroCopyMMapMemStore = ZeroCopyMMapMemStoreFallback;
 bool checkIoUringBackend(folly::EventBase* evb) {
   return dynamic_cast<folly::IoUringBackend*>(evb->getBackend()) != nullptr;
 }
+
+bool checkIoUringBatchWrites(folly::EventBase* evb) {
+  auto* backend = dynamic_cast<folly::IoUringBackend*>(evb->getBackend());
+  return backend && backend->options().batchSocketWrites;
+}
 #else
 bool checkIoUringBackend(folly::EventBase*) {
   return false;
 }
+
+bool checkIoUringBatchWrites(folly::EventBase*) {
+  return false;
+}
 #endif
 } // namespace
 
@@ -419,6 +431,269 @@ class AsyncSocket::BytesWriteRequest : public AsyncSocket::WriteRequest {
   struct iovec writeOps_[]; ///< write operation(s) list
 };
 
+/* The default WriteRequest implementation for writeFile(). While the socket
+ * can use sendfile() (see canSendFile()), it sends the range straight from
+ * the file. Otherwise, as on TLS sockets, which have to pass the bytes to
+ * performWrite(), it reads the range a chunk at a time, and at most one chunk
+ * per performWrite(), so that a large range neither sits in memory nor holds
+ * up the loop. This is decided on every performWrite(), since a socket may
+ * start TLS while the request is queued.
+ */
+class AsyncSocket::FileWriteRequest : public AsyncSocket::WriteRequest {
+ public:
+  FileWriteRequest(
+      AsyncSocket* socket,
+      WriteCallbackWithState callbackWithState,
+      int fd,
+      off_t offset,
+      size_t length)
+      : AsyncSocket::WriteRequest(socket, callbackWithState),
+        fd_(fd),
+        offset_(offset),
+        remaining_(length) {
+#if defined(__linux__)
+    struct sigaction action;
+    maskSigpipe_ = sigaction(SIGPIPE, nullptr, &action) != 0 ||
+        action.sa_handler != SIG_IGN;
+#endif
+  }
+
+  void destroy() override { delete this; }
+
+  WriteResult performWrite() override {
+    bytesWritten_ = 0;
+    // A chunk partly sent has to be finished first.
+    if (unsent_.empty() && socket_->canSendFile()) {
+      return sendFile();
+    }
+    return writeChunk();
+  }
+
+  bool isComplete() override { return remaining_ == 0; }
+
+  void consume() override { totalBytesWritten_ += uint32_t(bytesWritten_); }
+
+ private:
+  // private destructor, to ensure callers use destroy()
+  ~FileWriteRequest() override = default;
+
+  WriteResult sendFile() {
+#if defined(__linux__)
+    // Unlike sendmsg(), sendfile() takes no MSG_DONTWAIT, and a socket
+    // AsyncSocket did not connect itself may still be blocking.
+    if (!socket_->sendFileNonBlocking_) {
+      if (socket_->netops_->set_socket_non_blocking(socket_->fd_) == -1) {
+        auto errnoCopy = errno;
+        return WriteResult(
+            WRITE_ERROR,
+            std::make_unique<AsyncSocketException>(
+                AsyncSocketException::INTERNAL_ERROR,
+                socket_->withAddr("failed to put socket in non-blocking mode"),
+                errnoCopy));
+      }
+      socket_->sendFileNonBlocking_ = true;
+    }
+
+    // sendfile() has no MSG_NOSIGNAL: unless SIGPIPE is ignored, block the
+    // SIGPIPE a reset peer would raise, and discard it, so that this fails
+    // with EPIPE like sendmsg().
+    sigset_t sigpipe;
+    sigset_t oldMask;
+    if (maskSigpipe_) {
+      sigemptyset(&sigpipe);
+      sigaddset(&sigpipe, SIGPIPE);
+      pthread_sigmask(SIG_BLOCK, &sigpipe, &oldMask);
+    }
+    // Linux sends at most 0x7ffff000 bytes per call.
+    auto rv = ::sendfile(
+        socket_->fd_.toFd(),
+        fd_,
+        &offset_,
+        std::min<size_t>(remaining_, 0x7ffff000));
+    auto errnoCopy = errno;
+    if (maskSigpipe_) {
+      if (rv < 0 && errnoCopy == EPIPE && !sigismember(&oldMask, SIGPIPE)) {
+        timespec zero{};
+        while (sigtimedwait(&sigpipe, nullptr, &zero) == -1 &&
+               errno == EINTR) {
+        }
+      }
+      pthread_sigmask(SIG_SETMASK, &oldMask, nullptr);
+      errno = errnoCopy;
+    }
+
+    if (rv < 0) {
+      if (errnoCopy == EAGAIN || errnoCopy == EWOULDBLOCK) {
+        return WriteResult(0);
+      }
+      return WriteResult(WRITE_ERROR);
+    }
+    if (rv == 0 && remaining_ > 0) {
+      return WriteResult(
+          WRITE_ERROR,
+          std::make_unique<AsyncSocketException>(
+              AsyncSocketException::BAD_ARGS,
+              socket_->withAddr("file ended before the range was sent")));
+    }
+    bytesWritten_ = size_t(rv);
+    remaining_ -= bytesWritten_;
+    socket_->appBytesWritten_ += bytesWritten_;
+    socket_->rawBytesWritten_ += bytesWritten_;
+    return WriteResult(rv);
+#else
+    return WriteResult(
+        WRITE_ERROR,
+        std::make_unique<AsyncSocketException>(
+            AsyncSocketException::NOT_SUPPORTED, "sendfile() not supported"));
+#endif
+  }
+
+  WriteResult writeChunk() {
+    if (unsent_.empty()) {
+      auto chunk = socket_->readFileChunk(
+          fd_,
+          offset_,
+          std::min(remaining_, AsyncSocket::kFileWriteChunkSize));
+      if (chunk.hasError()) {
+        return WriteResult(
+            WRITE_ERROR,
+            std::make_unique<AsyncSocketException>(std::move(chunk.error())));
+      }
+      buf_ = std::move(chunk.value());
+      offset_ += off_t(buf_->length());
+      unsent_ = buf_->coalesce();
+    }
+
+    WriteFlags flags = WriteFlags::NONE;
+    if (getNext() != nullptr || remaining_ > unsent_.size()) {
+      flags |= WriteFlags::CORK;
+    }
+    iovec vec;
+    vec.iov_base = const_cast<uint8_t*>(unsent_.data());
+    vec.iov_len = unsent_.size();
+    uint32_t countWritten = 0;
+    uint32_t partialWritten = 0;
+    auto writeResult = socket_->performWrite(
+        &vec,
+        1,
+        flags,
+        &countWritten,
+        &partialWritten,
+        WriteRequestTag{buf_.get()});
+    if (writeResult.writeReturn > 0) {
+      bytesWritten_ = size_t(writeResult.writeReturn);
+      unsent_.advance(bytesWritten_);
+      remaining_ -= bytesWritten_;
+    }
+    return writeResult;
+  }
+
+  int fd_;
+  off_t offset_; ///< next byte of the file to send or read
+  size_t remaining_; ///< bytes of the range left to send
+  std::unique_ptr<IOBuf> buf_; ///< the chunk being written, if any
+  ByteRange unsent_; ///< the bytes of buf_ left to send
+  size_t bytesWritten_{0}; ///< bytes sent by the last performWrite()
+  bool maskSigpipe_{false}; ///< whether SIGPIPE was not ignored at the start
+};
+
+/* Writes a range of a file through the socket's buffer writes a chunk at a
+ * time, writing each chunk once the previous one was sent. Used by
+ * writeFile() on io_uring sockets, whose writes do not go through
+ * WriteRequests. Until it has queued its last chunk, it is the socket's
+ * fileChunkWriter_, and the writes issued after it are held back. Deletes
+ * itself once done.
+ */
+class AsyncSocket::FileChunkWriter : public AsyncSocket::WriteCallback {
+ public:
+  FileChunkWriter(
+      AsyncSocket* socket,
+      WriteCallback* callback,
+      int fd,
+      off_t offset,
+      size_t length)
+      : socket_(socket),
+        callback_(callback),
+        fd_(fd),
+        offset_(offset),
+        remaining_(length) {}
+
+  void writeNext() {
+    DestructorGuard dg(socket_);
+    auto* socket = socket_;
+    auto chunk = socket->readFileChunk(
+        fd_,
+        offset_,
+        std::min(remaining_, AsyncSocket::kFileWriteChunkSize));
+    if (chunk.hasError()) {
+      auto* callback = callback_;
+      auto written = written_;
+      finish();
+      return socket->failWrite(__func__, callback, written, chunk.error());
+    }
+    inFlight_ = chunk.value()->length();
+    offset_ += off_t(inFlight_);
+    remaining_ -= inFlight_;
+
+    // A failed write calls writeErr() right away: stay alive until
+    // writeChain() returns.
+    writing_ = true;
+    socket->writeChain(this, std::move(chunk.value()));
+    writing_ = false;
+    if (remaining_ == 0 && socket->fileChunkWriter_ == this) {
+      socket->releaseWritesAfterFile();
+    }
+    if (done_) {
+      delete this;
+    }
+  }
+
+  void writeSuccess() noexcept override {
+    written_ += inFlight_;
+    if (remaining_ > 0) {
+      return writeNext();
+    }
+    auto* callback = callback_;
+    finish();
+    if (callback) {
+      callback->writeSuccess();
+    }
+  }
+
+  void writeErr(
+      size_t bytesWritten, const AsyncSocketException& ex) noexcept override {
+    auto* callback = callback_;
+    auto written = written_ + bytesWritten;
+    finish();
+    if (callback) {
+      callback->writeErr(written, ex);
+    }
+  }
+
+ private:
+  void finish() {
+    // On failure, the socket fails the writes it held back.
+    if (socket_->fileChunkWriter_ == this) {
+      socket_->fileChunkWriter_ = nullptr;
+    }
+    if (writing_) {
+      done_ = true;
+    } else {
+      delete this;
+    }
+  }
+
+  AsyncSocket* socket_;
+  WriteCallback* callback_;
+  int fd_;
+  off_t offset_; ///< next byte of the file to read
+  size_t remaining_; ///< bytes of the range left to read
+  size_t inFlight_{0}; ///< bytes of the chunk being written
+  size_t written_{0}; ///< bytes of the range written so far
+  bool writing_{false}; ///< whether writeNext() is in writeChain()
+  bool done_{false}; ///< whether it finished while writing_
+};
+
 int AsyncSocket::SendMsgParamsCallback::getDefaultFlags(
     folly::WriteFlags flags, bool zeroCopyEnabled) noexcept {
   int msg_flags = MSG_DONTWAIT;
@@ -807,6 +1082,7 @@ void AsyncSocket::init() {
   if (eventBase_) {
     eventBase_->dcheckIsInEventBaseThread();
     useIoUring_ = checkIoUringBackend(eventBase_);
+    iouBatchWrites_ = checkIoUringBatchWrites(eventBase_);
   }
   eventFlags_ = EventHandler::NONE;
   sendTimeout_ = 0;
@@ -2007,6 +2283,121 @@ void AsyncSocket::writeChainImpl(
       callback, vec, res.numIovecs, std::move(buf), res.totalLength, flags);
 }
 
+folly::Expected<std::unique_ptr<IOBuf>, AsyncSocketException>
+AsyncSocket::readFileChunk(int fd, off_t offset, size_t length) {
+  auto buf = IOBuf::create(length);
+  auto rv = preadFull(fd, buf->writableData(), length, offset);
+  if (rv < 0) {
+    auto errnoCopy = errno;
+    return folly::makeUnexpected(AsyncSocketException(
+        AsyncSocketException::INTERNAL_ERROR,
+        withAddr("failed to read the file"),
+        errnoCopy));
+  }
+  if (size_t(rv) != length) {
+    return folly::makeUnexpected(AsyncSocketException(
+        AsyncSocketException::BAD_ARGS,
+        withAddr("file ended before the range was sent")));
+  }
+  buf->append(length);
+  return buf;
+}
+
+bool AsyncSocket::canSendFile() const {
+#if defined(__linux__)
+  // io_uring sockets queue their writes in iouSendHandle_, which only takes
+  // buffers.
+  return !useIoUring_;
+#else
+  return false;
+#endif
+}
+
+void AsyncSocket::writeFile(
+    WriteCallback* callback, int fd, off_t offset, size_t length) {
+  VLOG(6) << "AsyncSocket::writeFile() this=" << this << ", fd=" << fd_
+          << ", callback=" << callback << ", file=" << fd
+          << ", offset=" << offset << ", length=" << length
+          << ", state=" << state_;
+  DestructorGuard dg(this);
+  eventBase_->dcheckIsInEventBaseThread();
+
+  if (state_ == StateEnum::FAST_OPEN) {
+    // The first bytes go out with the TFO connect, through performWrite():
+    // write the first chunk as a buffer, and queue the rest behind it.
+    auto n = std::min(length, kFileWriteChunkSize);
+    auto chunk = readFileChunk(fd, offset, n);
+    if (chunk.hasError()) {
+      return failWrite(__func__, callback, 0, chunk.error());
+    }
+    if (n == length) {
+      return writeChain(callback, std::move(chunk.value()));
+    }
+    writeChain(nullptr, std::move(chunk.value()));
+    offset += off_t(n);
+    length -= n;
+  }
+
+  if (shutdownFlags_ & (SHUT_WRITE | SHUT_WRITE_PENDING)) {
+    // As in writeImpl(), fail everything: writing after shutdown is a bug.
+    return invalidState(callback);
+  }
+  if (state_ != StateEnum::ESTABLISHED && !connecting()) {
+    return invalidState(callback);
+  }
+
+  if (useIoUring_) {
+    if (length == 0) {
+      return writeChain(callback, IOBuf::create(0));
+    }
+    auto* writer = new FileChunkWriter(this, callback, fd, offset, length);
+    if (fileChunkWriter_ != nullptr || !writesAfterFile_.empty()) {
+      // Another file is still being written: start once it is queued.
+      writesAfterFile_.push_back(
+          HeldWrite{callback, {}, nullptr, WriteFlags::NONE, writer});
+      if (bufferCallback_) {
+        bufferCallback_->onEgressBuffered();
+      }
+      return;
+    }
+    fileChunkWriter_ = writer;
+    return writer->writeNext();
+  }
+
+  totalAppBytesScheduledForWrite_ += length;
+
+  WriteRequest* req;
+  try {
+    req = new FileWriteRequest(
+        this, WriteCallbackWithState(callback), fd, offset, length);
+  } catch (const std::exception& ex) {
+    AsyncSocketException tex(
+        AsyncSocketException::INTERNAL_ERROR,
+        withAddr(string("failed to append new WriteRequest: ") + ex.what()));
+    return failWrite(__func__, callback, 0, tex);
+  }
+
+  bool wasIdle = writeReqTail_ == nullptr;
+  if (wasIdle) {
+    writeReqHead_ = writeReqTail_ = req;
+  } else {
+    writeReqTail_->append(req);
+    writeReqTail_ = req;
+  }
+
+  if (wasIdle && state_ == StateEnum::ESTABLISHED &&
+      (eventFlags_ & EventHandler::WRITE) == 0) {
+    // Nothing ahead of us: send what the socket takes now. handleWrite()
+    // registers for WRITE and schedules the send timeout if some is left.
+    // Like writeImpl(), this writes without driving a TLS handshake.
+    AsyncSocket::handleWrite();
+  }
+
+  if (bufferCallback_ && writeReqHead_ != nullptr) {
+    bufferCallback_->onEgressBuffered();
+  }
+}
+
 void AsyncSocket::writeImpl(
     WriteCallback* callback,
     const iovec* vec,
@@ -2034,7 +2425,11 @@ void AsyncSocket::writeImpl(
     allocatedBytesBuffered_ += ioBuf->computeChainCapacity();
   }
 
-  if (shutdownFlags_ & (SHUT_WRITE | SHUT_WRITE_PENDING)) {
+  // The chunks of an io_uring writeFile() are written while it holds back the
+  // writes issued after it, shutdownWrite() and close() included.
+  bool fileChunk = fileChunkWriter_ != nullptr && callback == fileChunkWriter_;
+
+  if ((shutdownFlags_ & (SHUT_WRITE | SHUT_WRITE_PENDING)) && !fileChunk) {
     // No new writes may be performed after the write side of the socket has
     // been shutdown.
     //
@@ -2046,13 +2441,29 @@ void AsyncSocket::writeImpl(
     return invalidState(callback);
   }
 
+  if ((fileChunkWriter_ != nullptr || !writesAfterFile_.empty()) &&
+      !fileChunk) {
+    // Hold the write back until writeFile() has queued its last chunk, so
+    // that it is not sent in the middle of the file.
+    writesAfterFile_.push_back(HeldWrite{
+        callback,
+        std::vector<iovec>(vec, vec + count),
+        std::move(ioBuf),
+        flags,
+        nullptr});
+    if (bufferCallback_) {
+      bufferCallback_->onEgressBuffered();
+    }
+    return;
+  }
+
   uint32_t countWritten = 0;
   uint32_t partialWritten = 0;
   ssize_t bytesWritten = 0;
   bool mustRegister = false;
   if ((state_ == StateEnum::ESTABLISHED || state_ == StateEnum::FAST_OPEN) &&
       !connecting()) {
-    if (!hasPendingWrites()) {
+    if (!hasPendingWrites() || (fileChunk && iouSendHandle_->empty())) {
       // If we are established and there are no other writes pending,
       // we can attempt to perform the write immediately.
       assert(writeReqTail_ == nullptr);
@@ -2061,8 +2472,12 @@ void AsyncSocket::writeImpl(
 
       callbackWithState.notifyOnWrite();
 
-      if (useIoUring_ && isZeroCopyRequest(flags) &&
+      if (useIoUring_ &&
+          (iouBatchWrites_ || isZeroCopyRequest(flags) || fileChunk) &&
           state_ != StateEnum::FAST_OPEN) {
+        // Leave the send to io_uring, batched with the other SQEs queued in
+        // this loop iteration. A file chunk must not complete here, while
+        // writeFile() is still queuing it.
         mustRegister = true;
       } else {
         // For io_uring + zero-copy + TFO, strip the zero-copy flag on the first
@@ -2199,6 +2614,32 @@ void AsyncSocket::writeImpl(
   }
 }
 
+void AsyncSocket::releaseWritesAfterFile() {
+  fileChunkWriter_ = nullptr;
+  while (fileChunkWriter_ == nullptr && !writesAfterFile_.empty()) {
+    auto held = std::move(writesAfterFile_.front());
+    writesAfterFile_.pop_front();
+    if (held.file != nullptr) {
+      fileChunkWriter_ = held.file;
+      held.file->writeNext();
+    } else if (held.vec.empty()) {
+      if (held.callback) {
+        held.callback->writeSuccess();
+      }
+    } else {
+      // Queued right behind the last chunk of the file.
+      iouSendHandle_->write(
+          WriteCallbackWithState(held.callback),
+          held.vec.data(),
+          held.vec.size(),
+          0,
+          0,
+          std::move(held.buf),
+          held.flags);
+    }
+  }
+}
+
 void AsyncSocket::writeRequest(WriteRequest* req) {
   if (writeReqTail_ == nullptr) {
     assert(writeReqHead_ == nullptr);
@@ -2538,6 +2979,7 @@ void AsyncSocket::attachEventBase(EventBase* eventBase) {
 
   eventBase_ = eventBase;
   if (useIoUring_) {
+    iouBatchWrites_ = checkIoUringBatchWrites(eventBase);
     if (eventFlags_ & EventHandler::READ) {
       CHECK(iouRecvHandle_ != nullptr);
       CHECK(readCallback_ != nullptr);
@@ -3796,7 +4238,8 @@ void AsyncSocket::handleInitialReadWrite() noexcept {
 
 bool AsyncSocket::hasPendingWrites() noexcept {
   if (useIoUring_) {
-    return iouSendHandle_ && !iouSendHandle_->empty();
+    return fileChunkWriter_ != nullptr || !writesAfterFile_.empty() ||
+        (iouSendHandle_ && !iouSendHandle_->empty());
   }
 
   return writeReqHead_ != nullptr;
@@ -4507,6 +4950,21 @@ void AsyncSocket::failAllWrites(const AsyncSocketException& ex) {
     }
     req->destroy();
   }
+  if (fileChunkWriter_ != nullptr) {
+    // writeFile() was between two chunks.
+    fileChunkWriter_->writeErr(0, ex);
+  }
+  while (!writesAfterFile_.empty()) {
+    auto held = std::move(writesAfterFile_.front());
+    writesAfterFile_.pop_front();
+    delete held.file;
+    releaseIOBuf(
+        std::move(held.buf),
+        held.callback ? held.callback->getReleaseIOBufCallback() : nullptr);
+    if (held.callback) {
+      held.callback->writeErr(0, ex);
+    }
+  }
 
   // All pending writes have failed - reset totalAppBytesScheduledForWrite_
   totalAppBytesScheduledForWrite_ = appBytesWritten_;
@@ -4890,11 +5348,12 @@ void AsyncSocket::sendDone(size_t bytesWritten) {
   assert(!writeTimeout_.isScheduled());
 
   // If SHUT_WRITE_PENDING is set, we should shutdown the socket after
-  // we finish sending the last write request.
+  // we finish sending the last write request, and writeFile() has no chunk
+  // left to write.
   //
   // We have to do this before invoking writeSuccess(), since
   // writeSuccess() may detach us from our EventBase.
-  if (shutdownFlags_ & SHUT_WRITE_PENDING) {
+  if ((shutdownFlags_ & SHUT_WRITE_PENDING) && !hasPendingWrites()) {
     assert(connectCallback_ == nullptr);
     shutdownFlags_ |= SHUT_WRITE;
 
@@ -19,9 +19,11 @@
 #include <sys/types.h>
 
 #include <chrono>
+#include <deque>
 #include <map>
 #include <memory>
 #include <variant>
+#include <vector>
 
 #include <folly/ConstructorCallbackList.h>
 #include <folly/Optional.h>
@@ -880,6 +882,27 @@ class AsyncSocket
       std::unique_ptr<folly::IOBuf>&& buf,
       WriteFlags flags = WriteFlags::NONE) override;
 
+  /**
+   * Write `length` bytes of the file `fd`, starting at `offset`, to the
+   * socket. The write is queued behind, and completes like, any other write:
+   * through `callback`, once all the bytes were sent.
+   *
+   * Plain sockets on Linux, and TLS sockets whose kernel encrypts (see
+   * AsyncSSLSocket::enableKernelTLS()), send the range with sendfile(),
+   * straight from the page cache. Other sockets read it and write it a chunk
+   * of kFileWriteChunkSize bytes at a time, reading each chunk once the
+   * previous one was sent. On io_uring sockets, whose writes are queued in
+   * the kernel, the writes issued after this one are held back until its
+   * last chunk is queued.
+   *
+   * `fd` must stay open, and the range must stay readable, until the
+   * callback is invoked. A file that ends before the range does fails the
+   * write.
+   */
+  void writeFile(WriteCallback* callback, int fd, off_t offset, size_t length);
+
+  static constexpr size_t kFileWriteChunkSize = 256 * 1024;
+
   class WriteRequest;
   virtual void writeRequest(WriteRequest* req);
   void writeRequestReady() { handleWrite(); }
@@ -1620,6 +1643,18 @@ class AsyncSocket
   };
 
   class BytesWriteRequest;
+  class FileWriteRequest;
+  class FileChunkWriter;
+
+  // A write held back behind an io_uring writeFile(): either buffers, or
+  // another writeFile() not started yet.
+  struct HeldWrite {
+    WriteCallback* callback;
+    std::vector<iovec> vec;
+    std::unique_ptr<IOBuf> buf;
+    WriteFlags flags;
+    FileChunkWriter* file;
+  };
 
   class WriteTimeout : public AsyncTimeout {
    public:
@@ -1726,6 +1761,13 @@ class AsyncSocket
       std::unique_ptr<folly::IOBuf>&& buf,
       WriteFlags flags);
 
+  /**
+   * Whether writeFile() may hand the file to sendfile(), i.e. whether the
+   * bytes may go to the socket without passing through performWrite().
+   * Checked before each write of a queued writeFile().
+   */
+  virtual bool canSendFile() const;
+
   /**
    * Write as much data as possible to the socket without blocking,
    * and queue up any leftover data to send when the socket can
@@ -1867,6 +1909,19 @@ class AsyncSocket
 
   std::string withAddr(folly::StringPiece s);
 
+  /**
+   * Reads length bytes of a file at offset for writeFile(), or returns the
+   * error to fail the write with.
+   */
+  folly::Expected<std::unique_ptr<IOBuf>, AsyncSocketException> readFileChunk(
+      int fd, off_t offset, size_t length);
+
+  /**
+   * Queues the writes held back behind fileChunkWriter_, once it has queued
+   * its last chunk, up to the next writeFile() among them.
+   */
+  void releaseWritesAfterFile();
+
   void cacheLocalAddress() const;
   void cachePeerAddress() const;
 
@@ -2067,7 +2122,17 @@ class AsyncSocket
 
   bool closeOnFailedWrite_{true};
 
+  // Whether writeFile() already put fd_ in non-blocking mode for sendfile().
+  bool sendFileNonBlocking_{false};
+
+  // The io_uring writeFile() still queuing its chunks, if any, and the writes
+  // issued after it, queued once it has queued its last chunk.
+  FileChunkWriter* fileChunkWriter_{nullptr};
+  std::deque<HeldWrite> writesAfterFile_;
+
   bool useIoUring_{false};
+  // IoUringOptions::batchSocketWrites
+  bool iouBatchWrites_{false};
   bool iouRecvHandleDetached_{false};
   IoUringConnectHandle::UniquePtr iouConnectHandle_;
   IoUringSendHandle::UniquePtr iouSendHandle_;
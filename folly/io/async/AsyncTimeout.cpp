@@ -139,6 +139,10 @@ void AsyncTimeout::libeventCallback(libevent_fd_t fd, short events, void* arg) {
   timeout->timeoutManager_->bumpHandlingTime();
 
   RequestContextScopeGuard rctx(timeout->context_);
+  EventBaseLoopProfiler::Scope scope(
+      timeout->timeoutManager_->getLoopProfiler(),
+      EventBaseLoopProfiler::CallbackType::Timeout,
+      &typeid(*timeout));
 
   timeout->timeoutExpired();
 }
@@ -16,6 +16,9 @@
 
 #pragma once
 
+#include <algorithm>
+#include <vector>
+
 #include <folly/Memory.h>
 #include <folly/io/IOBufQueue.h>
 #include <folly/io/async/AsyncUDPSocket.h>
@@ -34,11 +37,25 @@ namespace folly {
  *       round-robin fashion. So, any protocol that expects to send/recv
  *       more than 1 packet will not work because they will end up with
  *       different event base to process.
+ *
+ * By default datagrams are read and handed to a listener one at a time. With
+ * setBatchedReads() the socket instead reads a batch of datagrams per wakeup
+ * with recvmmsg() and hands each listener its share of the batch at once.
  */
 class AsyncUDPServerSocket
     : private AsyncUDPSocket::ReadCallback,
       public AsyncSocketBase {
  public:
+  /**
+   * A datagram delivered by onDataAvailableBatch()
+   */
+  struct Datagram {
+    folly::SocketAddress client;
+    std::unique_ptr<folly::IOBuf> buf;
+    bool truncated{false};
+    AsyncUDPSocket::ReadCallback::OnDataAvailableParams params;
+  };
+
   class Callback {
    public:
     using OnDataAvailableParams =
@@ -91,6 +108,24 @@ class AsyncUDPServerSocket
         bool truncated,
         OnDataAvailableParams) noexcept = 0;
 
+    /**
+     * Invoked with the datagrams assigned to this listener from a single
+     * batched read, in the order they were read. Only used when batched
+     * reads are enabled. By default each one is passed to onDataAvailable().
+     */
+    virtual void onDataAvailableBatch(
+        std::shared_ptr<AsyncUDPSocket> socket,
+        std::vector<Datagram> datagrams) noexcept {
+      for (auto& datagram : datagrams) {
+        onDataAvailable(
+            socket,
+            datagram.client,
+            std::move(datagram.buf),
+            datagram.truncated,
+            datagram.params);
+      }
+    }
+
     virtual ~Callback() = default;
   };
 
@@ -255,6 +290,34 @@ class AsyncUDPServerSocket
 
   bool setTimestamping(int val) { return socket_->setTimestamping(val); }
 
+  /**
+   * Read up to `maxPackets` datagrams per wakeup with a single recvmmsg()
+   * call, and deliver them through Callback::onDataAvailableBatch() with one
+   * hop to each listener's event base instead of one per datagram. Passing 0
+   * goes back to reading one datagram at a time.
+   *
+   * The datagrams of a batch are read into a single slab of
+   * `maxPackets * packetSize` bytes and handed out as slices of it, so a slab
+   * is only reused once listeners have released every buffer cut from it.
+   * With GRO enabled on the socket, a coalesced read is split into one
+   * Datagram per segment, still without copying; `params.gro` keeps the
+   * segment size.
+   *
+   * Must be called from the server socket's event base thread.
+   */
+  void setBatchedReads(size_t maxPackets) {
+    maxBatchPackets_ = maxPackets;
+    slab_.reset();
+    msgs_.resize(maxPackets);
+    iovecs_.resize(maxPackets);
+    addrs_.resize(maxPackets);
+#ifdef FOLLY_HAVE_MSG_ERRQUEUE
+    control_.resize(
+        maxPackets * AsyncUDPSocket::ReadCallback::OnDataAvailableParams::
+                         kCmsgSpace);
+#endif
+  }
+
  private:
   // AsyncUDPSocket::ReadCallback
   void getReadBuffer(void** buf, size_t* len) noexcept override {
@@ -275,6 +338,26 @@ class AsyncUDPServerSocket
       return;
     }
 
+    uint32_t listenerId = pickListener(clientAddress);
+    auto callback = listeners_[listenerId].second;
+
+    // Schedule it in the listener's eventbase
+    // XXX: Speed this up
+    auto f =
+        [socket = socket_,
+         client = clientAddress,
+         callback,
+         data_2 = std::move(data),
+         truncated,
+         params]() mutable {
+          callback->onDataAvailable(
+              socket, client, std::move(data_2), truncated, params);
+        };
+
+    listeners_[listenerId].first->runInEventBaseThread(std::move(f));
+  }
+
+  uint32_t pickListener(const folly::SocketAddress& clientAddress) {
     uint32_t listenerId = 0;
     uint64_t client_hash_lo = 0;
     switch (dispatchMechanism_) {
@@ -296,23 +379,92 @@ class AsyncUDPServerSocket
         ++nextListener_;
         break;
     }
+    return listenerId;
+  }
 
-    auto callback = listeners_[listenerId].second;
+  bool shouldOnlyNotify() override { return maxBatchPackets_ > 0; }
 
-    // Schedule it in the listener's eventbase
-    // XXX: Speed this up
-    auto f =
-        [socket = socket_,
-         client = clientAddress,
-         callback,
-         data_2 = std::move(data),
-         truncated,
-         params]() mutable {
-          callback->onDataAvailable(
-              socket, client, std::move(data_2), truncated, params);
-        };
+  void onNotifyDataAvailable(AsyncUDPSocket& socket) noexcept override {
+    const size_t slabSize = maxBatchPackets_ * packetSize_;
+    if (!slab_ || slab_->isSharedOne()) {
+      slab_ = folly::IOBuf::create(slabSize);
+      slab_->append(slabSize);
+    }
 
-    listeners_[listenerId].first->runInEventBaseThread(std::move(f));
+    for (size_t i = 0; i < maxBatchPackets_; ++i) {
+      iovecs_[i].iov_base = slab_->writableData() + i * packetSize_;
+      iovecs_[i].iov_len = packetSize_;
+      auto& msg = msgs_[i].msg_hdr;
+      msg = {};
+      msg.msg_iov = &iovecs_[i];
+      msg.msg_iovlen = 1;
+      msg.msg_name = &addrs_[i];
+      msg.msg_namelen = sizeof(addrs_[i]);
+#ifdef FOLLY_HAVE_MSG_ERRQUEUE
+      constexpr size_t kCmsgSpace =
+          AsyncUDPSocket::ReadCallback::OnDataAvailableParams::kCmsgSpace;
+      msg.msg_control = control_.data() + i * kCmsgSpace;
+      msg.msg_controllen = kCmsgSpace;
+#endif
+    }
+
+    int ret = socket.recvmmsg(
+        msgs_.data(), static_cast<unsigned int>(maxBatchPackets_), 0, nullptr);
+    if (ret <= 0) {
+      if (ret < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+        AsyncSocketException ex(
+            AsyncSocketException::INTERNAL_ERROR, "recvmmsg() failed", errno);
+        LOG(ERROR) << ex.what();
+      }
+      return;
+    }
+
+    if (listeners_.empty()) {
+      LOG(WARNING) << "UDP server socket dropping " << ret << " packets, "
+                   << "no listener registered";
+      return;
+    }
+
+    pending_.resize(listeners_.size());
+    for (size_t i = 0; i < size_t(ret); ++i) {
+      auto& msg = msgs_[i].msg_hdr;
+      folly::SocketAddress client;
+      client.setFromSockaddr(
+          reinterpret_cast<sockaddr*>(&addrs_[i]), msg.msg_namelen);
+      OnDataAvailableParams params;
+      AsyncUDPSocket::fromMsg(params, msg);
+      const bool truncated = (msg.msg_flags & MSG_TRUNC) != 0;
+      const size_t len = std::min<size_t>(msgs_[i].msg_len, packetSize_);
+      const size_t segment = params.gro > 0 ? size_t(params.gro) : len;
+
+      auto& batch = pending_[pickListener(client)];
+      if (batch.empty()) {
+        // Room for the rest of the batch, assuming its reads are coalesced
+        // like this one.
+        batch.reserve((size_t(ret) - i) * ((len + segment - 1) / segment));
+      }
+      for (size_t offset = 0; offset < len; offset += segment) {
+        auto buf = slab_->cloneOne();
+        buf->trimStart(i * packetSize_ + offset);
+        buf->trimEnd(buf->length() - std::min(segment, len - offset));
+        bool last = offset + segment >= len;
+        batch.push_back({client, std::move(buf), truncated && last, params});
+      }
+    }
+
+    for (size_t i = 0; i < pending_.size(); ++i) {
+      if (pending_[i].empty()) {
+        continue;
+      }
+      auto callback = listeners_[i].second;
+      listeners_[i].first->runInEventBaseThread(
+          [socket = socket_,
+           callback,
+           datagrams = std::move(pending_[i])]() mutable {
+            callback->onDataAvailableBatch(socket, std::move(datagrams));
+          });
+      pending_[i].clear();
+    }
   }
 
   void onReadError(const AsyncSocketException& ex) noexcept override {
@@ -352,6 +504,18 @@ class AsyncUDPServerSocket
   bool reusePort_{false};
   bool reuseAddr_{false};
   bool recvTos_{false};
+
+  // Batched reads, see setBatchedReads(). The datagrams of a batch are read
+  // into slab_ and grouped by listener in pending_ before being dispatched.
+  size_t maxBatchPackets_{0};
+  std::unique_ptr<folly::IOBuf> slab_;
+  std::vector<struct mmsghdr> msgs_;
+  std::vector<struct iovec> iovecs_;
+  std::vector<struct sockaddr_storage> addrs_;
+#ifdef FOLLY_HAVE_MSG_ERRQUEUE
+  std::vector<char> control_;
+#endif
+  std::vector<std::vector<Datagram>> pending_;
 };
 
 } // namespace folly
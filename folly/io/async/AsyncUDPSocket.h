@@ -702,7 +702,7 @@ class AsyncUDPSocket : public EventHandler {
   // negative return value means GRO is not available
   int getGRO();
 
-  bool setGRO(bool bVal);
+  virtual bool setGRO(bool bVal);
 
   // TX time
   TXTime getTXTime();
@@ -207,7 +207,13 @@ class EventBase::FuncRunner {
         &eventBase_.getExecutionObserverList(),
         &func,
         folly::ExecutionObserver::CallbackType::NotificationQueue);
-    std::exchange(func, {})();
+    {
+      EventBaseLoopProfiler::Scope scope(
+          eventBase_.getLoopProfiler(),
+          EventBaseLoopProfiler::CallbackType::NotificationQueue,
+          nullptr);
+      std::exchange(func, {})();
+    }
 
     return deadline_.expired()
         ? AtomicNotificationQueueTaskStatus::CONSUMED_STOP
@@ -281,6 +287,7 @@ EventBase::EventBase(event_base* evb, bool enableTimeMeasurement)
 
 EventBase::EventBase(Options options)
     : intervalDuration_(options.timerTickInterval),
+      timerEngine_(options.timerEngine),
       enableTimeMeasurement_(!options.skipTimeMeasurement),
       loopCallbacksTimeslice_(options.loopCallbacksTimeslice),
       runOnceCallbacks_(nullptr),
@@ -294,6 +301,8 @@ EventBase::EventBase(Options options)
       ,
       latestLoopCnt_(nextLoopCnt_),
       startWork_(),
+      busyPoll_(options.busyPoll),
+      busyPollSpin_(options.busyPoll.maxSpin),
       observer_(nullptr),
       observerSampleCount_(0),
       evb_(
@@ -430,6 +439,27 @@ void EventBase::setMaxReadAtOnce(uint32_t maxAtOnce) {
   queue_->setMaxReadAtOnce(maxAtOnce);
 }
 
+void EventBase::setBusyPoll(BusyPollOptions options) {
+  dcheckIsInEventBaseThread();
+  busyPoll_ = options;
+  busyPollSpin_ = options.maxSpin;
+}
+
+void EventBase::enableLoopProfiler(EventBaseLoopProfiler::Options options) {
+  dcheckIsInEventBaseThread();
+  if (loopProfiler_) {
+    loopProfiler_->reset(options);
+  } else {
+    loopProfiler_ = std::make_unique<EventBaseLoopProfiler>(options);
+  }
+  loopProfilerEnabled_ = true;
+}
+
+void EventBase::disableLoopProfiler() {
+  dcheckIsInEventBaseThread();
+  loopProfilerEnabled_ = false;
+}
+
 bool EventBase::isInEventBaseThread() const {
   auto tid = loopTid_.load(std::memory_order_relaxed);
   return tid == static_cast<pid_t>(getOSThreadID()) ||
@@ -630,7 +660,9 @@ EventBase::LoopStatus EventBase::loopMain(int flags, LoopOptions options) {
     // nobody can add loop callbacks from within this thread if
     // we don't have to handle anything to start with...
     if (blocking && loopCallbacks_.empty()) {
-      res = evb_->eb_event_base_loop(EVLOOP_ONCE);
+      res = busyPoll_.maxSpin.count() > 0
+          ? busyPollLoop()
+          : evb_->eb_event_base_loop(EVLOOP_ONCE);
     } else {
       res = evb_->eb_event_base_loop(EVLOOP_ONCE | EVLOOP_NONBLOCK);
     }
@@ -743,6 +775,51 @@ EventBase::LoopStatus EventBase::loopMain(int flags, LoopOptions options) {
   return LoopStatus::kDone;
 }
 
+int EventBase::busyPollLoop() {
+  auto start = std::chrono::steady_clock::now();
+  auto deadline = start + busyPollSpin_;
+  ++busyPollStats_.numSpins;
+  while (true) {
+    bool foundWork = false;
+    if (!queue_->empty()) {
+      // Run the tasks now rather than when the queue's fd becomes readable.
+      queue_->execute();
+      foundWork = true;
+    } else {
+      handledEvent_ = false;
+      int res = evb_->eb_event_base_loop(EVLOOP_ONCE | EVLOOP_NONBLOCK);
+      if (res != 0) {
+        busyPollStats_.spinTime += std::chrono::steady_clock::now() - start;
+        return res;
+      }
+      foundWork = handledEvent_ || !loopCallbacks_.empty();
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (foundWork) {
+      ++busyPollStats_.numSpinsWithWork;
+      busyPollStats_.spinTime += now - start;
+      busyPollSpin_ = busyPoll_.maxSpin;
+      return 0;
+    }
+    if (stop_.load(std::memory_order_relaxed)) {
+      busyPollStats_.spinTime += now - start;
+      return 0;
+    }
+    if (now >= deadline) {
+      busyPollStats_.spinTime += now - start;
+      busyPollStats_.idleSpinTime += now - start;
+      break;
+    }
+  }
+
+  if (busyPoll_.adaptive) {
+    busyPollSpin_ = std::max<std::chrono::nanoseconds>(
+        busyPollSpin_ / 2, busyPoll_.maxSpin / 16);
+  }
+  return evb_->eb_event_base_loop(EVLOOP_ONCE);
+}
+
 void EventBase::loopMainCleanup() {
   threadIdCollector_->awaitOutstandingKeepAlives();
   loopThread_.store({}, std::memory_order_release);
@@ -843,6 +920,7 @@ void EventBase::loopForever() {
 }
 
 void EventBase::bumpHandlingTime() {
+  handledEvent_ = true;
   if (!enableTimeMeasurement_) {
     return;
   }
@@ -1065,6 +1143,10 @@ bool EventBase::swapAndRunLoopCallbackList(
         &executionObserverList_,
         callback,
         folly::ExecutionObserver::CallbackType::Loop);
+    EventBaseLoopProfiler::Scope scope(
+        getLoopProfiler(),
+        EventBaseLoopProfiler::CallbackType::Loop,
+        &typeid(*callback));
     callback->runLoopCallback();
   } while (!currentCallbacks.empty() && !deadline.expired());
 
@@ -49,6 +49,7 @@
 #include <folly/executors/ScheduledExecutor.h>
 #include <folly/executors/SequencedExecutor.h>
 #include <folly/io/async/AsyncTimeout.h>
+#include <folly/io/async/EventBaseLoopProfiler.h>
 #include <folly/io/async/HHWheelTimer.h>
 #include <folly/io/async/Request.h>
 #include <folly/io/async/TimeoutManager.h>
@@ -272,6 +273,59 @@ class EventBase
     Function<void()> f_;
   };
 
+  /**
+   * Busy polling trades CPU for latency: instead of blocking in the backend
+   * as soon as it runs out of work, the loop keeps polling the backend and
+   * the notification queue without blocking for up to `maxSpin`, so that an
+   * event arriving in that window is handled without a sleep and wakeup.
+   */
+  struct BusyPollOptions {
+    /**
+     * Longest time to poll for before blocking. Zero disables busy polling.
+     */
+    std::chrono::microseconds maxSpin{0};
+
+    /**
+     * If true, the spin time is halved (down to maxSpin / 16) every time the
+     * loop spins without finding work and reset to maxSpin when it finds some,
+     * so that a mostly idle loop burns little CPU.
+     */
+    bool adaptive{true};
+
+    /**
+     * If non-zero, SO_BUSY_POLL is set to this on the sockets of handlers
+     * attached to the EventBase, so that the kernel polls the NIC queue of
+     * the socket (NAPI busy polling) when there is nothing to read.
+     */
+    std::chrono::microseconds socketBusyPoll{0};
+
+    BusyPollOptions& setMaxSpin(std::chrono::microseconds spin) {
+      maxSpin = spin;
+      return *this;
+    }
+
+    BusyPollOptions& setAdaptive(bool enable) {
+      adaptive = enable;
+      return *this;
+    }
+
+    BusyPollOptions& setSocketBusyPoll(std::chrono::microseconds busyPoll) {
+      socketBusyPoll = busyPoll;
+      return *this;
+    }
+  };
+
+  struct BusyPollStats {
+    // Times the loop ran out of work and spun instead of blocking.
+    uint64_t numSpins{0};
+    // Spins that found work before running out of spin time.
+    uint64_t numSpinsWithWork{0};
+    // Total time spent spinning.
+    std::chrono::nanoseconds spinTime{0};
+    // Time spent in spins that found no work, after which the loop blocked.
+    std::chrono::nanoseconds idleSpinTime{0};
+  };
+
   struct Options {
     Options() {}
 
@@ -312,6 +366,16 @@ class EventBase
       return *this;
     }
 
+    /**
+     * Engine of the wheel timer in the EventBase.
+     */
+    HHWheelTimer::Engine timerEngine{HHWheelTimer::Engine::CASCADING};
+
+    Options& setTimerEngine(HHWheelTimer::Engine engine) {
+      timerEngine = engine;
+      return *this;
+    }
+
     /**
      * If non-zero, processing of loop callback and notification queue callbacks
      * will only be allowed to run for this timeslice within each iteration
@@ -326,6 +390,16 @@ class EventBase
       loopCallbacksTimeslice = timeslice;
       return *this;
     }
+
+    /**
+     * Busy polling, disabled by default. See BusyPollOptions.
+     */
+    BusyPollOptions busyPoll;
+
+    Options& setBusyPoll(BusyPollOptions options) {
+      busyPoll = options;
+      return *this;
+    }
   };
 
   /**
@@ -764,6 +838,27 @@ class EventBase
   uint32_t getMaxReadAtOnce() const;
   void setMaxReadAtOnce(uint32_t maxAtOnce);
 
+  /**
+   * Change the busy polling options. May only be called from the EventBase
+   * thread, and only affects handlers attached afterwards as far as
+   * socketBusyPoll is concerned.
+   */
+  void setBusyPoll(BusyPollOptions options);
+  const BusyPollOptions& getBusyPollOptions() const { return busyPoll_; }
+
+  /**
+   * Spin statistics since the EventBase was created. Together with the busy
+   * time reported by the observer (which counts spinning as idle time), they
+   * tell how much of the CPU spent spinning paid off.
+   */
+  const BusyPollStats& getBusyPollStats() const { return busyPollStats_; }
+
+  /**
+   * How long the loop will spin the next time it runs out of work: maxSpin,
+   * or less once adaptive busy polling has shrunk it.
+   */
+  std::chrono::nanoseconds getBusyPollSpin() const { return busyPollSpin_; }
+
   /**
    * Verify that current thread is the EventBase thread.
    *
@@ -810,7 +905,12 @@ class EventBase
 
   HHWheelTimer& timer() {
     if (!wheelTimer_) {
-      wheelTimer_ = HHWheelTimer::newTimer(this, intervalDuration_);
+      wheelTimer_ = HHWheelTimer::newTimer(
+          this,
+          intervalDuration_,
+          AsyncTimeout::InternalEnum::NORMAL,
+          std::chrono::milliseconds(-1),
+          timerEngine_);
     }
     return *wheelTimer_.get();
   }
@@ -896,6 +996,20 @@ class EventBase
     return executionObserverList_;
   }
 
+  /**
+   * Start attributing the time spent in callbacks to their kind and site,
+   * discarding what an earlier profiler recorded. See EventBaseLoopProfiler.
+   */
+  void enableLoopProfiler(EventBaseLoopProfiler::Options options = {});
+  void disableLoopProfiler();
+
+  /**
+   * The enabled loop profiler, or nullptr.
+   */
+  EventBaseLoopProfiler* getLoopProfiler() const final {
+    return loopProfilerEnabled_ ? loopProfiler_.get() : nullptr;
+  }
+
   /**
    * Set the name of the thread that runs this event base.
    */
@@ -1024,6 +1138,10 @@ class EventBase
 
   bool loopBody(int flags, LoopOptions options);
 
+  // Polls without blocking until there is work or the spin time runs out, in
+  // which case it blocks. Returns the result of the last backend loop.
+  int busyPollLoop();
+
   void loopMainSetup();
   LoopStatus loopMain(int flags, LoopOptions options);
   void loopMainCleanup();
@@ -1041,6 +1159,8 @@ class EventBase
   // Tick granularity to wheelTimer_
   const std::chrono::milliseconds intervalDuration_{
       HHWheelTimer::DEFAULT_TICK_INTERVAL};
+  // Engine of wheelTimer_
+  const HHWheelTimer::Engine timerEngine_{HHWheelTimer::Engine::CASCADING};
   const bool enableTimeMeasurement_;
   const std::chrono::milliseconds loopCallbacksTimeslice_;
   bool strictLoopThread_ = false;
@@ -1108,6 +1228,14 @@ class EventBase
   std::size_t latestLoopCnt_;
   std::chrono::steady_clock::time_point startWork_;
 
+  BusyPollOptions busyPoll_;
+  // Current spin time, between maxSpin / 16 and maxSpin if adaptive.
+  std::chrono::nanoseconds busyPollSpin_{0};
+  BusyPollStats busyPollStats_;
+  // Set whenever an event, timeout or callback is handled, so that a busy
+  // poll can tell whether a non-blocking poll found work.
+  bool handledEvent_{false};
+
   // Observer to export counters
   std::shared_ptr<EventBaseObserver> observer_;
   uint32_t observerSampleCount_;
@@ -1115,6 +1243,11 @@ class EventBase
   // EventHandler's execution observer list (in case multiple are registered)
   ExecutionObserver::List executionObserverList_;
 
+  // Kept until the EventBase is destroyed, so that a callback can disable or
+  // re-enable the profiler that is timing it.
+  std::unique_ptr<EventBaseLoopProfiler> loopProfiler_;
+  bool loopProfilerEnabled_{false};
+
   // Name of the thread running this EventBase
   std::string name_;
 
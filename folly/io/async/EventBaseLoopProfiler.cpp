@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/io/async/EventBaseLoopProfiler.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include <folly/Demangle.h>
+#include <folly/lang/Bits.h>
+#include <folly/tracing/StaticTracepoint.h>
+
+FOLLY_SDT_DEFINE_SEMAPHORE(folly, event_base_loop_profiler_sample)
+
+namespace folly {
+
+namespace {
+
+EventBaseLoopProfiler::Options sanitize(EventBaseLoopProfiler::Options o) {
+  o.sampleRate = std::max<uint32_t>(o.sampleRate, 1);
+  return o;
+}
+
+bool slower(
+    const EventBaseLoopProfiler::Sample& a,
+    const EventBaseLoopProfiler::Sample& b) {
+  return a.duration > b.duration;
+}
+
+} // namespace
+
+const char* EventBaseLoopProfiler::toString(CallbackType type) {
+  switch (type) {
+    case CallbackType::Event:
+      return "Event";
+    case CallbackType::Timeout:
+      return "Timeout";
+    case CallbackType::WheelTimer:
+      return "WheelTimer";
+    case CallbackType::Loop:
+      return "Loop";
+    case CallbackType::NotificationQueue:
+      return "NotificationQueue";
+  }
+  return "Unknown";
+}
+
+std::string EventBaseLoopProfiler::Sample::siteName() const {
+  if (site == nullptr) {
+    return "<task>";
+  }
+  return demangle(*site).toStdString();
+}
+
+std::chrono::nanoseconds
+EventBaseLoopProfiler::CallbackTypeStats::estimateQuantile(double q) const {
+  if (count == 0) {
+    return std::chrono::nanoseconds(0);
+  }
+  auto rank = static_cast<uint64_t>(std::ceil(q * double(count)));
+  rank = std::clamp<uint64_t>(rank, 1, count);
+  uint64_t seen = 0;
+  for (size_t i = 0; i < buckets.size(); ++i) {
+    seen += buckets[i];
+    if (seen >= rank) {
+      // The bucket's upper bound, but no more than the slowest sample.
+      auto upper = i + 1 < 63 ? int64_t(1) << (i + 1) : max.count();
+      return std::min(std::chrono::nanoseconds(upper), max);
+    }
+  }
+  return max;
+}
+
+EventBaseLoopProfiler::EventBaseLoopProfiler(Options options)
+    : options_(sanitize(options)), countdown_(1) {
+  slowest_.reserve(options_.topN);
+}
+
+EventBaseLoopProfiler::Snapshot EventBaseLoopProfiler::getSnapshot() const {
+  Snapshot snapshot;
+  snapshot.stats = stats_;
+  snapshot.slowest = slowest_;
+  std::sort(snapshot.slowest.begin(), snapshot.slowest.end(), slower);
+  return snapshot;
+}
+
+void EventBaseLoopProfiler::reset() {
+  stats_ = {};
+  slowest_.clear();
+  countdown_ = 1;
+}
+
+void EventBaseLoopProfiler::reset(Options options) {
+  options_ = sanitize(options);
+  reset();
+  slowest_.reserve(options_.topN);
+}
+
+void EventBaseLoopProfiler::record(
+    CallbackType type,
+    const std::type_info* site,
+    std::chrono::steady_clock::time_point start) noexcept {
+  auto duration = std::chrono::steady_clock::now() - start;
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(duration);
+
+  auto& stats = stats_[static_cast<size_t>(type)];
+  ++stats.count;
+  stats.total += ns;
+  stats.max = std::max(stats.max, ns);
+  auto bucket = ns.count() > 0 ? findLastSet(uint64_t(ns.count())) - 1 : 0;
+  ++stats.buckets[bucket];
+
+  if (options_.topN > 0 &&
+      (slowest_.size() < options_.topN || slowest_.front().duration < ns)) {
+    if (slowest_.size() == options_.topN) {
+      std::pop_heap(slowest_.begin(), slowest_.end(), slower);
+      slowest_.pop_back();
+    }
+    slowest_.push_back(Sample{type, site, start, ns});
+    std::push_heap(slowest_.begin(), slowest_.end(), slower);
+  }
+
+  FOLLY_SDT_WITH_SEMAPHORE(
+      folly,
+      event_base_loop_profiler_sample,
+      static_cast<int>(type),
+      site != nullptr ? site->name() : "",
+      static_cast<int64_t>(ns.count()));
+}
+
+} // namespace folly
@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+#include <folly/CPortability.h>
+#include <folly/Likely.h>
+
+namespace folly {
+
+/**
+ * Attributes the time an EventBase spends running callbacks to the kind of
+ * callback and to its site, i.e. the dynamic type of the handler, timeout or
+ * loop callback object, so that when a loop stalls one can tell what ate the
+ * time.
+ *
+ * Enable it with EventBase::enableLoopProfiler(). It times one in every
+ * `sampleRate` callbacks, keeps a log2 histogram of the sampled durations per
+ * kind of callback and the `topN` slowest samples, and fires the
+ * folly:event_base_loop_profiler_sample USDT tracepoint for every sample
+ * while a tracer is attached to it. Durations are inclusive: a wheel timer
+ * callback is also part of the duration of the wheel's timeout.
+ *
+ * Not thread-safe: use it from the EventBase thread only.
+ */
+class EventBaseLoopProfiler {
+ public:
+  enum class CallbackType : uint8_t {
+    // EventHandler::handlerReady(), e.g. a socket becoming readable.
+    Event,
+    // AsyncTimeout::timeoutExpired(), including HHWheelTimer's own timeout.
+    Timeout,
+    // HHWheelTimer::Callback::timeoutExpired().
+    WheelTimer,
+    // runInLoop() callbacks.
+    Loop,
+    // runInEventBaseThread() tasks.
+    NotificationQueue,
+  };
+  static constexpr size_t kNumCallbackTypes = 5;
+
+  static const char* toString(CallbackType type);
+
+  struct Options {
+    Options() {}
+
+    /**
+     * Time one in every sampleRate callbacks.
+     */
+    uint32_t sampleRate{1};
+
+    Options& setSampleRate(uint32_t rate) {
+      sampleRate = rate;
+      return *this;
+    }
+
+    /**
+     * Number of slowest samples to keep.
+     */
+    size_t topN{16};
+
+    Options& setTopN(size_t n) {
+      topN = n;
+      return *this;
+    }
+  };
+
+  struct Sample {
+    CallbackType type;
+    // Dynamic type of the callback object, or nullptr for
+    // runInEventBaseThread() tasks.
+    const std::type_info* site;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::nanoseconds duration;
+
+    // The demangled name of the site.
+    std::string siteName() const;
+  };
+
+  struct CallbackTypeStats {
+    uint64_t count{0};
+    std::chrono::nanoseconds total{0};
+    std::chrono::nanoseconds max{0};
+    // buckets[i] counts the durations in [2^i, 2^(i+1)) ns, and buckets[0]
+    // also counts zero durations.
+    std::array<uint64_t, 64> buckets{};
+
+    // The upper bound of the bucket that holds quantile `q` in [0, 1].
+    std::chrono::nanoseconds estimateQuantile(double q) const;
+  };
+
+  struct Snapshot {
+    std::array<CallbackTypeStats, kNumCallbackTypes> stats;
+    // Slowest first.
+    std::vector<Sample> slowest;
+
+    const CallbackTypeStats& operator[](CallbackType type) const {
+      return stats[static_cast<size_t>(type)];
+    }
+  };
+
+  /**
+   * Times a callback if it is picked for sampling. `profiler` may be null.
+   */
+  class Scope {
+   public:
+    Scope(
+        EventBaseLoopProfiler* profiler,
+        CallbackType type,
+        const std::type_info* site) noexcept
+        : profiler_(
+              FOLLY_UNLIKELY(profiler != nullptr) && profiler->shouldSample()
+                  ? profiler
+                  : nullptr),
+          type_(type),
+          site_(site) {
+      if (FOLLY_UNLIKELY(profiler_ != nullptr)) {
+        start_ = std::chrono::steady_clock::now();
+      }
+    }
+
+    ~Scope() {
+      if (FOLLY_UNLIKELY(profiler_ != nullptr)) {
+        profiler_->record(type_, site_, start_);
+      }
+    }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+   private:
+    EventBaseLoopProfiler* profiler_;
+    CallbackType type_;
+    const std::type_info* site_;
+    std::chrono::steady_clock::time_point start_;
+  };
+
+  explicit EventBaseLoopProfiler(Options options = Options());
+
+  Snapshot getSnapshot() const;
+
+  /**
+   * Drop everything recorded so far, and optionally switch to new options.
+   */
+  void reset();
+  void reset(Options options);
+
+ private:
+  bool shouldSample() noexcept {
+    if (--countdown_ > 0) {
+      return false;
+    }
+    countdown_ = options_.sampleRate;
+    return true;
+  }
+
+  void record(
+      CallbackType type,
+      const std::type_info* site,
+      std::chrono::steady_clock::time_point start) noexcept;
+
+  Options options_;
+  uint32_t countdown_;
+  std::array<CallbackTypeStats, kNumCallbackTypes> stats_;
+  // A min-heap on duration, so that the fastest of the slowest samples is
+  // the one to replace.
+  std::vector<Sample> slowest_;
+};
+
+} // namespace folly
@@ -20,6 +20,7 @@
 
 #include <folly/String.h>
 #include <folly/io/async/EventBase.h>
+#include <folly/net/NetOps.h>
 
 namespace folly {
 
@@ -125,6 +126,9 @@ void EventHandler::changeHandlerFD(NetworkSocket fd) {
   event_.eb_event_set(fd.data, 0, &EventHandler::libeventCallback, this);
   event_.eb_ev_base(
       evb); // don't use event_base_set(), since evb may be nullptr
+  if (evb != nullptr) {
+    setSocketBusyPoll();
+  }
 }
 
 void EventHandler::initHandler(EventBase* eventBase, NetworkSocket fd) {
@@ -156,6 +160,10 @@ void EventHandler::libeventCallback(libevent_fd_t fd, short events, void* arg) {
       &handler->eventBase_->getExecutionObserverList(),
       &handler->eventBase_,
       folly::ExecutionObserver::CallbackType::Event);
+  EventBaseLoopProfiler::Scope scope(
+      handler->eventBase_->getLoopProfiler(),
+      EventBaseLoopProfiler::CallbackType::Event,
+      &typeid(*handler));
 
   handler->handlerReady(uint16_t(events));
 }
@@ -163,6 +171,32 @@ void EventHandler::libeventCallback(libevent_fd_t fd, short events, void* arg) {
 void EventHandler::setEventBase(EventBase* eventBase) {
   event_.eb_event_base_set(eventBase);
   eventBase_ = eventBase;
+  setSocketBusyPoll();
+}
+
+void EventHandler::setSocketBusyPoll() {
+#ifdef SO_BUSY_POLL
+  if (eventBase_ == nullptr || event_.eb_ev_fd() < 0) {
+    return;
+  }
+  auto busyPoll = eventBase_->getBusyPollOptions().socketBusyPoll;
+  if (busyPoll.count() <= 0) {
+    return;
+  }
+  // This fails with ENOTSOCK for handlers of other kinds of fds, and with
+  // EPERM without CAP_NET_ADMIN if above the net.core.busy_read sysctl, in
+  // which case the socket just goes without.
+  int usecs = static_cast<int>(busyPoll.count());
+  if (netops::setsockopt(
+          NetworkSocket::fromFd(event_.eb_ev_fd()),
+          SOL_SOCKET,
+          SO_BUSY_POLL,
+          &usecs,
+          sizeof(usecs)) != 0) {
+    VLOG(4) << "EventHandler: failed to set SO_BUSY_POLL on fd "
+            << event_.eb_ev_fd() << ": " << errnoStr(errno);
+  }
+#endif
 }
 
 bool EventHandler::isPending() const {
@@ -195,6 +195,7 @@ class EventHandler {
   void ensureNotRegistered(const char* fn);
 
   void setEventBase(EventBase* eventBase);
+  void setSocketBusyPoll();
 
   static void libeventCallback(libevent_fd_t fd, short events, void* arg);
 
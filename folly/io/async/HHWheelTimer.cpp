@@ -17,9 +17,11 @@
 #include <folly/io/async/HHWheelTimer.h>
 
 #include <cassert>
+#include <limits>
 
 #include <folly/ScopeGuard.h>
 #include <folly/container/BitIterator.h>
+#include <folly/io/async/EventBaseLoopProfiler.h>
 #include <folly/io/async/Request.h>
 #include <folly/lang/Bits.h>
 
@@ -74,9 +76,8 @@ void HHWheelTimerBase<Duration>::Callback::cancelTimeoutImpl() {
     wheel_->AsyncTimeout::cancelTimeout();
   }
   unlink();
-  if ((-1 != bucket_) && (wheel_->buckets_[0][bucket_].empty())) {
-    auto bi = makeBitIterator(wheel_->bitmap_.begin());
-    *(bi + bucket_) = false;
+  if ((-1 != bucket_) && (wheel_->bucketAt(bucket_).empty())) {
+    wheel_->clearBit(bucket_);
   }
 
   wheel_ = nullptr;
@@ -88,10 +89,12 @@ HHWheelTimerBase<Duration>::HHWheelTimerBase(
     folly::TimeoutManager* timeoutMananger,
     Duration intervalDuration,
     AsyncTimeout::InternalEnum internal,
-    Duration defaultTimeoutDuration)
+    Duration defaultTimeoutDuration,
+    Engine engine)
     : AsyncTimeout(timeoutMananger, internal),
       interval_(intervalDuration),
       defaultTimeout_(defaultTimeoutDuration),
+      engine_(engine),
       expireTick_(1),
       count_(0),
       startTime_(getCurTime()),
@@ -148,6 +151,47 @@ void HHWheelTimerBase<Duration>::scheduleTimeoutImpl(
 template <class Duration>
 void HHWheelTimerBase<Duration>::scheduleTimeout(
     Callback* callback, Duration timeout) {
+  auto now = getCurTime();
+  auto nextTick = calcNextTick(now);
+  updateTimeoutAfterInsert(
+      nextTick, insertTimeout(callback, timeout, now, nextTick));
+}
+
+template <class Duration>
+void HHWheelTimerBase<Duration>::scheduleTimeouts(
+    Range<Callback* const*> callbacks, Duration timeout) {
+  if (callbacks.empty()) {
+    return;
+  }
+  auto now = getCurTime();
+  auto nextTick = calcNextTick(now);
+  int64_t wakeTick = std::numeric_limits<int64_t>::max();
+  for (auto* callback : callbacks) {
+    wakeTick =
+        std::min(wakeTick, insertTimeout(callback, timeout, now, nextTick));
+  }
+  updateTimeoutAfterInsert(nextTick, wakeTick);
+}
+
+template <class Duration>
+size_t HHWheelTimerBase<Duration>::cancelTimeouts(
+    Range<Callback* const*> callbacks) {
+  size_t count = 0;
+  for (auto* callback : callbacks) {
+    if (callback->isScheduled()) {
+      callback->cancelTimeoutImpl();
+      ++count;
+    }
+  }
+  return count;
+}
+
+template <class Duration>
+int64_t HHWheelTimerBase<Duration>::insertTimeout(
+    Callback* callback,
+    Duration timeout,
+    std::chrono::steady_clock::time_point now,
+    int64_t nextTick) {
   // Make sure that the timeout is not negative.
   timeout = std::max(timeout, Duration::zero());
   // Cancel the callback if it happens to be scheduled already.
@@ -156,10 +200,24 @@ void HHWheelTimerBase<Duration>::scheduleTimeout(
 
   count_++;
 
-  auto now = getCurTime();
-  auto nextTick = calcNextTick(now);
   callback->setScheduled(this, now + timeout);
 
+  int64_t ticks = timeToWheelTicks(timeout);
+  int64_t due = ticks + nextTick;
+
+  if (engine_ == Engine::LAZY) {
+    // Catch up with the ticks that passed since the wheel last woke up, which
+    // are known to have nothing to process: either the wheel is empty, or its
+    // timeout is set for the first tick that does.
+    if (!processingCallbacksGuard_) {
+      lazyNextTick_ = std::max(
+          lazyNextTick_,
+          isScheduled() ? std::min(nextTick, expireTick_) : nextTick);
+    }
+    callback->dueTick_ = due;
+    return lazyInsert(callback);
+  }
+
   // There are three possible scenarios:
   //   - we are currently inside of HHWheelTimerBase<Duration>::timeoutExpired.
   //   In this case,
@@ -172,24 +230,37 @@ void HHWheelTimerBase<Duration>::scheduleTimeout(
   if (processingCallbacksGuard_ || isScheduled()) {
     baseTick = std::min(expireTick_, nextTick);
   }
-  int64_t ticks = timeToWheelTicks(timeout);
-  int64_t due = ticks + nextTick;
   scheduleTimeoutImpl(callback, due, baseTick, nextTick);
+  return due;
+}
 
+template <class Duration>
+void HHWheelTimerBase<Duration>::updateTimeoutAfterInsert(
+    int64_t nextTick, int64_t wakeTick) {
   /* If we're calling callbacks, timer will be reset after all
    * callbacks are called.
    */
-  if (!processingCallbacksGuard_) {
-    // Check if we need to reschedule the timer.
-    // If the wheel timeout is already scheduled, then we need to reschedule
-    // only if our due is earlier than the current scheduled one.
-    // If it's not scheduled, we need to schedule it either for the first tick
-    // of next wheel epoch or our due tick, whichever is earlier.
-    if (!isScheduled() && !inSameEpoch(nextTick - 1, due)) {
-      scheduleNextTimeout(nextTick, WHEEL_SIZE - ((nextTick - 1) & WHEEL_MASK));
-    } else if (!isScheduled() || due < expireTick_) {
-      scheduleNextTimeout(nextTick, ticks + 1);
+  if (processingCallbacksGuard_) {
+    return;
+  }
+
+  if (engine_ == Engine::LAZY) {
+    if (!isScheduled() || wakeTick < expireTick_) {
+      scheduleNextTimeout(
+          nextTick, std::max<int64_t>(wakeTick - nextTick + 1, 1));
     }
+    return;
+  }
+
+  // Check if we need to reschedule the timer.
+  // If the wheel timeout is already scheduled, then we need to reschedule
+  // only if our due is earlier than the current scheduled one.
+  // If it's not scheduled, we need to schedule it either for the first tick
+  // of next wheel epoch or our due tick, whichever is earlier.
+  if (!isScheduled() && !inSameEpoch(nextTick - 1, wakeTick)) {
+    scheduleNextTimeout(nextTick, WHEEL_SIZE - ((nextTick - 1) & WHEEL_MASK));
+  } else if (!isScheduled() || wakeTick < expireTick_) {
+    scheduleNextTimeout(nextTick, wakeTick - nextTick + 1);
   }
 }
 
@@ -253,7 +324,10 @@ void HHWheelTimerBase<Duration>::timeoutExpired() noexcept {
   // timeoutExpired() can only be invoked directly from the event base loop.
   // It should never be invoked recursively.
   //
-  while (expireTick_ < nextTick) {
+  if (engine_ == Engine::LAZY) {
+    lazyExpire(nextTick);
+  }
+  while (engine_ == Engine::CASCADING && expireTick_ < nextTick) {
     int idx = expireTick_ & WHEEL_MASK;
 
     if (idx == 0) {
@@ -285,7 +359,14 @@ void HHWheelTimerBase<Duration>::timeoutExpired() noexcept {
     cb->wheel_ = nullptr;
     cb->expiration_ = {};
     RequestContextScopeGuard rctx(cb->requestContext_);
-    cb->timeoutExpired();
+    {
+      // Callbacks may enable or disable the profiler.
+      EventBaseLoopProfiler::Scope scope(
+          getTimeoutManager()->getLoopProfiler(),
+          EventBaseLoopProfiler::CallbackType::WheelTimer,
+          &typeid(*cb));
+      cb->timeoutExpired();
+    }
     if (isDestroyed) {
       // The HHWheelTimerBase itself has been destroyed. The other callbacks
       // will have been cancelled from the destructor. Bail before causing
@@ -296,7 +377,12 @@ void HHWheelTimerBase<Duration>::timeoutExpired() noexcept {
 
   // We don't need to schedule a new timeout if there're nothing in the wheel.
   if (count_ > 0) {
-    scheduleNextTimeout(expireTick_);
+    if (engine_ == Engine::LAZY) {
+      scheduleNextTimeout(
+          nextTick, std::max<int64_t>(lazyFindNextTick() - nextTick + 1, 1));
+    } else {
+      scheduleNextTimeout(expireTick_);
+    }
   }
 }
 
@@ -341,7 +427,7 @@ void HHWheelTimerBase<Duration>::scheduleNextTimeout(int64_t nextTick) {
 
   if (nextTick & WHEEL_MASK) {
     auto bi = makeBitIterator(bitmap_.begin());
-    auto bi_end = makeBitIterator(bitmap_.end());
+    auto bi_end = bi + WHEEL_SIZE;
     auto it = folly::findFirstSet(bi + (nextTick & WHEEL_MASK), bi_end);
     if (it == bi_end) {
       tick = WHEEL_SIZE - ((nextTick - 1) & WHEEL_MASK);
@@ -373,6 +459,110 @@ size_t HHWheelTimerBase<Duration>::cancelTimeoutsFromList(
   return count;
 }
 
+template <class Duration>
+int64_t HHWheelTimerBase<Duration>::lazyInsert(Callback* callback) {
+  int64_t due = callback->dueTick_;
+  int64_t diff = due - lazyNextTick_;
+  int level = 0;
+  int64_t wakeTick;
+  if (diff < WHEEL_SIZE) {
+    due = std::max(due, lazyNextTick_);
+    wakeTick = due;
+  } else {
+    // Lists beyond level 0 are processed at the start of the range of ticks
+    // they cover. Timeouts beyond the range of the wheel are put in the last
+    // list, and moved on from there when it is reached.
+    if (diff > LARGEST_SLOT) {
+      diff = LARGEST_SLOT;
+      due = lazyNextTick_ + diff;
+    }
+    level = diff < (1 << (2 * WHEEL_BITS)) ? 1
+        : diff < (1 << (3 * WHEEL_BITS))   ? 2
+                                           : 3;
+    int shift = level * WHEEL_BITS;
+    wakeTick = (due >> shift) << shift;
+    due >>= shift;
+  }
+
+  int index = level * WHEEL_SIZE + (due & WHEEL_MASK);
+  bucketAt(index).push_back(*callback);
+  setBit(index);
+  callback->bucket_ = index;
+  return wakeTick;
+}
+
+template <class Duration>
+int HHWheelTimerBase<Duration>::lazyFindSlot(
+    int level, unsigned int slot) const {
+  const std::size_t* words = bitmap_.data() + level * BITMAP_LEVEL_WORDS;
+  unsigned int word = slot / BITMAP_WORD_BITS;
+  std::size_t bits = words[word] & (~std::size_t(0) << (slot % BITMAP_WORD_BITS));
+  // The first word is visited twice, the second time for the bits before
+  // `slot`.
+  for (unsigned int i = 0; i <= BITMAP_LEVEL_WORDS; ++i) {
+    if (bits) {
+      unsigned int found = word * BITMAP_WORD_BITS + findFirstSet(bits) - 1;
+      return (found - slot) & WHEEL_MASK;
+    }
+    word = (word + 1) % BITMAP_LEVEL_WORDS;
+    bits = words[word];
+  }
+  return -1;
+}
+
+template <class Duration>
+int64_t HHWheelTimerBase<Duration>::lazyFindNextTick() const {
+  int64_t next = -1;
+  for (int level = 0; level < WHEEL_BUCKETS; ++level) {
+    int shift = level * WHEEL_BITS;
+    // The first list of this level that is still to be processed.
+    int64_t first = (lazyNextTick_ + (int64_t(1) << shift) - 1) >> shift;
+    int distance = lazyFindSlot(level, first & WHEEL_MASK);
+    if (distance >= 0) {
+      int64_t tick = (first + distance) << shift;
+      if (next < 0 || tick < next) {
+        next = tick;
+      }
+    }
+  }
+  return next;
+}
+
+template <class Duration>
+void HHWheelTimerBase<Duration>::lazyExpire(int64_t nextTick) {
+  while (true) {
+    int64_t tick = lazyFindNextTick();
+    if (tick < 0 || tick >= nextTick) {
+      break;
+    }
+    lazyNextTick_ = tick;
+
+    // Cascade the lists that start at this tick, highest level first, so
+    // that timeouts can fall through several levels at once.
+    for (int level = WHEEL_BUCKETS - 1; level > 0; --level) {
+      int shift = level * WHEEL_BITS;
+      if (tick & ((int64_t(1) << shift) - 1)) {
+        continue;
+      }
+      int index = level * WHEEL_SIZE + ((tick >> shift) & WHEEL_MASK);
+      CallbackList cbs;
+      cbs.swap(bucketAt(index));
+      clearBit(index);
+      while (!cbs.empty()) {
+        auto* cb = &cbs.front();
+        cbs.pop_front();
+        lazyInsert(cb);
+      }
+    }
+
+    int index = tick & WHEEL_MASK;
+    timeoutsToRunNow_.splice(timeoutsToRunNow_.end(), bucketAt(index));
+    clearBit(index);
+    lazyNextTick_ = tick + 1;
+  }
+  lazyNextTick_ = std::max(lazyNextTick_, nextTick);
+}
+
 template <class Duration>
 int64_t HHWheelTimerBase<Duration>::calcNextTick() {
   return calcNextTick(getCurTime());
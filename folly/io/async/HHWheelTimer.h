@@ -26,6 +26,7 @@
 
 #include <folly/ExceptionString.h>
 #include <folly/Optional.h>
+#include <folly/Range.h>
 #include <folly/io/async/AsyncTimeout.h>
 #include <folly/io/async/DelayedDestruction.h>
 #include <folly/io/async/HHWheelTimer-fwd.h>
@@ -125,6 +126,14 @@ struct HHWheelTimerDurationConst<std::chrono::microseconds> {
  * Unlike the original timer wheel paper, this implementation does
  * *not* tick constantly, and instead calculates the exact next wakeup
  * time.
+ *
+ * With Engine::LAZY, every level of the wheel keeps a bitmap of its
+ * non-empty lists. The next list to process, at any level, is found by
+ * scanning those bitmaps, so the timer sleeps through ticks and epochs that
+ * have nothing to do instead of stepping through them, and a list is only
+ * cascaded into the level below when the wheel actually reaches it. This
+ * makes fine tick intervals (down to a microsecond with HHWheelTimerHighRes)
+ * and large numbers of long, mostly cancelled timeouts cheap.
  */
 template <class Duration>
 class HHWheelTimerBase
@@ -134,6 +143,17 @@ class HHWheelTimerBase
   using UniquePtr = std::unique_ptr<HHWheelTimerBase, Destructor>;
   using SharedPtr = std::shared_ptr<HHWheelTimerBase>;
 
+  /**
+   * How the wheel finds and processes due timeouts. See the class comment.
+   */
+  enum class Engine {
+    // Step through every tick, cascading the higher levels at each epoch.
+    CASCADING,
+    // Jump to the next non-empty list using per-level bitmaps, cascading
+    // lists only when they are reached.
+    LAZY,
+  };
+
   template <typename... Args>
   static UniquePtr newTimer(Args&&... args) {
     return UniquePtr(new HHWheelTimerBase(std::forward<Args>(args)...));
@@ -202,7 +222,11 @@ class HHWheelTimerBase
 
     HHWheelTimerBase* wheel_{nullptr};
     std::chrono::steady_clock::time_point expiration_{};
+    // Index of the list the callback is in, counting the lists of all levels
+    // in order. Only kept for level 0 by the CASCADING engine.
     int bucket_{-1};
+    // Tick at which the callback is due, used by the LAZY engine.
+    int64_t dueTick_{0};
 
     using List = boost::intrusive::
         list<Callback, boost::intrusive::constant_time_size<false>>;
@@ -228,7 +252,8 @@ class HHWheelTimerBase
       folly::TimeoutManager* timeoutMananger,
       Duration intervalDuration = Duration(DEFAULT_TICK_INTERVAL),
       AsyncTimeout::InternalEnum internal = AsyncTimeout::InternalEnum::NORMAL,
-      Duration defaultTimeoutDuration = Duration(-1));
+      Duration defaultTimeoutDuration = Duration(-1),
+      Engine engine = Engine::CASCADING);
 
   /**
    * Cancel all outstanding timeouts
@@ -237,6 +262,11 @@ class HHWheelTimerBase
    */
   size_t cancelAll();
 
+  /**
+   * Get the engine this HHWheelTimerBase was created with.
+   */
+  Engine getEngine() const { return engine_; }
+
   /**
    * Get the tick interval for this HHWheelTimerBase.
    *
@@ -277,6 +307,21 @@ class HHWheelTimerBase
    */
   void scheduleTimeout(Callback* callback);
 
+  /**
+   * Schedule each of the callbacks to be invoked after the same timeout
+   * interval. This is equivalent to calling scheduleTimeout() for each of
+   * them, but reads the clock and updates the wheel's own timeout once for
+   * the whole batch.
+   */
+  void scheduleTimeouts(Range<Callback* const*> callbacks, Duration timeout);
+
+  /**
+   * Cancel each of the callbacks that is scheduled.
+   *
+   * @returns the number of timeouts that were cancelled.
+   */
+  size_t cancelTimeouts(Range<Callback* const*> callbacks);
+
   template <class F>
   void scheduleTimeoutFn(F fn, Duration timeout) {
     struct Wrapper : Callback {
@@ -326,6 +371,7 @@ class HHWheelTimerBase
 
   detail::HHWheelTimerDurationInterval<Duration> interval_;
   Duration defaultTimeout_;
+  Engine engine_;
 
   static constexpr int WHEEL_BUCKETS = 4;
   static constexpr int WHEEL_BITS = 8;
@@ -333,9 +379,19 @@ class HHWheelTimerBase
   static constexpr unsigned int WHEEL_MASK = (WHEEL_SIZE - 1);
   static constexpr uint32_t LARGEST_SLOT = 0xffffffffUL;
 
+  static constexpr unsigned int BITMAP_WORD_BITS = 8 * sizeof(std::size_t);
+  static constexpr unsigned int BITMAP_LEVEL_WORDS =
+      WHEEL_SIZE / BITMAP_WORD_BITS;
+
   using CallbackList = typename Callback::List;
   CallbackList buckets_[WHEEL_BUCKETS][WHEEL_SIZE];
-  std::array<std::size_t, (WHEEL_SIZE / sizeof(std::size_t)) / 8> bitmap_;
+  // One bit per list, set if the list may be non-empty. The CASCADING engine
+  // only tracks level 0.
+  std::array<std::size_t, WHEEL_BUCKETS * BITMAP_LEVEL_WORDS> bitmap_;
+
+  CallbackList& bucketAt(int index) {
+    return buckets_[index / WHEEL_SIZE][index % WHEEL_SIZE];
+  }
 
   int64_t timeToWheelTicks(Duration t) { return interval_.toWheelTicks(t); }
 
@@ -343,6 +399,23 @@ class HHWheelTimerBase
       int bucket, int tick, std::chrono::steady_clock::time_point curTime);
   void scheduleTimeoutInternal(Duration timeout);
 
+  /**
+   * Add a callback to the wheel without updating the wheel's own timeout.
+   *
+   * @returns the tick the wheel needs to wake up for to handle the callback.
+   */
+  int64_t insertTimeout(
+      Callback* callback,
+      Duration timeout,
+      std::chrono::steady_clock::time_point now,
+      int64_t nextTick);
+
+  /**
+   * Make sure the wheel wakes up in time for `wakeTick` after inserting
+   * timeouts.
+   */
+  void updateTimeoutAfterInsert(int64_t nextTick, int64_t wakeTick);
+
   int64_t expireTick_;
   std::size_t count_;
   std::chrono::steady_clock::time_point startTime_;
@@ -388,6 +461,47 @@ class HHWheelTimerBase
 
   size_t cancelTimeoutsFromList(CallbackList& timeouts);
 
+  // LAZY engine.
+
+  /**
+   * Put a callback in the list for its dueTick_, relative to
+   * lazyNextTick_.
+   *
+   * @returns the tick at which that list is processed.
+   */
+  int64_t lazyInsert(Callback* callback);
+
+  /**
+   * @returns the first tick, not before lazyNextTick_, at which a non-empty
+   *          list of any level is processed, or -1 if the wheel is empty.
+   */
+  int64_t lazyFindNextTick() const;
+
+  /**
+   * Cascade and expire the lists processed before `nextTick`, moving the
+   * expired callbacks to timeoutsToRunNow_.
+   */
+  void lazyExpire(int64_t nextTick);
+
+  /**
+   * @returns the distance from `slot` to the first non-empty list of `level`
+   *          at or after it, wrapping around, or -1 if the level is empty.
+   */
+  int lazyFindSlot(int level, unsigned int slot) const;
+
+  void setBit(int index) {
+    bitmap_[index / BITMAP_WORD_BITS] |= std::size_t(1)
+        << (index % BITMAP_WORD_BITS);
+  }
+
+  void clearBit(int index) {
+    bitmap_[index / BITMAP_WORD_BITS] &=
+        ~(std::size_t(1) << (index % BITMAP_WORD_BITS));
+  }
+
+  // All ticks before this one have been processed by the LAZY engine.
+  int64_t lazyNextTick_{0};
+
   bool* processingCallbacksGuard_;
   // Timeouts that we're about to run. They're already extracted from their
   // corresponding buckets, so we need this list for the `cancelAll` to be able
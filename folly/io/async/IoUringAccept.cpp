@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/io/async/IoUringAccept.h>
+
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/IoUringBackend.h>
+#include <folly/net/NetOps.h>
+
+namespace folly {
+
+#if FOLLY_HAS_LIBURING
+
+namespace {
+// Errors after which accepting again right away would fail the same way.
+bool shouldStayDisarmed(int err) {
+  return err == EMFILE || err == ENFILE || err == EINVAL;
+}
+} // namespace
+
+IoUringAcceptHandle::UniquePtr IoUringAcceptHandle::create(
+    EventBase* evb, NetworkSocket fd, IoUringAcceptCallback* callback) {
+  auto* backend = dynamic_cast<folly::IoUringBackend*>(evb->getBackend());
+  if (!backend) {
+    return nullptr;
+  }
+
+  auto handle = std::make_unique<IoUringAcceptHandle>(
+      NotPubliclyConstructible{}, evb, backend, fd, callback);
+  backend->submitSoon(*handle);
+  return handle;
+}
+
+IoUringAcceptHandle::IoUringAcceptHandle(
+    NotPubliclyConstructible,
+    EventBase* evb,
+    IoUringBackend* backend,
+    NetworkSocket fd,
+    IoUringAcceptCallback* callback)
+    : IoSqeBase(IoSqeBase::Type::Accept),
+      backend_(backend),
+      fd_(fd),
+      callback_(callback) {
+  setEventBase(evb);
+}
+
+void IoUringAcceptHandle::processSubmit(struct io_uring_sqe* sqe) noexcept {
+  ::io_uring_prep_multishot_accept(
+      sqe, fd_.toFd(), nullptr, nullptr, SOCK_NONBLOCK);
+}
+
+void IoUringAcceptHandle::callback(const struct io_uring_cqe* cqe) noexcept {
+  // The callback may destroy this handle, so re-arm before invoking it.
+  const bool more = cqe->flags & IORING_CQE_F_MORE;
+  if (cqe->res >= 0) {
+    if (!more) {
+      backend_->submitSoon(*this);
+    }
+    callback_->acceptSuccess(NetworkSocket::fromFd(cqe->res));
+    return;
+  }
+
+  const int err = -cqe->res;
+  if (err == ECANCELED) {
+    return;
+  }
+  if (!more && !shouldStayDisarmed(err)) {
+    backend_->submitSoon(*this);
+  }
+  callback_->acceptError(err);
+}
+
+void IoUringAcceptHandle::callbackCancelled(const io_uring_cqe* cqe) noexcept {
+  // Connections accepted before the cancellation took effect have nowhere to
+  // go.
+  if (cqe->res >= 0) {
+    netops::close(NetworkSocket::fromFd(cqe->res));
+  }
+  if (!(cqe->flags & IORING_CQE_F_MORE)) {
+    delete this;
+  }
+}
+
+void IoUringAcceptHandle::rearm() {
+  if (!inFlight()) {
+    backend_->submitSoon(*this);
+  }
+}
+
+bool IoUringAcceptHandle::cancel() {
+  if (inFlight()) {
+    backend_->cancel(this);
+    return true;
+  }
+
+  return false;
+}
+
+#else
+
+IoUringAcceptHandle::UniquePtr IoUringAcceptHandle::create(
+    EventBase* /*evb*/,
+    NetworkSocket /*fd*/,
+    IoUringAcceptCallback* /*callback*/) {
+  return nullptr;
+}
+
+IoUringAcceptHandle::IoUringAcceptHandle(
+    NotPubliclyConstructible,
+    EventBase* /*evb*/,
+    IoUringBackend* /*backend*/,
+    NetworkSocket /*fd*/,
+    IoUringAcceptCallback* /*callback*/)
+    : IoSqeBase(IoSqeBase::Type::Accept),
+      backend_(nullptr),
+      fd_(),
+      callback_(nullptr) {
+  (void)backend_;
+  (void)fd_;
+  (void)callback_;
+}
+
+void IoUringAcceptHandle::processSubmit(struct io_uring_sqe* /*sqe*/) noexcept {
+  folly::terminate_with<std::runtime_error>("io_uring not supported");
+}
+
+void IoUringAcceptHandle::callback(
+    const struct io_uring_cqe* /*cqe*/) noexcept {
+  folly::terminate_with<std::runtime_error>("io_uring not supported");
+}
+
+void IoUringAcceptHandle::callbackCancelled(const io_uring_cqe*) noexcept {
+  folly::terminate_with<std::runtime_error>("io_uring not supported");
+}
+
+void IoUringAcceptHandle::rearm() {
+  folly::terminate_with<std::runtime_error>("io_uring not supported");
+}
+
+bool IoUringAcceptHandle::cancel() {
+  folly::terminate_with<std::runtime_error>("io_uring not supported");
+}
+
+#endif
+
+} // namespace folly
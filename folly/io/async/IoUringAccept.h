@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <memory>
+
+#include <folly/io/async/IoUringBase.h>
+#include <folly/net/NetworkSocket.h>
+
+namespace folly {
+
+class IoUringAcceptCallback {
+ public:
+  virtual ~IoUringAcceptCallback() = default;
+
+  /**
+   * A connection was accepted. The socket is already in non-blocking mode.
+   */
+  virtual void acceptSuccess(NetworkSocket fd) noexcept = 0;
+
+  /**
+   * Accepting failed with `err`. The handle is left disarmed if the error is
+   * one the caller needs to act on (running out of file descriptors, or a
+   * kernel without multishot accept), and re-armed otherwise.
+   */
+  virtual void acceptError(int err) noexcept = 0;
+};
+
+class EventBase;
+class IoUringBackend;
+
+/**
+ * Accepts connections on a listening socket with a single multishot accept
+ * request, so that the backend completes one accept per connection instead
+ * of a readiness notification followed by an accept() call.
+ */
+class IoUringAcceptHandle : public IoSqeBase {
+ private:
+  struct NotPubliclyConstructible {};
+
+ public:
+  using UniquePtr = std::unique_ptr<IoUringAcceptHandle>;
+
+  /**
+   * Returns nullptr if the EventBase is not backed by an IoUringBackend.
+   */
+  static IoUringAcceptHandle::UniquePtr create(
+      EventBase* evb, NetworkSocket fd, IoUringAcceptCallback* callback);
+
+  IoUringAcceptHandle(
+      NotPubliclyConstructible,
+      EventBase* evb,
+      IoUringBackend* backend,
+      NetworkSocket fd,
+      IoUringAcceptCallback* callback);
+
+  /*
+   * IoSqeBase
+   */
+  void processSubmit(struct io_uring_sqe* sqe) noexcept override;
+  void callback(const struct io_uring_cqe* cqe) noexcept override;
+  void callbackCancelled(const io_uring_cqe* cqe) noexcept override;
+
+  /**
+   * Re-arm the handle after acceptError() left it disarmed.
+   */
+  void rearm();
+
+  /**
+   * Stop accepting. Returns true if the request is still in flight, in which
+   * case the handle deletes itself once the backend is done with it and the
+   * caller must release() it rather than destroy it.
+   */
+  bool cancel();
+
+ private:
+  IoUringBackend* backend_;
+  NetworkSocket fd_;
+  IoUringAcceptCallback* callback_;
+};
+
+} // namespace folly
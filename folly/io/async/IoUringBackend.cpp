@@ -1647,6 +1647,7 @@ int IoUringBackend::submitBusyCheck(
   DCHECK(!isSubmitting()) << "mid processing a submit, cannot submit";
   while (i < num) {
     VLOG(2) << "IoUringBackend::submit() " << waitingToSubmit_;
+    ++numSubmitCalls_;
 
     if (waitForEvents == WaitForEventsMode::WAIT) {
       if (options_.flags & Options::Flags::POLL_CQ) {
@@ -77,6 +77,10 @@ class IoUringBackend : public EventBaseBackendBase {
   bool isWaitingToSubmit() const {
     return waitingToSubmit_ || !submitList_.empty();
   }
+
+  // Number of io_uring_submit*() calls made to hand queued SQEs to the
+  // kernel, to tell how well submissions are batched.
+  uint64_t getNumSubmitCalls() const { return numSubmitCalls_; }
   io_uring* ioRingPtr() { return &ioRing_; }
   io_uring_params const& params() const { return params_; }
   bool useReqBatching() const {
@@ -881,6 +885,7 @@ class IoUringBackend : public EventBaseBackendBase {
   uint32_t numInsertedEvents_{0};
   uint32_t numInternalEvents_{0};
   uint32_t numSendEvents_{0};
+  uint64_t numSubmitCalls_{0};
 
   // io_uring related
   io_uring_params params_{};
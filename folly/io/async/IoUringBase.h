@@ -39,6 +39,7 @@ struct IoSqeBase
     Open,
     Close,
     Connect,
+    Accept,
     Cancel,
   };
 
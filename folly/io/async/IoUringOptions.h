@@ -212,6 +212,12 @@ struct IoUringOptions {
     return *this;
   }
 
+  IoUringOptions& setBatchSocketWrites(bool v) {
+    batchSocketWrites = v;
+
+    return *this;
+  }
+
   IoUringOptions& setZeroCopyRx(bool v) {
     zeroCopyRx = v;
 
@@ -312,6 +318,14 @@ struct IoUringOptions {
   bool taskRunCoop{false};
   bool deferTaskRun{false};
 
+  // Have AsyncSockets queue every write as an io_uring sendmsg instead of
+  // trying an inline sendmsg() first, so that the writes to all the sockets
+  // written to in one loop iteration reach the kernel in a single
+  // io_uring_enter (or one per maxSubmit writes) rather than one syscall per
+  // socket. Writes to a socket are still sent in order, one at a time, but
+  // their WriteCallbacks never complete inline.
+  bool batchSocketWrites{false};
+
   // Disable io_uring iowait accounting by passing IORING_ENTER_NO_IOWAIT on
   // io_uring_enter, so that waiting for completions is not charged as iowait
   // time. This stops io_uring from inflating cgroup io.pressure / iowait
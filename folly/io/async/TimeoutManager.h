@@ -25,6 +25,7 @@
 namespace folly {
 
 class AsyncTimeout;
+class EventBaseLoopProfiler;
 
 /**
  * Base interface to be implemented by all classes expecting to manage
@@ -79,6 +80,11 @@ class TimeoutManager {
    */
   virtual bool isInTimeoutManagerThread() = 0;
 
+  /**
+   * The profiler to attribute the time spent in timeouts to, if any.
+   */
+  virtual EventBaseLoopProfiler* getLoopProfiler() const { return nullptr; }
+
   /**
    * Runs the given Cob at some time after the specified number of
    * milliseconds.  (No guarantees exactly when.)
@@ -101,6 +101,10 @@ class VirtualEventBase
 
   void bumpHandlingTime() override { evb_->bumpHandlingTime(); }
 
+  EventBaseLoopProfiler* getLoopProfiler() const override {
+    return evb_->getLoopProfiler();
+  }
+
   bool isInTimeoutManagerThread() override {
     return evb_->isInTimeoutManagerThread();
   }
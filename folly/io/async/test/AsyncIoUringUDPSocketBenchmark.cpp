@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/SocketAddress.h>
+#include <folly/io/IOBuf.h>
+#include <folly/io/async/AsyncIoUringUDPSocket.h>
+#include <folly/io/async/AsyncUDPSocket.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/IoUringBackend.h>
+#include <folly/portability/GFlags.h>
+
+using namespace folly;
+
+// Each iteration is one QUIC-sized datagram sent by a client socket and read
+// by a server socket over loopback, both on one thread, so the iterations per
+// second are the packets per second a single core can send and receive.
+namespace {
+
+constexpr size_t kPacketSize = 1200;
+// Datagrams sent before draining the server, small enough to never overflow
+// the default receive buffer.
+constexpr size_t kBurst = 32;
+
+enum class Mode {
+  // AsyncUDPSocket on the default (epoll) backend.
+  kEpoll,
+  // AsyncUDPSocket on an io_uring backend, which only polls the socket.
+  kIoUringPoll,
+  // AsyncIoUringUDPSocket, which reads and writes through io_uring.
+  kIoUring,
+};
+
+class CountingReadCallback : public AsyncUDPSocket::ReadCallback {
+ public:
+  void getReadBuffer(void** buf, size_t* len) noexcept override {
+    *buf = buffer_;
+    *len = sizeof(buffer_);
+  }
+
+  void onDataAvailable(
+      const SocketAddress&,
+      size_t,
+      bool,
+      OnDataAvailableParams) noexcept override {
+    ++packets;
+  }
+
+  void onReadError(const AsyncSocketException& ex) noexcept override {
+    LOG(FATAL) << "read failed: " << ex.what();
+  }
+
+  void onReadClosed() noexcept override {}
+
+  size_t packets{0};
+
+ private:
+  char buffer_[2048];
+};
+
+EventBase::Options eventBaseOptions(Mode mode) {
+  EventBase::Options options;
+#if FOLLY_HAS_LIBURING
+  if (mode != Mode::kEpoll && IoUringBackend::isAvailable()) {
+    options.setBackendFactory([]() -> std::unique_ptr<EventBaseBackendBase> {
+      IoUringBackend::Options ioOptions;
+      ioOptions.setInitialProvidedBuffers(2048, 256);
+      return std::make_unique<IoUringBackend>(std::move(ioOptions));
+    });
+  }
+#else
+  (void)mode;
+#endif
+  return options;
+}
+
+std::unique_ptr<AsyncUDPSocket> makeSocket(EventBase* evb, Mode mode) {
+  std::unique_ptr<AsyncUDPSocket> socket;
+  if (mode == Mode::kIoUring) {
+    socket = std::make_unique<AsyncIoUringUDPSocket>(evb);
+  } else {
+    socket = std::make_unique<AsyncUDPSocket>(evb);
+  }
+  socket->bind(SocketAddress("127.0.0.1", 0));
+  return socket;
+}
+
+void pingPong(UserCounters& counters, size_t iters, Mode mode) {
+  BenchmarkSuspender suspender;
+  EventBase evb(eventBaseOptions(mode));
+  counters["io_uring"] = AsyncIoUringUDPSocket::supports(&evb) ? 1 : 0;
+  auto server = makeSocket(&evb, mode);
+  CountingReadCallback callback;
+  server->resumeRead(&callback);
+
+  auto client = makeSocket(&evb, mode);
+  auto payload = IOBuf::create(kPacketSize * kBurst);
+  payload->append(kPacketSize * kBurst);
+  std::fill(payload->writableData(), payload->writableTail(), 'a');
+  std::vector<std::unique_ptr<IOBuf>> bufs;
+  for (size_t i = 0; i < kBurst; ++i) {
+    bufs.push_back(IOBuf::wrapBuffer(
+        payload->data() + i * kPacketSize, kPacketSize));
+  }
+  std::vector<SocketAddress> addrs{server->address()};
+  suspender.dismiss();
+
+  size_t sent = 0;
+  while (sent < iters) {
+    size_t n = std::min(kBurst, iters - sent);
+    client->writem(range(addrs), bufs.data(), n);
+    sent += n;
+    while (callback.packets < sent) {
+      evb.loopOnce();
+    }
+  }
+
+  suspender.rehire();
+  client->close();
+  server->close();
+  evb.loopOnce(EVLOOP_NONBLOCK);
+}
+
+} // namespace
+
+BENCHMARK_COUNTERS(epoll, counters, iters) {
+  pingPong(counters, iters, Mode::kEpoll);
+}
+
+BENCHMARK_COUNTERS_RELATIVE(ioUringPoll, counters, iters) {
+  pingPong(counters, iters, Mode::kIoUringPoll);
+}
+
+BENCHMARK_COUNTERS_RELATIVE(ioUring, counters, iters) {
+  pingPong(counters, iters, Mode::kIoUring);
+}
+
+int main(int argc, char** argv) {
+  folly::gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
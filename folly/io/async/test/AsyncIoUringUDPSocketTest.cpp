@@ -0,0 +1,256 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <array>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <folly/SocketAddress.h>
+#include <folly/String.h>
+#include <folly/io/IOBuf.h>
+#include <folly/io/async/AsyncIoUringUDPSocket.h>
+#include <folly/io/async/AsyncUDPSocket.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/IoUringBackend.h>
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+
+namespace {
+
+class CollectingReadCallback : public AsyncUDPSocket::ReadCallback {
+ public:
+  explicit CollectingReadCallback(size_t bufferSize = 2048)
+      : buffer_(bufferSize) {}
+
+  void getReadBuffer(void** buf, size_t* len) noexcept override {
+    *buf = buffer_.data();
+    *len = buffer_.size();
+  }
+
+  void onDataAvailable(
+      const SocketAddress& client,
+      size_t len,
+      bool truncated,
+      OnDataAvailableParams /* params */) noexcept override {
+    datagrams.emplace_back(buffer_.data(), len);
+    clients.push_back(client);
+    numTruncated += truncated ? 1 : 0;
+  }
+
+  void onReadError(const AsyncSocketException& ex) noexcept override {
+    FAIL() << ex.what();
+  }
+
+  void onReadClosed() noexcept override { closed = true; }
+
+  std::vector<std::string> datagrams;
+  std::vector<SocketAddress> clients;
+  size_t numTruncated{0};
+  bool closed{false};
+
+ private:
+  std::vector<char> buffer_;
+};
+
+class AsyncIoUringUDPSocketTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    try {
+      evb_ = std::make_unique<EventBase>(EventBase::Options{}.setBackendFactory(
+          []() -> std::unique_ptr<EventBaseBackendBase> {
+            IoUringBackend::Options options;
+            options.setInitialProvidedBuffers(2048, 64);
+            return std::make_unique<IoUringBackend>(std::move(options));
+          }));
+    } catch (IoUringBackend::NotAvailable const&) {
+      GTEST_SKIP() << "io_uring not available";
+    }
+  }
+
+  void loopUntil(const std::function<bool()>& done) {
+    for (size_t i = 0; i < 1000 && !done(); ++i) {
+      evb_->loopOnce();
+    }
+    ASSERT_TRUE(done());
+  }
+
+  std::unique_ptr<EventBase> evb_;
+};
+
+} // namespace
+
+TEST_F(AsyncIoUringUDPSocketTest, Echo) {
+  ASSERT_TRUE(AsyncIoUringUDPSocket::supports(evb_.get()));
+
+  AsyncIoUringUDPSocket server(evb_.get());
+  server.bind(SocketAddress("127.0.0.1", 0));
+  CollectingReadCallback serverCallback;
+  server.resumeRead(&serverCallback);
+  EXPECT_TRUE(server.isIoUringReading());
+
+  AsyncIoUringUDPSocket client(evb_.get());
+  client.bind(SocketAddress("127.0.0.1", 0));
+  CollectingReadCallback clientCallback;
+  client.resumeRead(&clientCallback);
+
+  constexpr size_t kNumDatagrams = 100;
+  for (size_t i = 0; i < kNumDatagrams; ++i) {
+    auto data = std::to_string(i);
+    EXPECT_EQ(
+        client.write(server.address(), IOBuf::copyBuffer(data)),
+        ssize_t(data.size()));
+  }
+  loopUntil([&] { return serverCallback.datagrams.size() == kNumDatagrams; });
+  for (size_t i = 0; i < kNumDatagrams; ++i) {
+    EXPECT_EQ(serverCallback.datagrams[i], std::to_string(i));
+    EXPECT_EQ(serverCallback.clients[i], client.address());
+    server.write(
+        serverCallback.clients[i],
+        IOBuf::copyBuffer(serverCallback.datagrams[i]));
+  }
+  loopUntil([&] { return clientCallback.datagrams.size() == kNumDatagrams; });
+  EXPECT_EQ(clientCallback.datagrams, serverCallback.datagrams);
+  EXPECT_EQ(client.getNumSendErrors(), 0);
+  EXPECT_EQ(server.getNumSendErrors(), 0);
+}
+
+TEST_F(AsyncIoUringUDPSocketTest, WriteManyAndTruncate) {
+  AsyncIoUringUDPSocket server(evb_.get());
+  server.bind(SocketAddress("127.0.0.1", 0));
+  CollectingReadCallback serverCallback(16);
+  server.resumeRead(&serverCallback);
+
+  AsyncIoUringUDPSocket client(evb_.get());
+  client.bind(SocketAddress("127.0.0.1", 0));
+  std::array<std::unique_ptr<IOBuf>, 2> bufs{
+      IOBuf::copyBuffer("short"), IOBuf::copyBuffer(std::string(100, 'x'))};
+  std::vector<SocketAddress> addrs{server.address()};
+  EXPECT_EQ(client.writem(range(addrs), bufs.data(), bufs.size()), 2);
+
+  loopUntil([&] { return serverCallback.datagrams.size() == 2; });
+  EXPECT_EQ(serverCallback.datagrams[0], "short");
+  EXPECT_EQ(serverCallback.datagrams[1], std::string(16, 'x'));
+  EXPECT_EQ(serverCallback.numTruncated, 1);
+}
+
+TEST_F(AsyncIoUringUDPSocketTest, PauseResume) {
+  AsyncIoUringUDPSocket server(evb_.get());
+  server.bind(SocketAddress("127.0.0.1", 0));
+  CollectingReadCallback serverCallback;
+  server.resumeRead(&serverCallback);
+  server.pauseRead();
+  EXPECT_FALSE(server.isIoUringReading());
+
+  AsyncUDPSocket client(evb_.get());
+  client.bind(SocketAddress("127.0.0.1", 0));
+  client.write(server.address(), IOBuf::copyBuffer("queued"));
+  evb_->loopOnce(EVLOOP_NONBLOCK);
+  EXPECT_TRUE(serverCallback.datagrams.empty());
+
+  // The datagram waited in the socket while reads were paused.
+  server.resumeRead(&serverCallback);
+  loopUntil([&] { return serverCallback.datagrams.size() == 1; });
+  EXPECT_EQ(serverCallback.datagrams[0], "queued");
+}
+
+TEST_F(AsyncIoUringUDPSocketTest, CloseWithRequestsInFlight) {
+  SocketAddress serverAddress;
+  {
+    AsyncIoUringUDPSocket server(evb_.get());
+    server.bind(SocketAddress("127.0.0.1", 0));
+    serverAddress = server.address();
+    CollectingReadCallback serverCallback;
+    server.resumeRead(&serverCallback);
+    for (size_t i = 0; i < 10; ++i) {
+      server.write(serverAddress, IOBuf::copyBuffer("x"));
+    }
+    server.close();
+    EXPECT_TRUE(serverCallback.closed);
+    EXPECT_FALSE(server.isIoUringReading());
+  }
+  // The orphaned requests complete after the socket is gone.
+  evb_->loopOnce(EVLOOP_NONBLOCK);
+}
+
+TEST_F(AsyncIoUringUDPSocketTest, GRO) {
+  AsyncIoUringUDPSocket server(evb_.get());
+  server.bind(SocketAddress("127.0.0.1", 0));
+  CollectingReadCallback serverCallback(64 * 1024);
+  server.resumeRead(&serverCallback);
+  // Enabled while reading, and the provided buffers are too small for the
+  // coalesced datagrams.
+  if (!server.setGRO(true)) {
+    GTEST_SKIP() << "GRO not available";
+  }
+
+  AsyncUDPSocket client(evb_.get());
+  client.bind(SocketAddress("127.0.0.1", 0));
+  if (client.getGSO() < 0) {
+    GTEST_SKIP() << "GSO not available";
+  }
+
+  constexpr size_t kSegmentSize = 1000;
+  constexpr size_t kNumSegments = 10;
+  std::string data;
+  for (size_t i = 0; i < kNumSegments; ++i) {
+    data.append(kSegmentSize, char('a' + i));
+  }
+  EXPECT_EQ(
+      client.writeGSO(
+          server.address(),
+          IOBuf::copyBuffer(data),
+          AsyncUDPSocket::WriteOptions(kSegmentSize, false)),
+      ssize_t(data.size()));
+
+  std::string received;
+  loopUntil([&] {
+    received = join("", serverCallback.datagrams);
+    return received.size() >= data.size();
+  });
+  EXPECT_EQ(received, data);
+  EXPECT_EQ(serverCallback.numTruncated, 0);
+}
+
+TEST(AsyncIoUringUDPSocketFallbackTest, Echo) {
+  EventBase evb;
+  EXPECT_FALSE(AsyncIoUringUDPSocket::supports(&evb));
+
+  AsyncIoUringUDPSocket server(&evb);
+  server.bind(SocketAddress("127.0.0.1", 0));
+  CollectingReadCallback serverCallback;
+  server.resumeRead(&serverCallback);
+  EXPECT_FALSE(server.isIoUringReading());
+
+  AsyncIoUringUDPSocket client(&evb);
+  client.bind(SocketAddress("127.0.0.1", 0));
+  CollectingReadCallback clientCallback;
+  client.resumeRead(&clientCallback);
+
+  client.write(server.address(), IOBuf::copyBuffer("ping"));
+  while (serverCallback.datagrams.empty()) {
+    evb.loopOnce();
+  }
+  EXPECT_EQ(serverCallback.datagrams[0], "ping");
+  server.write(serverCallback.clients[0], IOBuf::copyBuffer("pong"));
+  while (clientCallback.datagrams.empty()) {
+    evb.loopOnce();
+  }
+  EXPECT_EQ(clientCallback.datagrams[0], "pong");
+}
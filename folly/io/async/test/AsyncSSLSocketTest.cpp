@@ -24,6 +24,7 @@
 #include <set>
 #include <thread>
 
+#include <folly/FileUtil.h>
 #include <folly/SocketAddress.h>
 #include <folly/String.h>
 #include <folly/io/Cursor.h>
@@ -4189,6 +4190,184 @@ TEST(AsyncSSLSocketTest, BytesWrittenWithMove) {
   EXPECT_EQ(socket1RawBytes, socket3->getRawBytesWritten());
 }
 
+namespace {
+
+// kTLS can only be set up on TCP sockets.
+void getTcpFds(NetworkSocket fds[2]) {
+  SocketAddress addr("127.0.0.1", 0);
+  sockaddr_storage storage;
+  addr.getAddress(&storage);
+  auto listener = netops::socket(AF_INET, SOCK_STREAM, 0);
+  ASSERT_EQ(
+      0,
+      netops::bind(
+          listener,
+          reinterpret_cast<sockaddr*>(&storage),
+          addr.getActualSize()));
+  ASSERT_EQ(0, netops::listen(listener, 1));
+  addr.setFromLocalAddress(listener);
+  addr.getAddress(&storage);
+
+  fds[0] = netops::socket(AF_INET, SOCK_STREAM, 0);
+  ASSERT_EQ(
+      0,
+      netops::connect(
+          fds[0],
+          reinterpret_cast<sockaddr*>(&storage),
+          addr.getActualSize()));
+  fds[1] = netops::accept(listener, nullptr, nullptr);
+  netops::close(listener);
+  for (int idx = 0; idx < 2; ++idx) {
+    ASSERT_EQ(0, netops::set_socket_non_blocking(fds[idx]));
+  }
+}
+
+// Whether this process can use kTLS: OpenSSL supports it, and the kernel
+// accepts the "tls" upper layer protocol on a connected TCP socket.
+bool kernelTLSAvailable() {
+#if FOLLY_OPENSSL_HAS_KTLS && defined(TCP_ULP)
+  NetworkSocket fds[2];
+  getTcpFds(fds);
+  bool available =
+      netops::setsockopt(fds[0], IPPROTO_TCP, TCP_ULP, "tls", 3) == 0;
+  netops::close(fds[0]);
+  netops::close(fds[1]);
+  return available;
+#else
+  return false;
+#endif
+}
+
+// Exposes whether writeFile() would use sendfile().
+class SendFileSSLSocket : public AsyncSSLSocket {
+ public:
+  using AsyncSSLSocket::AsyncSSLSocket;
+  using AsyncSSLSocket::canSendFile;
+};
+
+void kernelTLSWriteRead(
+    std::shared_ptr<SSLContext> clientCtx,
+    std::shared_ptr<SSLContext> serverCtx,
+    bool kernelTLS = true) {
+  if (kernelTLS && !kernelTLSAvailable()) {
+    GTEST_SKIP() << "kTLS is not available";
+  }
+  EventBase eventBase;
+  getctx(clientCtx, serverCtx);
+  NetworkSocket fds[2];
+  getTcpFds(fds);
+
+  AsyncSSLSocket::UniquePtr clientSock(
+      new SendFileSSLSocket(clientCtx, &eventBase, fds[0], false));
+  AsyncSSLSocket::UniquePtr serverSock(
+      new AsyncSSLSocket(serverCtx, &eventBase, fds[1], true));
+  if (kernelTLS) {
+    clientSock->enableKernelTLS();
+    serverSock->enableKernelTLS();
+  }
+  SSLHandshakeClient client(std::move(clientSock), true, true);
+  SSLHandshakeServer server(std::move(serverSock), true, true);
+  while (!client.handshakeSuccess_ || !server.handshakeSuccess_) {
+    ASSERT_FALSE(client.handshakeError_);
+    ASSERT_FALSE(server.handshakeError_);
+    eventBase.loopOnce();
+  }
+
+  std::shared_ptr<AsyncSSLSocket> clientSocket =
+      std::move(client).moveSocket();
+  std::shared_ptr<AsyncSSLSocket> serverSocket =
+      std::move(server).moveSocket();
+  EXPECT_EQ(kernelTLS, clientSocket->isKernelTLSSendEnabled());
+  EXPECT_EQ(kernelTLS, serverSocket->isKernelTLSRecvEnabled());
+  // Files go through sendfile() if and only if the kernel encrypts.
+  EXPECT_EQ(
+      kernelTLS,
+      static_cast<SendFileSSLSocket*>(clientSocket.get())->canSendFile());
+
+  WriteCallbackBase serverWriteCallback;
+  ReadCallback serverReadCallback(&serverWriteCallback);
+  serverReadCallback.setSocket(serverSocket);
+  serverSocket->setReadCB(&serverReadCallback);
+  ReadCallback clientReadCallback;
+  clientReadCallback.setSocket(clientSocket);
+  clientSocket->setReadCB(&clientReadCallback);
+
+  // The first part is written from memory, and the rest from a file larger
+  // than AsyncSocket::kFileWriteChunkSize: with sendfile() when the kernel
+  // encrypts, and a chunk at a time through SSL_write() otherwise.
+  constexpr size_t kWriteSize = 100000;
+  std::vector<uint8_t> buf(kWriteSize + 3 * AsyncSocket::kFileWriteChunkSize);
+  for (size_t i = 0; i < buf.size(); ++i) {
+    buf[i] = uint8_t(i * 7);
+  }
+  test::TemporaryFile file;
+  ASSERT_EQ(ssize_t(buf.size()), writeFull(file.fd(), buf.data(), buf.size()));
+  WriteCallbackBase clientWriteCallback;
+  WriteCallbackBase clientFileWriteCallback;
+  clientSocket->write(&clientWriteCallback, buf.data(), kWriteSize);
+  clientSocket->writeFile(
+      &clientFileWriteCallback, file.fd(), kWriteSize, buf.size() - kWriteSize);
+  while (clientReadCallback.dataRead() < buf.size()) {
+    ASSERT_NE(STATE_FAILED, clientWriteCallback.state);
+    ASSERT_NE(STATE_FAILED, clientFileWriteCallback.state);
+    ASSERT_NE(STATE_FAILED, serverReadCallback.state);
+    eventBase.loopOnce();
+  }
+  clientReadCallback.verifyData(buf.data(), buf.size());
+  EXPECT_EQ(buf.size(), clientSocket->getAppBytesWritten());
+  EXPECT_LT(buf.size(), clientSocket->getRawBytesWritten());
+
+  clientSocket->setReadCB(nullptr);
+  serverSocket->setReadCB(nullptr);
+}
+
+} // namespace
+
+TEST(AsyncSSLSocketTest, KernelTLS) {
+  kernelTLSWriteRead(
+      std::make_shared<SSLContext>(), std::make_shared<SSLContext>());
+}
+
+TEST(AsyncSSLSocketTest, KernelTLS12) {
+  auto clientCtx = std::make_shared<SSLContext>();
+  auto serverCtx = std::make_shared<SSLContext>();
+  clientCtx->disableTLS13();
+  serverCtx->disableTLS13();
+  kernelTLSWriteRead(clientCtx, serverCtx);
+}
+
+TEST(AsyncSSLSocketTest, KernelTLSNotEnabled) {
+  EventBase eventBase;
+  auto clientCtx = std::make_shared<SSLContext>();
+  auto serverCtx = std::make_shared<SSLContext>();
+  getctx(clientCtx, serverCtx);
+  NetworkSocket fds[2];
+  getTcpFds(fds);
+
+  AsyncSSLSocket::UniquePtr clientSock(
+      new AsyncSSLSocket(clientCtx, &eventBase, fds[0], false));
+  AsyncSSLSocket::UniquePtr serverSock(
+      new AsyncSSLSocket(serverCtx, &eventBase, fds[1], true));
+  SSLHandshakeClient client(std::move(clientSock), true, true);
+  SSLHandshakeServer server(std::move(serverSock), true, true);
+  while (!client.handshakeSuccess_ || !server.handshakeSuccess_) {
+    ASSERT_FALSE(client.handshakeError_);
+    ASSERT_FALSE(server.handshakeError_);
+    eventBase.loopOnce();
+  }
+
+  auto clientSocket = std::move(client).moveSocket();
+  EXPECT_FALSE(clientSocket->isKernelTLSSendEnabled());
+  EXPECT_FALSE(clientSocket->isKernelTLSRecvEnabled());
+}
+
+TEST(AsyncSSLSocketTest, KernelTLSNotEnabledWriteRead) {
+  kernelTLSWriteRead(
+      std::make_shared<SSLContext>(),
+      std::make_shared<SSLContext>(),
+      /* kernelTLS */ false);
+}
+
 #ifdef SIGPIPE
 ///////////////////////////////////////////////////////////////////////////
 // init_unit_test_suite
@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/SocketAddress.h>
+#include <folly/io/async/AsyncServerSocket.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/EventBaseManager.h>
+#include <folly/io/async/IoUringBackend.h>
+#include <folly/io/async/ScopedEventBaseThread.h>
+#include <folly/net/NetOps.h>
+#include <folly/portability/GFlags.h>
+#include <folly/portability/Sockets.h>
+
+using namespace folly;
+
+// Each iteration is one TCP connection made over loopback and accepted by the
+// server, with up to kWindow connections in flight at a time. Accept latency
+// is measured from just before connect() to the AcceptCallback on the IO
+// thread that gets the connection.
+namespace {
+
+constexpr size_t kThreads = 4;
+constexpr size_t kWindow = 64;
+
+enum class Mode {
+  // One thread accepts and hands connections over to the IO threads.
+  kAcceptorThread,
+  // Each IO thread accepts from its own SO_REUSEPORT listener.
+  kReusePort,
+  // As above, with io_uring multishot accept on each IO thread.
+  kReusePortIoUring,
+};
+
+int64_t nowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Indexed by client port.
+struct Connections {
+  Connections() : startNs(65536), accepted(65536) {}
+
+  std::vector<std::atomic<int64_t>> startNs;
+  std::vector<std::atomic<bool>> accepted;
+  std::atomic<size_t> numAccepted{0};
+};
+
+class StormCallback : public AsyncServerSocket::AcceptCallback {
+ public:
+  explicit StormCallback(Connections& connections)
+      : connections_(connections) {}
+
+  void connectionAccepted(
+      NetworkSocket fd,
+      const SocketAddress& clientAddr,
+      AcceptInfo /* info */) noexcept override {
+    auto port = clientAddr.getPort();
+    latenciesNs.push_back(
+        nowNs() - connections_.startNs[port].load(std::memory_order_relaxed));
+    netops::close(fd);
+    connections_.accepted[port].store(true, std::memory_order_release);
+    connections_.numAccepted.fetch_add(1, std::memory_order_release);
+  }
+
+  void acceptError(exception_wrapper ex) noexcept override {
+    LOG(FATAL) << "accept failed: " << ex.what();
+  }
+
+  std::vector<int64_t> latenciesNs;
+
+ private:
+  Connections& connections_;
+};
+
+EventBase::Options ioThreadOptions(Mode mode) {
+  EventBase::Options options;
+#if FOLLY_HAS_LIBURING
+  if (mode == Mode::kReusePortIoUring && IoUringBackend::isAvailable()) {
+    options.setBackendFactory([]() -> std::unique_ptr<EventBaseBackendBase> {
+      return std::make_unique<IoUringBackend>(IoUringBackend::Options{});
+    });
+  }
+#else
+  (void)mode;
+#endif
+  return options;
+}
+
+bool isIoUring(EventBase* evb) {
+#if FOLLY_HAS_LIBURING
+  return dynamic_cast<IoUringBackend*>(evb->getBackend()) != nullptr;
+#else
+  (void)evb;
+  return false;
+#endif
+}
+
+// Returns the socket and its local port.
+std::pair<NetworkSocket, uint16_t> startConnect(
+    Connections& connections, const SocketAddress& to) {
+  auto fd = netops::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  CHECK_NE(fd, NetworkSocket());
+  // Reset on close rather than linger in TIME_WAIT, or a long run would run
+  // out of ports.
+  linger noLinger{1, 0};
+  netops::setsockopt(fd, SOL_SOCKET, SO_LINGER, &noLinger, sizeof(noLinger));
+  SocketAddress local("127.0.0.1", 0);
+  sockaddr_storage storage;
+  CHECK_EQ(
+      netops::bind(
+          fd,
+          reinterpret_cast<sockaddr*>(&storage),
+          local.getAddress(&storage)),
+      0);
+  local.setFromLocalAddress(fd);
+  auto port = local.getPort();
+  connections.accepted[port].store(false);
+  connections.startNs[port].store(nowNs());
+  CHECK_EQ(netops::set_socket_non_blocking(fd), 0);
+  to.getAddress(&storage);
+  auto ret = netops::connect(
+      fd, reinterpret_cast<sockaddr*>(&storage), to.getActualSize());
+  CHECK(ret == 0 || errno == EINPROGRESS) << errnoStr(errno);
+  return {fd, port};
+}
+
+void storm(UserCounters& counters, size_t iters, Mode mode) {
+  BenchmarkSuspender suspender;
+  Connections connections;
+  std::vector<std::unique_ptr<ScopedEventBaseThread>> ioThreads;
+  std::vector<std::unique_ptr<StormCallback>> callbacks;
+  for (size_t i = 0; i < kThreads; ++i) {
+    ioThreads.push_back(std::make_unique<ScopedEventBaseThread>(
+        ioThreadOptions(mode), EventBaseManager::get(), "io"));
+    callbacks.push_back(std::make_unique<StormCallback>(connections));
+  }
+  counters["io_uring"] = isIoUring(ioThreads[0]->getEventBase()) ? 1 : 0;
+
+  // Server sockets, each with the EventBase it lives on.
+  std::vector<std::pair<EventBase*, AsyncServerSocket::UniquePtr>> servers;
+  ScopedEventBaseThread acceptorThread("acceptor");
+  SocketAddress address("127.0.0.1", 0);
+  if (mode == Mode::kAcceptorThread) {
+    auto* evb = acceptorThread.getEventBase();
+    evb->runInEventBaseThreadAndWait([&] {
+      AsyncServerSocket::UniquePtr server(new AsyncServerSocket(evb));
+      server->bind(address);
+      server->listen(1024);
+      server->getAddress(&address);
+      for (size_t i = 0; i < kThreads; ++i) {
+        server->addAcceptCallback(
+            callbacks[i].get(), ioThreads[i]->getEventBase());
+      }
+      server->startAccepting();
+      servers.emplace_back(evb, std::move(server));
+    });
+  } else {
+    for (size_t i = 0; i < kThreads; ++i) {
+      auto* evb = ioThreads[i]->getEventBase();
+      evb->runInEventBaseThreadAndWait([&] {
+        AsyncServerSocket::UniquePtr server(new AsyncServerSocket(evb));
+        server->setReusePortEnabled(true);
+        server->setIoUringAcceptEnabled(mode == Mode::kReusePortIoUring);
+        server->bind(address);
+        server->listen(1024);
+        server->getAddress(&address);
+        server->addAcceptCallback(callbacks[i].get(), nullptr);
+        server->startAccepting();
+        servers.emplace_back(evb, std::move(server));
+      });
+    }
+  }
+  suspender.dismiss();
+
+  size_t started = 0;
+  std::deque<std::pair<NetworkSocket, uint16_t>> clients;
+  while (connections.numAccepted.load(std::memory_order_acquire) < iters) {
+    auto accepted = connections.numAccepted.load(std::memory_order_acquire);
+    while (started < iters && started - accepted < kWindow) {
+      clients.push_back(startConnect(connections, address));
+      ++started;
+    }
+    // Close the client end of connections in order once they are accepted.
+    while (!clients.empty() &&
+           connections.accepted[clients.front().second].load(
+               std::memory_order_acquire)) {
+      netops::close(clients.front().first);
+      clients.pop_front();
+    }
+    std::this_thread::yield();
+  }
+
+  suspender.rehire();
+  for (auto& client : clients) {
+    netops::close(client.first);
+  }
+  for (auto& [evb, server] : servers) {
+    evb->runInEventBaseThreadAndWait([&server = server] { server.reset(); });
+  }
+  std::vector<int64_t> latenciesNs;
+  for (auto& callback : callbacks) {
+    latenciesNs.insert(
+        latenciesNs.end(),
+        callback->latenciesNs.begin(),
+        callback->latenciesNs.end());
+  }
+  auto p99 = latenciesNs.begin() + latenciesNs.size() * 99 / 100;
+  std::nth_element(latenciesNs.begin(), p99, latenciesNs.end());
+  counters["p99_accept_us"] = UserMetric(double(*p99) / 1000);
+}
+
+} // namespace
+
+BENCHMARK_COUNTERS(acceptorThread, counters, iters) {
+  storm(counters, iters, Mode::kAcceptorThread);
+}
+
+BENCHMARK_COUNTERS_RELATIVE(reusePort, counters, iters) {
+  storm(counters, iters, Mode::kReusePort);
+}
+
+BENCHMARK_COUNTERS_RELATIVE(reusePortIoUring, counters, iters) {
+  storm(counters, iters, Mode::kReusePortIoUring);
+}
+
+int main(int argc, char** argv) {
+  folly::gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/io/async/AsyncSocket.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/IoUringBackend.h>
+#include <folly/net/NetOps.h>
+#include <folly/portability/GFlags.h>
+#include <folly/portability/Sockets.h>
+
+FOLLY_GFLAGS_DEFINE_uint32(
+    sockets, 10000, "Number of sockets each message is fanned out to");
+
+using namespace folly;
+
+// Each iteration is one message written to one socket, as a pub/sub server
+// fanning a message out to all its subscribers would: a round writes one
+// message to each of --sockets sockets, then runs the loop until all the
+// writes have completed. The iterations per second are the messages per
+// second; syscalls_per_msg counts the sendmsg() calls made inline by
+// AsyncSocket plus the io_uring submissions. Needs twice --sockets fds.
+namespace {
+
+constexpr size_t kMessageSize = 64;
+
+enum class Mode {
+  // Inline sendmsg() per write, on the default (epoll) backend.
+  kEpoll,
+  // Inline sendmsg() per write, on an io_uring backend.
+  kIoUring,
+  // Writes queued as io_uring sendmsg SQEs, submitted once per loop.
+  kIoUringBatched,
+};
+
+class CountingWriteCallback : public AsyncWriter::WriteCallback {
+ public:
+  void writeSuccess() noexcept override { ++done; }
+  void writeErr(size_t, const AsyncSocketException& ex) noexcept override {
+    LOG(FATAL) << "write failed: " << ex.what();
+  }
+
+  size_t done{0};
+};
+
+std::unique_ptr<EventBase> makeEventBase(Mode mode) {
+#if FOLLY_HAS_LIBURING
+  if (mode != Mode::kEpoll && IoUringBackend::isAvailable()) {
+    return std::make_unique<EventBase>(EventBase::Options().setBackendFactory(
+        [mode]() -> std::unique_ptr<EventBaseBackendBase> {
+          IoUringBackend::Options options;
+          options.setCapacity(4096).setMaxSubmit(4096).setBatchSocketWrites(
+              mode == Mode::kIoUringBatched);
+          return std::make_unique<IoUringBackend>(std::move(options));
+        }));
+  }
+#else
+  (void)mode;
+#endif
+  return std::make_unique<EventBase>();
+}
+
+std::optional<uint64_t> getNumSubmitCalls(EventBase& evb) {
+#if FOLLY_HAS_LIBURING
+  if (auto* backend = dynamic_cast<IoUringBackend*>(evb.getBackend())) {
+    return backend->getNumSubmitCalls();
+  }
+#else
+  (void)evb;
+#endif
+  return std::nullopt;
+}
+
+void fanOut(UserCounters& counters, size_t iters, Mode mode) {
+  BenchmarkSuspender suspender;
+  auto evb = makeEventBase(mode);
+  std::vector<AsyncSocket::UniquePtr> sockets;
+  std::vector<NetworkSocket> peers;
+  for (uint32_t i = 0; i < FLAGS_sockets; ++i) {
+    NetworkSocket fds[2];
+    CHECK_EQ(netops::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    CHECK_EQ(netops::set_socket_non_blocking(fds[1]), 0);
+    sockets.push_back(AsyncSocket::newSocket(evb.get(), fds[0]));
+    peers.push_back(fds[1]);
+  }
+  char message[kMessageSize] = {};
+  char drain[kMessageSize * 16];
+  CountingWriteCallback callback;
+  auto submitCalls = getNumSubmitCalls(*evb);
+  suspender.dismiss();
+
+  size_t sent = 0;
+  while (sent < iters) {
+    size_t n = std::min<size_t>(sockets.size(), iters - sent);
+    for (size_t i = 0; i < n; ++i) {
+      sockets[i]->write(&callback, message, kMessageSize);
+    }
+    sent += n;
+    while (callback.done < sent) {
+      evb->loopOnce();
+    }
+
+    suspender.rehire();
+    for (size_t i = 0; i < n; ++i) {
+      while (netops::recv(peers[i], drain, sizeof(drain), 0) > 0) {
+      }
+    }
+    suspender.dismiss();
+  }
+
+  suspender.rehire();
+  double syscalls =
+      mode == Mode::kIoUringBatched && submitCalls ? 0 : double(iters);
+  if (submitCalls) {
+    syscalls += double(*getNumSubmitCalls(*evb) - *submitCalls);
+  }
+  counters["syscalls_per_msg"] = UserMetric(syscalls / double(iters));
+  counters["io_uring"] = submitCalls ? 1 : 0;
+  sockets.clear();
+  for (auto fd : peers) {
+    netops::close(fd);
+  }
+}
+
+} // namespace
+
+BENCHMARK_COUNTERS(epoll, counters, iters) {
+  fanOut(counters, iters, Mode::kEpoll);
+}
+
+BENCHMARK_COUNTERS_RELATIVE(ioUring, counters, iters) {
+  fanOut(counters, iters, Mode::kIoUring);
+}
+
+BENCHMARK_COUNTERS_RELATIVE(ioUringBatched, counters, iters) {
+  fanOut(counters, iters, Mode::kIoUringBatched);
+}
+
+int main(int argc, char** argv) {
+  folly::gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -20,11 +20,14 @@
 #include <sys/types.h>
 
 #include <time.h>
+#include <algorithm>
 #include <iostream>
 #include <memory>
+#include <set>
 #include <thread>
 
 #include <folly/ExceptionWrapper.h>
+#include <folly/FileUtil.h>
 #include <folly/Random.h>
 #include <folly/SocketAddress.h>
 #include <folly/io/IOBuf.h>
@@ -1195,6 +1198,294 @@ TEST_P(AsyncSocketTest, PartialWriteFiresWriteStartingOnce) {
   EXPECT_EQ(1, wcb.writeStartingInvocations);
 }
 
+/**
+ * With IoUringOptions::batchSocketWrites, the writes to many sockets in one
+ * loop iteration are sent with a single io_uring submission, in order per
+ * socket, and complete their callbacks from the loop.
+ */
+TEST(AsyncSocketIoUringTest, BatchedWritesAcrossSockets) {
+  std::unique_ptr<EventBase> evb;
+  try {
+    evb = std::make_unique<EventBase>(EventBase::Options{}.setBackendFactory(
+        []() -> std::unique_ptr<EventBaseBackendBase> {
+          IoUringBackend::Options options;
+          options.setBatchSocketWrites(true);
+          return std::make_unique<IoUringBackend>(std::move(options));
+        }));
+  } catch (IoUringBackend::NotAvailable const&) {
+    GTEST_SKIP() << "IoUringBackend not available";
+  }
+  auto* backend = dynamic_cast<IoUringBackend*>(evb->getBackend());
+  ASSERT_NE(backend, nullptr);
+
+  // Fewer than the default maxSubmit, so that one submission holds them all.
+  constexpr size_t kNumSockets = 64;
+  std::vector<NetworkSocket> peers;
+  std::vector<AsyncSocket::UniquePtr> sockets;
+  for (size_t i = 0; i < kNumSockets; ++i) {
+    NetworkSocket fds[2];
+    ASSERT_EQ(netops::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    sockets.push_back(AsyncSocket::newSocket(evb.get(), fds[0]));
+    peers.push_back(fds[1]);
+  }
+
+  std::vector<WriteCallback> first(kNumSockets);
+  std::vector<WriteCallback> second(kNumSockets);
+  for (size_t i = 0; i < kNumSockets; ++i) {
+    sockets[i]->write(&first[i], "hello ", 6);
+    sockets[i]->write(&second[i], "world", 5);
+    EXPECT_EQ(first[i].state, STATE_WAITING);
+  }
+
+  // Flush whatever the setup queued, then the writes.
+  auto submitCalls = backend->getNumSubmitCalls();
+  while (std::any_of(second.begin(), second.end(), [](const auto& wcb) {
+    return wcb.state == STATE_WAITING;
+  })) {
+    evb->loopOnce();
+  }
+  // About one submission for the first writes and one for the second,
+  // rather than a sendmsg() per write.
+  EXPECT_LE(backend->getNumSubmitCalls() - submitCalls, 6);
+
+  for (size_t i = 0; i < kNumSockets; ++i) {
+    EXPECT_EQ(first[i].state, STATE_SUCCEEDED);
+    EXPECT_EQ(second[i].state, STATE_SUCCEEDED);
+    char buf[16];
+    ASSERT_EQ(netops::recv(peers[i], buf, sizeof(buf), 0), 11);
+    EXPECT_EQ(std::string(buf, 11), "hello world");
+    netops::close(peers[i]);
+  }
+}
+
+namespace {
+
+// Writes files through performWrite(), like a TLS socket does.
+class NoSendFileSocket : public AsyncSocket {
+ public:
+  using AsyncSocket::AsyncSocket;
+
+ protected:
+  bool canSendFile() const override { return false; }
+};
+
+/**
+ * writeFile() sends a range of a file in order with the writes around it,
+ * across partial writes, and fails the write if the file is too short.
+ */
+void testWriteFile(EventBase& evb, bool sendFile) {
+  NetworkSocket fds[2];
+  ASSERT_EQ(netops::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  ASSERT_EQ(netops::set_socket_non_blocking(fds[1]), 0);
+  auto socket = sendFile
+      ? AsyncSocket::newSocket(&evb, fds[0])
+      : AsyncSocket::UniquePtr(new NoSendFileSocket(&evb, fds[0]));
+
+  // Much larger than the socket buffers, so it takes many partial writes.
+  constexpr size_t kFileSize = 4 * 1024 * 1024;
+  constexpr size_t kOffset = 1000;
+  std::string contents(kFileSize, '\0');
+  for (size_t i = 0; i < kFileSize; ++i) {
+    contents[i] = char('a' + i % 26);
+  }
+  TemporaryFile file;
+  ASSERT_EQ(
+      writeFull(file.fd(), contents.data(), contents.size()),
+      ssize_t(contents.size()));
+  auto expected = "head" + contents.substr(kOffset) + "tail";
+
+  WriteCallback before;
+  WriteCallback fileWcb;
+  WriteCallback after;
+  socket->write(&before, "head", 4);
+  socket->writeFile(&fileWcb, file.fd(), kOffset, kFileSize - kOffset);
+  socket->write(&after, "tail", 4);
+
+  std::string received;
+  char buf[64 * 1024];
+  while (received.size() < expected.size()) {
+    evb.loopOnce(EVLOOP_NONBLOCK);
+    auto n = netops::recv(fds[1], buf, sizeof(buf), 0);
+    if (n > 0) {
+      received.append(buf, size_t(n));
+    }
+  }
+  while (after.state == STATE_WAITING) {
+    evb.loopOnce();
+  }
+  EXPECT_EQ(before.state, STATE_SUCCEEDED);
+  EXPECT_EQ(fileWcb.state, STATE_SUCCEEDED);
+  EXPECT_EQ(after.state, STATE_SUCCEEDED);
+  EXPECT_TRUE(received == expected);
+  EXPECT_EQ(socket->getAppBytesWritten(), expected.size());
+
+  // The file ends before the range does.
+  WriteCallback shortFile;
+  socket->writeFile(&shortFile, file.fd(), kFileSize - 10, 20);
+  while (shortFile.state == STATE_WAITING) {
+    evb.loopOnce();
+  }
+  EXPECT_EQ(shortFile.state, STATE_FAILED);
+  netops::close(fds[1]);
+}
+
+} // namespace
+
+TEST_P(AsyncSocketTest, WriteFile) {
+  testWriteFile(getEventBase(), /* sendFile */ true);
+}
+
+TEST_P(AsyncSocketTest, WriteFileBuffered) {
+  testWriteFile(getEventBase(), /* sendFile */ false);
+}
+
+namespace {
+
+// Stops using sendfile() once told to, like a socket starting TLS does, and
+// counts the bytes it writes through performWrite().
+class SwitchingSendFileSocket : public AsyncSocket {
+ public:
+  using AsyncSocket::AsyncSocket;
+
+  bool canSendFile() const override {
+    return sendFile && AsyncSocket::canSendFile();
+  }
+
+  bool sendFile{true};
+  size_t performWriteBytes{0};
+
+ protected:
+  WriteResult performWrite(
+      const iovec* vec,
+      uint32_t count,
+      WriteFlags flags,
+      uint32_t* countWritten,
+      uint32_t* partialWritten,
+      WriteRequestTag writeTag) override {
+    auto result = AsyncSocket::performWrite(
+        vec, count, flags, countWritten, partialWritten, writeTag);
+    if (result.writeReturn > 0) {
+      performWriteBytes += size_t(result.writeReturn);
+    }
+    return result;
+  }
+};
+
+} // namespace
+
+/**
+ * A queued writeFile() checks canSendFile() before each write, and sends the
+ * rest of the range through performWrite() once it no longer holds.
+ */
+TEST(AsyncSocketTest, WriteFileRechecksSendFile) {
+  EventBase evb;
+  NetworkSocket fds[2];
+  ASSERT_EQ(netops::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  ASSERT_EQ(netops::set_socket_non_blocking(fds[1]), 0);
+  auto* rawSocket = new SwitchingSendFileSocket(&evb, fds[0]);
+  AsyncSocket::UniquePtr socket(rawSocket);
+  if (!rawSocket->canSendFile()) {
+    GTEST_SKIP() << "sendfile() not supported";
+  }
+
+  constexpr size_t kFileSize = 4 * 1024 * 1024;
+  std::string contents(kFileSize, '\0');
+  for (size_t i = 0; i < kFileSize; ++i) {
+    contents[i] = char('a' + i % 26);
+  }
+  TemporaryFile file;
+  ASSERT_EQ(
+      writeFull(file.fd(), contents.data(), contents.size()),
+      ssize_t(contents.size()));
+
+  WriteCallback wcb;
+  socket->writeFile(&wcb, file.fd(), 0, kFileSize);
+  ASSERT_EQ(wcb.state, STATE_WAITING);
+  EXPECT_EQ(rawSocket->performWriteBytes, 0u);
+  rawSocket->sendFile = false;
+
+  std::string received;
+  char buf[64 * 1024];
+  while (received.size() < kFileSize) {
+    evb.loopOnce(EVLOOP_NONBLOCK);
+    auto n = netops::recv(fds[1], buf, sizeof(buf), 0);
+    if (n > 0) {
+      received.append(buf, size_t(n));
+    }
+  }
+  while (wcb.state == STATE_WAITING) {
+    evb.loopOnce();
+  }
+  EXPECT_EQ(wcb.state, STATE_SUCCEEDED);
+  EXPECT_TRUE(received == contents);
+  // Whatever sendfile() had not sent went through performWrite().
+  EXPECT_GT(rawSocket->performWriteBytes, 0u);
+  EXPECT_LT(rawSocket->performWriteBytes, kFileSize);
+  EXPECT_EQ(socket->getAppBytesWritten(), kFileSize);
+  netops::close(fds[1]);
+}
+
+/**
+ * On io_uring sockets, which write files a chunk at a time, the writes issued
+ * after writeFile(), and shutdownWrite(), wait for its last chunk.
+ */
+TEST(AsyncSocketIoUringTest, WriteFileHoldsLaterWrites) {
+  std::unique_ptr<EventBase> evb;
+  try {
+    evb = std::make_unique<EventBase>(EventBase::Options{}.setBackendFactory(
+        []() -> std::unique_ptr<EventBaseBackendBase> {
+          return std::make_unique<IoUringBackend>(IoUringBackend::Options{});
+        }));
+  } catch (IoUringBackend::NotAvailable const&) {
+    GTEST_SKIP() << "IoUringBackend not available";
+  }
+  NetworkSocket fds[2];
+  ASSERT_EQ(netops::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  ASSERT_EQ(netops::set_socket_non_blocking(fds[1]), 0);
+  auto socket = AsyncSocket::newSocket(evb.get(), fds[0]);
+
+  // Several chunks.
+  constexpr size_t kFileSize = 4 * AsyncSocket::kFileWriteChunkSize + 1000;
+  std::string contents(kFileSize, '\0');
+  for (size_t i = 0; i < kFileSize; ++i) {
+    contents[i] = char('a' + i % 26);
+  }
+  TemporaryFile file;
+  ASSERT_EQ(
+      writeFull(file.fd(), contents.data(), contents.size()),
+      ssize_t(contents.size()));
+  auto expected = contents + "one" + contents.substr(10, 20) + "two";
+
+  WriteCallback firstFile;
+  WriteCallback one;
+  WriteCallback secondFile;
+  WriteCallback two;
+  socket->writeFile(&firstFile, file.fd(), 0, kFileSize);
+  socket->write(&one, "one", 3);
+  socket->writeFile(&secondFile, file.fd(), 10, 20);
+  socket->write(&two, "two", 3);
+  socket->shutdownWrite();
+
+  std::string received;
+  char buf[64 * 1024];
+  while (true) {
+    evb->loopOnce(EVLOOP_NONBLOCK);
+    auto n = netops::recv(fds[1], buf, sizeof(buf), 0);
+    if (n == 0) {
+      break;
+    }
+    if (n > 0) {
+      received.append(buf, size_t(n));
+    }
+  }
+  EXPECT_EQ(firstFile.state, STATE_SUCCEEDED);
+  EXPECT_EQ(one.state, STATE_SUCCEEDED);
+  EXPECT_EQ(secondFile.state, STATE_SUCCEEDED);
+  EXPECT_EQ(two.state, STATE_SUCCEEDED);
+  EXPECT_TRUE(received == expected);
+  netops::close(fds[1]);
+}
+
 /**
  * Test calling close() immediately after connect()
  */
@@ -3484,6 +3775,106 @@ TEST_P(AsyncSocketTest, ServerExistingSocket) {
   }
 }
 
+TEST_P(AsyncSocketTest, ServerIoUringAccept) {
+  EventBase& eventBase = getEventBase();
+
+  // On the default backend this falls back to accept()
+  auto serverSocket = AsyncServerSocket::newSocket(&eventBase);
+  serverSocket->setIoUringAcceptEnabled(true);
+  serverSocket->bind(folly::SocketAddress("127.0.0.1", 0));
+  serverSocket->listen(16);
+  folly::SocketAddress serverAddress;
+  serverSocket->getAddress(&serverAddress);
+
+  constexpr size_t kNumClients = 3;
+  TestAcceptCallback acceptCallback;
+  size_t accepted = 0;
+  acceptCallback.setConnectionAcceptedFn(
+      [&](NetworkSocket /* fd */, const folly::SocketAddress& /* addr */) {
+        if (++accepted == kNumClients) {
+          serverSocket->removeAcceptCallback(&acceptCallback, &eventBase);
+        }
+      });
+  acceptCallback.setAcceptErrorFn([&](const std::exception& /* ex */) {
+    serverSocket->removeAcceptCallback(&acceptCallback, &eventBase);
+  });
+  serverSocket->addAcceptCallback(&acceptCallback, &eventBase);
+  serverSocket->startAccepting();
+
+  std::vector<AsyncSocket::UniquePtr> clients;
+  for (size_t i = 0; i < kNumClients; ++i) {
+    clients.emplace_back(new AsyncSocket(&eventBase, serverAddress));
+  }
+  eventBase.loop();
+
+  auto* events = acceptCallback.getEvents();
+  ASSERT_EQ(events->size(), kNumClients + 2);
+  ASSERT_EQ(events->front().type, TestAcceptCallback::TYPE_START);
+  ASSERT_EQ(events->back().type, TestAcceptCallback::TYPE_STOP);
+  std::set<folly::SocketAddress> clientAddresses;
+  for (auto& client : clients) {
+    folly::SocketAddress addr;
+    client->getLocalAddress(&addr);
+    clientAddresses.insert(addr);
+  }
+  for (size_t i = 1; i <= kNumClients; ++i) {
+    auto& event = events->at(i);
+    ASSERT_EQ(event.type, TestAcceptCallback::TYPE_ACCEPT);
+    EXPECT_EQ(clientAddresses.count(event.address), 1);
+#ifndef _WIN32
+    int flags = fcntl(event.fd.toFd(), F_GETFL, 0);
+    EXPECT_EQ(flags & O_NONBLOCK, O_NONBLOCK);
+#endif
+    netops::close(event.fd);
+  }
+}
+
+#if defined(__linux__)
+TEST_P(AsyncSocketTest, ServerReusePortCpuSteering) {
+  EventBase& eventBase = getEventBase();
+
+  // Two listeners in one reuse port group, as two IO threads would have
+  std::vector<std::shared_ptr<AsyncServerSocket>> serverSockets;
+  folly::SocketAddress serverAddress("127.0.0.1", 0);
+  for (int i = 0; i < 2; ++i) {
+    auto serverSocket = AsyncServerSocket::newSocket(&eventBase);
+    serverSocket->setReusePortEnabled(true);
+    serverSocket->setIoUringAcceptEnabled(true);
+    serverSocket->bind(serverAddress);
+    serverSocket->listen(16);
+    serverSocket->getAddress(&serverAddress);
+    serverSockets.push_back(std::move(serverSocket));
+  }
+  serverSockets[0]->attachReusePortCpuSteering();
+
+  constexpr size_t kNumClients = 8;
+  size_t accepted = 0;
+  TestAcceptCallback acceptCallback;
+  acceptCallback.setConnectionAcceptedFn(
+      [&](NetworkSocket fd, const folly::SocketAddress& /* addr */) {
+        netops::close(fd);
+        if (++accepted == kNumClients) {
+          for (auto& serverSocket : serverSockets) {
+            serverSocket->removeAcceptCallback(&acceptCallback, nullptr);
+          }
+        }
+      });
+  for (auto& serverSocket : serverSockets) {
+    serverSocket->addAcceptCallback(&acceptCallback, nullptr);
+    serverSocket->startAccepting();
+  }
+
+  std::vector<AsyncSocket::UniquePtr> clients;
+  for (size_t i = 0; i < kNumClients; ++i) {
+    clients.emplace_back(new AsyncSocket(&eventBase, serverAddress));
+  }
+  eventBase.loop();
+
+  // Every connection is accepted by one of the listeners
+  EXPECT_EQ(accepted, kNumClients);
+}
+#endif
+
 TEST_P(AsyncSocketTest, UnixDomainSocketTest) {
   EventBase& eventBase = getEventBase();
 
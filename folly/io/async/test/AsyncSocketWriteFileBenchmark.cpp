@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/FileUtil.h>
+#include <folly/io/IOBuf.h>
+#include <folly/io/async/AsyncSocket.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/net/NetOps.h>
+#include <folly/portability/GFlags.h>
+#include <folly/portability/Sockets.h>
+#include <folly/portability/SysResource.h>
+#include <folly/testing/TestUtil.h>
+
+FOLLY_GFLAGS_DEFINE_uint32(
+    file_mb, 64, "Size of the (page cache resident) file that is sent, in MiB");
+
+using namespace folly;
+
+// Each iteration sends one kChunk slice of the file over a loopback TCP
+// connection, drained by a reader thread, with up to kWindow writes queued:
+// either with AsyncSocket::writeFile() (sendfile()) or by reading the slice
+// into an IOBuf and writing that, as a server without writeFile() would.
+// cpu_ms_per_gb is the CPU time of the whole process, sender and reader.
+namespace {
+
+constexpr size_t kChunk = 1 << 20;
+constexpr size_t kWindow = 4;
+
+class CountingWriteCallback : public AsyncWriter::WriteCallback {
+ public:
+  void writeSuccess() noexcept override { ++done; }
+  void writeErr(size_t, const AsyncSocketException& ex) noexcept override {
+    LOG(FATAL) << "write failed: " << ex.what();
+  }
+
+  size_t done{0};
+};
+
+double cpuSeconds() {
+  rusage usage;
+  CHECK_EQ(getrusage(RUSAGE_SELF, &usage), 0);
+  auto seconds = [](const timeval& tv) {
+    return double(tv.tv_sec) + double(tv.tv_usec) / 1e6;
+  };
+  return seconds(usage.ru_utime) + seconds(usage.ru_stime);
+}
+
+// A connected loopback TCP pair: {sender, receiver}.
+std::pair<NetworkSocket, NetworkSocket> connectLoopback() {
+  auto listener = netops::socket(AF_INET, SOCK_STREAM, 0);
+  CHECK_NE(listener, NetworkSocket());
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t len = sizeof(addr);
+  CHECK_EQ(netops::bind(listener, (sockaddr*)&addr, len), 0);
+  CHECK_EQ(netops::listen(listener, 1), 0);
+  CHECK_EQ(netops::getsockname(listener, (sockaddr*)&addr, &len), 0);
+  auto sender = netops::socket(AF_INET, SOCK_STREAM, 0);
+  CHECK_EQ(netops::connect(sender, (sockaddr*)&addr, len), 0);
+  auto receiver = netops::accept(listener, nullptr, nullptr);
+  CHECK_NE(receiver, NetworkSocket());
+  netops::close(listener);
+  CHECK_EQ(netops::set_socket_non_blocking(sender), 0);
+  return {sender, receiver};
+}
+
+void send(UserCounters& counters, size_t iters, bool useWriteFile) {
+  BenchmarkSuspender suspender;
+  size_t fileSize = size_t(FLAGS_file_mb) * kChunk;
+  test::TemporaryFile file;
+  {
+    std::string contents(fileSize, 'x');
+    CHECK_EQ(
+        writeFull(file.fd(), contents.data(), contents.size()),
+        ssize_t(contents.size()));
+  }
+  EventBase evb;
+  auto [sender, receiver] = connectLoopback();
+  auto socket = AsyncSocket::newSocket(&evb, sender);
+  std::thread reader([receiver = receiver] {
+    std::vector<char> buf(256 * 1024);
+    while (netops::recv(receiver, buf.data(), buf.size(), 0) > 0) {
+    }
+  });
+  CountingWriteCallback callback;
+  auto cpuStart = cpuSeconds();
+  suspender.dismiss();
+
+  size_t sent = 0;
+  while (callback.done < iters) {
+    while (sent < iters && sent - callback.done < kWindow) {
+      off_t offset = off_t((sent * kChunk) % fileSize);
+      if (useWriteFile) {
+        socket->writeFile(&callback, file.fd(), offset, kChunk);
+      } else {
+        auto buf = IOBuf::create(kChunk);
+        CHECK_EQ(
+            preadFull(file.fd(), buf->writableData(), kChunk, offset),
+            ssize_t(kChunk));
+        buf->append(kChunk);
+        socket->writeChain(&callback, std::move(buf));
+      }
+      ++sent;
+    }
+    evb.loopOnce();
+  }
+
+  suspender.rehire();
+  auto gb = double(iters * kChunk) / double(1 << 30);
+  counters["cpu_ms_per_gb"] = UserMetric((cpuSeconds() - cpuStart) * 1e3 / gb);
+  socket.reset();
+  reader.join();
+  netops::close(receiver);
+}
+
+} // namespace
+
+BENCHMARK_COUNTERS(readAndWrite, counters, iters) {
+  send(counters, iters, false);
+}
+
+BENCHMARK_COUNTERS_RELATIVE(writeFile, counters, iters) {
+  send(counters, iters, true);
+}
+
+int main(int argc, char** argv) {
+  folly::gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/SocketAddress.h>
+#include <folly/io/IOBuf.h>
+#include <folly/io/async/AsyncUDPServerSocket.h>
+#include <folly/io/async/AsyncUDPSocket.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/portability/GFlags.h>
+
+using namespace folly;
+
+// Each iteration is one QUIC-sized datagram sent by a client and handed to a
+// listener by an AsyncUDPServerSocket over loopback. The client, the server
+// socket and the listener share one thread, so the iterations per second are
+// the packets per second a single core can push through the receive path
+// (plus the cost of sending them).
+namespace {
+
+constexpr size_t kPacketSize = 1200;
+// Datagrams sent before draining the server, small enough to never overflow
+// the default receive buffer.
+constexpr size_t kBurst = 32;
+
+class CountingListener : public AsyncUDPServerSocket::Callback {
+ public:
+  void onListenStarted() noexcept override {}
+
+  void onListenStopped() noexcept override {}
+
+  void onDataAvailable(
+      std::shared_ptr<AsyncUDPSocket>,
+      const SocketAddress&,
+      std::unique_ptr<IOBuf> buf,
+      bool,
+      OnDataAvailableParams params) noexcept override {
+    // Without batched reads a coalesced read is delivered whole, so split it
+    // into its packets here, as the server socket does with batched reads.
+    size_t len = buf->length();
+    size_t segment = params.gro > 0 ? size_t(params.gro) : len;
+    for (size_t offset = 0; offset < len; offset += segment) {
+      auto packet = buf->cloneOne();
+      packet->trimStart(offset);
+      packet->trimEnd(packet->length() - std::min(segment, len - offset));
+      ++packets;
+    }
+  }
+
+  size_t packets{0};
+};
+
+void receive(size_t iters, size_t batch, bool gro) {
+  BenchmarkSuspender suspender;
+  EventBase evb;
+  AsyncUDPServerSocket server(&evb, gro ? 64 * 1024 : kPacketSize);
+  server.bind(SocketAddress("127.0.0.1", 0));
+  if (gro) {
+    CHECK(server.getSocket()->setGRO(true));
+  }
+  server.setBatchedReads(batch);
+  CountingListener listener;
+  server.addListener(&evb, &listener);
+  server.listen();
+
+  AsyncUDPSocket client(&evb);
+  client.bind(SocketAddress("127.0.0.1", 0));
+  auto payload = IOBuf::create(kPacketSize * kBurst);
+  payload->append(kPacketSize * kBurst);
+  std::fill(payload->writableData(), payload->writableTail(), 'a');
+  std::vector<std::unique_ptr<IOBuf>> bufs;
+  for (size_t i = 0; i < kBurst; ++i) {
+    bufs.push_back(IOBuf::wrapBuffer(
+        payload->data() + i * kPacketSize, kPacketSize));
+  }
+  std::vector<SocketAddress> addrs{server.address()};
+  suspender.dismiss();
+
+  size_t sent = 0;
+  while (sent < iters) {
+    size_t n = std::min(kBurst, iters - sent);
+    if (gro) {
+      // One GSO send, which loopback hands to the server still coalesced.
+      auto buf = IOBuf::wrapBuffer(payload->data(), n * kPacketSize);
+      client.writeGSO(
+          server.address(),
+          buf,
+          AsyncUDPSocket::WriteOptions(int(kPacketSize), false));
+    } else {
+      client.writem(range(addrs), bufs.data(), n);
+    }
+    sent += n;
+    while (listener.packets < sent) {
+      evb.loopOnce();
+    }
+  }
+
+  suspender.rehire();
+  server.close();
+  evb.loopOnce(EVLOOP_NONBLOCK);
+}
+
+} // namespace
+
+BENCHMARK(perPacket, iters) {
+  receive(iters, 0, false);
+}
+
+BENCHMARK_RELATIVE(batched8, iters) {
+  receive(iters, 8, false);
+}
+
+BENCHMARK_RELATIVE(batched32, iters) {
+  receive(iters, 32, false);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(perPacketGro, iters) {
+  receive(iters, 0, true);
+}
+
+BENCHMARK_RELATIVE(batched8Gro, iters) {
+  receive(iters, 8, true);
+}
+
+int main(int argc, char** argv) {
+  folly::gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
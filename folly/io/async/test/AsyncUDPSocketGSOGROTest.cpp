@@ -201,6 +201,7 @@ class UDPServer {
 
     auto s = socket_->getSocket();
     s->setGRO(true);
+    socket_->setBatchedReads(batchedReads_);
 
     acceptors_.reserve(evbs_.size());
     threads_.reserve(evbs_.size());
@@ -242,6 +243,8 @@ class UDPServer {
 
   void resumeAccepting() { socket_->resumeAccepting(); }
 
+  void setBatchedReads(size_t maxPackets) { batchedReads_ = maxPackets; }
+
  private:
   EventBase* const evb_{nullptr};
   const folly::SocketAddress addr_;
@@ -250,6 +253,7 @@ class UDPServer {
   std::vector<std::thread> threads_;
   std::vector<folly::EventBase> evbs_;
   std::vector<UDPAcceptor> acceptors_;
+  size_t batchedReads_{0};
 };
 
 class UDPClient : private AsyncUDPSocket::ReadCallback, private AsyncTimeout {
@@ -486,6 +490,25 @@ TEST_F(AsyncSocketGSOIntegrationTest, PingPongRequestGSO) {
   ASSERT_TRUE(testData.checkOut());
 }
 
+TEST_F(AsyncSocketGSOIntegrationTest, PingPongGlobalGSOBatchedReads) {
+  int gso = 1000;
+  int in[] = {100, 1200, 3000, 200, 100, 300};
+  int expected[] = {1000, 1000, 1000, 1000, 900};
+  TestData testData(
+      gso,
+      true /*useSocketGSO*/,
+      in,
+      sizeof(in) / sizeof(in[0]),
+      expected,
+      sizeof(expected) / sizeof(expected[0]));
+  ASSERT_TRUE(testData.checkIn());
+  // The server splits the coalesced datagrams before the acceptor sees them.
+  server->setBatchedReads(8);
+  startServer();
+  auto pingClient = performPingPongTest(testData, folly::none);
+  ASSERT_TRUE(testData.checkOut());
+}
+
 TEST_F(AsyncSocketGSOIntegrationTest, MultiPingPongGlobalGSO) {
   std::vector<folly::AsyncUDPSocket::WriteOptions> optionsVec = {
       {1000, false}, {800, false}, {1100, false}, {1200, false}};
@@ -113,6 +113,7 @@ class UDPServer {
 
     socket_ = std::make_unique<AsyncUDPServerSocket>(evb_, 1500);
     socket_->setReusePort(true);
+    socket_->setBatchedReads(batchedReads_);
 
     try {
       socket_->bind(addr_);
@@ -169,6 +170,8 @@ class UDPServer {
     changePortForWrites_ = changePortForWrites;
   }
 
+  void setBatchedReads(size_t maxPackets) { batchedReads_ = maxPackets; }
+
  private:
   EventBase* const evb_{nullptr};
   const folly::SocketAddress addr_;
@@ -180,6 +183,7 @@ class UDPServer {
   // freed UDPAcceptor
   std::vector<folly::EventBase> evbs_;
   bool changePortForWrites_{true};
+  size_t batchedReads_{0};
 };
 
 enum class BindSocket { YES, NO };
@@ -643,6 +647,14 @@ TEST_F(AsyncSocketIntegrationTest, PingPongRecvTos) {
   ASSERT_GT(pingClient->tosMessagesRecvd(), 0);
 }
 
+TEST_F(AsyncSocketIntegrationTest, PingPongBatchedReads) {
+  server->setBatchedReads(16);
+  startServer();
+  auto pingClient = performPingPongTest(server->address(), folly::none);
+  // This should succeed.
+  ASSERT_GT(pingClient->pongRecvd(), 0);
+}
+
 class ConnectedAsyncSocketIntegrationTest
     : public AsyncSocketIntegrationTest,
       public WithParamInterface<BindSocket> {};
@@ -714,6 +726,66 @@ TEST_F(AsyncSocketIntegrationTest, PingPongPauseResumeListening) {
   ASSERT_GT(pingClient->pongRecvd(), 0);
 }
 
+class BatchAcceptor : public AsyncUDPServerSocket::Callback {
+ public:
+  void onListenStarted() noexcept override {}
+
+  void onListenStopped() noexcept override {}
+
+  void onDataAvailable(
+      std::shared_ptr<folly::AsyncUDPSocket>,
+      const folly::SocketAddress&,
+      std::unique_ptr<folly::IOBuf>,
+      bool,
+      OnDataAvailableParams) noexcept override {
+    ADD_FAILURE() << "batched reads should use onDataAvailableBatch";
+  }
+
+  void onDataAvailableBatch(
+      std::shared_ptr<folly::AsyncUDPSocket>,
+      std::vector<AsyncUDPServerSocket::Datagram> datagrams) noexcept override {
+    batchSizes.push_back(datagrams.size());
+    for (auto& datagram : datagrams) {
+      EXPECT_FALSE(datagram.truncated);
+      bufs.push_back(std::move(datagram.buf));
+    }
+  }
+
+  std::vector<size_t> batchSizes;
+  std::vector<std::unique_ptr<folly::IOBuf>> bufs;
+};
+
+TEST(AsyncUDPServerSocketTest, BatchedReads) {
+  EventBase evb;
+  AsyncUDPServerSocket server(&evb, 1500);
+  server.bind(folly::SocketAddress("127.0.0.1", 0));
+  server.setBatchedReads(4);
+  BatchAcceptor acceptor;
+  server.addListener(&evb, &acceptor);
+  server.listen();
+
+  AsyncUDPSocket client(&evb);
+  client.bind(folly::SocketAddress("127.0.0.1", 0));
+  constexpr size_t kNumPackets = 10;
+  for (size_t i = 0; i < kNumPackets; ++i) {
+    client.write(
+        server.address(), folly::IOBuf::copyBuffer(folly::to<std::string>(i)));
+  }
+
+  while (acceptor.bufs.size() < kNumPackets) {
+    evb.loopOnce();
+  }
+  // All datagrams were queued before the first read, so they are read four
+  // at a time, in order, and each batch shares one slab.
+  EXPECT_THAT(acceptor.batchSizes, ElementsAre(4, 4, 2));
+  for (size_t i = 0; i < kNumPackets; ++i) {
+    EXPECT_EQ(folly::to<std::string>(i), acceptor.bufs[i]->to<std::string>());
+    EXPECT_TRUE(acceptor.bufs[i]->isSharedOne());
+  }
+  server.close();
+  evb.loopOnce(EVLOOP_NONBLOCK);
+}
+
 class MockErrMessageCallback : public AsyncUDPSocket::ErrMessageCallback {
  public:
   ~MockErrMessageCallback() override = default;
@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include <folly/Benchmark.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/EventHandler.h>
+#include <folly/io/async/ScopedEventBaseThread.h>
+#include <folly/net/NetOps.h>
+#include <folly/portability/GFlags.h>
+#include <folly/portability/Sockets.h>
+
+using namespace folly;
+
+// Each iteration is one round trip between the benchmark thread and an
+// EventBase thread that is otherwise idle, so that every request finds the
+// loop waiting for work: either blocked in the backend, or busy polling.
+// Needs at least two cores, or the spinning loop competes with the client.
+namespace {
+
+enum class Mode {
+  kBlocking,
+  kBusyPoll,
+  kAdaptiveBusyPoll,
+};
+
+EventBase::Options eventBaseOptions(Mode mode) {
+  EventBase::BusyPollOptions busyPoll;
+  if (mode != Mode::kBlocking) {
+    busyPoll.setMaxSpin(std::chrono::microseconds(50))
+        .setAdaptive(mode == Mode::kAdaptiveBusyPoll);
+  }
+  return EventBase::Options().setBusyPoll(busyPoll);
+}
+
+void reportSpin(
+    UserCounters& counters,
+    const EventBase::BusyPollStats& stats,
+    std::chrono::steady_clock::duration elapsed) {
+  counters["spin_pct"] = UserMetric(
+      100.0 * double(stats.spinTime.count()) /
+      double(std::chrono::nanoseconds(elapsed).count()));
+  counters["idle_spin_pct"] = UserMetric(
+      100.0 * double(stats.idleSpinTime.count()) /
+      double(std::chrono::nanoseconds(elapsed).count()));
+}
+
+// A task handed to the loop with runInEventBaseThread(), which the client
+// waits for by spinning, so that only the loop's wakeup is measured.
+void pingPongQueue(UserCounters& counters, size_t iters, Mode mode) {
+  BenchmarkSuspender suspender;
+  ScopedEventBaseThread thread(eventBaseOptions(mode), nullptr, "server");
+  auto* evb = thread.getEventBase();
+  std::atomic<bool> done{false};
+  auto start = std::chrono::steady_clock::now();
+  suspender.dismiss();
+
+  for (size_t i = 0; i < iters; ++i) {
+    done.store(false, std::memory_order_relaxed);
+    evb->runInEventBaseThread(
+        [&] { done.store(true, std::memory_order_release); });
+    while (!done.load(std::memory_order_acquire)) {
+    }
+  }
+
+  suspender.rehire();
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  evb->runInEventBaseThreadAndWait(
+      [&] { reportSpin(counters, evb->getBusyPollStats(), elapsed); });
+}
+
+class EchoHandler : public EventHandler {
+ public:
+  EchoHandler(EventBase* evb, NetworkSocket fd)
+      : EventHandler(evb, fd), fd_(fd) {}
+
+  void handlerReady(uint16_t /* events */) noexcept override {
+    char c;
+    while (netops::recv(fd_, &c, 1, 0) == 1) {
+      CHECK_EQ(netops::send(fd_, &c, 1, 0), 1);
+    }
+  }
+
+ private:
+  NetworkSocket fd_;
+};
+
+// A byte echoed back by a handler over a socket pair, which the client
+// waits for in a blocking read, as an RPC client would.
+void pingPongSocket(UserCounters& counters, size_t iters, Mode mode) {
+  BenchmarkSuspender suspender;
+  NetworkSocket fds[2];
+  CHECK_EQ(netops::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  CHECK_EQ(netops::set_socket_non_blocking(fds[1]), 0);
+  ScopedEventBaseThread thread(eventBaseOptions(mode), nullptr, "server");
+  auto* evb = thread.getEventBase();
+  std::unique_ptr<EchoHandler> handler;
+  evb->runInEventBaseThreadAndWait([&] {
+    handler = std::make_unique<EchoHandler>(evb, fds[1]);
+    handler->registerHandler(EventHandler::READ | EventHandler::PERSIST);
+  });
+  auto start = std::chrono::steady_clock::now();
+  suspender.dismiss();
+
+  for (size_t i = 0; i < iters; ++i) {
+    char c = 'a';
+    CHECK_EQ(netops::send(fds[0], &c, 1, 0), 1);
+    CHECK_EQ(netops::recv(fds[0], &c, 1, 0), 1);
+  }
+
+  suspender.rehire();
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  evb->runInEventBaseThreadAndWait([&] {
+    reportSpin(counters, evb->getBusyPollStats(), elapsed);
+    handler.reset();
+  });
+  netops::close(fds[0]);
+  netops::close(fds[1]);
+}
+
+} // namespace
+
+BENCHMARK_COUNTERS(queueBlocking, counters, iters) {
+  pingPongQueue(counters, iters, Mode::kBlocking);
+}
+
+BENCHMARK_COUNTERS_RELATIVE(queueBusyPoll, counters, iters) {
+  pingPongQueue(counters, iters, Mode::kBusyPoll);
+}
+
+BENCHMARK_COUNTERS_RELATIVE(queueAdaptiveBusyPoll, counters, iters) {
+  pingPongQueue(counters, iters, Mode::kAdaptiveBusyPoll);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK_COUNTERS(socketBlocking, counters, iters) {
+  pingPongSocket(counters, iters, Mode::kBlocking);
+}
+
+BENCHMARK_COUNTERS_RELATIVE(socketBusyPoll, counters, iters) {
+  pingPongSocket(counters, iters, Mode::kBusyPoll);
+}
+
+BENCHMARK_COUNTERS_RELATIVE(socketAdaptiveBusyPoll, counters, iters) {
+  pingPongSocket(counters, iters, Mode::kAdaptiveBusyPoll);
+}
+
+int main(int argc, char** argv) {
+  folly::gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
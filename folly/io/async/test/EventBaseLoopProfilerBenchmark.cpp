@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <optional>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/EventBaseLoopProfiler.h>
+#include <folly/portability/GFlags.h>
+
+using namespace folly;
+
+// The cost of the loop profiler on the cheapest callbacks there are: each
+// iteration is one empty runInLoop() callback or runInEventBaseThread() task,
+// run in batches of kBatch per loop iteration.
+namespace {
+
+constexpr size_t kBatch = 1000;
+
+struct EmptyLoopCallback : EventBase::LoopCallback {
+  void runLoopCallback() noexcept override {}
+};
+
+void runLoopCallbacks(
+    size_t iters, std::optional<EventBaseLoopProfiler::Options> options) {
+  BenchmarkSuspender suspender;
+  EventBase evb;
+  if (options) {
+    evb.enableLoopProfiler(*options);
+  }
+  std::vector<EmptyLoopCallback> callbacks(kBatch);
+  suspender.dismiss();
+
+  for (size_t done = 0; done < iters; done += kBatch) {
+    for (size_t i = 0; i < std::min(kBatch, iters - done); ++i) {
+      evb.runInLoop(&callbacks[i]);
+    }
+    evb.loopOnce(EVLOOP_NONBLOCK);
+  }
+}
+
+void runTasks(
+    size_t iters, std::optional<EventBaseLoopProfiler::Options> options) {
+  BenchmarkSuspender suspender;
+  EventBase evb;
+  if (options) {
+    evb.enableLoopProfiler(*options);
+  }
+  suspender.dismiss();
+
+  for (size_t done = 0; done < iters; done += kBatch) {
+    for (size_t i = 0; i < std::min(kBatch, iters - done); ++i) {
+      evb.runInEventBaseThreadAlwaysEnqueue([] {});
+    }
+    evb.loopOnce(EVLOOP_NONBLOCK);
+  }
+}
+
+} // namespace
+
+BENCHMARK(loopCallbackNoProfiler, iters) {
+  runLoopCallbacks(iters, std::nullopt);
+}
+
+BENCHMARK_RELATIVE(loopCallbackSampleEvery64, iters) {
+  runLoopCallbacks(iters, EventBaseLoopProfiler::Options().setSampleRate(64));
+}
+
+BENCHMARK_RELATIVE(loopCallbackSampleAll, iters) {
+  runLoopCallbacks(iters, EventBaseLoopProfiler::Options());
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(taskNoProfiler, iters) {
+  runTasks(iters, std::nullopt);
+}
+
+BENCHMARK_RELATIVE(taskSampleEvery64, iters) {
+  runTasks(iters, EventBaseLoopProfiler::Options().setSampleRate(64));
+}
+
+BENCHMARK_RELATIVE(taskSampleAll, iters) {
+  runTasks(iters, EventBaseLoopProfiler::Options());
+}
+
+int main(int argc, char** argv) {
+  folly::gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
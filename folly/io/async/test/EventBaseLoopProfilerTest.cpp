@@ -0,0 +1,245 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <chrono>
+#include <thread>
+
+#include <folly/io/async/AsyncTimeout.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/EventBaseLoopProfiler.h>
+#include <folly/io/async/EventHandler.h>
+#include <folly/io/async/HHWheelTimer.h>
+#include <folly/net/NetOps.h>
+#include <folly/portability/GTest.h>
+#include <folly/portability/Sockets.h>
+
+using namespace folly;
+using namespace std::chrono_literals;
+
+using CallbackType = EventBaseLoopProfiler::CallbackType;
+
+namespace {
+
+constexpr auto kSlow = 20ms;
+
+struct SlowLoopCallback : EventBase::LoopCallback {
+  void runLoopCallback() noexcept override {
+    std::this_thread::sleep_for(kSlow);
+  }
+};
+
+struct SlowTimeout : AsyncTimeout {
+  using AsyncTimeout::AsyncTimeout;
+  void timeoutExpired() noexcept override {
+    std::this_thread::sleep_for(kSlow);
+  }
+};
+
+struct SlowWheelCallback : HHWheelTimer::Callback {
+  void timeoutExpired() noexcept override {
+    std::this_thread::sleep_for(kSlow);
+  }
+};
+
+struct DisablingWheelCallback : HHWheelTimer::Callback {
+  explicit DisablingWheelCallback(EventBase& evb) : evb_(evb) {}
+  void timeoutExpired() noexcept override { evb_.disableLoopProfiler(); }
+  EventBase& evb_;
+};
+
+struct SlowHandler : EventHandler {
+  SlowHandler(EventBase* evb, NetworkSocket fd) : EventHandler(evb, fd) {}
+  void handlerReady(uint16_t /* events */) noexcept override {
+    std::this_thread::sleep_for(kSlow);
+    unregisterHandler();
+  }
+};
+
+void expectSlowest(
+    const EventBaseLoopProfiler::Snapshot& snapshot,
+    CallbackType type,
+    const std::string& siteName) {
+  // The EventBase's own handlers and timeouts may be sampled too, but they
+  // are fast.
+  EXPECT_GE(snapshot[type].count, 1);
+  EXPECT_GE(snapshot[type].max, kSlow);
+  ASSERT_FALSE(snapshot.slowest.empty());
+  EXPECT_EQ(snapshot.slowest[0].type, type);
+  EXPECT_EQ(snapshot.slowest[0].siteName(), siteName);
+  EXPECT_GE(snapshot.slowest[0].duration, kSlow);
+}
+
+} // namespace
+
+TEST(EventBaseLoopProfilerTest, Disabled) {
+  EventBase evb;
+  EXPECT_EQ(evb.getLoopProfiler(), nullptr);
+  evb.runInLoop([] {});
+  evb.loopOnce();
+  evb.enableLoopProfiler();
+  ASSERT_NE(evb.getLoopProfiler(), nullptr);
+  evb.disableLoopProfiler();
+  EXPECT_EQ(evb.getLoopProfiler(), nullptr);
+}
+
+TEST(EventBaseLoopProfilerTest, LoopCallback) {
+  EventBase evb;
+  evb.enableLoopProfiler();
+  SlowLoopCallback callback;
+  evb.runInLoop(&callback);
+  evb.loopOnce(EVLOOP_NONBLOCK);
+
+  auto snapshot = evb.getLoopProfiler()->getSnapshot();
+  expectSlowest(
+      snapshot, CallbackType::Loop, "(anonymous namespace)::SlowLoopCallback");
+  EXPECT_GE(snapshot[CallbackType::Loop].estimateQuantile(0.5), kSlow);
+}
+
+TEST(EventBaseLoopProfilerTest, Task) {
+  EventBase evb;
+  evb.enableLoopProfiler();
+  evb.runInEventBaseThreadAlwaysEnqueue(
+      [] { std::this_thread::sleep_for(kSlow); });
+  evb.loopOnce(EVLOOP_NONBLOCK);
+
+  expectSlowest(
+      evb.getLoopProfiler()->getSnapshot(),
+      CallbackType::NotificationQueue,
+      "<task>");
+}
+
+TEST(EventBaseLoopProfilerTest, Timeout) {
+  EventBase evb;
+  evb.enableLoopProfiler();
+  SlowTimeout timeout(&evb);
+  timeout.scheduleTimeout(1);
+  evb.loop();
+
+  expectSlowest(
+      evb.getLoopProfiler()->getSnapshot(),
+      CallbackType::Timeout,
+      "(anonymous namespace)::SlowTimeout");
+}
+
+TEST(EventBaseLoopProfilerTest, WheelTimer) {
+  EventBase evb;
+  evb.enableLoopProfiler();
+  SlowWheelCallback callback;
+  evb.timer().scheduleTimeout(&callback, 1ms);
+  evb.loop();
+
+  auto snapshot = evb.getLoopProfiler()->getSnapshot();
+  EXPECT_EQ(snapshot[CallbackType::WheelTimer].count, 1);
+  EXPECT_GE(snapshot[CallbackType::WheelTimer].max, kSlow);
+  // The wheel's own timeout is as slow as the callbacks it runs.
+  EXPECT_GE(snapshot[CallbackType::Timeout].max, kSlow);
+  ASSERT_GE(snapshot.slowest.size(), 2);
+  EXPECT_EQ(snapshot.slowest[0].type, CallbackType::Timeout);
+  EXPECT_EQ(snapshot.slowest[1].type, CallbackType::WheelTimer);
+  EXPECT_EQ(
+      snapshot.slowest[1].siteName(),
+      "(anonymous namespace)::SlowWheelCallback");
+}
+
+TEST(EventBaseLoopProfilerTest, Event) {
+  EventBase evb;
+  evb.enableLoopProfiler();
+  NetworkSocket fds[2];
+  ASSERT_EQ(netops::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  SlowHandler handler(&evb, fds[1]);
+  handler.registerHandler(EventHandler::READ);
+  char c = 'a';
+  ASSERT_EQ(netops::send(fds[0], &c, 1, 0), 1);
+  evb.loop();
+  netops::close(fds[0]);
+  netops::close(fds[1]);
+
+  expectSlowest(
+      evb.getLoopProfiler()->getSnapshot(),
+      CallbackType::Event,
+      "(anonymous namespace)::SlowHandler");
+}
+
+TEST(EventBaseLoopProfilerTest, SampleRateAndTopN) {
+  EventBase evb;
+  evb.enableLoopProfiler(
+      EventBaseLoopProfiler::Options().setSampleRate(4).setTopN(2));
+  for (int i = 0; i < 100; ++i) {
+    evb.runInLoop([] {});
+  }
+  evb.loopOnce(EVLOOP_NONBLOCK);
+
+  auto snapshot = evb.getLoopProfiler()->getSnapshot();
+  EXPECT_EQ(snapshot[CallbackType::Loop].count, 25);
+  ASSERT_EQ(snapshot.slowest.size(), 2);
+  EXPECT_GE(snapshot.slowest[0].duration, snapshot.slowest[1].duration);
+  EXPECT_LE(snapshot.slowest[0].duration, snapshot[CallbackType::Loop].max);
+}
+
+TEST(EventBaseLoopProfilerTest, Reset) {
+  EventBase evb;
+  evb.enableLoopProfiler();
+  evb.runInLoop([] {});
+  evb.loopOnce(EVLOOP_NONBLOCK);
+  EXPECT_EQ(evb.getLoopProfiler()->getSnapshot()[CallbackType::Loop].count, 1);
+
+  evb.getLoopProfiler()->reset();
+  auto snapshot = evb.getLoopProfiler()->getSnapshot();
+  EXPECT_EQ(snapshot[CallbackType::Loop].count, 0);
+  EXPECT_TRUE(snapshot.slowest.empty());
+
+  // Re-enabling starts over too.
+  evb.runInLoop([] {});
+  evb.loopOnce(EVLOOP_NONBLOCK);
+  evb.enableLoopProfiler();
+  EXPECT_EQ(evb.getLoopProfiler()->getSnapshot()[CallbackType::Loop].count, 0);
+}
+
+TEST(EventBaseLoopProfilerTest, DisableFromCallback) {
+  EventBase evb;
+  evb.enableLoopProfiler();
+  evb.runInLoop([&] { evb.disableLoopProfiler(); });
+  evb.loopOnce(EVLOOP_NONBLOCK);
+  EXPECT_EQ(evb.getLoopProfiler(), nullptr);
+}
+
+TEST(EventBaseLoopProfilerTest, DisabledRecordsNothing) {
+  EventBase evb;
+  evb.enableLoopProfiler();
+  auto* profiler = evb.getLoopProfiler();
+  evb.disableLoopProfiler();
+  SlowLoopCallback callback;
+  evb.runInLoop(&callback);
+  evb.runInLoop([] {});
+  evb.loopOnce(EVLOOP_NONBLOCK);
+  auto snapshot = profiler->getSnapshot();
+  EXPECT_EQ(snapshot[CallbackType::Loop].count, 0);
+  EXPECT_TRUE(snapshot.slowest.empty());
+}
+
+TEST(EventBaseLoopProfilerTest, DisableFromWheelTimerCallback) {
+  EventBase evb;
+  evb.enableLoopProfiler();
+  auto* profiler = evb.getLoopProfiler();
+  // Both expire in the same tick; the second one runs after the first has
+  // disabled the profiler.
+  DisablingWheelCallback first(evb);
+  DisablingWheelCallback second(evb);
+  evb.timer().scheduleTimeout(&first, 1ms);
+  evb.timer().scheduleTimeout(&second, 1ms);
+  evb.loop();
+  EXPECT_EQ(profiler->getSnapshot()[CallbackType::WheelTimer].count, 1);
+}
@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <atomic>
 #include <iostream>
 #include <memory>
@@ -3063,6 +3064,65 @@ TYPED_TEST_P(EventBaseTest, RunInEventBaseThreadAlwaysEnqueueNoContextSwap) {
   EXPECT_EQ(1, trackingDataPtr->onUnsetCount);
 }
 
+TYPED_TEST_P(EventBaseTest, BusyPollRunInEventBaseThread) {
+  auto evbPtr = this->makeEventBase(EventBase::Options().setBusyPoll(
+      EventBase::BusyPollOptions().setMaxSpin(std::chrono::milliseconds(10))));
+  std::thread t([&] { evbPtr->loopForever(); });
+  evbPtr->waitUntilRunning();
+
+  // Ping-pong, so that most tasks arrive while the loop is spinning.
+  size_t count = 0;
+  for (size_t i = 0; i < 100; ++i) {
+    evbPtr->runInEventBaseThreadAndWait([&] { ++count; });
+  }
+  evbPtr->terminateLoopSoon();
+  t.join();
+
+  EXPECT_EQ(100, count);
+  const auto& stats = evbPtr->getBusyPollStats();
+  EXPECT_GT(stats.numSpinsWithWork, 0);
+  EXPECT_GE(stats.numSpins, stats.numSpinsWithWork);
+  EXPECT_GE(stats.spinTime, stats.idleSpinTime);
+}
+
+TYPED_TEST_P(EventBaseTest, BusyPollAdaptive) {
+  const std::chrono::milliseconds kMaxSpin{2};
+  const size_t kNumTimeouts = 8;
+  for (bool adaptive : {false, true}) {
+    auto evbPtr = this->makeEventBase(
+        EventBase::Options().setBusyPoll(EventBase::BusyPollOptions()
+                                             .setMaxSpin(kMaxSpin)
+                                             .setAdaptive(adaptive)));
+    // A chain of timeouts, each of which the loop spins for in vain before it
+    // blocks. Each records the spin time left after that spin.
+    std::vector<std::chrono::nanoseconds> spins;
+    std::function<void()> schedule = [&] {
+      spins.push_back(evbPtr->getBusyPollSpin());
+      if (spins.size() < kNumTimeouts) {
+        evbPtr->runAfterDelay(schedule, 10);
+      }
+    };
+    evbPtr->runAfterDelay(schedule, 10);
+    evbPtr->loop();
+
+    ASSERT_EQ(kNumTimeouts, spins.size());
+    const auto& stats = evbPtr->getBusyPollStats();
+    EXPECT_GE(stats.numSpins - stats.numSpinsWithWork, kNumTimeouts);
+    if (adaptive) {
+      // The spin time halves on each idle spin, down to maxSpin / 16, which
+      // four idle spins in a row reach. A spin that catches a late timeout
+      // resets it, so this does not check every step.
+      EXPECT_EQ(
+          *std::min_element(spins.begin(), spins.end()),
+          std::chrono::nanoseconds(kMaxSpin) / 16);
+    } else {
+      for (auto spin : spins) {
+        EXPECT_EQ(spin, std::chrono::nanoseconds(kMaxSpin));
+      }
+    }
+  }
+}
+
 struct BackendProviderBase {
   static bool isIoUringBackend() { return false; }
 };
@@ -3148,7 +3208,9 @@ REGISTER_TYPED_TEST_SUITE_P(
     PidCheck,
     EventBaseExecutionObserver,
     LoopCallbackTimeslice,
-    RunInEventBaseThreadAlwaysEnqueueNoContextSwap);
+    RunInEventBaseThreadAlwaysEnqueueNoContextSwap,
+    BusyPollRunInEventBaseThread,
+    BusyPollAdaptive);
 
 } // namespace test
 } // namespace folly
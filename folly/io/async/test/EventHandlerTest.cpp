@@ -411,3 +411,25 @@ TEST_F(EventHandlerOobTest, SWALLOW_OOB) {
   eb.loop();
 }
 #endif
+
+#ifdef SO_BUSY_POLL
+TEST(EventHandlerBusyPollTest, SetsSocketBusyPoll) {
+  EventBase eb(EventBase::Options().setBusyPoll(
+      EventBase::BusyPollOptions().setSocketBusyPoll(
+          std::chrono::microseconds(50))));
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  ASSERT_GE(fd, 0);
+  SCOPE_EXIT {
+    fileops::close(fd);
+  };
+  EventHandlerMock handler(&eb, fd);
+
+  int usecs = 0;
+  socklen_t len = sizeof(usecs);
+  ASSERT_EQ(0, getsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &usecs, &len));
+  if (usecs == 0) {
+    GTEST_SKIP() << "Setting SO_BUSY_POLL requires CAP_NET_ADMIN";
+  }
+  EXPECT_EQ(50, usecs);
+}
+#endif
@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/Random.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/HHWheelTimer.h>
+#include <folly/io/async/STTimerFDTimeoutManager.h>
+#include <folly/io/async/test/UndelayedDestruction.h>
+#include <folly/portability/GFlags.h>
+
+using namespace folly;
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+
+// Run with --bm_min_iters=10000000 to schedule and cancel 10M timeouts.
+namespace {
+
+// Idle-connection style timeouts: a large pool of callbacks with long
+// timeouts, each rescheduled (which cancels it first) over and over.
+constexpr size_t kPoolSize = 1 << 20;
+constexpr size_t kBatchSize = 64;
+
+template <class Timer>
+class NopTimeout : public Timer::Callback {
+ public:
+  void timeoutExpired() noexcept override {}
+
+  void callbackCanceled() noexcept override {}
+};
+
+template <class Timer, class Duration>
+std::unique_ptr<UndelayedDestruction<Timer>> makeTimer(
+    TimeoutManager* timeoutManager,
+    Duration interval,
+    typename Timer::Engine engine) {
+  return std::make_unique<UndelayedDestruction<Timer>>(
+      timeoutManager,
+      interval,
+      AsyncTimeout::InternalEnum::NORMAL,
+      Duration(-1),
+      engine);
+}
+
+std::vector<milliseconds> idleTimeouts() {
+  std::vector<milliseconds> timeouts(kPoolSize);
+  for (auto& timeout : timeouts) {
+    // Between 1s and 10min, so that they land on levels 1 and 2 of the wheel.
+    timeout = milliseconds(Random::rand32(1000, 600 * 1000));
+  }
+  return timeouts;
+}
+
+void scheduleCancel(size_t iters, HHWheelTimer::Engine engine) {
+  BenchmarkSuspender suspender;
+  EventBase evb;
+  auto timer = makeTimer<HHWheelTimer>(&evb, milliseconds(1), engine);
+  std::vector<NopTimeout<HHWheelTimer>> callbacks(kPoolSize);
+  auto timeouts = idleTimeouts();
+  suspender.dismiss();
+
+  for (size_t i = 0; i < iters; ++i) {
+    size_t j = i % kPoolSize;
+    timer->scheduleTimeout(&callbacks[j], timeouts[j]);
+  }
+  timer->cancelAll();
+}
+
+void scheduleCancelBatch(size_t iters, HHWheelTimer::Engine engine) {
+  BenchmarkSuspender suspender;
+  EventBase evb;
+  auto timer = makeTimer<HHWheelTimer>(&evb, milliseconds(1), engine);
+  std::vector<NopTimeout<HHWheelTimer>> callbacks(kPoolSize);
+  std::vector<HHWheelTimer::Callback*> batch(kBatchSize);
+  suspender.dismiss();
+
+  // Schedule in batches, as when arming the same timeout for all the
+  // connections that became idle in one loop iteration, and cancel the
+  // previous use of each batch the same way.
+  for (size_t i = 0; i < iters; i += kBatchSize) {
+    size_t n = std::min(kBatchSize, iters - i);
+    for (size_t k = 0; k < n; ++k) {
+      batch[k] = &callbacks[(i + k) % kPoolSize];
+    }
+    auto callbackRange = range(batch.data(), batch.data() + n);
+    timer->cancelTimeouts(callbackRange);
+    timer->scheduleTimeouts(callbackRange, milliseconds(60 * 1000));
+  }
+  timer->cancelAll();
+}
+
+// Each iteration is one timeout, with all timeouts spread over 100ms of 1us
+// ticks. The wheel is given time for all of them to be due, and the
+// benchmark measures the single wakeup that processes the 100000 ticks and
+// runs the callbacks.
+void expireBacklog(size_t iters, HHWheelTimerHighRes::Engine engine) {
+  BenchmarkSuspender suspender;
+  EventBase evb;
+  STTimerFDTimeoutManager timeoutManager(&evb);
+  auto timer =
+      makeTimer<HHWheelTimerHighRes>(&timeoutManager, microseconds(1), engine);
+  std::vector<NopTimeout<HHWheelTimerHighRes>> callbacks(iters);
+  for (size_t i = 0; i < iters; ++i) {
+    timer->scheduleTimeout(
+        &callbacks[i], microseconds(Random::rand32(100 * 1000)));
+  }
+  std::this_thread::sleep_for(milliseconds(110));
+  suspender.dismiss();
+
+  while (timer->count() > 0) {
+    evb.loopOnce();
+  }
+}
+
+} // namespace
+
+BENCHMARK(scheduleCancelCascading, iters) {
+  scheduleCancel(iters, HHWheelTimer::Engine::CASCADING);
+}
+
+BENCHMARK_RELATIVE(scheduleCancelLazy, iters) {
+  scheduleCancel(iters, HHWheelTimer::Engine::LAZY);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(scheduleCancelBatchCascading, iters) {
+  scheduleCancelBatch(iters, HHWheelTimer::Engine::CASCADING);
+}
+
+BENCHMARK_RELATIVE(scheduleCancelBatchLazy, iters) {
+  scheduleCancelBatch(iters, HHWheelTimer::Engine::LAZY);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(expireBacklogCascading, iters) {
+  expireBacklog(iters, HHWheelTimerHighRes::Engine::CASCADING);
+}
+
+BENCHMARK_RELATIVE(expireBacklogLazy, iters) {
+  expireBacklog(iters, HHWheelTimerHighRes::Engine::LAZY);
+}
+
+int main(int argc, char** argv) {
+  folly::gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -570,3 +570,41 @@ TEST_F(HHWheelTimerHighResTest, NegativeTimeout) {
   ASSERT_EQ(tt2.timestamps.size(), 1);
   T_CHECK_TIMEOUT(start, end, std::chrono::milliseconds(10));
 }
+
+TEST_F(HHWheelTimerHighResTest, LazyMicrosecondTicks) {
+  StackWheelTimer t(
+      &timeoutMgr,
+      microseconds(1),
+      AsyncTimeout::InternalEnum::NORMAL,
+      microseconds(-1),
+      HHWheelTimerHighRes::Engine::LAZY);
+  ASSERT_EQ(t.getEngine(), HHWheelTimerHighRes::Engine::LAZY);
+
+  // With 1us ticks these start on levels 0, 1, 2 and 3 of the wheel.
+  TestTimeout t1;
+  TestTimeout t2;
+  TestTimeout t3;
+  TestTimeout t4;
+  t.scheduleTimeout(&t1, microseconds(100));
+  t.scheduleTimeout(&t2, microseconds(20 * 1000));
+  t.scheduleTimeout(&t3, microseconds(100 * 1000));
+  t.scheduleTimeout(&t4, microseconds(30 * 1000 * 1000));
+  t3.fn = [&] {
+    t4.cancelTimeout();
+    evb.terminateLoopSoon();
+  };
+
+  TimePoint start;
+  evb.loop();
+  TimePoint end;
+
+  ASSERT_EQ(t1.timestamps.size(), 1);
+  ASSERT_EQ(t2.timestamps.size(), 1);
+  ASSERT_EQ(t3.timestamps.size(), 1);
+  ASSERT_EQ(t4.timestamps.size(), 0);
+  ASSERT_EQ(t.count(), 0);
+  T_CHECK_TIMEOUT(start, t1.timestamps[0], microseconds(100));
+  T_CHECK_TIMEOUT(start, t2.timestamps[0], microseconds(20 * 1000));
+  T_CHECK_TIMEOUT(start, t3.timestamps[0], microseconds(100 * 1000));
+  T_CHECK_TIMEOUT(start, end, microseconds(100 * 1000));
+}
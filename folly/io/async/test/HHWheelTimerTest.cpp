@@ -16,6 +16,8 @@
 
 #include <folly/io/async/HHWheelTimer.h>
 
+#include <vector>
+
 #include <folly/io/async/EventBase.h>
 #include <folly/io/async/test/UndelayedDestruction.h>
 #include <folly/io/async/test/Util.h>
@@ -53,15 +55,30 @@ class TestTimeout : public HHWheelTimer::Callback {
   std::function<void()> fn;
 };
 
-struct HHWheelTimerTest : public ::testing::Test {
-  EventBase eventBase;
+struct HHWheelTimerTest
+    : public ::testing::TestWithParam<HHWheelTimer::Engine> {
+  EventBase eventBase{EventBase::Options().setTimerEngine(GetParam())};
 };
 
+INSTANTIATE_TEST_SUITE_P(
+    Engines,
+    HHWheelTimerTest,
+    ::testing::Values(
+        HHWheelTimer::Engine::CASCADING, HHWheelTimer::Engine::LAZY),
+    [](const ::testing::TestParamInfo<HHWheelTimer::Engine>& info) {
+      return info.param == HHWheelTimer::Engine::LAZY ? "Lazy" : "Cascading";
+    });
+
 /*
  * Test firing some simple timeouts that are fired once and never rescheduled
  */
-TEST_F(HHWheelTimerTest, FireOnce) {
-  StackWheelTimer t(&eventBase, milliseconds(1));
+TEST_P(HHWheelTimerTest, FireOnce) {
+  StackWheelTimer t(
+      &eventBase,
+      milliseconds(1),
+      AsyncTimeout::InternalEnum::NORMAL,
+      milliseconds(-1),
+      GetParam());
 
   TestTimeout t1;
   TestTimeout t2;
@@ -94,8 +111,13 @@ TEST_F(HHWheelTimerTest, FireOnce) {
   T_CHECK_TIMEOUT(start, end, milliseconds(40));
 }
 
-TEST_F(HHWheelTimerTest, NoRequestContextLeak) {
-  StackWheelTimer t(&eventBase, milliseconds(1));
+TEST_P(HHWheelTimerTest, NoRequestContextLeak) {
+  StackWheelTimer t(
+      &eventBase,
+      milliseconds(1),
+      AsyncTimeout::InternalEnum::NORMAL,
+      milliseconds(-1),
+      GetParam());
   std::set<int> destructed;
 
   class TestData : public RequestData {
@@ -137,7 +159,7 @@ TEST_F(HHWheelTimerTest, NoRequestContextLeak) {
 /*
  * Test scheduling a timeout from another timeout callback.
  */
-TEST_F(HHWheelTimerTest, TestSchedulingWithinCallback) {
+TEST_P(HHWheelTimerTest, TestSchedulingWithinCallback) {
   HHWheelTimer& t = eventBase.timer();
 
   TestTimeout t1, t2;
@@ -162,7 +184,7 @@ TEST_F(HHWheelTimerTest, TestSchedulingWithinCallback) {
 /*
  * Test changing default-timeout in timer.
  */
-TEST_F(HHWheelTimerTest, TestSetDefaultTimeout) {
+TEST_P(HHWheelTimerTest, TestSetDefaultTimeout) {
   HHWheelTimer& t = eventBase.timer();
 
   t.setDefaultTimeout(milliseconds(1000));
@@ -174,8 +196,13 @@ TEST_F(HHWheelTimerTest, TestSetDefaultTimeout) {
  * Test cancelling a timeout when it is scheduled to be fired right away.
  */
 
-TEST_F(HHWheelTimerTest, CancelTimeout) {
-  StackWheelTimer t(&eventBase, milliseconds(1));
+TEST_P(HHWheelTimerTest, CancelTimeout) {
+  StackWheelTimer t(
+      &eventBase,
+      milliseconds(1),
+      AsyncTimeout::InternalEnum::NORMAL,
+      milliseconds(-1),
+      GetParam());
 
   // Create several timeouts that will all fire in 5ms.
   TestTimeout t5_1(&t, milliseconds(5));
@@ -255,9 +282,13 @@ TEST_F(HHWheelTimerTest, CancelTimeout) {
  * Test destroying a HHWheelTimer with timeouts outstanding
  */
 
-TEST_F(HHWheelTimerTest, DestroyTimeoutSet) {
-  HHWheelTimer::UniquePtr t(
-      HHWheelTimer::newTimer(&eventBase, milliseconds(1)));
+TEST_P(HHWheelTimerTest, DestroyTimeoutSet) {
+  HHWheelTimer::UniquePtr t(HHWheelTimer::newTimer(
+      &eventBase,
+      milliseconds(1),
+      AsyncTimeout::InternalEnum::NORMAL,
+      milliseconds(-1),
+      GetParam()));
 
   TestTimeout t5_1(t.get(), milliseconds(5));
   TestTimeout t5_2(t.get(), milliseconds(5));
@@ -296,8 +327,13 @@ TEST_F(HHWheelTimerTest, DestroyTimeoutSet) {
 /*
  * Test an event scheduled before the last event fires on time
  */
-TEST_F(HHWheelTimerTest, SlowFast) {
-  StackWheelTimer t(&eventBase, milliseconds(1));
+TEST_P(HHWheelTimerTest, SlowFast) {
+  StackWheelTimer t(
+      &eventBase,
+      milliseconds(1),
+      AsyncTimeout::InternalEnum::NORMAL,
+      milliseconds(-1),
+      GetParam());
 
   TestTimeout t1;
   TestTimeout t2;
@@ -321,8 +357,13 @@ TEST_F(HHWheelTimerTest, SlowFast) {
   T_CHECK_TIMEOUT(start, t2.timestamps[0], milliseconds(5));
 }
 
-TEST_F(HHWheelTimerTest, ReschedTest) {
-  StackWheelTimer t(&eventBase, milliseconds(1));
+TEST_P(HHWheelTimerTest, ReschedTest) {
+  StackWheelTimer t(
+      &eventBase,
+      milliseconds(1),
+      AsyncTimeout::InternalEnum::NORMAL,
+      milliseconds(-1),
+      GetParam());
 
   TestTimeout t1;
   TestTimeout t2;
@@ -351,8 +392,13 @@ TEST_F(HHWheelTimerTest, ReschedTest) {
   T_CHECK_TIMEOUT(start2, t2.timestamps[0], milliseconds(255));
 }
 
-TEST_F(HHWheelTimerTest, DeleteWheelInTimeout) {
-  auto t = HHWheelTimer::newTimer(&eventBase, milliseconds(1));
+TEST_P(HHWheelTimerTest, DeleteWheelInTimeout) {
+  auto t = HHWheelTimer::newTimer(
+      &eventBase,
+      milliseconds(1),
+      AsyncTimeout::InternalEnum::NORMAL,
+      milliseconds(-1),
+      GetParam());
 
   TestTimeout t1;
   TestTimeout t2;
@@ -381,13 +427,14 @@ TEST_F(HHWheelTimerTest, DeleteWheelInTimeout) {
 /*
  * Test scheduling a mix of timers with default timeout and variable timeout.
  */
-TEST_F(HHWheelTimerTest, DefaultTimeout) {
+TEST_P(HHWheelTimerTest, DefaultTimeout) {
   milliseconds defaultTimeout(milliseconds(5));
   StackWheelTimer t(
       &eventBase,
       milliseconds(1),
       AsyncTimeout::InternalEnum::NORMAL,
-      defaultTimeout);
+      defaultTimeout,
+      GetParam());
 
   TestTimeout t1;
   TestTimeout t2;
@@ -414,8 +461,13 @@ TEST_F(HHWheelTimerTest, DefaultTimeout) {
   T_CHECK_TIMEOUT(start, end, milliseconds(10));
 }
 
-TEST_F(HHWheelTimerTest, lambda) {
-  StackWheelTimer t(&eventBase, milliseconds(1));
+TEST_P(HHWheelTimerTest, lambda) {
+  StackWheelTimer t(
+      &eventBase,
+      milliseconds(1),
+      AsyncTimeout::InternalEnum::NORMAL,
+      milliseconds(-1),
+      GetParam());
   size_t count = 0;
   t.scheduleTimeoutFn([&] { count++; }, milliseconds(1));
   eventBase.loop();
@@ -424,15 +476,25 @@ TEST_F(HHWheelTimerTest, lambda) {
 
 // shouldn't crash because we swallow and log the error (you'll have to look
 // at the console to confirm logging)
-TEST_F(HHWheelTimerTest, lambdaThrows) {
-  StackWheelTimer t(&eventBase, milliseconds(1));
+TEST_P(HHWheelTimerTest, lambdaThrows) {
+  StackWheelTimer t(
+      &eventBase,
+      milliseconds(1),
+      AsyncTimeout::InternalEnum::NORMAL,
+      milliseconds(-1),
+      GetParam());
   t.scheduleTimeoutFn(
       [&] { throw std::runtime_error("expected"); }, milliseconds(1));
   eventBase.loop();
 }
 
-TEST_F(HHWheelTimerTest, cancelAll) {
-  StackWheelTimer t(&eventBase, milliseconds(1));
+TEST_P(HHWheelTimerTest, cancelAll) {
+  StackWheelTimer t(
+      &eventBase,
+      milliseconds(1),
+      AsyncTimeout::InternalEnum::NORMAL,
+      milliseconds(-1),
+      GetParam());
   TestTimeout t1;
   TestTimeout t2;
   t.scheduleTimeout(&t1, std::chrono::milliseconds(1));
@@ -448,9 +510,13 @@ TEST_F(HHWheelTimerTest, cancelAll) {
   EXPECT_EQ(1, canceled);
 }
 
-TEST_F(HHWheelTimerTest, IntrusivePtr) {
-  HHWheelTimer::UniquePtr t(
-      HHWheelTimer::newTimer(&eventBase, milliseconds(1)));
+TEST_P(HHWheelTimerTest, IntrusivePtr) {
+  HHWheelTimer::UniquePtr t(HHWheelTimer::newTimer(
+      &eventBase,
+      milliseconds(1),
+      AsyncTimeout::InternalEnum::NORMAL,
+      milliseconds(-1),
+      GetParam()));
 
   TestTimeout t1;
   TestTimeout t2;
@@ -486,8 +552,13 @@ TEST_F(HHWheelTimerTest, IntrusivePtr) {
   T_CHECK_TIMEOUT(start, end, milliseconds(10));
 }
 
-TEST_F(HHWheelTimerTest, GetTimeRemaining) {
-  StackWheelTimer t(&eventBase, milliseconds(1));
+TEST_P(HHWheelTimerTest, GetTimeRemaining) {
+  StackWheelTimer t(
+      &eventBase,
+      milliseconds(1),
+      AsyncTimeout::InternalEnum::NORMAL,
+      milliseconds(-1),
+      GetParam());
   TestTimeout t1;
 
   // Not scheduled yet, time remaining should be zero
@@ -510,8 +581,13 @@ TEST_F(HHWheelTimerTest, GetTimeRemaining) {
   T_CHECK_TIMEOUT(start, end, milliseconds(10));
 }
 
-TEST_F(HHWheelTimerTest, prematureTimeout) {
-  StackWheelTimer t(&eventBase, milliseconds(10));
+TEST_P(HHWheelTimerTest, prematureTimeout) {
+  StackWheelTimer t(
+      &eventBase,
+      milliseconds(10),
+      AsyncTimeout::InternalEnum::NORMAL,
+      milliseconds(-1),
+      GetParam());
   TestTimeout t1;
   TestTimeout t2;
   // Schedule the timeout for the nextTick of timer
@@ -530,8 +606,13 @@ TEST_F(HHWheelTimerTest, prematureTimeout) {
   EXPECT_GE(elapsedMs.count(), timeout.count());
 }
 
-TEST_F(HHWheelTimerTest, Level1) {
-  StackWheelTimer t(&eventBase, milliseconds(1));
+TEST_P(HHWheelTimerTest, Level1) {
+  StackWheelTimer t(
+      &eventBase,
+      milliseconds(1),
+      AsyncTimeout::InternalEnum::NORMAL,
+      milliseconds(-1),
+      GetParam());
   TestTimeout tt;
   // Schedule the timeout for the tick in a next epoch.
   t.scheduleTimeout(&tt, std::chrono::milliseconds(500));
@@ -543,8 +624,13 @@ TEST_F(HHWheelTimerTest, Level1) {
 }
 
 // Test that we handle negative timeouts properly (i.e. treat them as 0)
-TEST_F(HHWheelTimerTest, NegativeTimeout) {
-  StackWheelTimer t(&eventBase, milliseconds(1));
+TEST_P(HHWheelTimerTest, NegativeTimeout) {
+  StackWheelTimer t(
+      &eventBase,
+      milliseconds(1),
+      AsyncTimeout::InternalEnum::NORMAL,
+      milliseconds(-1),
+      GetParam());
   std::this_thread::sleep_for(std::chrono::milliseconds(10));
   TestTimeout tt1;
   TestTimeout tt2;
@@ -560,6 +646,78 @@ TEST_F(HHWheelTimerTest, NegativeTimeout) {
   T_CHECK_TIMEOUT(start, end, milliseconds(1));
 }
 
+TEST_P(HHWheelTimerTest, ScheduleCancelBatch) {
+  StackWheelTimer t(
+      &eventBase,
+      milliseconds(1),
+      AsyncTimeout::InternalEnum::NORMAL,
+      milliseconds(-1),
+      GetParam());
+
+  std::vector<TestTimeout> timeouts(8);
+  std::vector<HHWheelTimer::Callback*> all;
+  std::vector<HHWheelTimer::Callback*> odd;
+  for (size_t i = 0; i < timeouts.size(); ++i) {
+    all.push_back(&timeouts[i]);
+    if (i % 2) {
+      odd.push_back(&timeouts[i]);
+    }
+  }
+
+  t.scheduleTimeouts(range(all), milliseconds(10));
+  ASSERT_EQ(t.count(), 8);
+  ASSERT_EQ(t.cancelTimeouts(range(odd)), 4);
+  ASSERT_EQ(t.cancelTimeouts(range(odd)), 0);
+  ASSERT_EQ(t.count(), 4);
+
+  TimePoint start;
+  eventBase.loop();
+  TimePoint end;
+
+  ASSERT_EQ(t.count(), 0);
+  for (size_t i = 0; i < timeouts.size(); ++i) {
+    if (i % 2) {
+      ASSERT_EQ(timeouts[i].timestamps.size(), 0);
+    } else {
+      ASSERT_EQ(timeouts[i].timestamps.size(), 1);
+      T_CHECK_TIMEOUT(start, timeouts[i].timestamps[0], milliseconds(10));
+    }
+  }
+  T_CHECK_TIMEOUT(start, end, milliseconds(10));
+}
+
+/*
+ * Test that timeouts in the higher levels of the wheel don't get in the way
+ * of short ones, and can be cancelled before they are reached.
+ */
+TEST_P(HHWheelTimerTest, CancelLongTimeouts) {
+  StackWheelTimer t(
+      &eventBase,
+      milliseconds(1),
+      AsyncTimeout::InternalEnum::NORMAL,
+      milliseconds(-1),
+      GetParam());
+
+  TestTimeout shortTimeout;
+  TestTimeout level1;
+  TestTimeout level2;
+  t.scheduleTimeout(&level2, std::chrono::minutes(10));
+  t.scheduleTimeout(&level1, milliseconds(300));
+  t.scheduleTimeout(&shortTimeout, milliseconds(20));
+  shortTimeout.fn = [&] { level2.cancelTimeout(); };
+
+  TimePoint start;
+  eventBase.loop();
+  TimePoint end;
+
+  ASSERT_EQ(shortTimeout.timestamps.size(), 1);
+  ASSERT_EQ(level1.timestamps.size(), 1);
+  ASSERT_EQ(level2.timestamps.size(), 0);
+  T_CHECK_TIMEOUT(start, shortTimeout.timestamps[0], milliseconds(20));
+  T_CHECK_TIMEOUT(start, level1.timestamps[0], milliseconds(300));
+  T_CHECK_TIMEOUT(start, end, milliseconds(300));
+}
+
 TEST(HHWheelTimerDetailsTest, Divider) {
   auto no_overflow_add = [](uint64_t& base, int offset) -> bool {
     if (offset >= 0 || static_cast<unsigned int>(-offset) < base) {
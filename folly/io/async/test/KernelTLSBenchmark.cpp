@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sys/resource.h>
+
+#include <array>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/SocketAddress.h>
+#include <folly/io/async/AsyncSSLSocket.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/test/TestSSLServer.h>
+#include <folly/net/NetOps.h>
+#include <folly/portability/GFlags.h>
+
+using namespace folly;
+
+// Sends bufferSize bytes per iteration from a client to a server over a
+// loopback TCP connection, with the TLS records encrypted and decrypted by
+// OpenSSL or by the kernel. Both ends run in this thread, so cpu_ns_per_byte
+// covers the work of both, in userspace and in the kernel.
+namespace {
+
+std::chrono::nanoseconds cpuTime() {
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  auto toNs = [](const timeval& tv) {
+    return std::chrono::seconds(tv.tv_sec) +
+        std::chrono::microseconds(tv.tv_usec);
+  };
+  return toNs(usage.ru_utime) + toNs(usage.ru_stime);
+}
+
+// kTLS can only be set up on TCP sockets.
+std::array<NetworkSocket, 2> tcpSocketPair() {
+  SocketAddress addr("127.0.0.1", 0);
+  sockaddr_storage storage;
+  addr.getAddress(&storage);
+  auto listener = netops::socket(AF_INET, SOCK_STREAM, 0);
+  CHECK_EQ(
+      0,
+      netops::bind(
+          listener,
+          reinterpret_cast<sockaddr*>(&storage),
+          addr.getActualSize()));
+  CHECK_EQ(0, netops::listen(listener, 1));
+  addr.setFromLocalAddress(listener);
+  addr.getAddress(&storage);
+
+  std::array<NetworkSocket, 2> fds;
+  fds[0] = netops::socket(AF_INET, SOCK_STREAM, 0);
+  CHECK_EQ(
+      0,
+      netops::connect(
+          fds[0],
+          reinterpret_cast<sockaddr*>(&storage),
+          addr.getActualSize()));
+  fds[1] = netops::accept(listener, nullptr, nullptr);
+  netops::close(listener);
+  for (auto fd : fds) {
+    CHECK_EQ(0, netops::set_socket_non_blocking(fd));
+  }
+  return fds;
+}
+
+class HandshakeCallback : public AsyncSSLSocket::HandshakeCB {
+ public:
+  void handshakeSuc(AsyncSSLSocket*) noexcept override { done = true; }
+
+  void handshakeErr(
+      AsyncSSLSocket*, const AsyncSocketException& ex) noexcept override {
+    LOG(FATAL) << "handshake failed: " << ex.what();
+  }
+
+  bool done{false};
+};
+
+class SinkReadCallback : public AsyncTransport::ReadCallback {
+ public:
+  void getReadBuffer(void** bufReturn, size_t* lenReturn) override {
+    *bufReturn = buf_.data();
+    *lenReturn = buf_.size();
+  }
+
+  void readDataAvailable(size_t len) noexcept override { bytesRead += len; }
+
+  void readEOF() noexcept override {}
+
+  void readErr(const AsyncSocketException& ex) noexcept override {
+    LOG(FATAL) << "read failed: " << ex.what();
+  }
+
+  size_t bytesRead{0};
+
+ private:
+  std::vector<char> buf_ = std::vector<char>(1 << 16);
+};
+
+void transfer(
+    UserCounters& counters,
+    unsigned iters,
+    size_t bufferSize,
+    bool kernelTLS) {
+  BenchmarkSuspender suspender;
+  EventBase evb;
+  auto fds = tcpSocketPair();
+  std::shared_ptr<SSLContext> serverCtx =
+      test::TestSSLServer::getDefaultSSLContext();
+  auto clientCtx = std::make_shared<SSLContext>();
+  AsyncSSLSocket::UniquePtr client(
+      new AsyncSSLSocket(clientCtx, &evb, fds[0], false));
+  AsyncSSLSocket::UniquePtr server(
+      new AsyncSSLSocket(serverCtx, &evb, fds[1], true));
+  if (kernelTLS) {
+    client->enableKernelTLS();
+    server->enableKernelTLS();
+  }
+  HandshakeCallback clientHandshake;
+  HandshakeCallback serverHandshake;
+  client->sslConn(&clientHandshake);
+  server->sslAccept(&serverHandshake);
+  while (!clientHandshake.done || !serverHandshake.done) {
+    evb.loopOnce();
+  }
+  counters["ktls"] = client->isKernelTLSSendEnabled() ? 1 : 0;
+
+  SinkReadCallback sink;
+  server->setReadCB(&sink);
+  std::vector<char> buf(bufferSize, 'a');
+  auto startCpu = cpuTime();
+  suspender.dismiss();
+
+  for (unsigned i = 0; i < iters; ++i) {
+    client->write(nullptr, buf.data(), buf.size());
+  }
+  while (sink.bytesRead < iters * bufferSize) {
+    evb.loopOnce();
+  }
+
+  suspender.rehire();
+  auto cpu = cpuTime() - startCpu;
+  counters["cpu_ns_per_byte"] =
+      UserMetric(double(cpu.count()) / (double(iters) * bufferSize));
+  server->setReadCB(nullptr);
+}
+
+} // namespace
+
+#define KTLS_BENCHMARK(size)                                       \
+  BENCHMARK_COUNTERS(userspaceTLS_##size, counters, iters) {       \
+    transfer(counters, iters, size, false);                        \
+  }                                                                \
+  BENCHMARK_COUNTERS_RELATIVE(kernelTLS_##size, counters, iters) { \
+    transfer(counters, iters, size, true);                         \
+  }                                                                \
+  BENCHMARK_DRAW_LINE();
+
+KTLS_BENCHMARK(4096)
+KTLS_BENCHMARK(16384)
+KTLS_BENCHMARK(65536)
+KTLS_BENCHMARK(262144)
+
+int main(int argc, char** argv) {
+  folly::gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
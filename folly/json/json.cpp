@@ -181,11 +181,24 @@ std::string contextDescription(const Context* context) {
 
 // Printer is templated on `Pretty` to let the compiler eliminate the
 // `if (indentLevel_)` runtime branches in `newline()`, `mapColon()`,
-// `indent()`, and `outdent()` for the common compact-output path.
-template <bool Pretty>
+// `indent()`, and `outdent()` for the common compact-output path, and on
+// `Chunked` to do the same for the flush checks that only
+// detail::serializeChunked() needs.
+template <bool Pretty, bool Chunked = false>
 struct PrinterImpl {
   explicit PrinterImpl(std::string& out, serialization_opts const* opts)
       : out_(out), opts_(*opts) {}
+  PrinterImpl(
+      std::string& out,
+      serialization_opts const* opts,
+      unsigned indentLevel,
+      std::size_t chunkSize,
+      FunctionRef<void(StringPiece)> flush)
+      : out_(out),
+        opts_(*opts),
+        chunkSize_(chunkSize),
+        flush_(flush),
+        indentLevel_(indentLevel) {}
 
   void operator()(dynamic const& v, const Context& context) const {
     (*this)(v, &context);
@@ -273,10 +286,12 @@ struct PrinterImpl {
       dynamic const& o, Iterator begin, Iterator end, const Context* context)
       const {
     printKV(o, *begin, context);
+    maybeFlush();
     for (++begin; begin != end; ++begin) {
       out_.push_back(',');
       newline();
       printKV(o, *begin, context);
+      maybeFlush();
     }
   }
 
@@ -324,11 +339,13 @@ struct PrinterImpl {
     auto it = a.begin();
     auto end = a.end();
     (*this)(*it, Context(context, dynamic(int64_t{0})));
+    maybeFlush();
     ++it;
     for (int64_t i = 1; it != end; ++it, ++i) {
       out_.push_back(',');
       newline();
       (*this)(*it, Context(context, dynamic(i)));
+      maybeFlush();
     }
     outdent();
     newline();
@@ -356,6 +373,17 @@ struct PrinterImpl {
   }
   void mapColon() const { out_.append(Pretty ? ": "sv : ":"sv); }
 
+  // Hands the output so far to flush_ once it reaches a chunk. Only called
+  // between the elements of containers, so scalars are never split.
+  void maybeFlush() const {
+    if constexpr (Chunked) {
+      if (out_.size() >= chunkSize_) {
+        flush_(out_);
+        out_.clear();
+      }
+    }
+  }
+
   // Append `dval` to `out_` using fmt's Dragonbox. Infinity/NaN use the
   // JSON spellings ("Infinity"/"-Infinity"/"NaN") since fmt emits "inf"/"nan".
   void appendDouble(double dval) const {
@@ -446,6 +474,8 @@ struct PrinterImpl {
 
   std::string& out_;
   serialization_opts const& opts_;
+  std::size_t chunkSize_{0};
+  FunctionRef<void(StringPiece)> flush_;
   // Mutable because the const operator()/printX methods mutate it via
   // indent()/outdent(); only present (logically) when Pretty.
   mutable unsigned indentLevel_{0};
@@ -1080,6 +1110,26 @@ std::string serialize(dynamic const& dyn, serialization_opts const& opts) {
   return ret;
 }
 
+namespace detail {
+
+void serializeChunked(
+    dynamic const& dyn,
+    serialization_opts const& opts,
+    std::string& out,
+    unsigned indentLevel,
+    std::size_t chunkSize,
+    FunctionRef<void(StringPiece)> flush) {
+  if (opts.pretty_formatting) {
+    PrinterImpl<true, true> p(out, &opts, indentLevel, chunkSize, flush);
+    p(dyn, nullptr);
+  } else {
+    PrinterImpl<false, true> p(out, &opts, indentLevel, chunkSize, flush);
+    p(dyn, nullptr);
+  }
+}
+
+} // namespace detail
+
 // Fast path to determine the longest prefix that can be left
 // unescaped in a string of sizeof(T) bytes packed in an integer of
 // type T.
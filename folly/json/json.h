@@ -195,6 +195,26 @@ std::string serialize(dynamic const&, serialization_opts const&);
 void escapeString(
     StringPiece input, std::string& out, const serialization_opts& opts);
 
+namespace detail {
+
+/**
+ * serialize(), appending to `out` and handing its contents to `flush` (and
+ * then clearing it) whenever it holds at least `chunkSize` bytes between two
+ * elements of an array or object; what remains at the end is left in `out`.
+ * Pretty output is indented as if nested `indentLevel` levels deep.
+ *
+ * The building block of json_stream.h.
+ */
+void serializeChunked(
+    dynamic const& dyn,
+    serialization_opts const& opts,
+    std::string& out,
+    unsigned indentLevel,
+    std::size_t chunkSize,
+    FunctionRef<void(StringPiece)> flush);
+
+} // namespace detail
+
 /**
  * Strip all C99-like comments (i.e. // and / * ... * /)
  */
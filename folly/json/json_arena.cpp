@@ -0,0 +1,447 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/json/json_arena.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+
+#include <folly/json/json_tape.h>
+#include <folly/lang/Assume.h>
+#include <folly/lang/Exception.h>
+
+namespace folly {
+namespace json {
+
+static_assert(std::is_trivially_destructible_v<arena_value>);
+static_assert(std::is_trivially_destructible_v<arena_value::member>);
+
+namespace {
+
+// Objects up to this size are sorted by insertion, which is stable and does
+// not allocate; larger ones by std::stable_sort.
+constexpr std::size_t kInsertionSortMax = 32;
+
+uint32_t checkedSize(std::size_t n) {
+  if (n > std::numeric_limits<uint32_t>::max()) {
+    throw_exception<std::length_error>("too many elements for a json arena");
+  }
+  return static_cast<uint32_t>(n);
+}
+
+bool keyLess(arena_value::member const& a, arena_value::member const& b) {
+  return a.key < b.key;
+}
+
+void sortMembers(arena_value::member* members, std::size_t n) {
+  if (n > kInsertionSortMax) {
+    std::stable_sort(members, members + n, keyLess);
+    return;
+  }
+  for (std::size_t i = 1; i < n; ++i) {
+    auto m = members[i];
+    auto j = i;
+    for (; j > 0 && keyLess(m, members[j - 1]); --j) {
+      members[j] = members[j - 1];
+    }
+    members[j] = m;
+  }
+}
+
+} // namespace
+
+//////////////////////////////////////////////////////////////////////
+
+bool arena_value::as_bool() const {
+  if (!is_bool()) {
+    throw_exception<TypeError>("bool", type_);
+  }
+  return u_.b;
+}
+
+int64_t arena_value::as_int() const {
+  if (is_int()) {
+    return u_.i;
+  }
+  if (is_double()) {
+    return to<int64_t>(u_.d);
+  }
+  throw_exception<TypeError>("int64", type_);
+}
+
+double arena_value::as_double() const {
+  if (is_double()) {
+    return u_.d;
+  }
+  if (is_int()) {
+    return to<double>(u_.i);
+  }
+  throw_exception<TypeError>("double", type_);
+}
+
+StringPiece arena_value::as_string() const {
+  if (!is_string()) {
+    throw_exception<TypeError>("string", type_);
+  }
+  return StringPiece(u_.s, size_);
+}
+
+std::size_t arena_value::size() const {
+  if (!is_array() && !is_object()) {
+    throw_exception<TypeError>("array/object", type_);
+  }
+  return size_;
+}
+
+arena_value const& arena_value::at(std::size_t i) const {
+  auto elements = begin();
+  if (i >= size_) {
+    throw_exception<std::out_of_range>("out of range in json arena array");
+  }
+  return elements[i];
+}
+
+arena_value& arena_value::at(std::size_t i) {
+  return const_cast<arena_value&>(std::as_const(*this).at(i));
+}
+
+arena_value const* arena_value::find(StringPiece key) const {
+  auto ms = members();
+  auto it = std::lower_bound(
+      ms.begin(), ms.end(), key, [](member const& m, StringPiece k) {
+        return m.key < k;
+      });
+  return it != ms.end() && it->key == key ? &it->value : nullptr;
+}
+
+arena_value* arena_value::find(StringPiece key) {
+  return const_cast<arena_value*>(std::as_const(*this).find(key));
+}
+
+arena_value const& arena_value::at(StringPiece key) const {
+  if (auto ret = find(key)) {
+    return *ret;
+  }
+  throw_exception<std::out_of_range>(
+      to<std::string>("couldn't find key ", key, " in json arena object"));
+}
+
+arena_value& arena_value::at(StringPiece key) {
+  return const_cast<arena_value&>(std::as_const(*this).at(key));
+}
+
+arena_value const* arena_value::begin() const {
+  if (!is_array()) {
+    throw_exception<TypeError>("array", type_);
+  }
+  return u_.a;
+}
+
+arena_value* arena_value::begin() {
+  return const_cast<arena_value*>(std::as_const(*this).begin());
+}
+
+Range<arena_value::member const*> arena_value::members() const {
+  if (!is_object()) {
+    throw_exception<TypeError>("object", type_);
+  }
+  return Range<member const*>(u_.m, size_);
+}
+
+dynamic arena_value::to_dynamic() const {
+  switch (type_) {
+    case dynamic::NULLT:
+      return nullptr;
+    case dynamic::BOOL:
+      return u_.b;
+    case dynamic::INT64:
+      return u_.i;
+    case dynamic::DOUBLE:
+      return u_.d;
+    case dynamic::STRING:
+      return as_string().str();
+    case dynamic::ARRAY: {
+      dynamic ret = dynamic::array;
+      ret.reserve(size_);
+      for (auto const& v : *this) {
+        ret.push_back(v.to_dynamic());
+      }
+      return ret;
+    }
+    case dynamic::OBJECT: {
+      dynamic ret = dynamic::object;
+      ret.reserve(size_);
+      for (auto const& m : members()) {
+        ret.insert(m.key.str(), m.value.to_dynamic());
+      }
+      return ret;
+    }
+  }
+  assume_unreachable();
+}
+
+//////////////////////////////////////////////////////////////////////
+
+arena_document::arena_document(std::size_t block_size)
+    : arena_(std::make_unique<SysArena>(block_size)) {}
+
+char const* arena_document::copy_chars(StringPiece s) {
+  if (s.empty()) {
+    return "";
+  }
+  auto chars = allocate<char>(s.size());
+  std::memcpy(chars, s.data(), s.size());
+  return chars;
+}
+
+arena_value arena_document::string(StringPiece s) {
+  arena_value ret;
+  ret.type_ = dynamic::STRING;
+  ret.size_ = checkedSize(s.size());
+  ret.u_.s = copy_chars(s);
+  return ret;
+}
+
+arena_value arena_document::array(Range<arena_value const*> elements) {
+  arena_value ret;
+  ret.type_ = dynamic::ARRAY;
+  ret.size_ = checkedSize(elements.size());
+  ret.u_.a = allocate<arena_value>(elements.size());
+  std::copy(elements.begin(), elements.end(), ret.u_.a);
+  return ret;
+}
+
+arena_value arena_document::object(Range<arena_value::member const*> members) {
+  checkedSize(members.size());
+  auto copies = allocate<arena_value::member>(members.size());
+  for (std::size_t i = 0; i < members.size(); ++i) {
+    auto const& m = members[i];
+    copies[i] = {StringPiece(copy_chars(m.key), m.key.size()), m.value};
+  }
+  return finish_object(copies, members.size(), nullptr);
+}
+
+arena_value arena_document::copy(dynamic const& dyn) {
+  switch (dyn.type()) {
+    case dynamic::NULLT:
+      return nullptr;
+    case dynamic::BOOL:
+      return dyn.getBool();
+    case dynamic::INT64:
+      return dyn.getInt();
+    case dynamic::DOUBLE:
+      return dyn.getDouble();
+    case dynamic::STRING:
+      return string(dyn.stringPiece());
+    case dynamic::ARRAY: {
+      arena_value ret;
+      ret.type_ = dynamic::ARRAY;
+      ret.size_ = checkedSize(dyn.size());
+      ret.u_.a = allocate<arena_value>(dyn.size());
+      std::size_t i = 0;
+      for (auto const& v : dyn) {
+        ret.u_.a[i++] = copy(v);
+      }
+      return ret;
+    }
+    case dynamic::OBJECT: {
+      auto n = checkedSize(dyn.size());
+      auto members = allocate<arena_value::member>(n);
+      std::size_t i = 0;
+      for (auto const& [k, v] : dyn.items()) {
+        if (!k.isString()) {
+          throw_exception<TypeError>("string", k.type());
+        }
+        auto key = k.stringPiece();
+        members[i++] = {StringPiece(copy_chars(key), key.size()), copy(v)};
+      }
+      return finish_object(members, n, nullptr);
+    }
+  }
+  assume_unreachable();
+}
+
+// Sorts `members` in place by key, keeping the last of equal keys.
+arena_value arena_document::finish_object(
+    arena_value::member* members, std::size_t n, bool* duplicates) {
+  sortMembers(members, n);
+  std::size_t out = 0;
+  bool repeated = false;
+  for (std::size_t i = 0; i < n; ++i) {
+    if (out > 0 && members[out - 1].key == members[i].key) {
+      members[out - 1] = members[i];
+      repeated = true;
+    } else {
+      members[out++] = members[i];
+    }
+  }
+  if (duplicates) {
+    *duplicates = repeated;
+  }
+  arena_value ret;
+  ret.type_ = dynamic::OBJECT;
+  ret.size_ = static_cast<uint32_t>(out);
+  ret.u_.m = members;
+  return ret;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+// Copies a tape into an arena_document in two walks: the first adds up the
+// space the tree needs, so that the document's first block holds all of it,
+// and the second fills it in.
+class arena_builder {
+ public:
+  explicit arena_builder(serialization_opts const& opts)
+      : distinct_(opts.validate_keys || opts.convert_int_keys) {}
+
+  arena_document build(tape_value root) {
+    measure(root);
+    auto bytes = values_ * sizeof(arena_value) +
+        members_ * sizeof(arena_value::member) + chars_ +
+        3 * SysArena::kDefaultMaxAlign;
+    arena_document doc(std::max(bytes, SysArena::kDefaultMinBlockSize));
+    nextValue_ = doc.allocate<arena_value>(values_);
+    nextMember_ = doc.allocate<arena_value::member>(members_);
+    nextChar_ = doc.allocate<char>(chars_);
+    doc_ = &doc;
+    doc.root_ = make(root);
+    return doc;
+  }
+
+ private:
+  // Keys are strings, or with convert_int_keys, integers to be stored as
+  // their string form.
+  StringPiece key_text(tape_value key) {
+    if (key.is_string()) {
+      return key.as_string();
+    }
+    scratch_ = to<std::string>(key.as_int());
+    return scratch_;
+  }
+
+  void measure(tape_value v) {
+    switch (v.type()) {
+      case dynamic::STRING:
+        chars_ += v.as_string().size();
+        break;
+      case dynamic::ARRAY:
+        values_ += v.size();
+        for (auto e : v) {
+          measure(e);
+        }
+        break;
+      case dynamic::OBJECT:
+        members_ += v.size();
+        for (auto [k, e] : v.members()) {
+          chars_ += key_text(k).size();
+          measure(e);
+        }
+        break;
+      default:
+        break;
+    }
+  }
+
+  StringPiece chars(StringPiece s) {
+    std::memcpy(nextChar_, s.data(), s.size());
+    StringPiece ret(nextChar_, s.size());
+    nextChar_ += s.size();
+    return ret;
+  }
+
+  arena_value make(tape_value v) {
+    switch (v.type()) {
+      case dynamic::NULLT:
+        return nullptr;
+      case dynamic::BOOL:
+        return v.as_bool();
+      case dynamic::INT64:
+        return v.as_int();
+      case dynamic::DOUBLE:
+        return v.as_double();
+      case dynamic::STRING: {
+        arena_value ret;
+        ret.type_ = dynamic::STRING;
+        auto s = chars(v.as_string());
+        ret.size_ = checkedSize(s.size());
+        ret.u_.s = s.data();
+        return ret;
+      }
+      case dynamic::ARRAY: {
+        arena_value ret;
+        ret.type_ = dynamic::ARRAY;
+        ret.size_ = checkedSize(v.size());
+        ret.u_.a = nextValue_;
+        nextValue_ += ret.size_;
+        std::size_t i = 0;
+        for (auto e : v) {
+          ret.u_.a[i++] = make(e);
+        }
+        return ret;
+      }
+      case dynamic::OBJECT: {
+        auto n = checkedSize(v.size());
+        auto members = nextMember_;
+        nextMember_ += n;
+        std::size_t i = 0;
+        for (auto [k, e] : v.members()) {
+          auto key = chars(key_text(k));
+          members[i++] = {key, make(e)};
+        }
+        bool duplicates = false;
+        auto ret = doc_->finish_object(members, n, &duplicates);
+        if (duplicates && distinct_) {
+          report_duplicate(v);
+        }
+        return ret;
+      }
+    }
+    assume_unreachable();
+  }
+
+  [[noreturn]] void report_duplicate(tape_value object) {
+    std::unordered_set<std::string> seen;
+    for (auto [k, e] : object.members()) {
+      if (!seen.insert(key_text(k).str()).second) {
+        k.error("duplicate key inserted");
+      }
+    }
+    assume_unreachable();
+  }
+
+  bool distinct_;
+  std::size_t values_{0};
+  std::size_t members_{0};
+  std::size_t chars_{0};
+  arena_document* doc_{nullptr};
+  arena_value* nextValue_{nullptr};
+  arena_value::member* nextMember_{nullptr};
+  char* nextChar_{nullptr};
+  std::string scratch_;
+};
+
+arena_document parse_arena(StringPiece json, serialization_opts const& opts) {
+  auto tape = parse_tape(json, opts);
+  return arena_builder(opts).build(tape.root());
+}
+
+} // namespace json
+} // namespace folly
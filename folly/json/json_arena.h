@@ -0,0 +1,249 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * A dynamic-like JSON tree whose nodes all live in one SysArena.
+ *
+ * A folly::dynamic tree makes a heap allocation for every string, array and
+ * object in it (and, through F14NodeMap, for every member of every object),
+ * and frees them one by one. An arena_document holds the same tree in arena
+ * blocks: a document parsed with parse_arena() takes one allocation, or a
+ * few, and is freed in one go, since its values are trivially destructible.
+ *
+ *   auto doc = json::parse_arena(body);
+ *   for (auto const& status : doc.root()["statuses"]) {
+ *     int64_t id = status["id"].as_int();
+ *     StringPiece name = status["user"]["screen_name"].as_string();
+ *   }
+ *
+ * Values are 16 bytes. Arrays are contiguous; objects are arrays of members
+ * sorted by key, looked up by binary search, so that small objects take no
+ * more room than their members and large ones still find keys in O(log n).
+ * Keys are always strings.
+ *
+ * The tree's shape is fixed when it is built: strings, arrays and objects are
+ * created whole by the document (from a range of elements or members, or by
+ * copying a dynamic) and values can then be replaced in place, but not added
+ * or removed. Build anything else as a dynamic.
+ *
+ * @file json_arena.h
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <type_traits>
+
+#include <folly/Conv.h>
+#include <folly/Range.h>
+#include <folly/json/dynamic.h>
+#include <folly/json/json.h>
+#include <folly/memory/Arena.h>
+
+namespace folly {
+namespace json {
+
+class arena_document;
+
+/**
+ * A value in an arena_document. Scalars can be made anywhere; strings, arrays
+ * and objects only by an arena_document, and refer into its arena.
+ *
+ * Accessors throw TypeError when the value is of the wrong type, like the
+ * corresponding dynamic accessors.
+ */
+class arena_value {
+ public:
+  struct member;
+
+  arena_value() noexcept {}
+  /* implicit */ arena_value(std::nullptr_t) noexcept {}
+  /* implicit */ arena_value(bool b) noexcept : type_(dynamic::BOOL) {
+    u_.b = b;
+  }
+  // Any integral type but bool; throws ConversionError if it is out of the
+  // range of int64_t.
+  template <
+      typename Int,
+      std::enable_if_t<
+          std::is_integral_v<Int> && !std::is_same_v<Int, bool>,
+          int> = 0>
+  /* implicit */ arena_value(Int i) : type_(dynamic::INT64) {
+    u_.i = to<int64_t>(i);
+  }
+  /* implicit */ arena_value(double d) noexcept : type_(dynamic::DOUBLE) {
+    u_.d = d;
+  }
+  // Strings are copied in with arena_document::string(); without this, a
+  // literal would convert to bool.
+  arena_value(char const*) = delete;
+
+  dynamic::Type type() const noexcept { return type_; }
+
+  bool is_null() const noexcept { return type_ == dynamic::NULLT; }
+  bool is_bool() const noexcept { return type_ == dynamic::BOOL; }
+  bool is_int() const noexcept { return type_ == dynamic::INT64; }
+  bool is_double() const noexcept { return type_ == dynamic::DOUBLE; }
+  bool is_number() const noexcept { return is_int() || is_double(); }
+  bool is_string() const noexcept { return type_ == dynamic::STRING; }
+  bool is_array() const noexcept { return type_ == dynamic::ARRAY; }
+  bool is_object() const noexcept { return type_ == dynamic::OBJECT; }
+
+  bool as_bool() const;
+  // Numbers convert both ways, throwing ConversionError if the value does not
+  // fit, as to<>() does.
+  int64_t as_int() const;
+  double as_double() const;
+  // Points into the document's arena.
+  StringPiece as_string() const;
+
+  // Number of elements of an array or members of an object.
+  std::size_t size() const;
+
+  // Array element; throws std::out_of_range if out of range.
+  arena_value const& at(std::size_t i) const;
+  arena_value& at(std::size_t i);
+  template <
+      typename Index,
+      std::enable_if_t<std::is_integral_v<Index>, int> = 0>
+  arena_value const& operator[](Index i) const {
+    return at(std::size_t(i));
+  }
+  template <
+      typename Index,
+      std::enable_if_t<std::is_integral_v<Index>, int> = 0>
+  arena_value& operator[](Index i) {
+    return at(std::size_t(i));
+  }
+
+  // Object member with the given key, or nullptr if there is none.
+  arena_value const* find(StringPiece key) const;
+  arena_value* find(StringPiece key);
+  // Same, but throws std::out_of_range if there is none.
+  arena_value const& at(StringPiece key) const;
+  arena_value& at(StringPiece key);
+  arena_value const& operator[](StringPiece key) const { return at(key); }
+  arena_value& operator[](StringPiece key) { return at(key); }
+
+  // Elements of an array.
+  arena_value const* begin() const;
+  arena_value const* end() const { return begin() + size_; }
+  arena_value* begin();
+  arena_value* end() { return begin() + size_; }
+  // Members of an object, in key order.
+  Range<member const*> members() const;
+
+  /** Materialize this value and everything below it. */
+  dynamic to_dynamic() const;
+
+ private:
+  friend class arena_document;
+  friend class arena_builder;
+
+  dynamic::Type type_{dynamic::NULLT};
+  // Length of strings, elements of arrays, members of objects.
+  uint32_t size_{0};
+  union {
+    bool b;
+    int64_t i;
+    double d;
+    char const* s;
+    arena_value* a;
+    member* m;
+  } u_{};
+};
+
+struct arena_value::member {
+  StringPiece key;
+  arena_value value;
+};
+
+static_assert(sizeof(arena_value) == 16);
+
+/**
+ * A tree of arena_values and the arena they are allocated from. Movable;
+ * values in it stay where they are.
+ */
+class arena_document {
+ public:
+  /**
+   * A document whose root is null, allocating blocks of at least
+   * `block_size` bytes as values are built in it.
+   */
+  explicit arena_document(
+      std::size_t block_size = SysArena::kDefaultMinBlockSize);
+
+  arena_value const& root() const { return root_; }
+  arena_value& root() { return root_; }
+
+  /** A copy of `s`, in this document. */
+  arena_value string(StringPiece s);
+
+  /** An array of copies of `elements`. */
+  arena_value array(Range<arena_value const*> elements);
+  arena_value array(std::initializer_list<arena_value> elements) {
+    return array(Range<arena_value const*>(elements.begin(), elements.end()));
+  }
+
+  /**
+   * An object of copies of `members`, keys included. Of members with equal
+   * keys, the last one is kept, as parseJson() does.
+   */
+  arena_value object(Range<arena_value::member const*> members);
+  arena_value object(std::initializer_list<arena_value::member> members) {
+    return object(
+        Range<arena_value::member const*>(members.begin(), members.end()));
+  }
+
+  /**
+   * A copy of `dyn`, in this document. Throws TypeError if it has an object
+   * with a key that is not a string.
+   */
+  arena_value copy(dynamic const& dyn);
+
+  // Bytes the document has allocated.
+  std::size_t allocated_size() const { return arena_->totalSize(); }
+
+ private:
+  friend class arena_builder;
+
+  template <typename T>
+  T* allocate(std::size_t n) {
+    return static_cast<T*>(arena_->allocate(n * sizeof(T)));
+  }
+
+  char const* copy_chars(StringPiece s);
+  arena_value finish_object(
+      arena_value::member* members, std::size_t n, bool* duplicates);
+
+  std::unique_ptr<SysArena> arena_;
+  arena_value root_;
+};
+
+/**
+ * Parse `json` into an arena_document, which does not refer to it. Accepts
+ * and rejects the same documents as parseJson(), throwing json::parse_error,
+ * and to_dynamic() of the root produces the same dynamic. The document is
+ * sized while parsing, so it is allocated as a single block.
+ */
+arena_document parse_arena(
+    StringPiece json, serialization_opts const& opts = serialization_opts());
+
+} // namespace json
+} // namespace folly
@@ -0,0 +1,261 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/json/json_stream.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <folly/lang/Exception.h>
+
+namespace folly {
+namespace json {
+
+namespace {
+
+// Copies `s` into the tail of `out`, filling the last buffer first and then
+// allocating buffers of `chunkSize`, or of all of `s` if that is larger.
+void appendTo(IOBufQueue& out, StringPiece s, std::size_t chunkSize) {
+  while (!s.empty()) {
+    auto room = out.preallocate(1, std::max(chunkSize, s.size()));
+    auto n = std::min(room.second, s.size());
+    std::memcpy(room.first, s.data(), n);
+    out.postallocate(n);
+    s.advance(n);
+  }
+}
+
+void appendTo(io::Appender& out, StringPiece s) {
+  out.push(ByteRange(s));
+}
+
+// The staging buffer: a chunk, plus room for the element that overflows it.
+std::string makeBuffer(std::size_t chunkSize) {
+  std::string buf;
+  buf.reserve(chunkSize + chunkSize / 4);
+  return buf;
+}
+
+} // namespace
+
+void serialize(
+    dynamic const& dyn,
+    IOBufQueue& out,
+    serialization_opts const& opts,
+    std::size_t chunk_size) {
+  auto buf = makeBuffer(chunk_size);
+  detail::serializeChunked(dyn, opts, buf, 0, chunk_size, [&](StringPiece s) {
+    appendTo(out, s, chunk_size);
+  });
+  appendTo(out, buf, chunk_size);
+}
+
+void serialize(
+    dynamic const& dyn,
+    io::Appender& out,
+    serialization_opts const& opts,
+    std::size_t chunk_size) {
+  auto buf = makeBuffer(chunk_size);
+  detail::serializeChunked(dyn, opts, buf, 0, chunk_size, [&](StringPiece s) {
+    appendTo(out, s);
+  });
+  appendTo(out, buf);
+}
+
+stream_writer::stream_writer(
+    IOBufQueue& out, serialization_opts const& opts, std::size_t chunk_size)
+    : stream_writer(&out, nullptr, opts, chunk_size) {}
+
+stream_writer::stream_writer(
+    io::Appender& out, serialization_opts const& opts, std::size_t chunk_size)
+    : stream_writer(nullptr, &out, opts, chunk_size) {}
+
+stream_writer::stream_writer(
+    IOBufQueue* queue,
+    io::Appender* appender,
+    serialization_opts const& opts,
+    std::size_t chunk_size)
+    : queue_(queue),
+      appender_(appender),
+      opts_(&opts),
+      chunk_size_(chunk_size),
+      buf_(makeBuffer(chunk_size)) {}
+
+stream_writer& stream_writer::begin_object() {
+  before_value();
+  buf_.push_back('{');
+  stack_.push_back({true, true});
+  return *this;
+}
+
+stream_writer& stream_writer::end_object() {
+  if (have_key_) {
+    throw_exception<std::logic_error>(
+        "json::stream_writer: end_object() after a key");
+  }
+  if (!close(true)) {
+    newline();
+  }
+  buf_.push_back('}');
+  after_value();
+  return *this;
+}
+
+stream_writer& stream_writer::begin_array() {
+  before_value();
+  buf_.push_back('[');
+  stack_.push_back({false, true});
+  return *this;
+}
+
+stream_writer& stream_writer::end_array() {
+  if (!close(false)) {
+    newline();
+  }
+  buf_.push_back(']');
+  after_value();
+  return *this;
+}
+
+stream_writer& stream_writer::key(StringPiece k) {
+  if (stack_.empty() || !stack_.back().object || have_key_) {
+    throw_exception<std::logic_error>(
+        "json::stream_writer: key() outside of an object or after a key");
+  }
+  separate(stack_.back());
+  escapeString(k, buf_, *opts_);
+  buf_.append(opts_->pretty_formatting ? ": " : ":");
+  have_key_ = true;
+  return *this;
+}
+
+stream_writer& stream_writer::value(std::nullptr_t) {
+  before_value();
+  buf_.append("null");
+  after_value();
+  return *this;
+}
+
+stream_writer& stream_writer::value(bool b) {
+  before_value();
+  buf_.append(b ? "true" : "false");
+  after_value();
+  return *this;
+}
+
+// Numbers go through the dynamic path, which owns javascript_safe,
+// float_format and the NaN and infinity checks; building a numeric dynamic
+// does not allocate.
+stream_writer& stream_writer::value_int(int64_t i) {
+  return value(dynamic(i));
+}
+
+stream_writer& stream_writer::value(double d) {
+  return value(dynamic(d));
+}
+
+stream_writer& stream_writer::value(StringPiece s) {
+  before_value();
+  escapeString(s, buf_, *opts_);
+  after_value();
+  return *this;
+}
+
+stream_writer& stream_writer::value(dynamic const& dyn) {
+  before_value();
+  detail::serializeChunked(
+      dyn,
+      *opts_,
+      buf_,
+      static_cast<unsigned>(stack_.size()),
+      chunk_size_,
+      [this](StringPiece s) { emit(s); });
+  after_value();
+  return *this;
+}
+
+void stream_writer::flush() {
+  emit(buf_);
+  buf_.clear();
+}
+
+void stream_writer::before_value() {
+  if (stack_.empty()) {
+    if (done_) {
+      throw_exception<std::logic_error>(
+          "json::stream_writer: more than one top-level value");
+    }
+    done_ = true;
+    return;
+  }
+  auto& f = stack_.back();
+  if (!f.object) {
+    separate(f);
+  } else if (have_key_) {
+    have_key_ = false;
+  } else {
+    throw_exception<std::logic_error>(
+        "json::stream_writer: object member without a key");
+  }
+}
+
+void stream_writer::after_value() {
+  if (buf_.size() >= chunk_size_) {
+    flush();
+  }
+}
+
+// Mirrors the printer in json.cpp: a newline before every element of a
+// container, and a comma before all but the first.
+void stream_writer::separate(frame& f) {
+  if (!f.empty) {
+    buf_.push_back(',');
+  }
+  f.empty = false;
+  newline();
+}
+
+void stream_writer::newline() {
+  if (opts_->pretty_formatting) {
+    buf_.push_back('\n');
+    buf_.append(stack_.size() * opts_->pretty_formatting_indent_width, ' ');
+  }
+}
+
+// Pops the innermost container, which must be of the given kind, and returns
+// whether it was empty.
+bool stream_writer::close(bool object) {
+  if (stack_.empty() || stack_.back().object != object) {
+    throw_exception<std::logic_error>(
+        object ? "json::stream_writer: end_object() outside of an object"
+               : "json::stream_writer: end_array() outside of an array");
+  }
+  bool empty = stack_.back().empty;
+  stack_.pop_back();
+  return empty;
+}
+
+void stream_writer::emit(StringPiece s) {
+  if (queue_) {
+    appendTo(*queue_, s, chunk_size_);
+  } else {
+    appendTo(*appender_, s);
+  }
+}
+
+} // namespace json
+} // namespace folly
@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * JSON serialization into IOBufs, a chunk at a time.
+ *
+ * json::serialize(dynamic, serialization_opts) builds the whole document in
+ * one std::string, which a server then copies into an IOBuf to send: twice
+ * the document in memory at the peak, and one more pass over it. The
+ * functions here produce the same bytes, but stage at most about one chunk
+ * in a reused buffer and move it into the output whenever it fills up:
+ *
+ *   IOBufQueue body{IOBufQueue::cacheChainLength()};
+ *   json::serialize(response, body, opts);
+ *
+ * stream_writer does the same for documents that are not in a dynamic at all,
+ * emitting them piece by piece:
+ *
+ *   json::stream_writer w(body, opts);
+ *   w.begin_object();
+ *   w.key("ids").begin_array();
+ *   for (auto id : ids) {
+ *     w.value(id);
+ *   }
+ *   w.end_array();
+ *   w.key("next").value(cursor);
+ *   w.end_object();
+ *   w.flush();
+ *
+ * Output is only ever split between the elements of arrays and objects, so
+ * one very long string still goes out in one piece.
+ *
+ * @file json_stream.h
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <folly/Conv.h>
+#include <folly/Range.h>
+#include <folly/io/Cursor.h>
+#include <folly/io/IOBufQueue.h>
+#include <folly/json/dynamic.h>
+#include <folly/json/json.h>
+
+namespace folly {
+namespace json {
+
+constexpr std::size_t kDefaultStreamChunkSize = 16 * 1024;
+
+/**
+ * Append the serialization of `dyn` to `out`, byte-identical to
+ * serialize(dyn, opts). New buffers in `out` are about `chunk_size` bytes.
+ *
+ * Throws what serialize() throws; `out` then holds a prefix of the output.
+ */
+void serialize(
+    dynamic const& dyn,
+    IOBufQueue& out,
+    serialization_opts const& opts = serialization_opts(),
+    std::size_t chunk_size = kDefaultStreamChunkSize);
+
+/**
+ * Same, through an Appender, which allocates as its growth parameter says.
+ */
+void serialize(
+    dynamic const& dyn,
+    io::Appender& out,
+    serialization_opts const& opts = serialization_opts(),
+    std::size_t chunk_size = kDefaultStreamChunkSize);
+
+/**
+ * Emits one JSON value, built with calls in document order, to an IOBufQueue
+ * or Appender. Output is formatted exactly as serialize() would format the
+ * equivalent dynamic, following `opts`, except that sort_keys and
+ * sort_keys_by only apply within dynamics passed to value(): the writer's own
+ * objects keep their members in the order written, and it does not check
+ * keys for duplicates.
+ *
+ * Calls out of order (a value where an object expects a key, an end_array()
+ * closing an object, a second top-level value) throw std::logic_error.
+ *
+ * Output is staged, up to about a chunk at a time; call flush() once done,
+ * since the destructor does not.
+ */
+class stream_writer {
+ public:
+  // `opts` must outlive the writer.
+  stream_writer(
+      IOBufQueue& out,
+      serialization_opts const& opts,
+      std::size_t chunk_size = kDefaultStreamChunkSize);
+  stream_writer(
+      io::Appender& out,
+      serialization_opts const& opts,
+      std::size_t chunk_size = kDefaultStreamChunkSize);
+
+  stream_writer(stream_writer const&) = delete;
+  stream_writer& operator=(stream_writer const&) = delete;
+
+  stream_writer& begin_object();
+  stream_writer& end_object();
+  stream_writer& begin_array();
+  stream_writer& end_array();
+
+  // The key of the next member of the current object.
+  stream_writer& key(StringPiece k);
+
+  stream_writer& value(std::nullptr_t);
+  stream_writer& value(bool b);
+  // Any integral type but bool; throws ConversionError if it is out of the
+  // range of int64_t, as dynamic would.
+  template <
+      typename Int,
+      std::enable_if_t<
+          std::is_integral_v<Int> && !std::is_same_v<Int, bool>,
+          int> = 0>
+  stream_writer& value(Int i) {
+    return value_int(to<int64_t>(i));
+  }
+  stream_writer& value(double d);
+  stream_writer& value(StringPiece s);
+  stream_writer& value(char const* s) { return value(StringPiece(s)); }
+  stream_writer& value(std::string const& s) { return value(StringPiece(s)); }
+  // A whole subtree, serialized as serialize() would at this position.
+  stream_writer& value(dynamic const& dyn);
+
+  /**
+   * Move everything staged into the output. Writing may continue after.
+   */
+  void flush();
+
+  // Whether one complete top-level value has been written.
+  bool done() const { return done_ && stack_.empty(); }
+
+ private:
+  struct frame {
+    bool object;
+    bool empty;
+  };
+
+  stream_writer(
+      IOBufQueue* queue,
+      io::Appender* appender,
+      serialization_opts const& opts,
+      std::size_t chunk_size);
+
+  stream_writer& value_int(int64_t i);
+
+  void before_value();
+  void after_value();
+  void separate(frame& f);
+  void newline();
+  bool close(bool object);
+  void emit(StringPiece s);
+
+  IOBufQueue* queue_;
+  io::Appender* appender_;
+  serialization_opts const* opts_;
+  std::size_t chunk_size_;
+  std::string buf_;
+  std::vector<frame> stack_;
+  bool have_key_{false};
+  bool done_{false};
+};
+
+} // namespace json
+} // namespace folly
@@ -0,0 +1,881 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/json/json_tape.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include <folly/Conv.h>
+#include <folly/Likely.h>
+#include <folly/Unicode.h>
+#include <folly/algorithm/simd/Ignore.h>
+#include <folly/algorithm/simd/Movemask.h>
+#include <folly/algorithm/simd/detail/SimdPlatform.h>
+#include <folly/lang/Assume.h>
+#include <folly/lang/Exception.h>
+
+namespace folly {
+namespace json {
+
+namespace {
+
+using tape_entry = detail::tape_entry;
+using kind = tape_entry::kind;
+
+[[noreturn]] void throw_parse_error(
+    StringPiece input, std::size_t offset, char const* what) {
+  offset = std::min(offset, input.size());
+  auto line = std::count(input.begin(), input.begin() + offset, '\n');
+  auto context = input.subpiece(offset, 16 /* as parseJson() */);
+  throw_exception<parse_error>(to<std::string>(
+      "json parse error on line ",
+      line,
+      !context.empty() ? to<std::string>(" near `", context, '\'') : "",
+      ": ",
+      what));
+}
+
+//////////////////////////////////////////////////////////////////////
+// Stage one: structural indexing.
+//
+// The input is processed in blocks of 64 bytes, each byte class being a
+// 64-bit mask with bit i for byte i of the block; state that spans blocks is
+// carried as the top bit of the previous block's masks.
+
+constexpr std::size_t kBlockSize = 64;
+
+struct block_masks {
+  uint64_t quote;
+  uint64_t backslash;
+  uint64_t op; // { } [ ] : ,
+  uint64_t space; // the four characters JSON counts as whitespace
+};
+
+#if FOLLY_DETAIL_HAS_SIMD_PLATFORM
+
+using platform = simd::detail::SimdPlatform<uint8_t>;
+
+// movemask() gives 4 bits per byte on aarch64; keep one of each 4.
+template <typename Bits, typename BitsPerElement>
+FOLLY_ALWAYS_INLINE uint64_t byte_mask(std::pair<Bits, BitsPerElement> mm) {
+  uint64_t bits = mm.first;
+  if constexpr (BitsPerElement::value == 4) {
+    bits &= 0x1111111111111111ULL;
+    bits = (bits | (bits >> 3)) & 0x0303030303030303ULL;
+    bits = (bits | (bits >> 6)) & 0x000f000f000f000fULL;
+    bits = (bits | (bits >> 12)) & 0x000000ff000000ffULL;
+    bits = (bits | (bits >> 24)) & 0xffffULL;
+  } else {
+    static_assert(BitsPerElement::value == 1);
+  }
+  return bits;
+}
+
+FOLLY_ALWAYS_INLINE block_masks classify(char const* block) {
+  block_masks m{};
+  for (std::size_t i = 0; i < kBlockSize; i += platform::kCardinal) {
+    auto reg = platform::loadu(
+        reinterpret_cast<uint8_t const*>(block + i), simd::ignore_none{});
+    auto eq = [&](char c) { return platform::equal(reg, uint8_t(c)); };
+    auto bits = [&](auto logical) {
+      return byte_mask(simd::movemask<uint8_t>(logical)) << i;
+    };
+    m.quote |= bits(eq('"'));
+    m.backslash |= bits(eq('\\'));
+    m.op |= bits(platform::logical_or(
+        platform::logical_or(
+            platform::logical_or(eq('{'), eq('}')),
+            platform::logical_or(eq('['), eq(']'))),
+        platform::logical_or(eq(':'), eq(','))));
+    m.space |= bits(platform::logical_or(
+        platform::logical_or(eq(' '), eq('\n')),
+        platform::logical_or(eq('\t'), eq('\r'))));
+  }
+  return m;
+}
+
+#else
+
+block_masks classify(char const* block) {
+  block_masks m{};
+  for (std::size_t i = 0; i < kBlockSize; ++i) {
+    uint64_t bit = uint64_t(1) << i;
+    switch (block[i]) {
+      case '"':
+        m.quote |= bit;
+        break;
+      case '\\':
+        m.backslash |= bit;
+        break;
+      case '{':
+      case '}':
+      case '[':
+      case ']':
+      case ':':
+      case ',':
+        m.op |= bit;
+        break;
+      case ' ':
+      case '\n':
+      case '\t':
+      case '\r':
+        m.space |= bit;
+        break;
+      default:
+        break;
+    }
+  }
+  return m;
+}
+
+#endif
+
+class structural_scanner {
+ public:
+  // Appends the positions of the structural characters of a block starting
+  // at `base` to `out`, returning the new end.
+  uint32_t* scan(block_masks const& m, uint32_t base, uint32_t* out) {
+    uint64_t quote = m.quote & ~escaped(m.backslash);
+    // Bit i set iff byte i is an opening quote or inside a string.
+    uint64_t in_string = prefix_xor(quote) ^ in_string_;
+    in_string_ = uint64_t(int64_t(in_string) >> 63);
+
+    // A scalar (number or literal) starts at a byte that is not whitespace,
+    // an operator or a quote, and that does not follow another such byte.
+    uint64_t scalar = ~(m.op | m.space | m.quote);
+    uint64_t scalar_start = scalar & ~((scalar << 1) | scalar_);
+    scalar_ = scalar >> 63;
+
+    uint64_t structural = ((m.op | scalar_start) & ~in_string) | quote;
+    while (structural) {
+      *out++ = base + uint32_t(std::countr_zero(structural));
+      structural &= structural - 1;
+    }
+    return out;
+  }
+
+ private:
+  static constexpr uint64_t kEvenBits = 0x5555555555555555ULL;
+  static constexpr uint64_t kOddBits = ~kEvenBits;
+
+  // The bytes escaped by a backslash: those after an odd-length run of
+  // backslashes. Adding a run's start bit to the run carries past its end, so
+  // which bit the carry lands on, relative to where the run started, gives
+  // the parity of its length.
+  uint64_t escaped(uint64_t backslash) {
+    uint64_t starts = backslash & ~(backslash << 1);
+    // A run continued from the previous block starts at an odd position.
+    uint64_t even_start_mask = kEvenBits ^ odd_run_;
+    uint64_t even_starts = starts & even_start_mask;
+    uint64_t odd_starts = starts & ~even_start_mask;
+
+    uint64_t even_carries = backslash + even_starts;
+    uint64_t odd_carries = backslash + odd_starts;
+    bool carry_out = odd_carries < backslash;
+    odd_carries |= odd_run_;
+    odd_run_ = carry_out ? 1 : 0;
+
+    uint64_t even_carry_ends = even_carries & ~backslash;
+    uint64_t odd_carry_ends = odd_carries & ~backslash;
+    return (even_carry_ends & kOddBits) | (odd_carry_ends & kEvenBits);
+  }
+
+  // Bit i is the xor of bits 0 to i.
+  static uint64_t prefix_xor(uint64_t bits) {
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+  }
+
+  uint64_t odd_run_{0}; // the previous block ended in an odd backslash run
+  uint64_t in_string_{0}; // all ones if the previous block ended in a string
+  uint64_t scalar_{0}; // the previous block ended in a scalar
+};
+
+// Writes the structural positions of `input` to `out`, which must have room
+// for one per byte, and returns how many there are.
+std::size_t find_structurals(StringPiece input, uint32_t* out) {
+  structural_scanner scanner;
+  auto const begin = out;
+  std::size_t i = 0;
+  for (; i + kBlockSize <= input.size(); i += kBlockSize) {
+    out = scanner.scan(classify(input.data() + i), uint32_t(i), out);
+  }
+  if (i < input.size()) {
+    // Pad the tail with whitespace, which is never structural.
+    char block[kBlockSize];
+    std::memset(block, ' ', kBlockSize);
+    std::memcpy(block, input.data() + i, input.size() - i);
+    out = scanner.scan(classify(block), uint32_t(i), out);
+  }
+  return std::size_t(out - begin);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Stage two: tape construction.
+
+bool is_digit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+// The bytes that may follow a number or literal.
+bool is_delimiter(char c) {
+  switch (c) {
+    case ' ':
+    case '\n':
+    case '\t':
+    case '\r':
+    case '{':
+    case '}':
+    case '[':
+    case ']':
+    case ':':
+    case ',':
+    case '"':
+      return true;
+    default:
+      return false;
+  }
+}
+
+class tape_builder {
+ public:
+  tape_builder(
+      StringPiece input,
+      serialization_opts const& opts,
+      uint32_t const* indices,
+      std::size_t count,
+      std::vector<tape_entry>& tape,
+      string_tape& strings)
+      : input_(input),
+        opts_(opts),
+        indices_(indices),
+        count_(count),
+        tape_(tape),
+        strings_(strings) {}
+
+  void build() {
+    enum class state { value, key, after_value };
+    auto s = state::value;
+    uint32_t end = 0; // one past the last byte of the last value
+    for (;;) {
+      switch (s) {
+        case state::key:
+          stack_.back().key = uint32_t(tape_.size());
+          [[fallthrough]];
+        case state::value: {
+          if (stack_.size() > opts_.recursion_limit) {
+            error(peek(), "recursion limit exceeded");
+          }
+          auto pos = next();
+          if (pos == input_.size()) {
+            error(pos, "expected json value");
+          }
+          char c = input_[pos];
+          if (c == '{' || c == '[') {
+            open(pos, c == '{');
+            if (peek_is(char(c + 2) /* '}' or ']' */)) {
+              end = next() + 1;
+              close();
+              s = state::after_value;
+            } else {
+              s = c == '{' ? state::key : state::value;
+            }
+            continue;
+          }
+          end = c == '"' ? parse_string(pos) : parse_scalar(pos);
+          s = state::after_value;
+          continue;
+        }
+        case state::after_value: {
+          if (stack_.empty()) {
+            finish(end);
+            return;
+          }
+          auto& f = stack_.back();
+          if (f.object && !f.in_value) {
+            check_key(f.key);
+            auto pos = next();
+            if (pos == input_.size() || input_[pos] != ':') {
+              error(pos, "expected ':'");
+            }
+            f.in_value = true;
+            s = state::value;
+            continue;
+          }
+          ++f.count;
+          f.in_value = false;
+          char const closing = f.object ? '}' : ']';
+          auto pos = next();
+          if (pos < input_.size() && input_[pos] == ',') {
+            if (!opts_.allow_trailing_comma || !peek_is(closing)) {
+              s = f.object ? state::key : state::value;
+              continue;
+            }
+            pos = next();
+          }
+          if (pos == input_.size() || input_[pos] != closing) {
+            error(pos, f.object ? "expected '}'" : "expected ']'");
+          }
+          end = pos + 1;
+          close();
+          continue;
+        }
+      }
+    }
+  }
+
+ private:
+  struct frame {
+    uint32_t entry; // of the container
+    uint32_t count{0};
+    uint32_t key{0}; // objects: entry of the current key
+    bool object;
+    bool in_value{false}; // objects: past the current key's colon
+  };
+
+  [[noreturn]] void error(std::size_t offset, char const* what) const {
+    throw_parse_error(input_, offset, what);
+  }
+
+  // Positions of the next structural character, or the input size at the end.
+  uint32_t next() {
+    return cursor_ < count_ ? indices_[cursor_++] : uint32_t(input_.size());
+  }
+  uint32_t peek() const {
+    return cursor_ < count_ ? indices_[cursor_] : uint32_t(input_.size());
+  }
+  bool peek_is(char c) const {
+    return cursor_ < count_ && input_[indices_[cursor_]] == c;
+  }
+
+  void push(uint32_t offset, uint32_t length, kind type, uint8_t flags) {
+    tape_.push_back(tape_entry{offset, length, 0, type, flags});
+  }
+
+  void open(uint32_t pos, bool object) {
+    stack_.push_back(frame{uint32_t(tape_.size()), 0, 0, object, false});
+    push(pos, 0, object ? kind::object : kind::array, 0);
+  }
+
+  void close() {
+    auto& e = tape_[stack_.back().entry];
+    e.length = stack_.back().count;
+    e.next = uint32_t(tape_.size());
+    stack_.pop_back();
+  }
+
+  // Checked once the key is parsed: under parse_numbers_as_strings, a number
+  // is a string key.
+  void check_key(uint32_t key) const {
+    auto const& e = tape_[key];
+    if (e.type == kind::string || opts_.allow_non_string_keys) {
+      return;
+    }
+    if (!opts_.convert_int_keys) {
+      error(e.offset, "expected string for object key");
+    }
+    if (e.type != kind::number || e.flags != tape_entry::integer) {
+      error(e.offset, "expected string or integer for object key");
+    }
+  }
+
+  // After the root value, only whitespace may follow, or a NUL and then
+  // anything at all.
+  void finish(uint32_t end) const {
+    while (end < input_.size() &&
+           (input_[end] == ' ' || input_[end] == '\n' || input_[end] == '\t' ||
+            input_[end] == '\r')) {
+      ++end;
+    }
+    if (end < input_.size() && input_[end] != '\0') {
+      error(end, "parsing didn't consume all input");
+    }
+  }
+
+  // What the parser wanted instead of a malformed scalar's tail.
+  char const* expected_after_value() const {
+    if (stack_.empty()) {
+      return "parsing didn't consume all input";
+    }
+    if (!stack_.back().object) {
+      return "expected ']'";
+    }
+    return stack_.back().in_value ? "expected '}'" : "expected ':'";
+  }
+
+  uint32_t parse_string(uint32_t pos) {
+    // Everything up to the closing quote is masked out of the index.
+    if (cursor_ == count_) {
+      error(pos, "unterminated string");
+    }
+    uint32_t closing = indices_[cursor_++];
+    uint32_t begin = pos + 1;
+    uint32_t length = closing - begin;
+    char const* body = input_.data() + begin;
+    if (FOLLY_LIKELY(!std::memchr(body, '\\', length))) {
+      push(begin, length, kind::string, 0);
+    } else {
+      unescape(body, body + length);
+      push(begin, uint32_t(strings_.back().size()), kind::string, 1);
+      tape_.back().next = uint32_t(strings_.size() - 1);
+    }
+    return closing + 1;
+  }
+
+  void unescape(char const* p, char const* end) {
+    scratch_.clear();
+    while (p < end) {
+      auto bs = static_cast<char const*>(std::memchr(p, '\\', end - p));
+      scratch_.append(p, bs ? bs : end);
+      if (!bs) {
+        break;
+      }
+      // An unescaped quote ends the string, so a backslash is never last.
+      p = bs + 1;
+      switch (*p) {
+          // clang-format off
+        case '\"':    scratch_.push_back('\"'); ++p; break;
+        case '\\':    scratch_.push_back('\\'); ++p; break;
+        case '/':     scratch_.push_back('/');  ++p; break;
+        case 'b':     scratch_.push_back('\b'); ++p; break;
+        case 'f':     scratch_.push_back('\f'); ++p; break;
+        case 'n':     scratch_.push_back('\n'); ++p; break;
+        case 'r':     scratch_.push_back('\r'); ++p; break;
+        case 't':     scratch_.push_back('\t'); ++p; break;
+        case 'u':     ++p; p = decode_unicode_escape(p); break;
+        // clang-format on
+        default:
+          error(
+              p - input_.data(),
+              to<std::string>("unknown escape ", *p, " in string").c_str());
+      }
+    }
+    strings_.push_back(scratch_);
+  }
+
+  // As parseJson(); `p` follows the "\u". Hex digits are read from the input
+  // rather than the string body: the closing quote is not a hex digit.
+  char const* decode_unicode_escape(char const* p) {
+    auto input_end = input_.data() + input_.size();
+    auto read_hex = [&]() -> uint16_t {
+      if (input_end - p < 4) {
+        error(p - input_.data(), "expected 4 hex digits");
+      }
+      uint16_t ret = 0;
+      for (int i = 0; i < 4; ++i, ++p) {
+        char c = *p;
+        // clang-format off
+        ret = uint16_t(ret * 16 + (
+            c >= '0' && c <= '9' ? c - '0' :
+            c >= 'a' && c <= 'f' ? c - 'a' + 10 :
+            c >= 'A' && c <= 'F' ? c - 'A' + 10 :
+            (error(p - input_.data(), "invalid hex digit"), 0)));
+        // clang-format on
+      }
+      return ret;
+    };
+
+    uint16_t prefix = read_hex();
+    char32_t code_point = prefix;
+    if (utf16_code_unit_is_high_surrogate(prefix)) {
+      if (input_end - p < 2 || p[0] != '\\' || p[1] != 'u') {
+        error(
+            p - input_.data(),
+            "expected another unicode escape for second half of "
+            "surrogate pair");
+      }
+      p += 2;
+      uint16_t suffix = read_hex();
+      if (!utf16_code_unit_is_low_surrogate(suffix)) {
+        error(
+            p - input_.data(),
+            "second character in surrogate pair is invalid");
+      }
+      code_point = unicode_code_point_from_utf16_surrogate_pair(prefix, suffix);
+    } else if (!utf16_code_unit_is_bmp(prefix)) {
+      error(
+          p - input_.data(),
+          "invalid unicode code point (in range [0xdc00,0xdfff])");
+    }
+    appendCodePointToUtf8(code_point, scratch_);
+    return p;
+  }
+
+  // A number or literal, lexed as parseJson() does.
+  uint32_t parse_scalar(uint32_t pos) {
+    char const* s = input_.data() + pos;
+    std::size_t avail = input_.size() - pos;
+    auto starts_with = [&](StringPiece literal) {
+      return avail >= literal.size() &&
+          std::memcmp(s, literal.data(), literal.size()) == 0;
+    };
+
+    uint32_t length;
+    if (*s == '-' || is_digit(*s)) {
+      if (starts_with("-Infinity")) {
+        length = 9;
+        push_number(pos, length, tape_entry::neg_infinity);
+      } else {
+        length = lex_number(pos, s, avail);
+      }
+    } else if (starts_with("true")) {
+      length = 4;
+      push(pos, length, kind::true_, 0);
+    } else if (starts_with("false")) {
+      length = 5;
+      push(pos, length, kind::false_, 0);
+    } else if (starts_with("null")) {
+      length = 4;
+      push(pos, length, kind::null, 0);
+    } else if (starts_with("Infinity")) {
+      length = 8;
+      push_number(pos, length, tape_entry::infinity);
+    } else if (starts_with("NaN")) {
+      length = 3;
+      push_number(pos, length, tape_entry::nan);
+    } else {
+      error(pos, "expected json value");
+    }
+
+    // The index only has the scalar's first byte, so check that it ends here
+    // rather than running into something the index skipped.
+    uint32_t end = pos + length;
+    if (end < input_.size() && !is_delimiter(input_[end]) &&
+        !(input_[end] == '\0' && stack_.empty())) {
+      error(end, expected_after_value());
+    }
+    return end;
+  }
+
+  uint32_t lex_number(uint32_t pos, char const* s, std::size_t avail) {
+    bool const negative = *s == '-';
+    std::size_t i = negative;
+    while (i < avail && is_digit(s[i])) {
+      ++i;
+    }
+    if (negative && i < 2) {
+      error(pos, "expected digits after `-`");
+    }
+    std::size_t integral = i;
+    if (i < avail && s[i] == '.') {
+      ++i;
+      while (i < avail && is_digit(s[i])) {
+        ++i;
+      }
+    }
+    if (i < avail && (s[i] == 'e' || s[i] == 'E')) {
+      ++i;
+      if (i < avail && (s[i] == '+' || s[i] == '-')) {
+        ++i;
+      }
+      while (i < avail && is_digit(s[i])) {
+        ++i;
+      }
+    }
+
+    uint8_t flag = tape_entry::floating;
+    if (i == integral) {
+      constexpr StringPiece maxIntStr = "9223372036854775807";
+      constexpr StringPiece minIntStr = "-9223372036854775808";
+      auto extrema = negative ? minIntStr : maxIntStr;
+      StringPiece text(s, integral);
+      if (!opts_.double_fallback || text.size() < extrema.size() ||
+          (text.size() == extrema.size() && text <= extrema)) {
+        flag = tape_entry::integer;
+      }
+    }
+    push_number(pos, uint32_t(i), flag);
+    return uint32_t(i);
+  }
+
+  void push_number(uint32_t pos, uint32_t length, uint8_t flag) {
+    if (opts_.parse_numbers_as_strings) {
+      push(pos, length, kind::string, 0);
+    } else {
+      push(pos, length, kind::number, flag);
+    }
+  }
+
+  StringPiece input_;
+  serialization_opts const& opts_;
+  uint32_t const* indices_;
+  std::size_t count_;
+  std::size_t cursor_{0};
+  std::vector<tape_entry>& tape_;
+  string_tape& strings_;
+  std::vector<frame> stack_;
+  std::string scratch_;
+};
+
+bool supported(StringPiece json, serialization_opts const& opts) {
+  return !opts.allow_json5_experimental &&
+      json.size() < std::numeric_limits<uint32_t>::max();
+}
+
+} // namespace
+
+namespace detail {
+
+std::vector<uint32_t> json_structural_indices(StringPiece input) {
+  std::vector<uint32_t> ret(input.size());
+  ret.resize(find_structurals(input, ret.data()));
+  return ret;
+}
+
+} // namespace detail
+
+tape_document parse_tape(StringPiece json, serialization_opts const& opts) {
+  if (!supported(json, opts)) {
+    throw_exception<std::invalid_argument>(
+        opts.allow_json5_experimental
+            ? "parse_tape() does not support json5"
+            : "parse_tape() does not support inputs of 4GiB or more");
+  }
+  std::unique_ptr<uint32_t[]> indices(new uint32_t[json.size() + 1]);
+  auto count = find_structurals(json, indices.get());
+
+  tape_document doc;
+  doc.input_ = json;
+  doc.opts_.convert_int_keys = opts.convert_int_keys;
+  doc.opts_.validate_keys = opts.validate_keys;
+  // Every value has at least one structural character.
+  doc.tape_.reserve(count);
+  tape_builder(json, opts, indices.get(), count, doc.tape_, doc.strings_)
+      .build();
+  return doc;
+}
+
+void tape_document::error(uint32_t offset, char const* what) const {
+  throw_parse_error(input_, offset, what);
+}
+
+//////////////////////////////////////////////////////////////////////
+
+tape_entry const& tape_value::entry() const {
+  return doc_->tape_[index_];
+}
+
+uint32_t tape_value::next_index() const {
+  auto const& e = entry();
+  return e.type == kind::array || e.type == kind::object ? e.next : index_ + 1;
+}
+
+void tape_value::require(kind k, char const* expected) const {
+  if (FOLLY_UNLIKELY(entry().type != k)) {
+    throw_exception<TypeError>(expected, type());
+  }
+}
+
+dynamic::Type tape_value::type() const {
+  auto const& e = entry();
+  switch (e.type) {
+    case kind::null:
+      return dynamic::NULLT;
+    case kind::true_:
+    case kind::false_:
+      return dynamic::BOOL;
+    case kind::number:
+      return e.flags == tape_entry::integer ? dynamic::INT64 : dynamic::DOUBLE;
+    case kind::string:
+      return dynamic::STRING;
+    case kind::array:
+      return dynamic::ARRAY;
+    case kind::object:
+      return dynamic::OBJECT;
+  }
+  assume_unreachable();
+}
+
+bool tape_value::is_bool() const {
+  auto t = entry().type;
+  return t == kind::true_ || t == kind::false_;
+}
+
+bool tape_value::as_bool() const {
+  if (!is_bool()) {
+    throw_exception<TypeError>("bool", type());
+  }
+  return entry().type == kind::true_;
+}
+
+int64_t tape_value::as_int() const {
+  require(kind::number, "int64");
+  if (entry().flags == tape_entry::integer) {
+    return to<int64_t>(raw_number());
+  }
+  return to<int64_t>(as_double());
+}
+
+double tape_value::as_double() const {
+  require(kind::number, "double");
+  switch (entry().flags) {
+    case tape_entry::nan:
+      return std::numeric_limits<double>::quiet_NaN();
+    case tape_entry::infinity:
+      return std::numeric_limits<double>::infinity();
+    case tape_entry::neg_infinity:
+      return -std::numeric_limits<double>::infinity();
+    default:
+      return to<double>(raw_number());
+  }
+}
+
+StringPiece tape_value::as_string() const {
+  require(kind::string, "string");
+  auto const& e = entry();
+  if (e.flags) {
+    auto s = doc_->strings_[e.next];
+    return StringPiece(s.data(), s.size());
+  }
+  return doc_->input_.subpiece(e.offset, e.length);
+}
+
+StringPiece tape_value::raw_number() const {
+  require(kind::number, "number");
+  return doc_->input_.subpiece(entry().offset, entry().length);
+}
+
+std::size_t tape_value::size() const {
+  auto const& e = entry();
+  if (e.type != kind::array && e.type != kind::object) {
+    throw_exception<TypeError>("array/object", type());
+  }
+  return e.length;
+}
+
+tape_value tape_value::at(std::size_t i) const {
+  require(kind::array, "array");
+  if (i >= entry().length) {
+    throw_exception<std::out_of_range>("out of range in json tape array");
+  }
+  auto it = begin();
+  std::advance(it, i);
+  return *it;
+}
+
+std::optional<tape_value> tape_value::find(StringPiece key) const {
+  require(kind::object, "object");
+  std::optional<tape_value> ret;
+  for (auto [k, v] : members()) {
+    if (k.is_string() && k.as_string() == key) {
+      ret = v;
+    }
+  }
+  return ret;
+}
+
+tape_value tape_value::at(StringPiece key) const {
+  if (auto ret = find(key)) {
+    return *ret;
+  }
+  throw_exception<std::out_of_range>(
+      to<std::string>("couldn't find key ", key, " in json tape object"));
+}
+
+tape_value::iterator tape_value::begin() const {
+  require(kind::array, "array");
+  return iterator(doc_, index_ + 1);
+}
+
+tape_value::iterator tape_value::end() const {
+  require(kind::array, "array");
+  return iterator(doc_, entry().next);
+}
+
+auto tape_value::members() const -> range<member_iterator> {
+  require(kind::object, "object");
+  return {
+      member_iterator(doc_, index_ + 1), member_iterator(doc_, entry().next)};
+}
+
+dynamic tape_value::to_dynamic() const {
+  auto const& e = entry();
+  switch (e.type) {
+    case kind::null:
+      return nullptr;
+    case kind::true_:
+      return true;
+    case kind::false_:
+      return false;
+    case kind::number:
+      if (e.flags == tape_entry::integer) {
+        return to<int64_t>(raw_number());
+      }
+      return as_double();
+    case kind::string:
+      return as_string().str();
+    case kind::array: {
+      dynamic ret = dynamic::array;
+      ret.reserve(e.length);
+      for (auto v : *this) {
+        ret.push_back(v.to_dynamic());
+      }
+      return ret;
+    }
+    case kind::object: {
+      auto const& opts = doc_->opts_;
+      bool const distinct = opts.validate_keys || opts.convert_int_keys;
+      dynamic ret = dynamic::object;
+      ret.reserve(e.length);
+      for (auto [k, v] : members()) {
+        dynamic key = k.to_dynamic();
+        if (opts.convert_int_keys && key.isInt()) {
+          key = key.asString();
+        }
+        auto value = v.to_dynamic();
+        auto [it, inserted] = ret.try_emplace(std::move(key), std::move(value));
+        if (!inserted) {
+          if (distinct) {
+            k.error("duplicate key inserted");
+          }
+          it->second = std::move(value);
+        }
+      }
+      return ret;
+    }
+  }
+  assume_unreachable();
+}
+
+void tape_value::error(char const* what) const {
+  doc_->error(entry().offset, what);
+}
+
+} // namespace json
+
+dynamic parseJsonFast(StringPiece range, json::serialization_opts const& opts) {
+  if (!json::supported(range, opts)) {
+    return parseJson(range, opts);
+  }
+  return json::parse_tape(range, opts).root().to_dynamic();
+}
+
+dynamic parseJsonFast(StringPiece range) {
+  return parseJsonFast(range, json::serialization_opts());
+}
+
+} // namespace folly
@@ -0,0 +1,321 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * A two-stage JSON parser that reads values on demand, after simdjson
+ * (Langdale and Lemire, "Parsing Gigabytes of JSON per Second").
+ *
+ * Stage one finds the structural characters of the input 64 bytes at a time
+ * with SIMD compares: brackets, braces, colons and commas outside of strings,
+ * the quotes around strings, and the first character of every other scalar.
+ * Stage two walks those positions and records the document as a tape: one
+ * fixed-size entry per value, in document order, and no allocation per value.
+ * Numbers and strings without escapes are left in the input, and each
+ * container entry records where its contents end, so that a cursor can step
+ * over a subtree without looking at it.
+ *
+ *   std::string text = readFile(...);
+ *   auto doc = json::parse_tape(text);
+ *   for (auto status : doc.root()["statuses"]) {
+ *     int64_t id = status["id"].as_int();
+ *     StringPiece name = status["user"]["screen_name"].as_string();
+ *   }
+ *
+ * A tape_document refers into the text it was parsed from, which must outlive
+ * it.
+ *
+ * parse_tape() rejects the same documents that parseJson() rejects with the
+ * same options, throwing json::parse_error, and to_dynamic() then produces
+ * the same dynamic. The exceptions are numbers, which are only checked
+ * lexically while parsing and converted when read, so a 20-digit integer
+ * throws ConversionError from as_int() or to_dynamic() rather than from
+ * parse_tape(); and validate_keys, which only to_dynamic() enforces.
+ * allow_json5_experimental is not supported.
+ *
+ * parseJsonFast() is a drop-in replacement for parseJson() built on this.
+ *
+ * @file json_tape.h
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <folly/Range.h>
+#include <folly/container/tape.h>
+#include <folly/json/dynamic.h>
+#include <folly/json/json.h>
+
+namespace folly {
+namespace json {
+
+class tape_document;
+
+namespace detail {
+
+struct tape_entry {
+  enum class kind : uint8_t {
+    null,
+    true_,
+    false_,
+    number,
+    string,
+    array,
+    object,
+  };
+
+  // Number entries: how to convert the text.
+  enum number_flag : uint8_t { integer, floating, nan, infinity, neg_infinity };
+
+  uint32_t offset; // of the value's first character in the input
+  uint32_t length; // strings and numbers: of the text; containers: of elements
+  uint32_t next; // containers: tape index after the subtree; escaped strings:
+                 // index in tape_document's string tape
+  kind type;
+  uint8_t flags; // numbers: number_flag; strings: whether escaped
+};
+
+/**
+ * The structural positions of `input`, in order, as found by stage one.
+ * Exposed for tests.
+ */
+std::vector<uint32_t> json_structural_indices(StringPiece input);
+
+} // namespace detail
+
+/**
+ * A value in a tape_document: a cheap, trivially copyable cursor.
+ *
+ * Accessors throw TypeError when the value is of the wrong type, like the
+ * corresponding dynamic accessors.
+ */
+class tape_value {
+ public:
+  class iterator;
+  class member_iterator;
+
+  template <typename It>
+  struct range {
+    It b;
+    It e;
+    It begin() const { return b; }
+    It end() const { return e; }
+  };
+
+  /**
+   * The type that to_dynamic() will produce. Numbers are INT64 or DOUBLE as
+   * parseJson() would convert them; under parse_numbers_as_strings they are
+   * STRING.
+   */
+  dynamic::Type type() const;
+
+  bool is_null() const { return entry().type == kind::null; }
+  bool is_bool() const;
+  bool is_int() const { return type() == dynamic::INT64; }
+  bool is_double() const { return type() == dynamic::DOUBLE; }
+  bool is_number() const { return entry().type == kind::number; }
+  bool is_string() const { return entry().type == kind::string; }
+  bool is_array() const { return entry().type == kind::array; }
+  bool is_object() const { return entry().type == kind::object; }
+
+  bool as_bool() const;
+  // Numbers convert both ways, throwing ConversionError if the value does not
+  // fit, as to<>() does.
+  int64_t as_int() const;
+  double as_double() const;
+  // Points into the input unless the string has escapes, and into the
+  // document otherwise; valid as long as both are.
+  StringPiece as_string() const;
+  // The number as written in the input.
+  StringPiece raw_number() const;
+
+  // Number of elements of an array or members of an object.
+  std::size_t size() const;
+
+  // Array element; throws std::out_of_range if out of range. Linear in `i`.
+  tape_value at(std::size_t i) const;
+  template <
+      typename Index,
+      std::enable_if_t<std::is_integral_v<Index>, int> = 0>
+  tape_value operator[](Index i) const {
+    return at(std::size_t(i));
+  }
+
+  // Object member with the given string key, the last one if repeated, as
+  // parseJson() keeps. Linear in the size of the object.
+  std::optional<tape_value> find(StringPiece key) const;
+  // Same, but throws std::out_of_range if there is none.
+  tape_value at(StringPiece key) const;
+  tape_value operator[](StringPiece key) const { return at(key); }
+
+  // Elements of an array.
+  iterator begin() const;
+  iterator end() const;
+  // (key, value) pairs of an object.
+  range<member_iterator> members() const;
+
+  /** Materialize this value and everything below it. */
+  dynamic to_dynamic() const;
+
+  /**
+   * Throw parse_error at this value's position in the input, for consumers
+   * that check the document further than parse_tape() does.
+   */
+  [[noreturn]] void error(char const* what) const;
+
+ private:
+  friend class tape_document;
+  using kind = detail::tape_entry::kind;
+
+  tape_value(tape_document const* doc, uint32_t index)
+      : doc_(doc), index_(index) {}
+
+  detail::tape_entry const& entry() const;
+  uint32_t next_index() const;
+  void require(kind k, char const* expected) const;
+
+  tape_document const* doc_;
+  uint32_t index_;
+};
+
+class tape_value::iterator {
+ public:
+  using iterator_category = std::forward_iterator_tag;
+  using value_type = tape_value;
+  using difference_type = std::ptrdiff_t;
+  using pointer = void;
+  using reference = tape_value;
+
+  iterator() = default;
+
+  tape_value operator*() const { return tape_value(doc_, index_); }
+  iterator& operator++() {
+    index_ = tape_value(doc_, index_).next_index();
+    return *this;
+  }
+  iterator operator++(int) {
+    auto ret = *this;
+    ++*this;
+    return ret;
+  }
+  friend bool operator==(iterator const& a, iterator const& b) {
+    return a.index_ == b.index_;
+  }
+  friend bool operator!=(iterator const& a, iterator const& b) {
+    return !(a == b);
+  }
+
+ private:
+  friend class tape_value;
+  iterator(tape_document const* doc, uint32_t index)
+      : doc_(doc), index_(index) {}
+
+  tape_document const* doc_{};
+  uint32_t index_{};
+};
+
+class tape_value::member_iterator {
+ public:
+  using iterator_category = std::forward_iterator_tag;
+  using value_type = std::pair<tape_value, tape_value>;
+  using difference_type = std::ptrdiff_t;
+  using pointer = void;
+  using reference = value_type;
+
+  member_iterator() = default;
+
+  value_type operator*() const {
+    tape_value key(doc_, index_);
+    return {key, tape_value(doc_, key.next_index())};
+  }
+  member_iterator& operator++() {
+    index_ = tape_value(doc_, (**this).second.index_).next_index();
+    return *this;
+  }
+  member_iterator operator++(int) {
+    auto ret = *this;
+    ++*this;
+    return ret;
+  }
+  friend bool operator==(member_iterator const& a, member_iterator const& b) {
+    return a.index_ == b.index_;
+  }
+  friend bool operator!=(member_iterator const& a, member_iterator const& b) {
+    return !(a == b);
+  }
+
+ private:
+  friend class tape_value;
+  member_iterator(tape_document const* doc, uint32_t index)
+      : doc_(doc), index_(index) {}
+
+  tape_document const* doc_{};
+  uint32_t index_{};
+};
+
+/**
+ * A parsed document. Movable, but tape_values into it do not survive a move.
+ */
+class tape_document {
+ public:
+  tape_value root() const { return tape_value(this, 0); }
+
+  // Entries in the tape, one per value (object keys included).
+  std::size_t tape_size() const { return tape_.size(); }
+
+ private:
+  friend class tape_value;
+  friend tape_document parse_tape(StringPiece, serialization_opts const&);
+
+  // The parse options that to_dynamic() still needs.
+  struct options {
+    bool convert_int_keys{false};
+    bool validate_keys{false};
+  };
+
+  tape_document() = default;
+
+  [[noreturn]] void error(uint32_t offset, char const* what) const;
+
+  StringPiece input_;
+  std::vector<detail::tape_entry> tape_;
+  string_tape strings_;
+  options opts_;
+};
+
+/**
+ * Parse `json` into a tape_document referring into it. Throws parse_error on
+ * malformed input, and std::invalid_argument for allow_json5_experimental.
+ */
+tape_document parse_tape(
+    StringPiece json, serialization_opts const& opts = serialization_opts());
+
+} // namespace json
+
+/**
+ * Equivalent to parseJson(), faster: parses into a tape, then builds the
+ * dynamic from it. Falls back to parseJson() for json5.
+ */
+dynamic parseJsonFast(StringPiece, json::serialization_opts const&);
+dynamic parseJsonFast(StringPiece);
+
+} // namespace folly
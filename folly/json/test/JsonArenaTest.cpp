@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/json/json_arena.h>
+
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <folly/Conv.h>
+#include <folly/portability/GTest.h>
+
+using folly::dynamic;
+using folly::parseJson;
+using folly::StringPiece;
+using folly::json::arena_document;
+using folly::json::arena_value;
+using folly::json::parse_arena;
+using folly::json::parse_error;
+using folly::json::serialization_opts;
+
+TEST(JsonArena, MatchesParseJson) {
+  std::vector<std::string> docs = {
+      "null",
+      "true",
+      "-12",
+      "1.5e3",
+      "\"a\\n\\u00e9\\ud83d\\ude00\"",
+      "[]",
+      "{}",
+      "[1, [2, [3, []]], {\"a\": {}}]",
+      "{\"b\": 1, \"a\": [true, false, null], \"c\": {\"d\": \"e\"}}",
+      "{\"k\": 1, \"k\": 2, \"j\": 0}",
+      "  [\"x\", 9223372036854775807, -0.0, 1e-300]  ",
+  };
+  dynamic big = dynamic::object;
+  for (int i = 0; i < 100; ++i) {
+    big[folly::to<std::string>("key", i)] =
+        dynamic::array(i, folly::to<std::string>(i), dynamic::object("x", i));
+  }
+  docs.push_back(folly::toJson(big));
+
+  for (auto const& doc : docs) {
+    EXPECT_EQ(parseJson(doc), parse_arena(doc).root().to_dynamic()) << doc;
+  }
+
+  for (auto bad : {"", "[1,]", "{\"a\" 1}", "[1] 2", "\"\\x\"", "{]"}) {
+    EXPECT_THROW(parse_arena(bad), parse_error) << bad;
+  }
+}
+
+TEST(JsonArena, Options) {
+  serialization_opts opts;
+  opts.parse_numbers_as_strings = true;
+  auto doc = parse_arena("[1.50, 2]", opts);
+  EXPECT_EQ("1.50", doc.root()[0].as_string());
+  EXPECT_EQ(parseJson("[1.50, 2]", opts), doc.root().to_dynamic());
+
+  serialization_opts intKeys;
+  intKeys.convert_int_keys = true;
+  auto keys = parse_arena("{1: \"a\", \"2\": \"b\"}", intKeys);
+  EXPECT_EQ("a", keys.root()["1"].as_string());
+  EXPECT_EQ(
+      parseJson("{1: \"a\", \"2\": \"b\"}", intKeys),
+      keys.root().to_dynamic());
+  EXPECT_THROW(parse_arena("{1: \"a\", \"1\": \"b\"}", intKeys), parse_error);
+
+  serialization_opts validate;
+  validate.validate_keys = true;
+  EXPECT_NO_THROW(parse_arena("{\"a\": 1, \"b\": {\"a\": 2}}", validate));
+  try {
+    parse_arena("{\"a\": 1,\n \"b\": 2, \"a\": 3}", validate);
+    ADD_FAILURE();
+  } catch (parse_error const& e) {
+    EXPECT_NE(std::string::npos, StringPiece(e.what()).find("line 1"))
+        << e.what();
+    EXPECT_NE(
+        std::string::npos,
+        StringPiece(e.what()).find("duplicate key inserted"));
+  }
+}
+
+TEST(JsonArena, Access) {
+  auto doc = parse_arena(
+      "{\"b\": [1, 2.5, \"s\"], \"a\": true, \"c\": null, \"a\": false}");
+  auto const& root = doc.root();
+  ASSERT_TRUE(root.is_object());
+  EXPECT_EQ(3, root.size());
+
+  // Members are sorted, and the last of repeated keys wins.
+  std::vector<std::string> keys;
+  for (auto const& m : root.members()) {
+    keys.push_back(m.key.str());
+  }
+  EXPECT_EQ((std::vector<std::string>{"a", "b", "c"}), keys);
+  EXPECT_FALSE(root["a"].as_bool());
+  EXPECT_TRUE(root["c"].is_null());
+  EXPECT_EQ(nullptr, root.find("d"));
+  EXPECT_THROW(root["d"], std::out_of_range);
+
+  auto const& b = root["b"];
+  EXPECT_EQ(3, b.size());
+  EXPECT_EQ(1, b[0].as_int());
+  EXPECT_EQ(1.0, b[0].as_double());
+  EXPECT_EQ(2.5, b[1].as_double());
+  EXPECT_THROW(b[1].as_int(), folly::ConversionError);
+  EXPECT_EQ("s", b[2].as_string());
+  EXPECT_THROW(b[3], std::out_of_range);
+  int n = 0;
+  for (auto const& v : b) {
+    n += v.is_number();
+  }
+  EXPECT_EQ(2, n);
+
+  EXPECT_THROW(b.as_string(), folly::TypeError);
+  EXPECT_THROW(b["x"], folly::TypeError);
+  EXPECT_THROW(root[0], folly::TypeError);
+  EXPECT_THROW(b[2].size(), folly::TypeError);
+}
+
+TEST(JsonArena, Build) {
+  arena_document doc;
+  std::vector<arena_value> many;
+  for (int i = 0; i < 50; ++i) {
+    many.push_back(doc.string(folly::to<std::string>("v", i)));
+  }
+  std::vector<std::string> names;
+  std::vector<arena_value::member> members;
+  for (int i = 50; i-- > 0;) {
+    names.push_back(folly::to<std::string>("k", i));
+  }
+  for (int i = 0; i < 50; ++i) {
+    members.push_back({names[i], 49 - i});
+  }
+  {
+    // Keys and strings are copied, so temporaries are fine.
+    std::string key = "name";
+    doc.root() = doc.object({
+        {key, doc.string(std::string("value"))},
+        {"list", doc.array({1, 2.5, true, nullptr, doc.array({})})},
+        {"many", doc.array(folly::range(many))},
+        {"sorted", doc.object(folly::range(members))},
+        {"empty", doc.object({})},
+    });
+    key = "xxxx";
+  }
+  dynamic expected = dynamic::object("name", "value")(
+      "list", dynamic::array(1, 2.5, true, nullptr, dynamic::array()))(
+      "many", dynamic::array)("sorted", dynamic::object)(
+      "empty", dynamic::object);
+  for (int i = 0; i < 50; ++i) {
+    expected["many"].push_back(folly::to<std::string>("v", i));
+    expected["sorted"][folly::to<std::string>("k", i)] = i;
+  }
+  EXPECT_EQ(expected, doc.root().to_dynamic());
+  EXPECT_EQ("v49", doc.root()["many"][49].as_string());
+  EXPECT_EQ(49, doc.root()["sorted"]["k49"].as_int());
+  EXPECT_EQ(50, doc.root()["sorted"].size());
+
+  // Values can be replaced in place.
+  doc.root()["list"][0] = doc.string("one");
+  *doc.root().find("name") = 7;
+  EXPECT_EQ("one", doc.root()["list"][0].as_string());
+  EXPECT_EQ(7, doc.root()["name"].as_int());
+
+  // Moving the document keeps values in place.
+  auto const* list = &doc.root()["list"][0];
+  arena_document moved = std::move(doc);
+  EXPECT_EQ(list, &moved.root()["list"][0]);
+  EXPECT_EQ("one", list->as_string());
+}
+
+TEST(JsonArena, Copy) {
+  dynamic d = parseJson(
+      "{\"a\": [1, {\"b\": \"c\"}, [], {}], \"d\": -1.5, \"e\": null}");
+  arena_document doc;
+  doc.root() = doc.copy(d);
+  EXPECT_EQ(d, doc.root().to_dynamic());
+  EXPECT_EQ("c", doc.root()["a"][1]["b"].as_string());
+
+  EXPECT_THROW(doc.copy(dynamic::object(1, 2)), folly::TypeError);
+}
+
+TEST(JsonArena, SingleBlock) {
+  dynamic d = dynamic::array;
+  for (int i = 0; i < 10000; ++i) {
+    d.push_back(dynamic::object("id", i)("name", folly::to<std::string>(i)));
+  }
+  auto json = folly::toJson(d);
+  auto doc = parse_arena(json);
+  EXPECT_EQ(d, doc.root().to_dynamic());
+  // One block, holding 10000 values, 20000 members and their keys and
+  // strings, of at most 10 characters per object.
+  auto nodes =
+      10000 * sizeof(arena_value) + 20000 * sizeof(arena_value::member);
+  EXPECT_GE(doc.allocated_size(), nodes);
+  EXPECT_LT(doc.allocated_size(), nodes + 10000 * 10 + 4096);
+}
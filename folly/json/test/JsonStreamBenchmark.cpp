@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/json/json_stream.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+#include <folly/Benchmark.h>
+#include <folly/Conv.h>
+#include <folly/io/IOBuf.h>
+#include <folly/portability/GFlags.h>
+
+using namespace folly;
+
+// Counts operator new calls and bytes. IOBuf buffers come from malloc instead,
+// so the benchmarks below add the buffers of their output chain themselves.
+namespace {
+std::atomic<uint64_t> gAllocs{0};
+std::atomic<uint64_t> gAllocBytes{0};
+} // namespace
+
+void* operator new(std::size_t size) {
+  gAllocs.fetch_add(1, std::memory_order_relaxed);
+  gAllocBytes.fetch_add(size, std::memory_order_relaxed);
+  if (void* p = std::malloc(size ? size : 1)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+  std::free(p);
+}
+
+namespace {
+
+// An API response of 5000 records (~1MB compact): the document sizes where
+// serialize() + copy costs the most.
+dynamic makeResponse() {
+  dynamic items = dynamic::array;
+  for (int64_t i = 0; i < 5000; ++i) {
+    items.push_back(
+        dynamic::object("id", 1000000 + i)("name", to<std::string>("item-", i))(
+            "description",
+            "a \"quoted\" description of the item, long enough to matter")(
+            "price", 19.99 + i)("in_stock", i % 3 != 0)(
+            "tags", dynamic::array("new", "sale", "caf\xc3\xa9"))(
+            "dimensions",
+            dynamic::object("w", 1.5 * i)("h", 2.25)("d", nullptr)));
+  }
+  return dynamic::object("items", std::move(items))("next", "cursor-5000");
+}
+
+dynamic const& response() {
+  static dynamic const doc = makeResponse();
+  return doc;
+}
+
+// The same document, emitted without building a dynamic.
+void writeResponse(json::stream_writer& w) {
+  w.begin_object().key("items").begin_array();
+  for (int64_t i = 0; i < 5000; ++i) {
+    w.begin_object();
+    w.key("id").value(1000000 + i);
+    w.key("name").value(to<std::string>("item-", i));
+    w.key("description")
+        .value("a \"quoted\" description of the item, long enough to matter");
+    w.key("price").value(19.99 + i);
+    w.key("in_stock").value(i % 3 != 0);
+    w.key("tags").begin_array();
+    w.value("new").value("sale").value("caf\xc3\xa9");
+    w.end_array();
+    w.key("dimensions").begin_object();
+    w.key("w").value(1.5 * i).key("h").value(2.25).key("d").value(nullptr);
+    w.end_object();
+    w.end_object();
+  }
+  w.end_array().key("next").value("cursor-5000").end_object();
+}
+
+// Per iteration: operator new calls and bytes, plus the output's buffers.
+class AllocStats {
+ public:
+  AllocStats() {
+    BENCHMARK_SUSPEND {
+      allocs_ = gAllocs.load();
+      bytes_ = gAllocBytes.load();
+    }
+  }
+
+  void addOutput(IOBuf const& buf) {
+    bufs_ += buf.countChainElements();
+    capacity_ += buf.computeChainCapacity();
+  }
+
+  void report(UserCounters& counters, size_t iters) const {
+    BENCHMARK_SUSPEND {
+      double n = iters ? double(iters) : 1.0;
+      counters["allocs"] = double(gAllocs.load() - allocs_ + bufs_) / n;
+      counters["alloc_KiB"] =
+          double(gAllocBytes.load() - bytes_ + capacity_) / n / 1024;
+    }
+  }
+
+ private:
+  uint64_t allocs_{0};
+  uint64_t bytes_{0};
+  uint64_t bufs_{0};
+  uint64_t capacity_{0};
+};
+
+} // namespace
+
+BENCHMARK_COUNTERS(serialize_and_copyBuffer, counters, iters) {
+  BENCHMARK_SUSPEND {
+    response();
+  }
+  AllocStats stats;
+  json::serialization_opts opts;
+  for (size_t i = 0; i < iters; ++i) {
+    auto str = json::serialize(response(), opts);
+    auto buf = IOBuf::copyBuffer(str);
+    stats.addOutput(*buf);
+    doNotOptimizeAway(buf);
+  }
+  stats.report(counters, iters);
+}
+
+BENCHMARK_COUNTERS_RELATIVE(serialize_to_IOBufQueue, counters, iters) {
+  BENCHMARK_SUSPEND {
+    response();
+  }
+  AllocStats stats;
+  json::serialization_opts opts;
+  for (size_t i = 0; i < iters; ++i) {
+    IOBufQueue queue{IOBufQueue::cacheChainLength()};
+    json::serialize(response(), queue, opts);
+    auto buf = queue.move();
+    stats.addOutput(*buf);
+    doNotOptimizeAway(buf);
+  }
+  stats.report(counters, iters);
+}
+
+BENCHMARK_COUNTERS_RELATIVE(serialize_to_Appender, counters, iters) {
+  BENCHMARK_SUSPEND {
+    response();
+  }
+  AllocStats stats;
+  json::serialization_opts opts;
+  for (size_t i = 0; i < iters; ++i) {
+    auto buf = IOBuf::create(json::kDefaultStreamChunkSize);
+    io::Appender app(buf.get(), json::kDefaultStreamChunkSize);
+    json::serialize(response(), app, opts);
+    stats.addOutput(*buf);
+    doNotOptimizeAway(buf);
+  }
+  stats.report(counters, iters);
+}
+
+BENCHMARK_COUNTERS_RELATIVE(stream_writer_to_IOBufQueue, counters, iters) {
+  AllocStats stats;
+  json::serialization_opts opts;
+  for (size_t i = 0; i < iters; ++i) {
+    IOBufQueue queue{IOBufQueue::cacheChainLength()};
+    json::stream_writer w(queue, opts);
+    writeResponse(w);
+    w.flush();
+    auto buf = queue.move();
+    stats.addOutput(*buf);
+    doNotOptimizeAway(buf);
+  }
+  stats.report(counters, iters);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK_COUNTERS(pretty_serialize_and_copyBuffer, counters, iters) {
+  BENCHMARK_SUSPEND {
+    response();
+  }
+  AllocStats stats;
+  json::serialization_opts opts;
+  opts.pretty_formatting = true;
+  for (size_t i = 0; i < iters; ++i) {
+    auto str = json::serialize(response(), opts);
+    auto buf = IOBuf::copyBuffer(str);
+    stats.addOutput(*buf);
+    doNotOptimizeAway(buf);
+  }
+  stats.report(counters, iters);
+}
+
+BENCHMARK_COUNTERS_RELATIVE(pretty_serialize_to_IOBufQueue, counters, iters) {
+  BENCHMARK_SUSPEND {
+    response();
+  }
+  AllocStats stats;
+  json::serialization_opts opts;
+  opts.pretty_formatting = true;
+  for (size_t i = 0; i < iters; ++i) {
+    IOBufQueue queue{IOBufQueue::cacheChainLength()};
+    json::serialize(response(), queue, opts);
+    auto buf = queue.move();
+    stats.addOutput(*buf);
+    doNotOptimizeAway(buf);
+  }
+  stats.report(counters, iters);
+}
+
+int main(int argc, char** argv) {
+  folly::gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,233 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/json/json_stream.h>
+
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+#include <folly/Conv.h>
+#include <folly/io/IOBuf.h>
+#include <folly/portability/GTest.h>
+
+using folly::dynamic;
+using folly::IOBuf;
+using folly::IOBufQueue;
+using folly::json::serialization_opts;
+using folly::json::stream_writer;
+
+namespace {
+
+dynamic makeDoc() {
+  dynamic items = dynamic::array;
+  for (int i = 0; i < 200; ++i) {
+    items.push_back(
+        dynamic::object("id", i)("name", folly::to<std::string>("item ", i))(
+            "price", 0.5 * i)("tags", dynamic::array("a", "\"b\"", "\xc3\xa9"))(
+            "empty", dynamic::object)("none", dynamic::array)("n", nullptr)(
+            "ok", i % 2 == 0));
+  }
+  return dynamic::object("items", std::move(items))("count", 200)(
+      "nested", dynamic::array(dynamic::array(dynamic::array(1, 2), 3)));
+}
+
+std::string toString(IOBufQueue& queue) {
+  auto buf = queue.move();
+  return buf ? buf->toString() : std::string();
+}
+
+std::string serializeToQueue(
+    dynamic const& dyn, serialization_opts const& opts, size_t chunkSize) {
+  IOBufQueue queue{IOBufQueue::cacheChainLength()};
+  folly::json::serialize(dyn, queue, opts, chunkSize);
+  return toString(queue);
+}
+
+} // namespace
+
+TEST(JsonStream, MatchesSerialize) {
+  auto doc = makeDoc();
+  for (int variant = 0; variant < 5; ++variant) {
+    serialization_opts opts;
+    switch (variant) {
+      case 1:
+        opts.pretty_formatting = true;
+        break;
+      case 2:
+        opts.pretty_formatting = true;
+        opts.pretty_formatting_indent_width = 4;
+        opts.sort_keys = true;
+        break;
+      case 3:
+        opts.encode_non_ascii = true;
+        opts.javascript_safe = true;
+        break;
+      case 4:
+        opts.sort_keys_by = [](dynamic const& a, dynamic const& b) {
+          return b < a;
+        };
+        break;
+    }
+    auto expected = folly::json::serialize(doc, opts);
+    for (size_t chunkSize : {1, 7, 100, 4096, 1 << 20}) {
+      EXPECT_EQ(expected, serializeToQueue(doc, opts, chunkSize))
+          << variant << " " << chunkSize;
+    }
+  }
+
+  serialization_opts opts;
+  for (auto scalar :
+       {dynamic(nullptr), dynamic(3), dynamic("x"), dynamic(2.5)}) {
+    EXPECT_EQ(
+        folly::json::serialize(scalar, opts),
+        serializeToQueue(scalar, opts, 1));
+  }
+}
+
+TEST(JsonStream, Chunks) {
+  auto doc = makeDoc();
+  serialization_opts opts;
+  auto expected = folly::json::serialize(doc, opts);
+
+  IOBufQueue queue{IOBufQueue::cacheChainLength()};
+  folly::json::serialize(doc, queue, opts, 1024);
+  EXPECT_EQ(expected.size(), queue.chainLength());
+  auto buf = queue.move();
+  // Buffers of about a chunk each, not one per flush.
+  EXPECT_GT(buf->countChainElements(), expected.size() / 2048);
+  EXPECT_LE(buf->countChainElements(), expected.size() / 1024 + 1);
+  EXPECT_EQ(expected, buf->toString());
+
+  // Appending after what the queue already holds.
+  queue.append("prefix");
+  folly::json::serialize(doc, queue, opts, 1024);
+  EXPECT_EQ("prefix" + expected, toString(queue));
+}
+
+TEST(JsonStream, Appender) {
+  auto doc = makeDoc();
+  serialization_opts opts;
+  opts.pretty_formatting = true;
+  auto buf = IOBuf::create(0);
+  folly::io::Appender app(buf.get(), 512);
+  folly::json::serialize(doc, app, opts, 256);
+  EXPECT_EQ(folly::json::serialize(doc, opts), buf->toString());
+}
+
+TEST(JsonStream, Errors) {
+  serialization_opts opts;
+  IOBufQueue queue;
+  EXPECT_THROW(
+      folly::json::serialize(dynamic::array(1, NAN), queue, opts),
+      folly::json::print_error);
+  EXPECT_THROW(
+      folly::json::serialize(dynamic::object(1, 2), queue, opts),
+      folly::json::print_error);
+}
+
+TEST(JsonStream, Writer) {
+  auto doc = makeDoc();
+  for (bool pretty : {false, true}) {
+    // The writer keeps members in the order written, so compare with the
+    // dynamic's members sorted, and write them sorted.
+    serialization_opts opts;
+    opts.pretty_formatting = pretty;
+    opts.sort_keys = true;
+    for (size_t chunkSize : {1, 64, 1 << 20}) {
+      IOBufQueue queue;
+      stream_writer w(queue, opts, chunkSize);
+      w.begin_object().key("count").value(200u).key("items").begin_array();
+      for (int i = 0; i < 200; ++i) {
+        w.begin_object();
+        w.key("empty").begin_object().end_object();
+        w.key("id").value(i);
+        w.key("n").value(nullptr);
+        w.key("name").value(folly::to<std::string>("item ", i));
+        w.key("none").begin_array().end_array();
+        w.key("ok").value(i % 2 == 0);
+        w.key("price").value(0.5 * i);
+        w.key("tags").begin_array().value("a").value("\"b\"");
+        w.value("\xc3\xa9").end_array();
+        w.end_object();
+      }
+      w.end_array();
+      // A dynamic nested in written containers is indented to match.
+      w.key("nested").value(doc["nested"]);
+      EXPECT_FALSE(w.done());
+      w.end_object();
+      EXPECT_TRUE(w.done());
+      w.flush();
+      EXPECT_EQ(folly::json::serialize(doc, opts), toString(queue))
+          << pretty << " " << chunkSize;
+    }
+  }
+}
+
+TEST(JsonStream, WriterScalars) {
+  auto written = [](auto&& v, serialization_opts const& opts) {
+    IOBufQueue queue;
+    stream_writer w(queue, opts);
+    w.value(v);
+    w.flush();
+    return toString(queue);
+  };
+  serialization_opts opts;
+  EXPECT_EQ("null", written(nullptr, opts));
+  EXPECT_EQ("true", written(true, opts));
+  EXPECT_EQ("-7", written(int8_t(-7), opts));
+  EXPECT_EQ("0.1", written(0.1, opts));
+  EXPECT_EQ("\"caf\xc3\xa9\"", written("caf\xc3\xa9", opts));
+  EXPECT_EQ("\"s\"", written(std::string("s"), opts));
+  EXPECT_EQ("[1,\"2\"]", written(dynamic::array(1, "2"), opts));
+  EXPECT_THROW(written(NAN, opts), folly::json::print_error);
+  EXPECT_THROW(written(uint64_t(1) << 63, opts), folly::ConversionError);
+
+  serialization_opts nonAscii;
+  nonAscii.encode_non_ascii = true;
+  EXPECT_EQ("\"caf\\u00e9\"", written("caf\xc3\xa9", nonAscii));
+
+  serialization_opts nanOk;
+  nanOk.allow_nan_inf = true;
+  EXPECT_EQ("Infinity", written(INFINITY, nanOk));
+}
+
+TEST(JsonStream, WriterMisuse) {
+  serialization_opts opts;
+  IOBufQueue queue;
+  {
+    stream_writer w(queue, opts);
+    w.value(1);
+    EXPECT_THROW(w.value(2), std::logic_error);
+  }
+  {
+    stream_writer w(queue, opts);
+    w.begin_object();
+    EXPECT_THROW(w.value(1), std::logic_error);
+    EXPECT_THROW(w.end_array(), std::logic_error);
+    w.key("k");
+    EXPECT_THROW(w.key("k2"), std::logic_error);
+    EXPECT_THROW(w.end_object(), std::logic_error);
+  }
+  {
+    stream_writer w(queue, opts);
+    EXPECT_THROW(w.key("k"), std::logic_error);
+    EXPECT_THROW(w.end_object(), std::logic_error);
+    w.begin_array();
+    EXPECT_THROW(w.key("k"), std::logic_error);
+    EXPECT_THROW(w.end_object(), std::logic_error);
+  }
+}
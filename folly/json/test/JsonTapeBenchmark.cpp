@@ -0,0 +1,254 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/json/json_tape.h>
+
+#include <cstdint>
+#include <string>
+
+#include <folly/Benchmark.h>
+#include <folly/Conv.h>
+#include <folly/json/json_arena.h>
+#include <folly/portability/GFlags.h>
+
+using namespace folly;
+
+// Stand-ins for the twitter.json and canada.json documents that JSON parsers
+// are usually measured on, generated so that the benchmark is self-contained.
+//
+// twitter: 400 search results (~850KB), objects and strings: short keys, ids,
+// many \u escapes, nested users and entities.
+// canada: a polygon of 100 rings of 1000 points (~3.8MB), arrays of doubles
+// printed to full precision.
+
+namespace {
+
+std::string makeTwitter() {
+  static constexpr StringPiece kTexts[] = {
+      "RT @aym0566x: \xe5\x90\x8d\xe5\x89\x8d:\xe5\x89\x8d\xe7\x94\xb0\n"
+      "\xe7\x9c\x8c:\xe4\xba\xac\xe9\x83\xbd",
+      "Let's \"quote\" something, with a link http://t.co/Xk7Kp3 #json",
+      "plain ascii text that runs on for a while, as tweets tend to do",
+  };
+  dynamic statuses = dynamic::array;
+  for (int i = 0; i < 400; ++i) {
+    int64_t id = 505874924095815681 + i * 7919;
+    dynamic user = dynamic::object("id", 1186275104 + i)(
+        "id_str", to<std::string>(1186275104 + i))("name", "AYUMI")(
+        "screen_name", to<std::string>("user_", i))("location", "")(
+        "description",
+        "\xe3\x83\x86\xe3\x83\x8b\xe3\x82\xb9 loves \"json\" and <html>")(
+        "url", nullptr)(
+        "entities",
+        dynamic::object(
+            "description", dynamic::object("urls", dynamic::array)))(
+        "protected", false)("followers_count", 262 + i)(
+        "friends_count", 252)("listed_count", 0)(
+        "created_at", "Sat Feb 16 13:40:25 +0000 2013")(
+        "favourites_count", 235)("utc_offset", nullptr)("time_zone", nullptr)(
+        "geo_enabled", i % 3 == 0)("verified", false)("statuses_count", 1769)(
+        "lang", "en")("profile_background_color", "C0DEED")(
+        "default_profile", true);
+    statuses.push_back(
+        dynamic::object(
+            "metadata",
+            dynamic::object("result_type", "recent")(
+                "iso_language_code", "ja"))(
+            "created_at", "Sun Aug 31 00:29:15 +0000 2014")("id", id)(
+            "id_str", to<std::string>(id))("text", kTexts[i % 3])(
+            "source",
+            "<a href=\"http://twitter.com/download/iphone\" "
+            "rel=\"nofollow\">Twitter for iPhone</a>")("truncated", false)(
+            "in_reply_to_status_id", nullptr)("user", std::move(user))(
+            "geo", nullptr)("coordinates", nullptr)("retweet_count", i % 50)(
+            "favorite_count", 0)(
+            "entities",
+            dynamic::object("hashtags", dynamic::array)(
+                "symbols", dynamic::array)("urls", dynamic::array)(
+                "user_mentions",
+                dynamic::array(dynamic::object("screen_name", "aym0566x")(
+                    "id", 866260188)("indices", dynamic::array(0, 9)))))(
+            "favorited", false)("retweeted", false)("lang", "ja"));
+  }
+  dynamic doc = dynamic::object("statuses", std::move(statuses))(
+      "search_metadata",
+      dynamic::object("completed_in", 0.087)("max_id", 505874924095815681)(
+          "query", "%E4%B8%80")("count", 100));
+  json::serialization_opts opts;
+  opts.encode_non_ascii = true;
+  return json::serialize(doc, opts);
+}
+
+std::string makeCanada() {
+  dynamic rings = dynamic::array;
+  uint64_t state = 88172645463325252ULL;
+  auto next = [&] {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return double(state >> 11) / double(uint64_t(1) << 53);
+  };
+  for (int r = 0; r < 100; ++r) {
+    dynamic ring = dynamic::array;
+    for (int p = 0; p < 1000; ++p) {
+      ring.push_back(dynamic::array(-141.0 + next() * 88, 41.0 + next() * 42));
+    }
+    rings.push_back(std::move(ring));
+  }
+  dynamic doc = dynamic::object("type", "FeatureCollection")(
+      "features",
+      dynamic::array(
+          dynamic::object("type", "Feature")(
+              "properties", dynamic::object("name", "Canada"))(
+              "geometry",
+              dynamic::object("type", "Polygon")(
+                  "coordinates", std::move(rings)))));
+  return toJson(doc);
+}
+
+std::string const& twitter() {
+  static std::string const json = makeTwitter();
+  return json;
+}
+
+std::string const& canada() {
+  static std::string const json = makeCanada();
+  return json;
+}
+
+// What a caller that only wants a few fields does: ids and screen names.
+size_t pullTwitterFields(json::tape_value root) {
+  size_t ret = 0;
+  for (auto status : root["statuses"]) {
+    ret += status["id"].as_int();
+    ret += status["user"]["screen_name"].as_string().size();
+  }
+  return ret;
+}
+
+double sumCanadaCoordinates(json::tape_value root) {
+  double ret = 0;
+  for (auto ring : root["features"][0]["geometry"]["coordinates"]) {
+    for (auto point : ring) {
+      ret += point[0].as_double() + point[1].as_double();
+    }
+  }
+  return ret;
+}
+
+} // namespace
+
+BENCHMARK(twitter_parseJson, iters) {
+  BENCHMARK_SUSPEND {
+    twitter();
+  }
+  for (size_t i = 0; i < iters; ++i) {
+    doNotOptimizeAway(parseJson(twitter()));
+  }
+}
+
+BENCHMARK_RELATIVE(twitter_parseJsonFast, iters) {
+  BENCHMARK_SUSPEND {
+    twitter();
+  }
+  for (size_t i = 0; i < iters; ++i) {
+    doNotOptimizeAway(parseJsonFast(twitter()));
+  }
+}
+
+BENCHMARK_RELATIVE(twitter_parse_tape, iters) {
+  BENCHMARK_SUSPEND {
+    twitter();
+  }
+  for (size_t i = 0; i < iters; ++i) {
+    doNotOptimizeAway(json::parse_tape(twitter()).tape_size());
+  }
+}
+
+BENCHMARK_RELATIVE(twitter_parse_tape_and_pull_fields, iters) {
+  BENCHMARK_SUSPEND {
+    twitter();
+  }
+  for (size_t i = 0; i < iters; ++i) {
+    auto doc = json::parse_tape(twitter());
+    doNotOptimizeAway(pullTwitterFields(doc.root()));
+  }
+}
+
+// Each iteration builds the tree and then frees it: dynamic's one node at a
+// time, the arena's in one go.
+BENCHMARK_RELATIVE(twitter_parse_arena, iters) {
+  BENCHMARK_SUSPEND {
+    twitter();
+  }
+  for (size_t i = 0; i < iters; ++i) {
+    doNotOptimizeAway(json::parse_arena(twitter()).allocated_size());
+  }
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(canada_parseJson, iters) {
+  BENCHMARK_SUSPEND {
+    canada();
+  }
+  for (size_t i = 0; i < iters; ++i) {
+    doNotOptimizeAway(parseJson(canada()));
+  }
+}
+
+BENCHMARK_RELATIVE(canada_parseJsonFast, iters) {
+  BENCHMARK_SUSPEND {
+    canada();
+  }
+  for (size_t i = 0; i < iters; ++i) {
+    doNotOptimizeAway(parseJsonFast(canada()));
+  }
+}
+
+BENCHMARK_RELATIVE(canada_parse_tape, iters) {
+  BENCHMARK_SUSPEND {
+    canada();
+  }
+  for (size_t i = 0; i < iters; ++i) {
+    doNotOptimizeAway(json::parse_tape(canada()).tape_size());
+  }
+}
+
+BENCHMARK_RELATIVE(canada_parse_tape_and_sum_coordinates, iters) {
+  BENCHMARK_SUSPEND {
+    canada();
+  }
+  for (size_t i = 0; i < iters; ++i) {
+    auto doc = json::parse_tape(canada());
+    doNotOptimizeAway(sumCanadaCoordinates(doc.root()));
+  }
+}
+
+BENCHMARK_RELATIVE(canada_parse_arena, iters) {
+  BENCHMARK_SUSPEND {
+    canada();
+  }
+  for (size_t i = 0; i < iters; ++i) {
+    doNotOptimizeAway(json::parse_arena(canada()).allocated_size());
+  }
+}
+
+int main(int argc, char** argv) {
+  folly::gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
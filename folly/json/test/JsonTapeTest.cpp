@@ -0,0 +1,429 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/json/json_tape.h>
+
+#include <random>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+#include <folly/Conv.h>
+#include <folly/Demangle.h>
+#include <folly/portability/GTest.h>
+
+using folly::dynamic;
+using folly::parseJson;
+using folly::parseJsonFast;
+using folly::StringPiece;
+using folly::json::parse_error;
+using folly::json::parse_tape;
+using folly::json::serialization_opts;
+
+namespace {
+
+// Byte-at-a-time statement of what stage one computes.
+std::vector<uint32_t> referenceStructurals(StringPiece s) {
+  auto isOp = [](char c) {
+    return StringPiece("{}[]:,").find(c) != StringPiece::npos;
+  };
+  auto isSpace = [](char c) {
+    return StringPiece(" \n\t\r").find(c) != StringPiece::npos;
+  };
+  auto isScalar = [&](char c) { return !isOp(c) && !isSpace(c) && c != '"'; };
+  std::vector<uint32_t> ret;
+  bool inString = false;
+  bool escaped = false;
+  for (uint32_t i = 0; i < s.size(); ++i) {
+    char c = s[i];
+    bool quote = c == '"' && !escaped;
+    escaped = c == '\\' && !escaped;
+    if (quote) {
+      ret.push_back(i);
+      inString = !inString;
+    } else if (
+        !inString &&
+        (isOp(c) || (isScalar(c) && (i == 0 || !isScalar(s[i - 1]))))) {
+      ret.push_back(i);
+    }
+  }
+  return ret;
+}
+
+std::string render(dynamic const& d) {
+  serialization_opts opts;
+  opts.allow_nan_inf = true;
+  opts.allow_non_string_keys = true;
+  opts.sort_keys = true;
+  return folly::json::serialize(d, opts);
+}
+
+// Outcome of a parse: the value, or the type of the exception thrown.
+template <typename Parse>
+std::string outcome(Parse parse) {
+  try {
+    return render(parse());
+  } catch (std::exception const& e) {
+    return "threw " + folly::demangle(typeid(e)).toStdString();
+  }
+}
+
+void expectSameAsParseJson(
+    StringPiece json, serialization_opts const& opts = serialization_opts()) {
+  EXPECT_EQ(
+      outcome([&] { return parseJson(json, opts); }),
+      outcome([&] { return parseJsonFast(json, opts); }))
+      << json;
+}
+
+dynamic randomValue(std::mt19937& rng, int depth) {
+  auto pick = [&](int n) { return int(rng() % n); };
+  switch (pick(depth > 4 ? 6 : 8)) {
+    case 0:
+      return nullptr;
+    case 1:
+      return pick(2) == 0;
+    case 2:
+      return int64_t(rng()) - int64_t(rng()) * pick(1 << 20);
+    case 3:
+      return std::uniform_real_distribution<double>(-1e9, 1e9)(rng);
+    case 4:
+    case 5: {
+      static constexpr StringPiece kPieces[] = {
+          "a", "long run of plain text", "\\", "\"", "\n", "\x01", "/",
+          "\xc3\xa9", "\xf0\x9d\x84\x9e", " ", "{", "]", ":", ","};
+      std::string s;
+      for (int i = pick(12); i > 0; --i) {
+        s += kPieces[pick(std::size(kPieces))];
+      }
+      return s;
+    }
+    case 6: {
+      dynamic ret = dynamic::array;
+      for (int i = pick(6); i > 0; --i) {
+        ret.push_back(randomValue(rng, depth + 1));
+      }
+      return ret;
+    }
+    default: {
+      dynamic ret = dynamic::object;
+      for (int i = pick(6); i > 0; --i) {
+        ret[folly::to<std::string>("k", pick(8), "\\\"")] =
+            randomValue(rng, depth + 1);
+      }
+      return ret;
+    }
+  }
+}
+
+} // namespace
+
+TEST(JsonTape, StructuralIndices) {
+  using folly::json::detail::json_structural_indices;
+  std::vector<std::string> inputs = {
+      "",
+      "{\"a\": [1, true, null], \"b\\\"c\": \"d\\\\\"}",
+      R"(["\\\\\"", "\\", "x\"y"])",
+      "  123  -4.5e6 \"str\"xyz{}",
+  };
+  // Backslash runs and strings that straddle the 64-byte block boundary.
+  for (int pad = 56; pad < 72; ++pad) {
+    for (int run = 1; run < 5; ++run) {
+      inputs.push_back(
+          std::string(pad, ' ') + "\"" + std::string(run, '\\') + "\"]\" , 1");
+    }
+  }
+  std::mt19937 rng(42);
+  static constexpr char kAlphabet[] = "\"\\\\\\{}[]:, \na1";
+  for (int i = 0; i < 2000; ++i) {
+    std::string s(rng() % 300, ' ');
+    for (auto& c : s) {
+      c = kAlphabet[rng() % (sizeof(kAlphabet) - 1)];
+    }
+    inputs.push_back(std::move(s));
+  }
+  for (auto const& s : inputs) {
+    EXPECT_EQ(referenceStructurals(s), json_structural_indices(s)) << s;
+  }
+}
+
+TEST(JsonTape, MatchesParseJson) {
+  for (StringPiece json : {
+           "12",
+           "-0",
+           "12e5",
+           "12.5E-3",
+           "1.",
+           "4611686018427387904",
+           "-9223372036854775808",
+           "true",
+           "false",
+           "null",
+           "Infinity",
+           "-Infinity",
+           "NaN",
+           "\"\"",
+           "\"plain\"",
+           R"("esc\"aped\\ \/ \b\f\n\r\t")",
+           R"("I \u2665 UTF-8 \uD834\uDD1E")",
+           "\"I \xe2\x99\xa5 UTF-8\"",
+           "[]",
+           "{}",
+           "[ ]",
+           "{ }",
+           "[12,false, false  , null , [12e4,32, [], 12]]",
+           "{\"a\":{\"b\":[{\"c\":{}}]},\"d\":[[],[[]]]}",
+           " \t\r\n{ \"k\" : [ 1 , 2 ] } \n",
+           "{\"dup\":1,\"dup\":2}",
+       }) {
+    expectSameAsParseJson(json);
+  }
+  // parseJson() only rejects NUL bytes outside of strings.
+  expectSameAsParseJson(StringPiece("\"null\0byte\"", 11));
+  // Anything may follow a NUL after the value.
+  expectSameAsParseJson(StringPiece("1\0garbage", 9));
+  expectSameAsParseJson(StringPiece("[1] \0[\"", 7));
+  // Long strings, so that they cross block boundaries.
+  expectSameAsParseJson(
+      "[\"" + std::string(100, 'x') + "\\\"" + std::string(100, 'y') + "\"]");
+}
+
+TEST(JsonTape, RejectsWhatParseJsonRejects) {
+  for (StringPiece json : {
+           "",
+           " ",
+           "[",
+           "]",
+           "{",
+           "[1,]",
+           "{\"a\":1,}",
+           "[1 2]",
+           "[1,,2]",
+           "{\"a\" 1}",
+           "{\"a\":}",
+           "{1:2}",
+           "{\"a\":1 \"b\":2}",
+           "\"unterminated",
+           "[\"unterminated]",
+           "\"bad \\x escape\"",
+           "\"\\u12\"",
+           "\"\\uD834\"",
+           "\"\\uD834\\u0041\"",
+           "\"\\uDD1E\"",
+           "-",
+           "-a",
+           "+1",
+           ".5",
+           "12e2e2",
+           "12x",
+           "[12x]",
+           "truex",
+           "[truefalse]",
+           "nul",
+           "infinity",
+           "nan",
+           "\"a\" \"b\"",
+           "{\"foo\":12,\"bar\":42} \"something\"",
+           "[1]]",
+           "\\\"",
+       }) {
+    expectSameAsParseJson(json);
+    EXPECT_THROW(parse_tape(json), parse_error) << json;
+  }
+  // Not a parse error in either: the integer does not fit.
+  expectSameAsParseJson("123456789012345678901234567890");
+  expectSameAsParseJson(StringPiece("[1,\0 2]", 7));
+  expectSameAsParseJson(StringPiece("[1\0]", 4));
+}
+
+TEST(JsonTape, ErrorMessages) {
+  try {
+    parse_tape("{\n\"a\": [1,\n 2 3]}");
+    ADD_FAILURE();
+  } catch (parse_error const& e) {
+    EXPECT_STREQ(
+        "json parse error on line 2 near `3]}': expected ']'", e.what());
+  }
+}
+
+TEST(JsonTape, Options) {
+  serialization_opts trailingComma;
+  trailingComma.allow_trailing_comma = true;
+  serialization_opts nonStringKeys;
+  nonStringKeys.allow_non_string_keys = true;
+  serialization_opts convertIntKeys;
+  convertIntKeys.convert_int_keys = true;
+  serialization_opts validateKeys;
+  validateKeys.validate_keys = true;
+  serialization_opts doubleFallback;
+  doubleFallback.double_fallback = true;
+  serialization_opts numbersAsStrings;
+  numbersAsStrings.parse_numbers_as_strings = true;
+  for (auto const* opts :
+       {&trailingComma,
+        &nonStringKeys,
+        &convertIntKeys,
+        &validateKeys,
+        &doubleFallback,
+        &numbersAsStrings}) {
+    for (StringPiece json : {
+             "[1,]",
+             "[1,2,]",
+             "[,]",
+             "[1,,]",
+             "{\"a\":1,}",
+             "{,}",
+             "{1:2}",
+             "{1:2,\"1\":3}",
+             "{1.5:2}",
+             "{true:1,null:2,[1]:3,{\"a\":1}:4}",
+             "{\"a\":1,\"a\":2}",
+             "9223372036854775807",
+             "9223372036854775808",
+             "-9223372036854775808",
+             "-9223372036854775809",
+             "[1.5,-2e3,NaN,Infinity,-Infinity,\"x\"]",
+         }) {
+      expectSameAsParseJson(json, *opts);
+    }
+  }
+}
+
+TEST(JsonTape, RecursionLimit) {
+  std::string in;
+  for (int i = 0; i < 200; i++) {
+    in.append("{\"x\":[");
+  }
+  for (int i = 0; i < 200; i++) {
+    in.append("]}");
+  }
+  EXPECT_THROW(parse_tape(in), parse_error);
+  serialization_opts opts;
+  opts.recursion_limit = 400;
+  expectSameAsParseJson(in, opts);
+  opts.recursion_limit = 399;
+  expectSameAsParseJson(in, opts);
+}
+
+TEST(JsonTape, Cursor) {
+  std::string json = R"({
+    "id": 42,
+    "name": "plain",
+    "escaped": "a\tb",
+    "ratio": 0.5,
+    "flags": [true, false, null],
+    "nested": {"skip": [[1, [2]], {"x": {}}], "want": "found"},
+    "id": 43
+  })";
+  auto doc = parse_tape(json);
+  auto root = doc.root();
+
+  EXPECT_TRUE(root.is_object());
+  EXPECT_EQ(7, root.size());
+  EXPECT_EQ(43, root["id"].as_int()) << "the last duplicate wins";
+  EXPECT_EQ(dynamic::INT64, root["id"].type());
+  EXPECT_EQ("found", root["nested"]["want"].as_string());
+  EXPECT_EQ(0.5, root["ratio"].as_double());
+  EXPECT_EQ(dynamic::DOUBLE, root["ratio"].type());
+  EXPECT_EQ("0.5", root["ratio"].raw_number());
+
+  // Strings without escapes are not copied.
+  auto name = root["name"].as_string();
+  EXPECT_EQ("plain", name);
+  EXPECT_GE(name.data(), json.data());
+  EXPECT_LT(name.data(), json.data() + json.size());
+  EXPECT_EQ("a\tb", root["escaped"].as_string());
+
+  auto flags = root["flags"];
+  EXPECT_EQ(3, flags.size());
+  EXPECT_TRUE(flags[0].as_bool());
+  EXPECT_FALSE(flags.at(1).as_bool());
+  EXPECT_TRUE(flags[2].is_null());
+  std::vector<dynamic::Type> types;
+  for (auto v : flags) {
+    types.push_back(v.type());
+  }
+  EXPECT_EQ(
+      (std::vector<dynamic::Type>{
+          dynamic::BOOL, dynamic::BOOL, dynamic::NULLT}),
+      types);
+
+  std::vector<std::string> keys;
+  for (auto [k, v] : root.members()) {
+    keys.push_back(k.as_string().str());
+  }
+  EXPECT_EQ(
+      (std::vector<std::string>{
+          "id", "name", "escaped", "ratio", "flags", "nested", "id"}),
+      keys);
+
+  EXPECT_FALSE(root.find("missing").has_value());
+  EXPECT_THROW(root["missing"], std::out_of_range);
+  EXPECT_THROW(flags[3], std::out_of_range);
+  EXPECT_THROW(root["name"].as_int(), folly::TypeError);
+  EXPECT_THROW(root["id"].as_string(), folly::TypeError);
+  EXPECT_THROW(flags["key"], folly::TypeError);
+  EXPECT_THROW(root[0], folly::TypeError);
+  EXPECT_THROW(root["ratio"].find("x"), folly::TypeError);
+
+  EXPECT_EQ(parseJson(json), root.to_dynamic());
+  EXPECT_EQ(parseJson(json)["nested"], root["nested"].to_dynamic());
+}
+
+TEST(JsonTape, CursorNumbers) {
+  auto doc =
+      parse_tape("[1, 2.0, 1e400, NaN, -Infinity, 99999999999999999999]");
+  auto root = doc.root();
+  EXPECT_EQ(1.0, root[0].as_double());
+  EXPECT_EQ(2, root[1].as_int());
+  EXPECT_TRUE(std::isinf(root[2].as_double()));
+  EXPECT_TRUE(std::isnan(root[3].as_double()));
+  EXPECT_EQ(-std::numeric_limits<double>::infinity(), root[4].as_double());
+  EXPECT_THROW(root[5].as_int(), folly::ConversionError);
+  EXPECT_THROW(root.to_dynamic(), folly::ConversionError);
+
+  serialization_opts opts;
+  opts.parse_numbers_as_strings = true;
+  auto strings = parse_tape("[1.50, NaN]", opts);
+  EXPECT_EQ("1.50", strings.root()[0].as_string());
+  EXPECT_EQ("NaN", strings.root()[1].as_string());
+}
+
+TEST(JsonTape, RandomDocuments) {
+  static constexpr StringPiece kBytes("\"\\{}[]:, 0a\0", 12);
+  std::mt19937 rng(7);
+  for (int i = 0; i < 500; ++i) {
+    auto json = folly::toJson(randomValue(rng, 0));
+    expectSameAsParseJson(json);
+    // And some broken ones.
+    for (int j = 0; j < 4 && !json.empty(); ++j) {
+      auto broken = json;
+      auto pos = rng() % broken.size();
+      switch (rng() % 3) {
+        case 0:
+          broken.erase(pos, 1);
+          break;
+        case 1:
+          broken[pos] = kBytes[rng() % kBytes.size()];
+          break;
+        default:
+          broken.resize(pos);
+          break;
+      }
+      expectSameAsParseJson(broken);
+    }
+  }
+}
@@ -22,11 +22,13 @@
 
 namespace folly {
 
-AsyncFileWriter::AsyncFileWriter(StringPiece path)
+AsyncFileWriter::AsyncFileWriter(StringPiece path, Buffering buffering)
     : AsyncFileWriter{
-          File{path.str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC}} {}
+          File{path.str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC},
+          buffering} {}
 
-AsyncFileWriter::AsyncFileWriter(folly::File&& file) : file_{std::move(file)} {}
+AsyncFileWriter::AsyncFileWriter(folly::File&& file, Buffering buffering)
+    : AsyncLogWriter{buffering}, file_{std::move(file)} {}
 
 AsyncFileWriter::~AsyncFileWriter() {
   cleanup();
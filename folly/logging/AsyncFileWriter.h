@@ -33,12 +33,14 @@ class AsyncFileWriter : public AsyncLogWriter {
    * Construct an AsyncFileWriter that appends to the file at the specified
    * path.
    */
-  explicit AsyncFileWriter(folly::StringPiece path);
+  explicit AsyncFileWriter(
+      folly::StringPiece path, Buffering buffering = Buffering::SHARED_QUEUE);
 
   /**
    * Construct an AsyncFileWriter that writes to the specified File object.
    */
-  explicit AsyncFileWriter(folly::File&& file);
+  explicit AsyncFileWriter(
+      folly::File&& file, Buffering buffering = Buffering::SHARED_QUEUE);
 
   ~AsyncFileWriter() override;
 
@@ -16,13 +16,151 @@
 
 #include <folly/logging/AsyncLogWriter.h>
 
+#include <folly/ExceptionString.h>
+#include <folly/ThreadLocal.h>
+#include <folly/concurrency/UnboundedQueue.h>
 #include <folly/logging/LoggerDB.h>
+#include <folly/synchronization/Baton.h>
 #include <folly/system/AtFork.h>
 #include <folly/system/ThreadName.h>
 
 namespace folly {
 
-AsyncLogWriter::AsyncLogWriter() {
+/*
+ * The writer threads' queues with Buffering::PER_THREAD.
+ *
+ * Each writer thread gets a single-producer single-consumer queue the first
+ * time it logs, and only that thread and the I/O thread ever touch it.  The
+ * total size of buffered messages is still kept in one counter, so that the
+ * maximum buffer size applies to all threads together, as it does with the
+ * shared queue.
+ *
+ * The I/O thread sleeps on a Baton when there is nothing to write.  Writer
+ * threads only post it if the I/O thread has said it is waiting, which costs
+ * them a fence and the load of a flag that only changes when the I/O thread
+ * goes to sleep or wakes up.
+ */
+struct AsyncLogWriter::ThreadBuffers {
+  struct Message {
+    std::string text;
+    // Set for messages to be formatted by the I/O thread, in which case text
+    // is empty.
+    MessageFormatter format;
+    // The bytes counted in bufferedBytes for this message.
+    size_t size{0};
+  };
+
+  struct Buffer {
+    USPSCQueue<Message, false> messages;
+    // The number of messages this thread has discarded since the I/O thread
+    // last drained its queue.
+    std::atomic<size_t> numDiscarded{0};
+  };
+
+  explicit ThreadBuffers(size_t maxBytes)
+      : local{[this] { return addBuffer(); }},
+        maxBufferBytes{maxBytes} {}
+
+  std::shared_ptr<Buffer> addBuffer() {
+    auto buffer = std::make_shared<Buffer>();
+    std::lock_guard<std::mutex> guard(mutex);
+    buffers.push_back(buffer);
+    return buffer;
+  }
+
+  Buffer& current() { return **local; }
+
+  // Wake the I/O thread if it is waiting.  Called after making new work
+  // visible to it.
+  void notify() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting.load(std::memory_order_relaxed) &&
+        waiting.exchange(false, std::memory_order_acq_rel)) {
+      wakeup.post();
+    }
+  }
+
+  // Move the messages queued so far into `ioQueue`, and those still to be
+  // formatted into `deferred`, and return the number of messages discarded.
+  // Called by the I/O thread.
+  size_t drain(std::vector<std::string>& ioQueue, DeferredQueue& deferred) {
+    size_t numDiscarded = 0;
+    size_t bytes = 0;
+    std::lock_guard<std::mutex> guard(mutex);
+    for (size_t i = 0; i < buffers.size();) {
+      auto& buffer = *buffers[i];
+      numDiscarded +=
+          buffer.numDiscarded.exchange(0, std::memory_order_relaxed);
+      // Take only what is there now, so that a thread logging continuously
+      // cannot keep us from the others.
+      Message message;
+      for (auto n = buffer.messages.size();
+           n > 0 && buffer.messages.try_dequeue(message);
+           --n) {
+        bytes += message.size;
+        ioQueue.push_back(std::move(message.text));
+        if (message.format) {
+          deferred.emplace_back(ioQueue.size() - 1, std::move(message.format));
+        }
+      }
+      // Forget the queues of threads that have exited once they are empty.
+      if (buffers[i].use_count() == 1 && buffer.messages.empty() &&
+          buffer.numDiscarded.load(std::memory_order_relaxed) == 0) {
+        buffers[i] = std::move(buffers.back());
+        buffers.pop_back();
+      } else {
+        ++i;
+      }
+    }
+    bufferedBytes.fetch_sub(bytes, std::memory_order_relaxed);
+    return numDiscarded;
+  }
+
+  bool empty() {
+    std::lock_guard<std::mutex> guard(mutex);
+    for (const auto& buffer : buffers) {
+      if (!buffer->messages.empty() ||
+          buffer->numDiscarded.load(std::memory_order_relaxed) > 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Sleep until notify() is called, unless there is work already, or
+  // `stopping()` returns true.  Called by the I/O thread.
+  template <typename Stopping>
+  void wait(Stopping stopping) {
+    wakeup.reset();
+    waiting.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!empty() || stopping()) {
+      if (!waiting.exchange(false, std::memory_order_acq_rel)) {
+        // A writer saw us waiting and is posting the baton; consume that.
+        wakeup.wait();
+      }
+      return;
+    }
+    wakeup.wait();
+  }
+
+  ThreadLocal<std::shared_ptr<Buffer>, ThreadBuffers> local;
+  std::mutex mutex;
+  // The queues of all threads that have logged, including threads that have
+  // since exited but whose messages have not been written yet.  Protected by
+  // mutex.
+  std::vector<std::shared_ptr<Buffer>> buffers;
+  std::atomic<size_t> maxBufferBytes;
+  std::atomic<size_t> bufferedBytes{0};
+  std::atomic<bool> waiting{false};
+  Baton<> wakeup;
+};
+
+AsyncLogWriter::AsyncLogWriter(Buffering buffering) {
+  if (buffering == Buffering::PER_THREAD) {
+    threadBuffers_ = std::make_unique<ThreadBuffers>(kDefaultMaxBufferSize);
+  }
+
   folly::AtFork::registerHandler(
       this,
       [this] { return preFork(); },
@@ -72,6 +210,7 @@ void AsyncLogWriter::invokeDiscardCallback(size_t numDiscarded) {
 
 void AsyncLogWriter::cleanup() {
   std::vector<std::string>* ioQueue;
+  DeferredQueue* deferred;
   size_t numDiscarded;
   {
     // Stop the I/O thread
@@ -82,14 +221,19 @@ void AsyncLogWriter::cleanup() {
     // without waiting for all pending messages to be written.  Extract any
     // remaining messages to write them below.
     ioQueue = data->getCurrentQueue();
+    deferred = data->getCurrentDeferred();
     numDiscarded = data->numDiscarded;
   }
+  if (threadBuffers_) {
+    numDiscarded += threadBuffers_->drain(*ioQueue, *deferred);
+  }
   if (numDiscarded > 0) {
     invokeDiscardCallback(numDiscarded);
   }
 
   // If there are still any pending messages, flush them now.
   if (!ioQueue->empty()) {
+    formatDeferred(*ioQueue, *deferred);
     performIO(*ioQueue, numDiscarded);
   }
 }
@@ -99,6 +243,37 @@ void AsyncLogWriter::writeMessage(StringPiece buffer, uint32_t flags) {
 }
 
 void AsyncLogWriter::writeMessage(std::string&& buffer, uint32_t flags) {
+  auto size = buffer.size();
+  enqueue(std::move(buffer), nullptr, size, flags);
+}
+
+void AsyncLogWriter::writeDeferredMessage(
+    MessageFormatter&& format, size_t sizeHint, uint32_t flags) {
+  enqueue(std::string(), std::move(format), sizeHint, flags);
+}
+
+void AsyncLogWriter::enqueue(
+    std::string&& buffer,
+    MessageFormatter&& format,
+    size_t size,
+    uint32_t flags) {
+  if (threadBuffers_) {
+    auto& threadBuffers = *threadBuffers_;
+    auto& local = threadBuffers.current();
+    if (threadBuffers.bufferedBytes.load(std::memory_order_relaxed) >=
+            threadBuffers.maxBufferBytes.load(std::memory_order_relaxed) &&
+        !(flags & NEVER_DISCARD)) {
+      local.numDiscarded.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+
+    threadBuffers.bufferedBytes.fetch_add(size, std::memory_order_relaxed);
+    local.messages.enqueue(
+        ThreadBuffers::Message{std::move(buffer), std::move(format), size});
+    threadBuffers.notify();
+    return;
+  }
+
   auto data = data_.lock();
   if ((data->currentBufferSize >= data->maxBufferBytes) &&
       !(flags & NEVER_DISCARD)) {
@@ -106,12 +281,33 @@ void AsyncLogWriter::writeMessage(std::string&& buffer, uint32_t flags) {
     return;
   }
 
-  data->currentBufferSize += buffer.size();
+  data->currentBufferSize += size;
   auto* queue = data->getCurrentQueue();
   queue->emplace_back(std::move(buffer));
+  if (format) {
+    data->getCurrentDeferred()->emplace_back(
+        queue->size() - 1, std::move(format));
+  }
   messageReady_.notify_one();
 }
 
+void AsyncLogWriter::formatDeferred(
+    std::vector<std::string>& ioQueue, DeferredQueue& deferred) {
+  for (auto& [index, format] : deferred) {
+    try {
+      ioQueue[index] = format();
+    } catch (const std::exception& ex) {
+      // Leave the message out, but say why.
+      LoggerDB::internalWarning(
+          __FILE__,
+          __LINE__,
+          "error formatting log message in AsyncLogWriter: ",
+          folly::exceptionStr(ex));
+    }
+  }
+  deferred.clear();
+}
+
 void AsyncLogWriter::flush() {
   auto data = data_.lock();
   auto start = data->ioThreadCounter;
@@ -125,8 +321,13 @@ void AsyncLogWriter::flush() {
     // The empty string ensures that the I/O thread will break out of its wait
     // loop and increment the ioThreadCounter, even if there is no other work
     // to do.
-    data->getCurrentQueue()->emplace_back();
-    messageReady_.notify_one();
+    if (threadBuffers_) {
+      threadBuffers_->current().messages.enqueue(ThreadBuffers::Message{});
+      threadBuffers_->notify();
+    } else {
+      data->getCurrentQueue()->emplace_back();
+      messageReady_.notify_one();
+    }
 
     // Wait for notification from the I/O thread that it has done work.
     ioCV_.wait(data.as_lock());
@@ -136,6 +337,9 @@ void AsyncLogWriter::flush() {
 void AsyncLogWriter::setMaxBufferSize(size_t size) {
   auto data = data_.lock();
   data->maxBufferBytes = size;
+  if (threadBuffers_) {
+    threadBuffers_->maxBufferBytes.store(size, std::memory_order_relaxed);
+  }
 }
 
 size_t AsyncLogWriter::getMaxBufferSize() const {
@@ -146,15 +350,22 @@ size_t AsyncLogWriter::getMaxBufferSize() const {
 void AsyncLogWriter::ioThread() {
   folly::setThreadName("log_writer");
 
+  if (threadBuffers_) {
+    drainThreadBuffers();
+    return;
+  }
+
   while (true) {
     // With the lock held, grab a pointer to the current queue, then increment
     // the ioThreadCounter index so that other threads will write into the
     // other queue as we process this one.
     std::vector<std::string>* ioQueue;
+    DeferredQueue* deferred;
     size_t numDiscarded;
     {
       auto data = data_.lock();
       ioQueue = data->getCurrentQueue();
+      deferred = data->getCurrentDeferred();
       while (ioQueue->empty() && !(data->flags & FLAG_STOP)) {
         // Wait for a message or one of the above flags to be set.
         messageReady_.wait(data.as_lock());
@@ -180,7 +391,8 @@ void AsyncLogWriter::ioThread() {
     }
     ioCV_.notify_all();
 
-    // Write the log messages now that we have released the lock
+    // Format and write the log messages now that we have released the lock
+    formatDeferred(*ioQueue, *deferred);
     performIO(*ioQueue, numDiscarded);
 
     if (numDiscarded > 0) {
@@ -193,6 +405,49 @@ void AsyncLogWriter::ioThread() {
   }
 }
 
+void AsyncLogWriter::drainThreadBuffers() {
+  auto& threadBuffers = *threadBuffers_;
+  std::vector<std::string> ioQueue;
+  DeferredQueue deferred;
+  auto stopping = [&] { return bool(data_.lock()->flags & FLAG_STOP); };
+
+  while (true) {
+    {
+      auto data = data_.lock();
+      if (data->flags & FLAG_STOP) {
+        // As in ioThread(), exit without writing out pending messages; they
+        // stay in the threads' queues for the destructor or the restarted
+        // thread.
+        data->flags |= FLAG_IO_THREAD_STOPPED;
+        data.unlock();
+        ioCV_.notify_all();
+        return;
+      }
+
+      // Incremented before draining the queues, so that flush() knows that
+      // everything enqueued before it has been written once this has been
+      // incremented twice.
+      ++data->ioThreadCounter;
+    }
+    ioCV_.notify_all();
+
+    auto numDiscarded = threadBuffers.drain(ioQueue, deferred);
+    if (ioQueue.empty() && numDiscarded == 0) {
+      threadBuffers.wait(stopping);
+      continue;
+    }
+
+    formatDeferred(ioQueue, deferred);
+    performIO(ioQueue, numDiscarded);
+
+    if (numDiscarded > 0) {
+      invokeDiscardCallback(numDiscarded);
+    }
+
+    ioQueue.clear();
+  }
+}
+
 bool AsyncLogWriter::preFork() {
   // Stop the I/O thread.
   //
@@ -225,6 +480,16 @@ void AsyncLogWriter::postForkChild() {
   // and we let the parent process handle writing them.
   lockedData_->queues[0].clear();
   lockedData_->queues[1].clear();
+  lockedData_->deferred[0].clear();
+  lockedData_->deferred[1].clear();
+  if (threadBuffers_) {
+    // Other threads may have been in the middle of enqueueing when we forked,
+    // and do not exist here to finish.  Leak the parent's queues rather than
+    // touch them, and start over.
+    (void)threadBuffers_.release();
+    threadBuffers_ =
+        std::make_unique<ThreadBuffers>(lockedData_->maxBufferBytes);
+  }
 
   // Restart the I/O thread
   restartThread();
@@ -235,6 +500,9 @@ void AsyncLogWriter::stopIoThread(
     uint32_t extraFlags) {
   data->flags |= (FLAG_STOP | extraFlags);
   messageReady_.notify_one();
+  if (threadBuffers_) {
+    threadBuffers_->notify();
+  }
   ioCV_.wait(data.as_lock(), [&] {
     return bool(data->flags & FLAG_IO_THREAD_STOPPED);
   });
@@ -16,9 +16,13 @@
 
 #pragma once
 
+#include <atomic>
 #include <condition_variable>
+#include <memory>
 #include <mutex>
 #include <thread>
+#include <utility>
+#include <vector>
 
 #include <folly/File.h>
 #include <folly/Range.h>
@@ -55,7 +59,30 @@ class AsyncLogWriter : public LogWriter {
    */
   static constexpr size_t kDefaultMaxBufferSize = 1024 * 1024;
 
-  explicit AsyncLogWriter();
+  /**
+   * How writer threads hand messages to the I/O thread.
+   */
+  enum class Buffering {
+    /**
+     * All writer threads append to one queue, under a mutex.  Messages are
+     * written in the order they were enqueued.
+     */
+    SHARED_QUEUE,
+    /**
+     * Each writer thread appends to a lock-free queue of its own, which the
+     * I/O thread drains in batches, so that logging threads do not contend
+     * with each other.  Messages from one thread are written in the order
+     * they were enqueued, but within a batch the messages of each thread are
+     * written together, so messages from different threads may be reordered
+     * relative to each other.
+     *
+     * The maximum buffer size and discard accounting are the same as with
+     * SHARED_QUEUE.
+     */
+    PER_THREAD,
+  };
+
+  explicit AsyncLogWriter(Buffering buffering = Buffering::SHARED_QUEUE);
 
   virtual ~AsyncLogWriter() override;
 
@@ -63,6 +90,15 @@ class AsyncLogWriter : public LogWriter {
 
   void writeMessage(std::string&& buffer, uint32_t flags = 0) override;
 
+  /**
+   * Enqueue a message to be formatted by the I/O thread, just before it is
+   * written.  It counts as `sizeHint` bytes towards the maximum buffer size.
+   */
+  void writeDeferredMessage(
+      MessageFormatter&& format,
+      size_t sizeHint,
+      uint32_t flags = 0) override;
+
   /**
    * Block until the I/O thread has finished writing all messages that
    * were already enqueued when flush() was called.
@@ -84,6 +120,13 @@ class AsyncLogWriter : public LogWriter {
    */
   size_t getMaxBufferSize() const;
 
+  /**
+   * Get how writer threads hand messages to the I/O thread.
+   */
+  Buffering getBuffering() const {
+    return threadBuffers_ ? Buffering::PER_THREAD : Buffering::SHARED_QUEUE;
+  }
+
   using DiscardCallback = void (*)(size_t);
 
   /**
@@ -124,6 +167,12 @@ class AsyncLogWriter : public LogWriter {
     FLAG_IO_THREAD_JOINED = 0x10,
   };
 
+  /**
+   * The messages in a queue that are still to be formatted, with the index
+   * of the empty string holding their place in the queue.
+   */
+  using DeferredQueue = std::vector<std::pair<size_t, MessageFormatter>>;
+
   /*
    * A simple implementation using two queues.
    * All writer threads enqueue into one queue while the I/O thread is
@@ -134,6 +183,7 @@ class AsyncLogWriter : public LogWriter {
    */
   struct Data {
     std::array<std::vector<std::string>, 2> queues;
+    std::array<DeferredQueue, 2> deferred;
     uint32_t flags{0};
     uint64_t ioThreadCounter{0};
     size_t maxBufferBytes{kDefaultMaxBufferSize};
@@ -144,6 +194,9 @@ class AsyncLogWriter : public LogWriter {
     std::vector<std::string>* getCurrentQueue() {
       return &queues[ioThreadCounter & 0x1];
     }
+    DeferredQueue* getCurrentDeferred() {
+      return &deferred[ioThreadCounter & 0x1];
+    }
   };
 
   /**
@@ -153,9 +206,20 @@ class AsyncLogWriter : public LogWriter {
   virtual void performIO(
       const std::vector<std::string>& logs, size_t numDiscarded) = 0;
 
+  struct ThreadBuffers;
+
   void invokeDiscardCallback(size_t numDiscarded);
 
+  void enqueue(
+      std::string&& buffer,
+      MessageFormatter&& format,
+      size_t size,
+      uint32_t flags);
+  static void formatDeferred(
+      std::vector<std::string>& ioQueue, DeferredQueue& deferred);
+
   void ioThread();
+  void drainThreadBuffers();
 
   bool preFork();
   void postForkParent();
@@ -166,6 +230,11 @@ class AsyncLogWriter : public LogWriter {
   void restartThread();
 
   folly::Synchronized<Data, std::mutex> data_;
+  /**
+   * threadBuffers_ holds the writer threads' queues with
+   * Buffering::PER_THREAD, and is null with Buffering::SHARED_QUEUE.
+   */
+  std::unique_ptr<ThreadBuffers> threadBuffers_;
   /**
    * messageReady_ is signaled by writer threads whenever they add a new
    * message to the current queue.
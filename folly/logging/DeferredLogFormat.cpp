@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/logging/DeferredLogFormat.h>
+
+#include <folly/ExceptionString.h>
+#include <folly/lang/Exception.h>
+
+namespace folly {
+namespace logging {
+
+std::string DeferredLogFormat::vformat(
+    fmt::format_args args, bool& failed) const noexcept {
+  return folly::catch_exception(
+      [&] {
+        return fmt::vformat(fmt::string_view(fmt_.data(), fmt_.size()), args);
+      },
+      [&]() {
+        // Report the error the same way XLOGF() does: with the format string,
+        // followed by the arguments appended by our caller.
+        failed = true;
+        std::string result;
+        result.append("error formatting log message: ");
+        result.append(exceptionStr(std::current_exception()).c_str());
+        result.append("; format string: \"");
+        result.append(fmt_.data(), fmt_.size());
+        result.append("\", arguments: ");
+        return result;
+      });
+}
+
+} // namespace logging
+} // namespace folly
@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include <fmt/core.h>
+#include <folly/Range.h>
+#include <folly/Traits.h>
+#include <folly/logging/ObjectToString.h>
+
+namespace folly {
+namespace logging {
+
+/**
+ * DeferredLogFormat holds a format string and copies of the arguments to
+ * format with it, so that a log message can be formatted later, and on
+ * another thread, rather than by the thread that logged it.
+ *
+ * It is created by the XLOGF_DEFERRED() macro, and carried by the LogMessage
+ * in place of the message text.  It is immutable once created, so a single
+ * DeferredLogFormat can be shared by all the handlers of a message.
+ *
+ * The format string is not copied: it must be a string literal.
+ */
+class DeferredLogFormat {
+ public:
+  virtual ~DeferredLogFormat() = default;
+
+  folly::StringPiece getFormatString() const { return fmt_; }
+
+  /**
+   * A rough estimate of the size of the formatted message, for buffer
+   * accounting before it has been formatted.
+   */
+  size_t getSizeHint() const { return sizeHint_; }
+
+  /**
+   * Format the message with fmt::format().
+   *
+   * As with XLOGF(), errors in the format string or arguments do not throw,
+   * but are reported in the returned message.
+   */
+  virtual std::string format() const noexcept = 0;
+
+ protected:
+  DeferredLogFormat(folly::StringPiece fmt, size_t sizeHint)
+      : fmt_{fmt}, sizeHint_{sizeHint} {}
+
+  /**
+   * Format with the given arguments, setting `failed` rather than throwing
+   * if that fails.
+   */
+  std::string vformat(fmt::format_args args, bool& failed) const noexcept;
+
+ private:
+  folly::StringPiece const fmt_;
+  size_t const sizeHint_;
+};
+
+namespace detail {
+
+/**
+ * The type an argument to XLOGF_DEFERRED() is stored as.
+ *
+ * Arguments are copied, and must not refer to anything that may be gone by
+ * the time the message is formatted.  Numbers, enums and untyped pointers are
+ * stored as they are, and strings of any kind are copied into a std::string.
+ * Other types are rejected: use XLOGF() for those.
+ */
+template <typename T>
+using deferred_log_arg_t = std::conditional_t<
+    std::is_arithmetic_v<T> || std::is_enum_v<T> ||
+        std::is_same_v<T, const void*> || std::is_same_v<T, void*> ||
+        std::is_same_v<T, std::nullptr_t>,
+    T,
+    std::conditional_t<
+        std::is_convertible_v<const T&, std::string_view>,
+        std::string,
+        void>>;
+
+template <typename T>
+auto toDeferredLogArg(T&& arg) {
+  using Stored = deferred_log_arg_t<remove_cvref_t<T>>;
+  static_assert(
+      !std::is_void_v<Stored>,
+      "XLOGF_DEFERRED() arguments must be numbers, enums, strings or "
+      "untyped pointers");
+  if constexpr (std::is_same_v<Stored, std::string>) {
+    if constexpr (std::is_same_v<remove_cvref_t<T>, std::string>) {
+      return std::string(std::forward<T>(arg));
+    } else if constexpr (std::is_pointer_v<std::decay_t<T>>) {
+      return arg ? std::string(arg) : std::string("(null)");
+    } else {
+      return std::string(std::string_view(arg));
+    }
+  } else {
+    return Stored(arg);
+  }
+}
+
+template <typename T>
+size_t deferredLogArgSize(const T& arg) {
+  if constexpr (std::is_same_v<T, std::string>) {
+    return arg.size();
+  } else {
+    return 8;
+  }
+}
+
+template <typename... Args>
+class DeferredLogFormatImpl final : public DeferredLogFormat {
+ public:
+  DeferredLogFormatImpl(folly::StringPiece fmt, Args&&... args)
+      : DeferredLogFormat{fmt, (fmt.size() + ... + deferredLogArgSize(args))},
+        args_{std::move(args)...} {}
+
+  std::string format() const noexcept override {
+    return std::apply(
+        [&](const Args&... args) {
+          bool failed = false;
+          auto result = vformat(fmt::make_format_args(args...), failed);
+          if (failed) {
+            ::folly::logging::appendToString(result, args...);
+          }
+          return result;
+        },
+        args_);
+  }
+
+ private:
+  std::tuple<Args...> args_;
+};
+
+} // namespace detail
+
+/**
+ * Capture a format string and its arguments into a DeferredLogFormat.
+ *
+ * This is a single allocation holding the format string pointer and the
+ * copied arguments; nothing is formatted until format() is called.
+ */
+template <typename... Args>
+std::shared_ptr<const DeferredLogFormat> makeDeferredLogFormat(
+    folly::StringPiece fmt, Args&&... args) {
+  return std::make_shared<detail::DeferredLogFormatImpl<
+      detail::deferred_log_arg_t<remove_cvref_t<Args>>...>>(
+      fmt, detail::toDeferredLogArg(std::forward<Args>(args))...);
+}
+
+} // namespace logging
+} // namespace folly
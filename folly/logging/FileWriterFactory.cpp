@@ -37,6 +37,9 @@ bool FileWriterFactory::processOption(StringPiece name, StringPiece value) {
     }
     maxBufferSize_ = size;
     return true;
+  } else if (name == "thread_buffers") {
+    threadBuffers_ = to<bool>(value);
+    return true;
   } else {
     return false;
   }
@@ -45,7 +48,11 @@ bool FileWriterFactory::processOption(StringPiece name, StringPiece value) {
 std::shared_ptr<LogWriter> FileWriterFactory::createWriter(File file) {
   // Determine whether we should use ImmediateFileWriter or AsyncFileWriter
   if (async_) {
-    auto asyncWriter = make_shared<AsyncFileWriter>(std::move(file));
+    auto asyncWriter = make_shared<AsyncFileWriter>(
+        std::move(file),
+        threadBuffers_.value_or(false)
+            ? AsyncLogWriter::Buffering::PER_THREAD
+            : AsyncLogWriter::Buffering::SHARED_QUEUE);
     if (maxBufferSize_.has_value()) {
       asyncWriter->setMaxBufferSize(maxBufferSize_.value());
     }
@@ -57,6 +64,12 @@ std::shared_ptr<LogWriter> FileWriterFactory::createWriter(File file) {
               "the \"max_buffer_size\" option is only valid for async file "
               "handlers"));
     }
+    if (threadBuffers_.has_value()) {
+      throw std::invalid_argument(
+          to<string>(
+              "the \"thread_buffers\" option is only valid for async file "
+              "handlers"));
+    }
     return make_shared<ImmediateFileWriter>(std::move(file));
   }
 }
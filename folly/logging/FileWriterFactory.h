@@ -40,6 +40,7 @@ class FileWriterFactory {
  private:
   bool async_{true};
   Optional<size_t> maxBufferSize_;
+  Optional<bool> threadBuffers_;
 };
 
 } // namespace folly
@@ -0,0 +1,273 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/logging/IoUringFileWriter.h>
+
+#include <cerrno>
+
+#include <folly/Conv.h>
+#include <folly/Exception.h>
+#include <folly/FileUtil.h>
+#include <folly/String.h>
+#include <folly/io/async/IoUring.h>
+#include <folly/logging/LoggerDB.h>
+#include <folly/portability/Fcntl.h>
+#include <folly/portability/SysStat.h>
+#include <folly/portability/Unistd.h>
+
+#ifdef __linux__
+#include <linux/falloc.h>
+#endif
+
+namespace folly {
+
+#if FOLLY_HAS_LIBURING
+
+struct IoUringFileWriter::Ring {
+  IoUring ring{1};
+  IoUringOp op;
+  // The process the ring was created in; after a fork(), the ring and any
+  // write in flight on it still belong to the parent.
+  pid_t pid{getpid()};
+  // The batch being written, and how much of it the kernel has written.
+  std::string buffer;
+  size_t written{0};
+  bool inFlight{false};
+};
+
+namespace {
+
+// Whether io_uring writes at the file position when given offset -1, as
+// submitWrite() relies on. Kernels before 5.6 fail such writes.
+bool ioUringWritesAtFilePosition() {
+  static const bool supported = [] {
+    struct io_uring ring;
+    struct io_uring_params params = {};
+    if (io_uring_queue_init_params(1, &ring, &params) != 0) {
+      return false;
+    }
+    io_uring_queue_exit(&ring);
+    return (params.features & IORING_FEAT_RW_CUR_POS) != 0;
+  }();
+  return supported;
+}
+
+} // namespace
+
+#else // !FOLLY_HAS_LIBURING
+
+struct IoUringFileWriter::Ring {};
+
+#endif // FOLLY_HAS_LIBURING
+
+IoUringFileWriter::IoUringFileWriter(StringPiece path, const Options& options)
+    : IoUringFileWriter{
+          File{path.str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC},
+          options} {}
+
+IoUringFileWriter::IoUringFileWriter(folly::File&& file, const Options& options)
+    : AsyncLogWriter{options.buffering}, file_{std::move(file)} {
+#ifdef __linux__
+  struct stat st;
+  if (options.preallocateBytes > 0 && fstat(file_.fd(), &st) == 0 &&
+      S_ISREG(st.st_mode)) {
+    preallocate_ = true;
+    preallocateBytes_ = options.preallocateBytes;
+  }
+#else
+  (void)options;
+#endif
+
+#if FOLLY_HAS_LIBURING
+  // Without io_uring, or without writes at the file position, write() each
+  // batch instead.
+  if (ioUringWritesAtFilePosition()) {
+    try {
+      ring_ = std::make_unique<Ring>();
+    } catch (const std::exception&) {
+    }
+  }
+#endif
+}
+
+IoUringFileWriter::~IoUringFileWriter() {
+  cleanup();
+
+  std::lock_guard<std::mutex> guard(ioMutex_);
+  if (auto* ring = getRing()) {
+    waitForWrite(*ring);
+  }
+}
+
+void IoUringFileWriter::flush() {
+  AsyncLogWriter::flush();
+
+  std::lock_guard<std::mutex> guard(ioMutex_);
+  if (auto* ring = getRing()) {
+    waitForWrite(*ring);
+  }
+}
+
+bool IoUringFileWriter::ttyOutput() const {
+  return isatty(file_.fd());
+}
+
+IoUringFileWriter::Ring* IoUringFileWriter::getRing() {
+#if FOLLY_HAS_LIBURING
+  if (ring_ && ring_->pid != getpid()) {
+    // We are in a child process.  The ring is shared with the parent, which
+    // will reap its own write; leak our copy rather than tear it down, and
+    // start over with a ring of our own.
+    (void)ring_.release();
+    try {
+      ring_ = std::make_unique<Ring>();
+    } catch (const std::exception&) {
+    }
+  }
+#endif
+  return ring_.get();
+}
+
+void IoUringFileWriter::performIO(
+    const std::vector<std::string>& ioQueue, size_t numDiscarded) {
+  std::lock_guard<std::mutex> guard(ioMutex_);
+
+  batch_.clear();
+  for (const auto& str : ioQueue) {
+    batch_.append(str);
+  }
+  if (numDiscarded > 0) {
+    toAppend(
+        numDiscarded,
+        " log messages discarded: logging faster than we can write\n",
+        &batch_);
+  }
+  if (batch_.empty()) {
+    // flush() enqueues empty messages to wake the I/O thread.
+    return;
+  }
+
+  try {
+#if FOLLY_HAS_LIBURING
+    if (auto* ring = getRing()) {
+      // Keep one batch in flight: the previous one must be written before
+      // this one is appended after it.
+      waitForWrite(*ring);
+      preallocate(batch_.size());
+      std::swap(batch_, ring->buffer);
+      ring->written = 0;
+      submitWrite(*ring);
+      return;
+    }
+#endif
+    preallocate(batch_.size());
+    auto ret = folly::writeFull(file_.fd(), batch_.data(), batch_.size());
+    folly::checkUnixError(ret, "writeFull() failed");
+  } catch (const std::exception& ex) {
+    LoggerDB::internalWarning(
+        __FILE__,
+        __LINE__,
+        "error writing to log file ",
+        file_.fd(),
+        " in IoUringFileWriter: ",
+        folly::exceptionStr(ex));
+  }
+}
+
+#if FOLLY_HAS_LIBURING
+
+void IoUringFileWriter::submitWrite(Ring& ring) {
+  ring.op.reset();
+  // Write at the file offset rather than at an explicit one, so that the file
+  // can be opened with O_APPEND and shared with other writers, like the one
+  // AsyncFileWriter writes to.
+  ring.op.pwrite(
+      file_.fd(),
+      ring.buffer.data() + ring.written,
+      ring.buffer.size() - ring.written,
+      -1);
+  ring.ring.submit(&ring.op);
+  ring.inFlight = true;
+}
+
+void IoUringFileWriter::waitForWrite(Ring& ring) {
+  while (ring.inFlight) {
+    ring.ring.wait(1);
+    ring.inFlight = false;
+
+    auto res = ring.op.result();
+    if (res == -EINTR || res == -EAGAIN) {
+      res = 0;
+    } else if (res <= 0) {
+      // Drop the rest of the batch, as AsyncFileWriter does when writev()
+      // fails.
+      LoggerDB::internalWarning(
+          __FILE__,
+          __LINE__,
+          "error writing to log file ",
+          file_.fd(),
+          " in IoUringFileWriter: ",
+          res == 0 ? std::string("no progress")
+                   : folly::errnoStr(static_cast<int>(-res)));
+      continue;
+    }
+    ring.written += static_cast<size_t>(res);
+    if (ring.written < ring.buffer.size()) {
+      submitWrite(ring);
+    }
+  }
+}
+
+#else // !FOLLY_HAS_LIBURING
+
+void IoUringFileWriter::submitWrite(Ring&) {}
+
+void IoUringFileWriter::waitForWrite(Ring&) {}
+
+#endif // FOLLY_HAS_LIBURING
+
+void IoUringFileWriter::preallocate(size_t bytes) {
+#ifdef __linux__
+  if (!preallocate_) {
+    return;
+  }
+  struct stat st;
+  if (fstat(file_.fd(), &st) != 0) {
+    return;
+  }
+  off_t end = st.st_size + static_cast<off_t>(bytes);
+  if (end <= preallocatedEnd_) {
+    return;
+  }
+  // Round up to whole chunks, so that the next writes fit in what is reserved
+  // here.
+  auto chunk = static_cast<off_t>(preallocateBytes_);
+  off_t newEnd = (end + chunk - 1) / chunk * chunk;
+  if (fallocate(
+          file_.fd(), FALLOC_FL_KEEP_SIZE, st.st_size, newEnd - st.st_size) !=
+      0) {
+    // Not supported by the file system (or out of space, in which case the
+    // writes will report it).
+    preallocate_ = false;
+    return;
+  }
+  preallocatedEnd_ = newEnd;
+#else
+  (void)bytes;
+#endif
+}
+
+} // namespace folly
@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <folly/File.h>
+#include <folly/logging/AsyncLogWriter.h>
+#include <folly/portability/SysTypes.h>
+
+namespace folly {
+
+/**
+ * An implementation of `folly::AsyncLogWriter` that writes log messages into a
+ * file through io_uring.
+ *
+ * It queues and discards messages exactly like `folly::AsyncFileWriter`, and
+ * like it appends to the file in the order messages were written.  The
+ * difference is in the I/O thread: rather than blocking in writev() on each
+ * batch of messages, it copies the batch into a single buffer, submits one
+ * write for it, and goes back to collecting messages while the kernel writes.
+ * The next batch waits only for that write, so producers get a fresh queue as
+ * soon as a batch has been copied out, and a batch costs one system call
+ * however many messages it holds.
+ *
+ * At most one batch is in flight, so memory use is bounded by the maximum
+ * buffer size plus one batch.  flush() waits for the kernel to finish the
+ * write as well as for the I/O thread to pick up the messages.
+ *
+ * When folly is built without liburing, or io_uring is unavailable at run
+ * time (a kernel before 5.6, which cannot write at the file position through
+ * io_uring, or a seccomp policy denying it), the batch is written with
+ * write() from the I/O thread instead.
+ */
+class IoUringFileWriter : public AsyncLogWriter {
+ public:
+  struct Options {
+    /**
+     * When non-zero, reserve disk space for the file in chunks of this many
+     * bytes ahead of the data written, with fallocate(FALLOC_FL_KEEP_SIZE),
+     * so that appends do not allocate blocks one write at a time.  The file
+     * size seen by readers is unchanged.  Only used for regular files on
+     * Linux, and turned off if the file system does not support it.
+     */
+    size_t preallocateBytes;
+
+    /**
+     * How writer threads hand messages to the I/O thread; see
+     * AsyncLogWriter::Buffering.
+     */
+    Buffering buffering;
+
+    Options() : preallocateBytes(0), buffering(Buffering::SHARED_QUEUE) {}
+  };
+
+  /**
+   * Construct an IoUringFileWriter that appends to the file at the specified
+   * path.
+   */
+  explicit IoUringFileWriter(
+      folly::StringPiece path, const Options& options = Options());
+
+  /**
+   * Construct an IoUringFileWriter that writes to the specified File object.
+   */
+  explicit IoUringFileWriter(
+      folly::File&& file, const Options& options = Options());
+
+  ~IoUringFileWriter() override;
+
+  /**
+   * Block until all messages that were already enqueued when flush() was
+   * called have been written to the file.
+   */
+  void flush() override;
+
+  /**
+   * Returns true if the output steam is a tty.
+   */
+  bool ttyOutput() const override;
+
+  /**
+   * Returns true if batches are written through io_uring, and false if this
+   * writer fell back to write().
+   */
+  bool usingIoUring() const { return ring_ != nullptr; }
+
+  /**
+   * Get the output file.
+   */
+  const folly::File& getFile() const { return file_; }
+
+ private:
+  struct Ring;
+
+  void performIO(
+      const std::vector<std::string>& ioQueue, size_t numDiscarded) override;
+
+  Ring* getRing();
+  void waitForWrite(Ring& ring);
+  void submitWrite(Ring& ring);
+  void preallocate(size_t bytes);
+
+  folly::File file_;
+  bool preallocate_{false};
+  size_t preallocateBytes_{0};
+
+  // ioMutex_ is held by the I/O thread while it writes, and by flush() and
+  // the destructor while they wait for the write in flight.  It protects the
+  // members below.
+  std::mutex ioMutex_;
+  std::string batch_;
+  off_t preallocatedEnd_{0};
+  std::unique_ptr<Ring> ring_;
+};
+
+} // namespace folly
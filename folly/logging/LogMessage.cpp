@@ -16,6 +16,7 @@
 
 #include <folly/logging/LogMessage.h>
 
+#include <folly/logging/DeferredLogFormat.h>
 #include <folly/logging/LogCategory.h>
 #include <folly/logging/LoggerDB.h>
 #include <folly/system/ThreadId.h>
@@ -69,6 +70,29 @@ LogMessage::LogMessage(
   sanitizeMessage();
 }
 
+LogMessage::LogMessage(
+    const LogCategory* category,
+    LogLevel level,
+    StringPiece filename,
+    unsigned int lineNumber,
+    StringPiece functionName,
+    std::shared_ptr<const logging::DeferredLogFormat> deferred)
+    : category_{category},
+      level_{level},
+      threadID_{getOSThreadID()},
+      timestamp_{system_clock::now()},
+      filename_{filename},
+      lineNumber_{lineNumber},
+      functionName_{functionName},
+      contextString_{getContextStringFromCategory(category_)},
+      deferred_{std::move(deferred)} {}
+
+void LogMessage::formatDeferred() const {
+  rawMessage_ = deferred_->format();
+  deferred_.reset();
+  sanitizeMessage();
+}
+
 StringPiece LogMessage::getFileBaseName() const {
 #ifdef _WIN32
   // Windows allows either backwards or forwards slash as path separator
@@ -91,7 +115,7 @@ StringPiece LogMessage::getFileBaseName() const {
   return filename_.subpiece(idx + 1);
 }
 
-void LogMessage::sanitizeMessage() {
+void LogMessage::sanitizeMessage() const {
   // Compute how long the sanitized string will be.
   size_t sanitizedLength = 0;
   size_t numNewlines = 0;
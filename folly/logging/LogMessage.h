@@ -19,8 +19,10 @@
 #include <sys/types.h>
 
 #include <chrono>
+#include <memory>
 #include <string>
 
+#include <folly/Likely.h>
 #include <folly/Range.h>
 #include <folly/logging/LogLevel.h>
 
@@ -28,6 +30,10 @@ namespace folly {
 
 class LogCategory;
 
+namespace logging {
+class DeferredLogFormat;
+} // namespace logging
+
 /**
  * LogMessage represents a single message to be logged.
  *
@@ -36,6 +42,12 @@ class LogCategory;
  * only live in the thread that logged the message, and are not modified once
  * created.  (That said, LogHandler implementations may copy and store
  * LogMessage objects for later use if desired.)
+ *
+ * A LogMessage logged with XLOGF_DEFERRED() holds a DeferredLogFormat rather
+ * than the message text, and formats it the first time the text is needed.
+ * Because of that, a LogMessage must not be accessed from several threads at
+ * once; copies of it may be used on other threads, and will format the text
+ * there.
  */
 class LogMessage {
  public:
@@ -70,6 +82,18 @@ class LogMessage {
       folly::StringPiece functionName,
       std::string&& msg);
 
+  /**
+   * Construct a LogMessage whose text is formatted from `deferred` when it is
+   * first needed.
+   */
+  LogMessage(
+      const LogCategory* category,
+      LogLevel level,
+      folly::StringPiece filename,
+      unsigned int lineNumber,
+      folly::StringPiece functionName,
+      std::shared_ptr<const logging::DeferredLogFormat> deferred);
+
   const LogCategory* getCategory() const { return category_; }
 
   LogLevel getLevel() const { return level_; }
@@ -88,6 +112,7 @@ class LogMessage {
   uint64_t getThreadID() const { return threadID_; }
 
   const std::string& getMessage() const {
+    formatIfDeferred();
     // If no characters needed to be sanitized, message_ will be empty.
     if (message_.empty()) {
       return rawMessage_;
@@ -95,16 +120,46 @@ class LogMessage {
     return message_;
   }
 
-  const std::string& getRawMessage() const { return rawMessage_; }
+  const std::string& getRawMessage() const {
+    formatIfDeferred();
+    return rawMessage_;
+  }
+
+  bool containsNewlines() const { return getNumNewlines() > 0; }
+
+  size_t getNumNewlines() const {
+    formatIfDeferred();
+    return numNewlines_;
+  }
 
-  bool containsNewlines() const { return numNewlines_ > 0; }
+  /**
+   * Returns true if the message text has not been formatted yet.
+   *
+   * LogHandlers can use this to leave the formatting to a LogWriter that
+   * writes on another thread.
+   */
+  bool isFormatDeferred() const { return deferred_ != nullptr; }
 
-  size_t getNumNewlines() const { return numNewlines_; }
+  /**
+   * Get the format string and arguments the message text will be formatted
+   * from, or null if it has been formatted already.
+   */
+  const std::shared_ptr<const logging::DeferredLogFormat>& getDeferredFormat()
+      const {
+    return deferred_;
+  }
 
   const std::string& getContextString() const { return contextString_; }
 
  private:
-  void sanitizeMessage();
+  void sanitizeMessage() const;
+
+  void formatIfDeferred() const {
+    if (FOLLY_UNLIKELY(deferred_ != nullptr)) {
+      formatDeferred();
+    }
+  }
+  void formatDeferred() const;
 
   const LogCategory* const category_{nullptr};
   LogLevel const level_{static_cast<LogLevel>(0)};
@@ -133,7 +188,7 @@ class LogMessage {
    * messages to easily detect if a message contains multiple lines or not and
    * size their buffers appropriately.
    */
-  size_t numNewlines_{0};
+  mutable size_t numNewlines_{0};
 
   /**
    * contextString_ contains user defined context information.
@@ -148,8 +203,10 @@ class LogMessage {
    *
    * This may contain arbitrary binary data, including unprintable characters
    * and nul bytes.
+   *
+   * It is empty while deferred_ is set.
    */
-  std::string const rawMessage_;
+  mutable std::string rawMessage_;
 
   /**
    * message_ contains a sanitized version of the log message.
@@ -159,6 +216,12 @@ class LogMessage {
    * are responsible for deciding how they want to handle log messages with
    * internal newlines.
    */
-  std::string message_;
+  mutable std::string message_;
+
+  /**
+   * deferred_ holds the format string and arguments of a message logged with
+   * XLOGF_DEFERRED() until the text is formatted from them.
+   */
+  mutable std::shared_ptr<const logging::DeferredLogFormat> deferred_;
 };
 } // namespace folly
@@ -187,6 +187,23 @@ void LogStreamProcessor::logNow() noexcept {
   //
   // Any other error here is unexpected and we also want to fail hard
   // in that situation too.
+  if (deferred_) {
+    if (stream_.empty()) {
+      category_->admitMessage(
+          LogMessage{
+              category_,
+              level_,
+              filename_,
+              lineNumber_,
+              functionName_,
+              std::move(deferred_)});
+      return;
+    }
+    // Arguments were also streamed in with <<; format the message now so
+    // they can be appended to it.
+    message_ = deferred_->format();
+    deferred_.reset();
+  }
   category_->admitMessage(
       LogMessage{
           category_,
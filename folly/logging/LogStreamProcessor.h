@@ -24,6 +24,7 @@
 #include <folly/ExceptionString.h>
 #include <folly/Portability.h>
 #include <folly/lang/Exception.h>
+#include <folly/logging/DeferredLogFormat.h>
 #include <folly/logging/LogCategory.h>
 #include <folly/logging/LogMessage.h>
 #include <folly/logging/LogStream.h>
@@ -51,6 +52,7 @@ class LogStreamProcessor {
  public:
   enum AppendType { APPEND };
   enum FormatType { FORMAT };
+  enum DeferredFormatType { DEFERRED_FORMAT };
 
   /**
    * LogStreamProcessor constructor for use with a LOG() macro with no extra
@@ -124,6 +126,33 @@ class LogStreamProcessor {
             INTERNAL,
             formatLogString(fmt, std::forward<Args>(args)...)) {}
 
+  /**
+   * LogStreamProcessor constructor for use with a LOG() macro with arguments
+   * to be formatted with fmt::format() when the message is written, rather
+   * than now.  The arguments are copied, and the format string must outlive
+   * the message: it should be a string literal.
+   */
+  template <typename... Args>
+  LogStreamProcessor(
+      const LogCategory* category,
+      LogLevel level,
+      folly::StringPiece filename,
+      unsigned int lineNumber,
+      folly::StringPiece functionName,
+      DeferredFormatType /*unused*/,
+      folly::StringPiece fmt,
+      Args&&... args) noexcept
+      : LogStreamProcessor(
+            category,
+            level,
+            filename,
+            lineNumber,
+            functionName,
+            INTERNAL,
+            std::string()) {
+    deferFormat(fmt, args...);
+  }
+
   /*
    * Versions of the above constructors for use in XLOG() statements.
    *
@@ -185,6 +214,30 @@ class LogStreamProcessor {
             functionName,
             INTERNAL,
             formatLogString(fmt, std::forward<Args>(args)...)) {}
+  template <typename... Args>
+  LogStreamProcessor(
+      XlogCategoryInfo<true>* categoryInfo,
+      LogLevel level,
+      folly::StringPiece categoryName,
+      bool isCategoryNameOverridden,
+      folly::StringPiece filename,
+      unsigned int lineNumber,
+      folly::StringPiece functionName,
+      DeferredFormatType /*unused*/,
+      folly::StringPiece fmt,
+      Args&&... args) noexcept
+      : LogStreamProcessor(
+            categoryInfo,
+            level,
+            categoryName,
+            isCategoryNameOverridden,
+            filename,
+            lineNumber,
+            functionName,
+            INTERNAL,
+            std::string()) {
+    deferFormat(fmt, args...);
+  }
 
   /*
    * Versions of the above constructors to use in XLOG() macros that appear in
@@ -253,6 +306,28 @@ class LogStreamProcessor {
             functionName,
             INTERNAL,
             formatLogString(fmt, std::forward<Args>(args)...)) {}
+  template <typename... Args>
+  LogStreamProcessor(
+      XlogFileScopeInfo* fileScopeInfo,
+      LogLevel level,
+      folly::StringPiece /* categoryName */,
+      bool /* isCategoryNameOverridden */,
+      folly::StringPiece filename,
+      unsigned int lineNumber,
+      folly::StringPiece functionName,
+      DeferredFormatType /*unused*/,
+      folly::StringPiece fmt,
+      Args&&... args) noexcept
+      : LogStreamProcessor(
+            fileScopeInfo,
+            level,
+            filename,
+            lineNumber,
+            functionName,
+            INTERNAL,
+            std::string()) {
+    deferFormat(fmt, args...);
+  }
 
   ~LogStreamProcessor() noexcept;
 
@@ -378,12 +453,33 @@ class LogStreamProcessor {
     return result;
   }
 
+  /**
+   * Save the format string and a copy of the arguments to be formatted when
+   * the message is written.
+   *
+   * Like formatLogString(), this does not throw: if the arguments cannot be
+   * copied, the message is formatted now instead.
+   */
+  template <typename... Args>
+  FOLLY_NOINLINE void deferFormat(
+      folly::StringPiece fmt, const Args&... args) noexcept {
+    deferred_ = folly::catch_exception(
+        [&] { return logging::makeDeferredLogFormat(fmt, args...); },
+        [&] {
+          message_ = formatLogString(fmt, args...);
+          return std::shared_ptr<const logging::DeferredLogFormat>();
+        });
+  }
+
   const LogCategory* const category_;
   LogLevel const level_;
   folly::StringPiece filename_;
   unsigned int lineNumber_;
   folly::StringPiece functionName_;
   std::string message_;
+  // The format string and arguments of a DEFERRED_FORMAT message, formatted
+  // by the LogHandlers rather than here.
+  std::shared_ptr<const logging::DeferredLogFormat> deferred_;
   LogStream stream_;
 };
 
@@ -16,6 +16,9 @@
 
 #pragma once
 
+#include <string>
+
+#include <folly/Function.h>
 #include <folly/Range.h>
 
 namespace folly {
@@ -64,6 +67,30 @@ class LogWriter {
     writeMessage(folly::StringPiece{buffer}, flags);
   }
 
+  /**
+   * A function that returns a serialized log message, for
+   * writeDeferredMessage().
+   */
+  using MessageFormatter = folly::Function<std::string()>;
+
+  /**
+   * Write a log message that has not been serialized yet.
+   *
+   * `format` returns the serialized message.  Writers that write from a
+   * separate thread may call it on that thread, to keep the cost of
+   * formatting off the thread that logged the message.  It is called at most
+   * once, and not at all if the message is discarded.  `sizeHint` estimates
+   * the size of the serialized message, for writers that limit how much they
+   * buffer.
+   *
+   * The default implementation serializes the message immediately and passes
+   * it to writeMessage().
+   */
+  virtual void writeDeferredMessage(
+      MessageFormatter&& format, size_t /* sizeHint */, uint32_t flags = 0) {
+    writeMessage(format(), flags);
+  }
+
   /**
    * Write a message synchronously.
    *
@@ -18,6 +18,7 @@
 
 #include <utility>
 
+#include <folly/logging/DeferredLogFormat.h>
 #include <folly/logging/LogFormatter.h>
 #include <folly/logging/LogMessage.h>
 #include <folly/logging/LogWriter.h>
@@ -41,6 +42,19 @@ void StandardLogHandler::handleMessage(
   if (message.getLevel() < getLevel()) {
     return;
   }
+  if (message.isFormatDeferred() &&
+      message.getLevel() < syncLevel_.load(std::memory_order_relaxed)) {
+    // Let the writer decide when to format the message, possibly on its own
+    // thread.  The closure holds a copy of the message, which formats its own
+    // text when the formatter asks for it.
+    auto sizeHint = message.getDeferredFormat()->getSizeHint();
+    writer_->writeDeferredMessage(
+        [formatter = formatter_, message, handlerCategory] {
+          return formatter->formatMessage(message, handlerCategory);
+        },
+        sizeHint);
+    return;
+  }
   std::string formattedMessage =
       formatter_->formatMessage(message, handlerCategory);
   if (message.getLevel() >= syncLevel_.load(std::memory_order_relaxed)) {
@@ -38,6 +38,10 @@ class LogWriter;
  *
  * StandardLogHandler also supports ignoring messages less than a specific
  * LogLevel.  By default it processes all messages.
+ *
+ * Messages logged with XLOGF_DEFERRED() are passed to the LogWriter's
+ * writeDeferredMessage() unformatted, unless they are at or above the sync
+ * level, so that an asynchronous writer can format them on its own thread.
  */
 class StandardLogHandler : public LogHandler {
  public:
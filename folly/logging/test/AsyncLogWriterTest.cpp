@@ -16,11 +16,18 @@
 
 #include <folly/logging/AsyncLogWriter.h>
 
+#include <array>
+#include <atomic>
 #include <iostream>
+#include <thread>
+#include <vector>
 
+#include <folly/Conv.h>
+#include <folly/Synchronized.h>
 #include <folly/logging/LoggerDB.h>
 #include <folly/portability/GMock.h>
 #include <folly/portability/GTest.h>
+#include <folly/synchronization/Baton.h>
 #include <folly/test/TestUtils.h>
 
 using namespace folly;
@@ -60,3 +67,198 @@ TEST(AsyncLogWriterDeathTest, cleanupWarning) {
     EXPECT_TRUE(flag);
   }
 }
+
+namespace {
+// Records the messages it is given.  After block(), the next performIO() waits
+// until unblock() is called.
+class RecordingLogWriter : public AsyncLogWriter {
+ public:
+  explicit RecordingLogWriter(Buffering buffering)
+      : AsyncLogWriter(buffering) {}
+  ~RecordingLogWriter() override { cleanup(); }
+
+  void block() { blocked_ = true; }
+  void unblock() { unblocked_.post(); }
+
+  std::vector<std::string> messages() const { return *messages_.rlock(); }
+
+  bool ttyOutput() const override { return false; }
+
+ private:
+  void performIO(const std::vector<std::string>& logs, size_t) override {
+    if (blocked_.exchange(false)) {
+      unblocked_.wait();
+    }
+    auto messages = messages_.wlock();
+    for (const auto& log : logs) {
+      if (!log.empty()) {
+        messages->push_back(log);
+      }
+    }
+  }
+
+  std::atomic<bool> blocked_{false};
+  folly::Baton<> unblocked_;
+  folly::Synchronized<std::vector<std::string>> messages_;
+};
+
+std::atomic<size_t> totalDiscarded{0};
+void countDiscarded(size_t numDiscarded) {
+  totalDiscarded += numDiscarded;
+}
+
+const AsyncLogWriter::Buffering kBufferings[] = {
+    AsyncLogWriter::Buffering::SHARED_QUEUE,
+    AsyncLogWriter::Buffering::PER_THREAD,
+};
+} // namespace
+
+TEST(AsyncLogWriter, ordering) {
+  constexpr size_t kNumThreads = 8;
+  constexpr size_t kNumMessages = 5000;
+  for (auto buffering : kBufferings) {
+    std::vector<std::string> messages;
+    {
+      RecordingLogWriter writer{buffering};
+      EXPECT_EQ(buffering, writer.getBuffering());
+      std::vector<std::thread> threads;
+      for (size_t t = 0; t < kNumThreads; ++t) {
+        threads.emplace_back([&writer, t] {
+          for (size_t n = 0; n < kNumMessages; ++n) {
+            writer.writeMessage(
+                folly::to<std::string>(t, " ", n), LogWriter::NEVER_DISCARD);
+          }
+        });
+      }
+      for (auto& thread : threads) {
+        thread.join();
+      }
+      writer.flush();
+      messages = writer.messages();
+    }
+
+    // Every thread's messages are all there, in the order written.
+    ASSERT_EQ(kNumThreads * kNumMessages, messages.size());
+    std::array<size_t, kNumThreads> next{};
+    for (folly::StringPiece message : messages) {
+      auto thread = folly::to<size_t>(message.split_step(' '));
+      ASSERT_LT(thread, kNumThreads);
+      EXPECT_EQ(next[thread]++, folly::to<size_t>(message));
+    }
+  }
+}
+
+TEST(AsyncLogWriter, flush) {
+  for (auto buffering : kBufferings) {
+    RecordingLogWriter writer{buffering};
+    for (size_t n = 0; n < 100; ++n) {
+      writer.writeMessage(folly::to<std::string>(n));
+      writer.flush();
+      auto messages = writer.messages();
+      ASSERT_EQ(n + 1, messages.size());
+      EXPECT_EQ(folly::to<std::string>(n), messages.back());
+    }
+  }
+}
+
+TEST(AsyncLogWriter, discard) {
+  AsyncLogWriter::setDiscardCallback(countDiscarded);
+  constexpr size_t kNumMessages = 1000;
+  for (auto buffering : kBufferings) {
+    totalDiscarded = 0;
+    std::vector<std::string> messages;
+    {
+      RecordingLogWriter writer{buffering};
+      writer.setMaxBufferSize(100);
+      writer.block();
+      for (size_t n = 0; n < kNumMessages; ++n) {
+        writer.writeMessage(folly::to<std::string>("message ", n));
+      }
+      // Messages that must not be discarded are kept beyond the limit.
+      writer.writeMessage(std::string("kept"), LogWriter::NEVER_DISCARD);
+      writer.unblock();
+      writer.flush();
+      messages = writer.messages();
+    }
+
+    EXPECT_GT(totalDiscarded, 0);
+    EXPECT_EQ(kNumMessages + 1, messages.size() + totalDiscarded);
+    EXPECT_EQ("kept", messages.back());
+  }
+  AsyncLogWriter::setDiscardCallback(nullptr);
+}
+
+TEST(AsyncLogWriter, deferredFormat) {
+  for (auto buffering : kBufferings) {
+    std::vector<std::string> messages;
+    std::thread::id formatThread;
+    {
+      RecordingLogWriter writer{buffering};
+      writer.writeMessage(std::string("first"));
+      writer.writeDeferredMessage(
+          [&] {
+            formatThread = std::this_thread::get_id();
+            return std::string("second");
+          },
+          6);
+      writer.writeMessage(std::string("third"));
+      writer.flush();
+      messages = writer.messages();
+    }
+
+    // Deferred messages are formatted by the I/O thread, and written in their
+    // place in the queue.
+    EXPECT_THAT(messages, testing::ElementsAre("first", "second", "third"));
+    EXPECT_NE(std::thread::id(), formatThread);
+    EXPECT_NE(std::this_thread::get_id(), formatThread);
+  }
+}
+
+TEST(AsyncLogWriter, deferredDiscard) {
+  AsyncLogWriter::setDiscardCallback(countDiscarded);
+  constexpr size_t kNumMessages = 1000;
+  for (auto buffering : kBufferings) {
+    totalDiscarded = 0;
+    size_t numFormatted = 0;
+    std::vector<std::string> messages;
+    {
+      RecordingLogWriter writer{buffering};
+      writer.setMaxBufferSize(100);
+      writer.block();
+      for (size_t n = 0; n < kNumMessages; ++n) {
+        writer.writeDeferredMessage(
+            [&numFormatted, n] {
+              ++numFormatted;
+              return folly::to<std::string>("message ", n);
+            },
+            10);
+      }
+      writer.unblock();
+      writer.flush();
+      messages = writer.messages();
+    }
+
+    // The size hint counts towards the buffer limit, and discarded messages
+    // are never formatted.
+    EXPECT_GT(totalDiscarded, 0);
+    EXPECT_EQ(messages.size(), numFormatted);
+    EXPECT_EQ(kNumMessages, messages.size() + totalDiscarded);
+  }
+  AsyncLogWriter::setDiscardCallback(nullptr);
+}
+
+TEST(AsyncLogWriter, threadExit) {
+  RecordingLogWriter writer{AsyncLogWriter::Buffering::PER_THREAD};
+  writer.block();
+  writer.writeMessage(std::string("first"));
+  // Threads that exit before the I/O thread gets to their messages still
+  // have them written.
+  for (size_t t = 0; t < 10; ++t) {
+    std::thread([&writer, t] {
+      writer.writeMessage(folly::to<std::string>("thread ", t));
+    }).join();
+  }
+  writer.unblock();
+  writer.flush();
+  EXPECT_EQ(11, writer.messages().size());
+}
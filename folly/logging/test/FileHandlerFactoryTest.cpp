@@ -147,6 +147,28 @@ TEST(FileHandlerFactory, pathWithMaxBufferSize) {
       stdHandler->getWriter().get(), tmpFile.path().string().c_str(), 4096000);
 }
 
+TEST(FileHandlerFactory, pathWithThreadBuffers) {
+  FileHandlerFactory factory;
+
+  TemporaryFile tmpFile{"logging_test"};
+  auto options = LogHandlerFactory::Options{
+      make_pair("path", tmpFile.path().string()),
+      make_pair("thread_buffers", "true"),
+  };
+  auto handler = factory.createHandler(options);
+
+  auto stdHandler = std::dynamic_pointer_cast<StandardLogHandler>(handler);
+  ASSERT_TRUE(stdHandler);
+  checkAsyncWriter(
+      stdHandler->getWriter().get(),
+      tmpFile.path().string().c_str(),
+      AsyncFileWriter::kDefaultMaxBufferSize);
+  auto asyncWriter =
+      std::dynamic_pointer_cast<AsyncFileWriter>(stdHandler->getWriter());
+  EXPECT_EQ(
+      AsyncLogWriter::Buffering::PER_THREAD, asyncWriter->getBuffering());
+}
+
 TEST(StreamHandlerFactory, nonAsyncStderr) {
   StreamHandlerFactory factory;
 
@@ -228,6 +250,18 @@ TEST(FileHandlerFactory, errors) {
         "the \"max_buffer_size\" option is only valid for async file handlers");
   }
 
+  {
+    auto options = Options{
+        {"path", tmpFile.path().string()},
+        {"async", "false"},
+        {"thread_buffers", "true"},
+    };
+    EXPECT_THROW_RE(
+        factory.createHandler(options),
+        std::invalid_argument,
+        "the \"thread_buffers\" option is only valid for async file handlers");
+  }
+
   {
     auto options = Options{
         {"path", tmpFile.path().string()},
@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compares the log writers that write to a file from a background thread.
+// Each iteration is one message written, from --num_threads producers at
+// once, and the time includes flushing them all to the file, so the reported
+// iterations per second are messages per second.  The counters give the
+// latency of writeMessage() seen by producers, and the percentage of messages
+// discarded because the writer could not keep up.  Run with --num_threads=32
+// or more to compare the shared queue against per-thread buffering under
+// contention.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/File.h>
+#include <folly/init/Init.h>
+#include <folly/logging/AsyncFileWriter.h>
+#include <folly/logging/IoUringFileWriter.h>
+#include <folly/portability/GFlags.h>
+#include <folly/synchronization/test/Barrier.h>
+#include <folly/testing/TestUtil.h>
+
+DEFINE_int32(num_threads, 4, "Number of threads writing log messages");
+DEFINE_int32(message_size, 128, "Size of each log message, in bytes");
+DEFINE_string(
+    log_dir,
+    "",
+    "Directory to write the log files to; a temporary directory by default");
+
+namespace folly {
+
+namespace {
+
+std::atomic<size_t> gDiscarded{0};
+
+void countDiscarded(size_t numDiscarded) {
+  gDiscarded.fetch_add(numDiscarded, std::memory_order_relaxed);
+}
+
+template <typename MakeWriter>
+void runFileWriterBench(
+    UserCounters& counters, size_t iters, MakeWriter makeWriter) {
+  BenchmarkSuspender braces;
+
+  test::TemporaryFile logFile{
+      "file_writer_bench",
+      FLAGS_log_dir.empty() ? fs::path() : fs::path(FLAGS_log_dir)};
+  auto writer = makeWriter(File{logFile.fd(), false});
+  gDiscarded = 0;
+  AsyncLogWriter::setDiscardCallback(countDiscarded);
+
+  std::string message(std::max(FLAGS_message_size, 1) - 1, 'x');
+  message += '\n';
+
+  size_t numThreads = std::max(FLAGS_num_threads, 1);
+  size_t perThread = (iters + numThreads - 1) / numThreads;
+  std::vector<std::vector<uint64_t>> latencies(numThreads);
+  folly::test::Barrier barrier(1 + numThreads);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < numThreads; ++t) {
+    threads.emplace_back([&, t] {
+      auto& samples = latencies[t];
+      samples.reserve(perThread);
+
+      barrier.wait(); // A - wait for thread start
+
+      for (size_t i = 0; i < perThread; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        writer->writeMessage(StringPiece(message));
+        auto end = std::chrono::steady_clock::now();
+        samples.push_back(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+                .count());
+      }
+
+      barrier.wait(); // B - join the work
+    });
+  }
+
+  barrier.wait(); // A - wait for thread start
+
+  // Time the producers and writing out everything they produced; thread
+  // start-up and the file's creation and removal are not included.
+  braces.dismissing([&] {
+    barrier.wait(); // B - join the work
+    writer->flush();
+  });
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  writer.reset();
+  AsyncLogWriter::setDiscardCallback(nullptr);
+
+  std::vector<uint64_t> all;
+  for (auto const& samples : latencies) {
+    all.insert(all.end(), samples.begin(), samples.end());
+  }
+  if (all.empty()) {
+    return;
+  }
+  auto percentile = [&](double p) {
+    auto nth = all.begin() + static_cast<ptrdiff_t>(p * (all.size() - 1));
+    std::nth_element(all.begin(), nth, all.end());
+    return double(*nth);
+  };
+  counters["p50_ns"] = percentile(0.5);
+  counters["p99_ns"] = percentile(0.99);
+  counters["p999_ns"] = percentile(0.999);
+  counters["max_ns"] = double(*std::max_element(all.begin(), all.end()));
+  counters["discard_pct"] = 100.0 * double(gDiscarded.load()) / all.size();
+}
+
+} // namespace
+
+BENCHMARK_COUNTERS(async_file_writer, counters, iters) {
+  runFileWriterBench(counters, iters, [](File&& file) {
+    return std::make_unique<AsyncFileWriter>(std::move(file));
+  });
+}
+
+BENCHMARK_COUNTERS_RELATIVE(async_file_writer_per_thread, counters, iters) {
+  runFileWriterBench(counters, iters, [](File&& file) {
+    return std::make_unique<AsyncFileWriter>(
+        std::move(file), AsyncLogWriter::Buffering::PER_THREAD);
+  });
+}
+
+BENCHMARK_COUNTERS_RELATIVE(io_uring_file_writer, counters, iters) {
+  runFileWriterBench(counters, iters, [](File&& file) {
+    return std::make_unique<IoUringFileWriter>(std::move(file));
+  });
+}
+
+BENCHMARK_COUNTERS_RELATIVE(
+    io_uring_file_writer_preallocate, counters, iters) {
+  runFileWriterBench(counters, iters, [](File&& file) {
+    IoUringFileWriter::Options options;
+    options.preallocateBytes = 64 * 1024 * 1024;
+    return std::make_unique<IoUringFileWriter>(std::move(file), options);
+  });
+}
+
+BENCHMARK_COUNTERS_RELATIVE(io_uring_file_writer_per_thread, counters, iters) {
+  runFileWriterBench(counters, iters, [](File&& file) {
+    IoUringFileWriter::Options options;
+    options.buffering = AsyncLogWriter::Buffering::PER_THREAD;
+    return std::make_unique<IoUringFileWriter>(std::move(file), options);
+  });
+}
+
+} // namespace folly
+
+int main(int argc, char** argv) {
+  folly::Init init(&argc, &argv);
+  folly::runBenchmarks();
+  return 0;
+}
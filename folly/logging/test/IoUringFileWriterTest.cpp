@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/logging/IoUringFileWriter.h>
+
+#include <array>
+#include <thread>
+#include <vector>
+
+#include <folly/Conv.h>
+#include <folly/Exception.h>
+#include <folly/File.h>
+#include <folly/FileUtil.h>
+#include <folly/String.h>
+#include <folly/portability/Fcntl.h>
+#include <folly/portability/GMock.h>
+#include <folly/portability/GTest.h>
+#include <folly/portability/SysStat.h>
+#include <folly/portability/Unistd.h>
+#include <folly/testing/TestUtil.h>
+
+#ifdef __linux__
+#include <linux/falloc.h>
+#endif
+
+using namespace folly;
+using folly::test::TemporaryFile;
+using testing::HasSubstr;
+
+namespace {
+std::string readAll(TemporaryFile& tmpFile) {
+  std::string data;
+  auto ret = folly::readFile(tmpFile.path().string().c_str(), data);
+  EXPECT_TRUE(ret);
+  return data;
+}
+} // namespace
+
+TEST(IoUringFileWriter, noMessages) {
+  TemporaryFile tmpFile{"logging_test"};
+  IoUringFileWriter writer{folly::File{tmpFile.fd(), false}};
+}
+
+TEST(IoUringFileWriter, simpleMessages) {
+  TemporaryFile tmpFile{"logging_test"};
+
+  {
+    IoUringFileWriter writer{folly::File{tmpFile.fd(), false}};
+    for (int n = 0; n < 10; ++n) {
+      writer.writeMessage(folly::to<std::string>("message ", n, "\n"));
+      std::this_thread::yield();
+    }
+  }
+
+  std::string expected;
+  for (int n = 0; n < 10; ++n) {
+    expected += folly::to<std::string>("message ", n, "\n");
+  }
+  EXPECT_EQ(expected, readAll(tmpFile));
+}
+
+TEST(IoUringFileWriter, flush) {
+  TemporaryFile tmpFile{"logging_test"};
+  IoUringFileWriter writer{folly::File{tmpFile.fd(), false}};
+
+  // flush() returns only once the kernel has written the messages, not just
+  // once the I/O thread has submitted them.
+  std::string expected;
+  for (int n = 0; n < 100; ++n) {
+    auto msg = folly::to<std::string>("message ", n, "\n");
+    writer.writeMessage(msg);
+    expected += msg;
+    writer.flush();
+    ASSERT_EQ(expected, readAll(tmpFile)) << n;
+  }
+}
+
+TEST(IoUringFileWriter, ordering) {
+  TemporaryFile tmpFile{"logging_test"};
+  constexpr size_t kNumThreads = 4;
+  constexpr size_t kNumMessages = 20000;
+
+  {
+    IoUringFileWriter writer{folly::File{tmpFile.fd(), false}};
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < kNumThreads; ++t) {
+      threads.emplace_back([&writer, t] {
+        for (size_t n = 0; n < kNumMessages; ++n) {
+          writer.writeMessage(
+              folly::to<std::string>(t, " ", n, "\n"),
+              LogWriter::NEVER_DISCARD);
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }
+
+  // Every message is there, whole, and each thread's in the order written.
+  std::vector<folly::StringPiece> lines;
+  auto data = readAll(tmpFile);
+  ASSERT_FALSE(data.empty());
+  ASSERT_EQ('\n', data.back());
+  folly::split('\n', folly::StringPiece(data).subpiece(0, data.size() - 1), lines);
+  ASSERT_EQ(kNumThreads * kNumMessages, lines.size());
+  std::array<size_t, kNumThreads> next{};
+  for (auto line : lines) {
+    auto thread = folly::to<size_t>(line.split_step(' '));
+    ASSERT_LT(thread, kNumThreads);
+    EXPECT_EQ(next[thread]++, folly::to<size_t>(line));
+  }
+}
+
+TEST(IoUringFileWriter, discard) {
+  std::array<int, 2> fds;
+  auto pipeResult = fileops::pipe(fds.data());
+  folly::checkUnixError(pipeResult, "pipe failed");
+  folly::File readPipe{fds[0], true};
+
+  std::string data;
+  std::thread reader;
+  constexpr size_t kNumMessages = 1000;
+  {
+    IoUringFileWriter writer{folly::File{fds[1], true}};
+    writer.setMaxBufferSize(4096);
+
+    // Nothing reads the pipe until all messages have been written, so most of
+    // them are discarded once the pipe and the buffers are full.
+    std::string padding(1000, 'x');
+    for (size_t n = 0; n < kNumMessages; ++n) {
+      writer.writeMessage(folly::to<std::string>(n, " ", padding, "\n"));
+    }
+    reader = std::thread([&] {
+      auto ret = folly::readFile(readPipe.fd(), data);
+      folly::checkUnixError(ret, "read failed");
+    });
+  }
+  reader.join();
+
+  EXPECT_THAT(
+      data, HasSubstr("log messages discarded: logging faster than we can write"));
+  size_t received = 0;
+  size_t discarded = 0;
+  std::vector<folly::StringPiece> lines;
+  folly::split('\n', data, lines);
+  size_t last = 0;
+  for (auto line : lines) {
+    if (line.empty()) {
+      continue;
+    }
+    auto n = folly::to<size_t>(line.split_step(' '));
+    if (line.startsWith("log messages discarded")) {
+      discarded += n;
+      continue;
+    }
+    EXPECT_EQ(1000, line.size());
+    if (received > 0) {
+      EXPECT_GT(n, last);
+    }
+    last = n;
+    ++received;
+  }
+  EXPECT_LT(received, kNumMessages);
+  // Messages discarded after the last batch was picked up are not reported.
+  EXPECT_GT(discarded, 0);
+  EXPECT_LE(received + discarded, kNumMessages);
+}
+
+#ifdef __linux__
+TEST(IoUringFileWriter, preallocate) {
+  TemporaryFile tmpFile{"logging_test"};
+  constexpr size_t kChunk = 1024 * 1024;
+  if (fallocate(tmpFile.fd(), FALLOC_FL_KEEP_SIZE, 0, 4096) != 0) {
+    GTEST_SKIP() << "fallocate() not supported here: " << errnoStr(errno);
+  }
+
+  IoUringFileWriter::Options options;
+  options.preallocateBytes = kChunk;
+  IoUringFileWriter writer{folly::File{tmpFile.fd(), false}, options};
+  std::string expected;
+  for (int n = 0; n < 10; ++n) {
+    auto msg = folly::to<std::string>("message ", n, "\n");
+    writer.writeMessage(msg);
+    expected += msg;
+  }
+  writer.flush();
+
+  // The file holds the messages, with room for more reserved past its end.
+  EXPECT_EQ(expected, readAll(tmpFile));
+  struct stat st;
+  ASSERT_EQ(0, fstat(tmpFile.fd(), &st));
+  EXPECT_EQ(expected.size(), st.st_size);
+  EXPECT_GE(st.st_blocks * 512, kChunk);
+}
+#endif
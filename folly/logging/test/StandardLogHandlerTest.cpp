@@ -17,6 +17,7 @@
 #include <folly/logging/StandardLogHandler.h>
 
 #include <folly/Conv.h>
+#include <folly/logging/DeferredLogFormat.h>
 #include <folly/logging/LogCategory.h>
 #include <folly/logging/LogFormatter.h>
 #include <folly/logging/LogHandlerConfig.h>
@@ -65,6 +66,31 @@ class TestLogWriter : public LogWriter {
  private:
   std::vector<std::string> messages_;
 };
+
+// Holds on to deferred messages until format() is called.
+class DeferringLogWriter : public TestLogWriter {
+ public:
+  void writeDeferredMessage(
+      MessageFormatter&& format,
+      size_t sizeHint,
+      uint32_t /* flags */ = 0) override {
+    sizeHints_.push_back(sizeHint);
+    pending_.push_back(std::move(format));
+  }
+
+  void format() {
+    for (auto& format : pending_) {
+      getMessages().push_back(format());
+    }
+    pending_.clear();
+  }
+
+  const std::vector<size_t>& getSizeHints() const { return sizeHints_; }
+
+ private:
+  std::vector<MessageFormatter> pending_;
+  std::vector<size_t> sizeHints_;
+};
 } // namespace
 
 TEST(StandardLogHandler, simple) {
@@ -136,3 +162,46 @@ TEST(StandardLogHandler, levelCheck) {
       "ERR::log_cat::handler_cat::src/test.cpp::1234::oh noes", messages.at(2));
   messages.clear();
 }
+
+TEST(StandardLogHandler, deferredFormat) {
+  auto writer = make_shared<DeferringLogWriter>();
+  LogHandlerConfig config{"std_test"};
+  StandardLogHandler handler(
+      config, make_shared<TestLogFormatter>(), writer, LogLevel::ERR);
+
+  LoggerDB db{LoggerDB::TESTING};
+  auto logCategory = db.getCategory("log_cat");
+  auto handlerCategory = db.getCategory("handler_cat");
+
+  auto logMsg = [&](LogLevel level, folly::StringPiece name) {
+    LogMessage msg{
+        logCategory,
+        level,
+        "src/test.cpp",
+        1234,
+        "testMethod",
+        logging::makeDeferredLogFormat("hello {}", name)};
+    handler.handleMessage(msg, handlerCategory);
+  };
+
+  // The writer is given the message unformatted, and formats it when it
+  // wants to, after the LogMessage itself is gone.
+  logMsg(LogLevel::INFO, "world");
+  EXPECT_EQ(0, writer->getMessages().size());
+  ASSERT_EQ(1, writer->getSizeHints().size());
+  EXPECT_EQ(strlen("hello {}") + strlen("world"), writer->getSizeHints()[0]);
+  writer->format();
+  ASSERT_EQ(1, writer->getMessages().size());
+  EXPECT_EQ(
+      "INFO::log_cat::handler_cat::src/test.cpp::1234::hello world",
+      writer->getMessages()[0]);
+  writer->getMessages().clear();
+
+  // Messages at the sync level are formatted right away.
+  logMsg(LogLevel::ERR, "now");
+  ASSERT_EQ(1, writer->getMessages().size());
+  EXPECT_EQ(
+      "ERR::log_cat::handler_cat::src/test.cpp::1234::hello now",
+      writer->getMessages()[0]);
+  EXPECT_EQ(1, writer->getSizeHints().size());
+}
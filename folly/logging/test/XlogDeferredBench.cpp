@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compares the cost to the calling thread of XLOGF(), which formats the
+// message before handing it to the log handlers, with XLOGF_DEFERRED(), which
+// leaves the formatting to the async file handler's I/O thread.  Each
+// iteration is one log statement; the time the I/O thread takes to write the
+// messages out afterwards is not included.
+
+#include <folly/logging/xlog.h>
+
+#include <string>
+
+#include <folly/Benchmark.h>
+#include <folly/init/Init.h>
+#include <folly/logging/FileHandlerFactory.h>
+#include <folly/logging/Init.h>
+#include <folly/logging/LoggerDB.h>
+
+namespace folly {
+
+namespace {
+template <typename LogFn>
+void runXlogDeferredBench(size_t iters, LogFn log) {
+  for (size_t i = 0; i < iters; ++i) {
+    log(i);
+  }
+
+  // Let the I/O thread catch up, so that each benchmark starts with an empty
+  // buffer.
+  BenchmarkSuspender braces;
+  LoggerDB::get().flushAllHandlers();
+}
+
+const std::string kPeer = "2001:db8::1:443";
+} // namespace
+
+BENCHMARK(xlogf_ints, iters) {
+  runXlogDeferredBench(iters, [](size_t i) {
+    XLOGF(INFO, "batch {} of {}: {} items", i, i + 1, i * 7);
+  });
+}
+
+BENCHMARK_RELATIVE(xlogf_deferred_ints, iters) {
+  runXlogDeferredBench(iters, [](size_t i) {
+    XLOGF_DEFERRED(INFO, "batch {} of {}: {} items", i, i + 1, i * 7);
+  });
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(xlogf_mixed, iters) {
+  runXlogDeferredBench(iters, [](size_t i) {
+    XLOGF(
+        INFO,
+        "request {:08x} from {} took {:.3f} ms, status {}",
+        i,
+        kPeer,
+        i * 0.001,
+        200);
+  });
+}
+
+BENCHMARK_RELATIVE(xlogf_deferred_mixed, iters) {
+  runXlogDeferredBench(iters, [](size_t i) {
+    XLOGF_DEFERRED(
+        INFO,
+        "request {:08x} from {} took {:.3f} ms, status {}",
+        i,
+        kPeer,
+        i * 0.001,
+        200);
+  });
+}
+
+} // namespace folly
+
+// A large buffer, so that messages are not discarded, which would make the
+// deferred path look cheaper than it is.
+FOLLY_INIT_LOGGING_CONFIG(
+    ".=INFO:default; "
+    "default=file:path=/dev/null,async=true,max_buffer_size=1073741824");
+
+int main(int argc, char** argv) {
+  folly::LoggerDB::get().registerHandlerFactory(
+      std::make_unique<folly::FileHandlerFactory>(),
+      /* replaceExisting = */ true);
+  folly::Init init(&argc, &argv);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -235,6 +235,61 @@ TEST_F(XlogTest, xlog) {
   messages.clear();
 }
 
+TEST_F(XlogTest, xlogDeferred) {
+  auto handler = make_shared<TestLogHandler>();
+  LoggerDB::get().getCategory(current_xlog_parent)->addHandler(handler);
+  auto& messages = handler->getMessages();
+
+  XLOGF_DEFERRED(INFO, "not enabled: {}", 1);
+  EXPECT_EQ(0, messages.size());
+
+  // The arguments are copied, so changing them after the statement does not
+  // change the message.
+  std::string str = "foo";
+  XLOGF_DEFERRED(WARN, "number: {:>3d}; string: {}", 12, str);
+  str = "bar";
+  ASSERT_EQ(1, messages.size());
+  EXPECT_TRUE(messages[0].first.isFormatDeferred());
+  EXPECT_EQ(
+      "number: {:>3d}; string: {}",
+      messages[0].first.getDeferredFormat()->getFormatString());
+  EXPECT_EQ("number:  12; string: foo", messages[0].first.getMessage());
+  EXPECT_FALSE(messages[0].first.isFormatDeferred());
+  EXPECT_TRUE(messages[0].first.getFileName().endsWith("XlogTest.cpp"))
+      << "unexpected file name: " << messages[0].first.getFileName();
+  EXPECT_EQ(LogLevel::WARN, messages[0].first.getLevel());
+  EXPECT_EQ(current_xlog_category, messages[0].first.getCategory()->getName());
+  EXPECT_EQ(current_xlog_parent, messages[0].second->getName());
+  messages.clear();
+
+  // The text is sanitized once it is formatted.
+  XLOGF_DEFERRED(ERR, "{}\n{}", folly::StringPiece("a\x01"), 'b');
+  ASSERT_EQ(1, messages.size());
+  EXPECT_EQ("a\x01\nb", messages[0].first.getRawMessage());
+  EXPECT_EQ("a\\x01\nb", messages[0].first.getMessage());
+  EXPECT_EQ(1, messages[0].first.getNumNewlines());
+  messages.clear();
+
+  // Errors are reported like XLOGF() does.
+  XLOGF_DEFERRED(WARN, "{:d}", "x");
+  ASSERT_EQ(1, messages.size());
+  EXPECT_THAT(
+      messages[0].first.getMessage(),
+      testing::StartsWith("error formatting log message: "));
+  EXPECT_THAT(
+      messages[0].first.getMessage(),
+      testing::EndsWith("format string: \"{:d}\", arguments: x"));
+  messages.clear();
+
+  // Arguments streamed in with << are appended, which needs the message to
+  // be formatted right away.
+  XLOGF_DEFERRED(WARN, "count: {}", 3) << ", and more";
+  ASSERT_EQ(1, messages.size());
+  EXPECT_FALSE(messages[0].first.isFormatDeferred());
+  EXPECT_EQ("count: 3, and more", messages[0].first.getMessage());
+  messages.clear();
+}
+
 TEST_F(XlogTest, perFileCategoryHandling) {
   using namespace logging_test;
 
@@ -111,6 +111,29 @@ static_assert(
       fmt,                                 \
       ##__VA_ARGS__)
 
+/**
+ * Log a message to this file's default log category, using a format string,
+ * and leave the formatting to the log handlers.
+ *
+ * This behaves like XLOGF(), except that the calling thread only copies the
+ * arguments into a compact record, and does not format the message.  Handlers
+ * that write asynchronously (for instance file handlers with async=true)
+ * format it on their I/O thread instead, which takes the cost of formatting
+ * off the calling thread; other handlers format it as they handle it, as with
+ * XLOGF().
+ *
+ * The format string must be a string literal.  The arguments must be numbers,
+ * enums, strings or untyped pointers: they are copied, and strings of any
+ * kind are copied into a std::string, so that nothing they refer to needs to
+ * outlive the statement.
+ */
+#define XLOGF_DEFERRED(level, fmt, ...)             \
+  XLOG_IMPL(                                        \
+      ::folly::LogLevel::level,                     \
+      ::folly::LogStreamProcessor::DEFERRED_FORMAT, \
+      "" fmt,                                       \
+      ##__VA_ARGS__)
+
 /**
  * Log a message using a format string if and only if the specified condition
  * predicate evaluates to true. Note that the condition is *only* evaluated
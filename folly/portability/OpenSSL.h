@@ -100,3 +100,12 @@
 #else
 #define FOLLY_OPENSSL_HAS_CHACHA 0
 #endif
+
+// OpenSSL 3.0 can hand the record layer of a socket to the kernel (kTLS) on
+// Linux and FreeBSD, unless it is explicitly compiled out
+#if !defined(OPENSSL_IS_BORINGSSL) && defined(SSL_OP_ENABLE_KTLS) && \
+    !defined(OPENSSL_NO_KTLS)
+#define FOLLY_OPENSSL_HAS_KTLS 1
+#else
+#define FOLLY_OPENSSL_HAS_KTLS 0
+#endif
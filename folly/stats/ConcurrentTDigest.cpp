@@ -0,0 +1,246 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/stats/ConcurrentTDigest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <thread>
+#include <utility>
+
+#include <folly/Likely.h>
+#include <folly/concurrency/CacheLocality.h>
+
+namespace folly {
+
+namespace {
+
+// New cpu-local buffers start small and double in size up to bufferSize, as
+// there can be a lot of digests, one per stat, and most of them are not hot
+// enough to fill a full sized buffer on every cpu.
+constexpr size_t kInitialBufferCapacity = 16;
+
+// How many digests merge() queues before merging them into the digest.
+constexpr size_t kMaxQueuedDigests = 32;
+
+// Buffer slots hold this until their value is written. It is a NaN, and
+// appended NaNs are stored as the canonical quiet NaN instead, so no value is
+// ever written as kUnwritten.
+constexpr uint64_t kUnwritten = 0x7ff0dead0000beefull;
+
+uint64_t toSlot(double value) {
+  if (FOLLY_UNLIKELY(std::isnan(value))) {
+    value = std::numeric_limits<double>::quiet_NaN();
+  }
+  uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+double fromSlot(uint64_t bits) {
+  double value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+} // namespace
+
+ConcurrentTDigest::Buffer::Buffer(size_t cap)
+    : values(new std::atomic<uint64_t>[cap]), capacity(cap) {
+  for (size_t i = 0; i < capacity; ++i) {
+    values[i].store(kUnwritten, std::memory_order_relaxed);
+  }
+}
+
+ConcurrentTDigest::ConcurrentTDigest(size_t bufferSize, size_t digestSize)
+    : cpuLocalBuffers_(CacheLocality::system().numCachesByLevel[0]),
+      bufferSize_(std::max<size_t>(bufferSize, 1)),
+      digestSize_(digestSize),
+      digest_(digestSize) {}
+
+ConcurrentTDigest::~ConcurrentTDigest() {
+  for (auto& cpuLocalBuffer : cpuLocalBuffers_) {
+    delete cpuLocalBuffer.buffer.load(std::memory_order_relaxed);
+  }
+  auto* buffer = full_.load(std::memory_order_relaxed);
+  while (buffer) {
+    delete std::exchange(buffer, buffer->next);
+  }
+  auto* digest = digests_.load(std::memory_order_relaxed);
+  while (digest) {
+    delete std::exchange(digest, digest->next);
+  }
+}
+
+void ConcurrentTDigest::append(double value) {
+  auto& cpuLocalBuffer =
+      cpuLocalBuffers_[AccessSpreader<>::cachedCurrent(cpuLocalBuffers_.size())];
+  // The buffer may be replaced and compressed by another thread as soon as we
+  // have loaded it; the hazard pointer keeps it from being freed under us.
+  auto hptr = make_hazard_pointer<>();
+  auto* buffer = hptr.protect(cpuLocalBuffer.buffer);
+  while (true) {
+    if (FOLLY_LIKELY(buffer != nullptr)) {
+      auto slot = buffer->claimed.fetch_add(1, std::memory_order_relaxed);
+      if (FOLLY_LIKELY(slot < buffer->capacity)) {
+        buffer->values[slot].store(toSlot(value), std::memory_order_relaxed);
+        return;
+      }
+    }
+
+    // The buffer is full, or this cpu has none yet. Replace it with a new one
+    // holding the value; if another thread beats us to it, use theirs.
+    auto* next = newBuffer(buffer);
+    next->values[0].store(toSlot(value), std::memory_order_relaxed);
+    next->claimed.store(1, std::memory_order_relaxed);
+    if (cpuLocalBuffer.buffer.compare_exchange_strong(
+            buffer, next, std::memory_order_acq_rel)) {
+      if (buffer) {
+        // Every slot was claimed before ours, so they will all be written.
+        buffer->size = buffer->capacity;
+        pushFull(buffer);
+        tryCompress();
+      }
+      return;
+    }
+    delete next;
+    buffer = hptr.protect(cpuLocalBuffer.buffer);
+  }
+}
+
+void ConcurrentTDigest::merge(TDigest digest) {
+  if (digest.empty()) {
+    return;
+  }
+  auto* node = new Digest{std::move(digest)};
+  node->next = digests_.load(std::memory_order_relaxed);
+  while (!digests_.compare_exchange_weak(
+      node->next, node, std::memory_order_release, std::memory_order_relaxed)) {
+  }
+  if (numDigests_.fetch_add(1, std::memory_order_relaxed) + 1 >=
+      kMaxQueuedDigests) {
+    tryCompress();
+  }
+}
+
+TDigest ConcurrentTDigest::build() {
+  auto hptr = make_hazard_pointer<>();
+  for (auto& cpuLocalBuffer : cpuLocalBuffers_) {
+    auto* buffer = hptr.protect(cpuLocalBuffer.buffer);
+    while (buffer) {
+      // Replace buffers that are in use with ones of the same capacity, so
+      // that hot stats do not start over with small buffers after every
+      // build(), and release unused ones.
+      auto* replacement = buffer->claimed.load(std::memory_order_relaxed) > 0
+          ? new Buffer(buffer->capacity)
+          : nullptr;
+      if (cpuLocalBuffer.buffer.compare_exchange_strong(
+              buffer, replacement, std::memory_order_acq_rel)) {
+        // Seal the buffer: threads still holding it will find it full.
+        auto claimed = buffer->claimed.fetch_add(
+            buffer->capacity, std::memory_order_acq_rel);
+        buffer->size = std::min(claimed, buffer->capacity);
+        pushFull(buffer);
+        break;
+      }
+      delete replacement;
+      buffer = hptr.protect(cpuLocalBuffer.buffer);
+    }
+  }
+  hptr.reset_protection();
+
+  std::lock_guard<std::mutex> g(compressMutex_);
+  compress(/* wait = */ true);
+  return std::exchange(digest_, TDigest(digestSize_));
+}
+
+ConcurrentTDigest::Buffer* ConcurrentTDigest::newBuffer(
+    const Buffer* prev) const {
+  auto capacity = prev ? prev->capacity * 2 : kInitialBufferCapacity;
+  return new Buffer(std::min(capacity, bufferSize_));
+}
+
+void ConcurrentTDigest::pushFull(Buffer* buffer) {
+  buffer->next = full_.load(std::memory_order_relaxed);
+  while (!full_.compare_exchange_weak(
+      buffer->next,
+      buffer,
+      std::memory_order_release,
+      std::memory_order_relaxed)) {
+  }
+}
+
+void ConcurrentTDigest::tryCompress() {
+  // Never wait here: if another thread is compressing, it will get to our
+  // buffer on its next pass, or build() will.
+  std::unique_lock<std::mutex> g(compressMutex_, std::try_to_lock);
+  if (g.owns_lock()) {
+    compress(/* wait = */ false);
+  }
+}
+
+void ConcurrentTDigest::compress(bool wait) {
+  std::vector<double> values;
+  values.reserve(bufferSize_);
+  Buffer* unfinished = nullptr;
+  auto* buffer = full_.exchange(nullptr, std::memory_order_acquire);
+  while (buffer) {
+    auto* next = buffer->next;
+    auto begin = values.size();
+    for (size_t i = 0; i < buffer->size; ++i) {
+      auto bits = buffer->values[i].load(std::memory_order_relaxed);
+      // A thread that claimed the slot has not written it yet.
+      while (bits == kUnwritten && wait) {
+        std::this_thread::yield();
+        bits = buffer->values[i].load(std::memory_order_relaxed);
+      }
+      if (bits == kUnwritten) {
+        break;
+      }
+      values.push_back(fromSlot(bits));
+    }
+    if (values.size() - begin < buffer->size) {
+      values.resize(begin);
+      buffer->next = std::exchange(unfinished, buffer);
+    } else {
+      buffer->retire();
+    }
+    buffer = next;
+  }
+  while (unfinished) {
+    pushFull(std::exchange(unfinished, unfinished->next));
+  }
+
+  if (!values.empty()) {
+    digest_ = digest_.merge(values);
+  }
+
+  auto* digest = digests_.exchange(nullptr, std::memory_order_acquire);
+  if (digest) {
+    std::vector<TDigest> digests;
+    digests.push_back(std::move(digest_));
+    while (digest) {
+      digests.push_back(std::move(digest->digest));
+      delete std::exchange(digest, digest->next);
+    }
+    numDigests_.fetch_sub(digests.size() - 1, std::memory_order_relaxed);
+    digest_ = TDigest::merge(digests);
+  }
+}
+
+} // namespace folly
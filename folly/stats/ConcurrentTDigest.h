@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <folly/lang/Align.h>
+#include <folly/stats/TDigest.h>
+#include <folly/synchronization/Hazptr.h>
+
+namespace folly {
+
+/*
+ * ConcurrentTDigest is a TDigest that any number of threads can add values to
+ * without taking locks.
+ *
+ * Like DigestBuilder, it buffers values in cpu-local buffers and merges them
+ * into the digest in large chunks. Unlike DigestBuilder, appending a value
+ * never blocks: a thread claims a slot in its cpu's buffer with a single
+ * atomic increment and writes the value there. The thread that finds the
+ * buffer full swaps in a new one and hands the full one over for compression,
+ * which is done by whichever appending thread finds no other compression in
+ * progress; the others carry on appending.
+ *
+ * Digests from other sources, such as other processes (see
+ * TDigest::serialize()), can be merged in with merge(). This queues the digest
+ * in constant time, and queued digests are merged together in batches.
+ *
+ * As with DigestBuilder, a typical usage is to append values for a period of
+ * time, and then have one thread call build() to collect them.
+ */
+class ConcurrentTDigest {
+ public:
+  explicit ConcurrentTDigest(
+      size_t bufferSize = TDigest::kDefaultBufferSize,
+      size_t digestSize = TDigest::kDefaultMaxSize);
+
+  ~ConcurrentTDigest();
+
+  ConcurrentTDigest(const ConcurrentTDigest&) = delete;
+  ConcurrentTDigest& operator=(const ConcurrentTDigest&) = delete;
+
+  /*
+   * Adds a value to the digest. Lock-free.
+   */
+  void append(double value);
+
+  /*
+   * Merges a digest into this one. The digest is queued, and merged along
+   * with others later, so this takes constant time amortized.
+   */
+  void merge(TDigest digest);
+
+  /*
+   * Builds a TDigest from all values and digests added so far, and removes
+   * them from this digest. Values added concurrently with build() are either
+   * in the result or left for the next build().
+   */
+  TDigest build();
+
+ private:
+  // A buffer of values, stored as their bit patterns. Appending threads claim
+  // slots by incrementing `claimed`, and then overwrite the marker that the
+  // slot was filled with. A buffer is sealed by pushing `claimed` to at least
+  // `capacity`, after which no more slots can be claimed, and the first `size`
+  // slots will be written.
+  struct Buffer : hazptr_obj_base<Buffer> {
+    explicit Buffer(size_t cap);
+
+    std::atomic<size_t> claimed{0};
+    std::unique_ptr<std::atomic<uint64_t>[]> values;
+    const size_t capacity;
+    // Set when the buffer is sealed.
+    size_t size{0};
+    Buffer* next{nullptr};
+  };
+
+  struct Digest {
+    TDigest digest;
+    Digest* next{nullptr};
+  };
+
+  struct alignas(hardware_destructive_interference_size) CpuLocalBuffer {
+    std::atomic<Buffer*> buffer{nullptr};
+  };
+
+  Buffer* newBuffer(const Buffer* prev) const;
+  void pushFull(Buffer* buffer);
+  void tryCompress();
+  // Must be called with compressMutex_ held. If wait is false, buffers still
+  // being written to are left for the next call.
+  void compress(bool wait);
+
+  std::vector<CpuLocalBuffer> cpuLocalBuffers_;
+  const size_t bufferSize_;
+  const size_t digestSize_;
+
+  // Sealed buffers, and digests passed to merge(), waiting to be compressed.
+  std::atomic<Buffer*> full_{nullptr};
+  std::atomic<Digest*> digests_{nullptr};
+  std::atomic<size_t> numDigests_{0};
+
+  std::mutex compressMutex_;
+  TDigest digest_; // Protected by compressMutex_.
+};
+
+} // namespace folly
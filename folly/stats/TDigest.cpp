@@ -34,16 +34,19 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <optional>
 
 #include <glog/logging.h>
 
-#include <folly/Overload.h>
 #include <folly/Utility.h>
+#include <folly/Varint.h>
 #include <folly/algorithm/BinaryHeap.h>
+#include <folly/lang/Bits.h>
 #include <folly/lang/Exception.h>
 #include <folly/memory/Malloc.h>
 #include <folly/stats/detail/DoubleRadixSort.h>
+#include <folly/stats/detail/DoubleSimd.h>
 
 namespace folly {
 
@@ -124,6 +127,58 @@ class Buffer : NonCopyableNonMovable {
   size_t size_;
 };
 
+/*
+ * Wire format written by TDigest::serialize(), all integers little endian:
+ *   u8      version (kSerializationVersion)
+ *   u8      flags (kFlagDoubleWeights)
+ *   varint  maxSize
+ *   varint  number of centroids
+ *   f64     sum, count, max, min
+ *   then for each centroid, in increasing order of mean:
+ *   f64     mean
+ *   varint  weight, or f64 if kFlagDoubleWeights is set
+ */
+constexpr uint8_t kSerializationVersion = 1;
+constexpr uint8_t kFlagDoubleWeights = 1;
+
+void appendDouble(std::string& out, double value) {
+  uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  bits = Endian::little(bits);
+  out.append(reinterpret_cast<const char*>(&bits), sizeof(bits));
+}
+
+void appendVarint(std::string& out, uint64_t value) {
+  uint8_t buf[kMaxVarintLength64];
+  out.append(reinterpret_cast<const char*>(buf), encodeVarint(value, buf));
+}
+
+double readDouble(ByteRange& bytes) {
+  uint64_t bits;
+  if (bytes.size() < sizeof(bits)) {
+    throw_exception<std::invalid_argument>("Truncated TDigest.");
+  }
+  std::memcpy(&bits, bytes.data(), sizeof(bits));
+  bytes.advance(sizeof(bits));
+  bits = Endian::little(bits);
+  double value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+uint64_t readVarint(ByteRange& bytes) {
+  auto value = tryDecodeVarint(bytes);
+  if (!value) {
+    throw_exception<std::invalid_argument>("Truncated TDigest.");
+  }
+  return *value;
+}
+
+bool isVarintWeight(double weight) {
+  // 2^53 is the largest power of two up to which doubles hold every integer.
+  return weight <= 9007199254740992.0 && weight == std::floor(weight);
+}
+
 double clamp(double v, double lo, double hi) {
   if (v > hi) {
     return hi;
@@ -173,6 +228,43 @@ class TDigest::CentroidMerger {
     }
   }
 
+  /*
+   * Appends a sorted run of values, each of weight 1. This is equivalent to
+   * appending Centroid{value, 1.0} for each of them, but rather than checking
+   * the weight limit value by value, finds where the next centroid starts from
+   * the room left under the limit, and sums the values up to there at once.
+   */
+  void appendValues(Range<const double*> values) {
+    if (!values.empty() && !cur_) {
+      append(Centroid{values.front(), 1.0});
+      values.advance(1);
+    }
+    while (!values.empty()) {
+      size_t fit = values.size();
+      if (k_limit_ <= maxSize_) {
+        double room = q_limit_times_count_ - weightSoFar_;
+        fit = room < 1                 ? 0
+            : room >= values.size() ? values.size()
+                                    : size_t(room);
+        // Match the check append() does, in case room was rounded.
+        while (fit > 0 && !(weightSoFar_ + fit <= q_limit_times_count_)) {
+          --fit;
+        }
+      }
+      if (fit > 0) {
+        sumsToMerge_ += detail::double_sum(values.data(), fit);
+        weightsToMerge_ += fit;
+        weightSoFar_ += fit;
+        values.advance(fit);
+      }
+      if (!values.empty()) {
+        // Starts a new centroid, unless rounding left room for the value.
+        append(Centroid{values.front(), 1.0});
+        values.advance(1);
+      }
+    }
+  }
+
   std::pair<std::vector<Centroid>, double> finalize() && {
     if (!cur_) {
       return {}; // No centroids, no sum.
@@ -242,9 +334,23 @@ TDigest::TDigest(
 
 // Merge unsorted values by first sorting them.
 TDigest TDigest::merge(Range<const double*> unsortedValues) const {
+  return merge(Range<const Range<const double*>*>(&unsortedValues, 1));
+}
+
+// Merge all buffers at once, by sorting them together.
+TDigest TDigest::merge(
+    Range<const Range<const double*>*> unsortedBuffers) const {
   constexpr size_t kRadixSortThreshold = 700;
 
-  auto n = unsortedValues.size();
+  size_t n = 0;
+  for (const auto& buffer : unsortedBuffers) {
+    n += buffer.size();
+  }
+  auto copyValues = [&](double* out) {
+    for (const auto& buffer : unsortedBuffers) {
+      out = std::copy(buffer.begin(), buffer.end(), out);
+    }
+  };
 
   if (n > kRadixSortThreshold) {
     // Use radix sort if the set is large enough.  This implementation puts all
@@ -263,7 +369,7 @@ TDigest TDigest::merge(Range<const double*> unsortedValues) const {
     p += n * sizeof(double);
     double* out = reinterpret_cast<double*>(p);
 
-    std::copy(unsortedValues.begin(), unsortedValues.end(), in);
+    copyValues(in);
     detail::double_radix_sort(n, buckets, in, out);
 
     return merge(sorted_equivalent, Range<const double*>(in, in + n));
@@ -271,7 +377,7 @@ TDigest TDigest::merge(Range<const double*> unsortedValues) const {
     // Set is small, prefer avoiding allocations. Temporary buffer is small
     // enough that we can keep it on the stack.
     double in[kRadixSortThreshold];
-    std::copy(unsortedValues.begin(), unsortedValues.end(), in);
+    copyValues(in);
     std::sort(in, in + n);
     return merge(sorted_equivalent, Range<const double*>(in, in + n));
   }
@@ -304,13 +410,17 @@ void TDigest::mergeValues(
 
   CentroidMerger merger(std::move(workingBuffer), maxSize_, newCount);
 
-  merge2Containers(
-      centroids_,
-      sortedValues,
-      [](const Centroid& c, double val) { return c.mean() < val; },
-      overload(
-          [&](const Centroid& c) { merger.append(c); },
-          [&](double val) { merger.append(Centroid{val, 1.0}); }));
+  // Merge the values and the centroids, taking the values in runs: the values
+  // that go before each centroid are found and appended in bulk. In case of
+  // ties, values go first.
+  for (const auto& centroid : centroids_) {
+    auto run = detail::double_count_not_greater(
+        sortedValues.data(), sortedValues.size(), centroid.mean());
+    merger.appendValues(sortedValues.subpiece(0, run));
+    sortedValues.advance(run);
+    merger.append(centroid);
+  }
+  merger.appendValues(sortedValues);
 
   workingBuffer = std::move(dst.centroids_);
   std::tie(dst.centroids_, dst.sum_) = std::move(merger).finalize();
@@ -721,6 +831,82 @@ double TDigest::estimateCdf(double x) const {
   }
 }
 
+std::string TDigest::serialize() const {
+  bool varintWeights = std::all_of(
+      centroids_.begin(), centroids_.end(), [](const Centroid& c) {
+        return isVarintWeight(c.weight());
+      });
+
+  std::string out;
+  out.reserve(
+      2 + 2 * kMaxVarintLength64 + 4 * sizeof(double) +
+      centroids_.size() * (sizeof(double) + kMaxVarintLength64));
+  out.push_back(static_cast<char>(kSerializationVersion));
+  out.push_back(static_cast<char>(varintWeights ? 0 : kFlagDoubleWeights));
+  appendVarint(out, maxSize_);
+  appendVarint(out, centroids_.size());
+  appendDouble(out, sum_);
+  appendDouble(out, count_);
+  appendDouble(out, max_);
+  appendDouble(out, min_);
+  for (const auto& centroid : centroids_) {
+    appendDouble(out, centroid.mean());
+    if (varintWeights) {
+      appendVarint(out, static_cast<uint64_t>(centroid.weight()));
+    } else {
+      appendDouble(out, centroid.weight());
+    }
+  }
+  return out;
+}
+
+TDigest TDigest::deserialize(ByteRange bytes) {
+  if (bytes.size() < 2) {
+    throw_exception<std::invalid_argument>("Truncated TDigest.");
+  }
+  if (bytes[0] != kSerializationVersion) {
+    throw_exception<std::invalid_argument>("Unsupported TDigest version.");
+  }
+  uint8_t flags = bytes[1];
+  if ((flags & ~kFlagDoubleWeights) != 0) {
+    throw_exception<std::invalid_argument>("Unsupported TDigest flags.");
+  }
+  bytes.advance(2);
+
+  auto maxSize = readVarint(bytes);
+  auto numCentroids = readVarint(bytes);
+  double sum = readDouble(bytes);
+  double count = readDouble(bytes);
+  double max = readDouble(bytes);
+  double min = readDouble(bytes);
+
+  // Every centroid takes at least a mean and a one byte weight; checking this
+  // first keeps a corrupt count from turning into a huge allocation.
+  if (numCentroids > bytes.size() / (sizeof(double) + 1) ||
+      numCentroids > maxSize) {
+    throw_exception<std::invalid_argument>("Invalid TDigest centroid count.");
+  }
+
+  std::vector<Centroid> centroids;
+  centroids.reserve(numCentroids);
+  for (uint64_t i = 0; i < numCentroids; ++i) {
+    double mean = readDouble(bytes);
+    double weight = (flags & kFlagDoubleWeights)
+        ? readDouble(bytes)
+        : static_cast<double>(readVarint(bytes));
+    if (!(weight > 0) || std::isnan(mean) ||
+        (!centroids.empty() && mean < centroids.back().mean())) {
+      throw_exception<std::invalid_argument>("Invalid TDigest centroid.");
+    }
+    centroids.emplace_back(mean, weight);
+  }
+  if (!bytes.empty()) {
+    throw_exception<std::invalid_argument>("Trailing bytes after TDigest.");
+  }
+
+  return TDigest(std::move(centroids), sum, count, max, min, maxSize);
+}
+
 double TDigest::Centroid::add(double sum, double weight) {
   sum += (mean_ * weight_);
   weight_ += weight;
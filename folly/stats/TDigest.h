@@ -18,6 +18,7 @@
 
 #include <cassert>
 #include <limits>
+#include <string>
 #include <vector>
 
 #include <folly/Range.h>
@@ -104,6 +105,13 @@ class TDigest {
    * digest and the given unsortedValues.
    */
   TDigest merge(Range<const double*> unsortedValues) const;
+  /*
+   * Returns a new TDigest constructed with values merged from the current
+   * digest and all of the given unsortedBuffers. The buffers are sorted
+   * together and merged in a single pass, which is cheaper than merging them
+   * one at a time.
+   */
+  TDigest merge(Range<const Range<const double*>*> unsortedBuffers) const;
 
   /*
    * Returns a new TDigest constructed with values merged from the given
@@ -149,6 +157,20 @@ class TDigest {
 
   size_t maxSize() const { return maxSize_; }
 
+  /*
+   * Serializes the digest into a compact binary form, for shipping it to
+   * another process, where deserialize() turns it back into an equal TDigest.
+   * Centroid weights are encoded as varints when they are all whole numbers,
+   * which they are unless the digest was constructed from weighted centroids.
+   */
+  std::string serialize() const;
+
+  /*
+   * Reconstructs a digest from the output of serialize(). Raise an
+   * invalid_argument exception if the input is truncated or malformed.
+   */
+  static TDigest deserialize(ByteRange bytes);
+
  private:
   class CentroidMerger;
 
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/stats/detail/DoubleSimd.h>
+
+#include <algorithm>
+
+#include <folly/Portability.h>
+#include <folly/lang/Bits.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#if FOLLY_AARCH64
+#include <arm_neon.h>
+#endif
+
+namespace folly {
+namespace detail {
+
+namespace {
+
+// Runs between centroids are usually short, so they are scanned a register at
+// a time for this many values before switching to a binary search.
+constexpr size_t kLinearScanLimit = 16;
+
+bool notGreater(double value, double x) {
+  return !(x < value);
+}
+
+} // namespace
+
+double double_sum(const double* values, size_t n) {
+  size_t i = 0;
+  double sum = 0;
+#if defined(__AVX2__)
+  // Two accumulators, to hide the latency of the adds.
+  __m256d acc0 = _mm256_setzero_pd();
+  __m256d acc1 = _mm256_setzero_pd();
+  for (; i + 8 <= n; i += 8) {
+    acc0 = _mm256_add_pd(acc0, _mm256_loadu_pd(values + i));
+    acc1 = _mm256_add_pd(acc1, _mm256_loadu_pd(values + i + 4));
+  }
+  acc0 = _mm256_add_pd(acc0, acc1);
+  __m128d acc = _mm_add_pd(
+      _mm256_castpd256_pd128(acc0), _mm256_extractf128_pd(acc0, 1));
+  sum = _mm_cvtsd_f64(acc) + _mm_cvtsd_f64(_mm_unpackhi_pd(acc, acc));
+#elif defined(__SSE2__)
+  __m128d acc0 = _mm_setzero_pd();
+  __m128d acc1 = _mm_setzero_pd();
+  for (; i + 4 <= n; i += 4) {
+    acc0 = _mm_add_pd(acc0, _mm_loadu_pd(values + i));
+    acc1 = _mm_add_pd(acc1, _mm_loadu_pd(values + i + 2));
+  }
+  acc0 = _mm_add_pd(acc0, acc1);
+  sum = _mm_cvtsd_f64(acc0) + _mm_cvtsd_f64(_mm_unpackhi_pd(acc0, acc0));
+#elif FOLLY_AARCH64
+  float64x2_t acc0 = vdupq_n_f64(0);
+  float64x2_t acc1 = vdupq_n_f64(0);
+  for (; i + 4 <= n; i += 4) {
+    acc0 = vaddq_f64(acc0, vld1q_f64(values + i));
+    acc1 = vaddq_f64(acc1, vld1q_f64(values + i + 2));
+  }
+  sum = vaddvq_f64(vaddq_f64(acc0, acc1));
+#endif
+  for (; i < n; ++i) {
+    sum += values[i];
+  }
+  return sum;
+}
+
+size_t double_count_not_greater(const double* values, size_t n, double x) {
+  size_t i = 0;
+  size_t scan = std::min(n, kLinearScanLimit);
+#if defined(__AVX2__)
+  __m256d xs = _mm256_set1_pd(x);
+  for (; i + 4 <= scan; i += 4) {
+    // Set for each value that is not greater than x, unordered included.
+    auto mask = static_cast<unsigned>(_mm256_movemask_pd(
+        _mm256_cmp_pd(xs, _mm256_loadu_pd(values + i), _CMP_NLT_UQ)));
+    if (mask != 0xf) {
+      return i + findFirstSet(~mask) - 1;
+    }
+  }
+#elif defined(__SSE2__)
+  __m128d xs = _mm_set1_pd(x);
+  for (; i + 2 <= scan; i += 2) {
+    auto mask = static_cast<unsigned>(
+        _mm_movemask_pd(_mm_cmpnlt_pd(xs, _mm_loadu_pd(values + i))));
+    if (mask != 0x3) {
+      return i + findFirstSet(~mask) - 1;
+    }
+  }
+#elif FOLLY_AARCH64
+  float64x2_t xs = vdupq_n_f64(x);
+  for (; i + 2 <= scan; i += 2) {
+    // Set for each value that is greater than x.
+    uint64x2_t greater = vcltq_f64(xs, vld1q_f64(values + i));
+    if (vgetq_lane_u64(greater, 0)) {
+      return i;
+    }
+    if (vgetq_lane_u64(greater, 1)) {
+      return i + 1;
+    }
+  }
+#endif
+  for (; i < scan; ++i) {
+    if (!notGreater(values[i], x)) {
+      return i;
+    }
+  }
+  if (scan == n) {
+    return n;
+  }
+  return std::partition_point(
+             values + scan,
+             values + n,
+             [x](double value) { return notGreater(value, x); }) -
+      values;
+}
+
+} // namespace detail
+} // namespace folly
@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace folly {
+namespace detail {
+
+/*
+ * Kernels used by TDigest to process runs of sorted values in bulk. They use
+ * AVX2, SSE2 or NEON, whichever the build targets, and plain loops otherwise.
+ */
+
+/*
+ * Returns the sum of the n doubles at values.
+ *
+ * The sum is accumulated in several lanes, so it can differ in the last bits
+ * from adding the values one at a time.
+ */
+double double_sum(const double* values, size_t n);
+
+/*
+ * Returns the length of the longest prefix of the n doubles at values whose
+ * elements are all !(x < value), that is, the number of values that
+ * std::merge() would take before x, if values is sorted.
+ */
+size_t double_count_not_greater(const double* values, size_t n, double x);
+
+} // namespace detail
+} // namespace folly
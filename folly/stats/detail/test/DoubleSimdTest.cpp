@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/stats/detail/DoubleSimd.h>
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+#include <folly/Random.h>
+#include <folly/portability/GTest.h>
+
+using namespace folly::detail;
+
+TEST(DoubleSimd, Sum) {
+  for (size_t n = 0; n < 100; ++n) {
+    // Whole numbers, so that the sum is exact whatever the order.
+    std::vector<double> values(n);
+    for (size_t i = 0; i < n; ++i) {
+      values[i] = folly::Random::rand32(0, 1000) - 500.0;
+    }
+    EXPECT_EQ(
+        std::accumulate(values.begin(), values.end(), 0.0),
+        double_sum(values.data(), n));
+  }
+
+  std::vector<double> values(100000);
+  for (auto& value : values) {
+    value = folly::Random::randDouble(-100.0, 100.0);
+  }
+  EXPECT_NEAR(
+      std::accumulate(values.begin(), values.end(), 0.0),
+      double_sum(values.data(), values.size()),
+      1e-6);
+}
+
+TEST(DoubleSimd, CountNotGreater) {
+  for (size_t n = 0; n < 100; ++n) {
+    std::vector<double> values(n);
+    for (size_t i = 0; i < n; ++i) {
+      values[i] = folly::Random::rand32(0, 20);
+    }
+    std::sort(values.begin(), values.end());
+    for (double x = -1; x <= 21; x += 0.5) {
+      auto expected =
+          std::upper_bound(values.begin(), values.end(), x) - values.begin();
+      EXPECT_EQ(expected, double_count_not_greater(values.data(), n, x))
+          << "n=" << n << " x=" << x;
+    }
+  }
+}
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/stats/ConcurrentTDigest.h>
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <folly/synchronization/test/Barrier.h>
+
+#include <folly/Benchmark.h>
+#include <folly/portability/GFlags.h>
+#include <folly/stats/DigestBuilder.h>
+#include <folly/stats/TDigest.h>
+
+using namespace folly;
+
+// Appends with real TDigest merges, as opposed to DigestBuilderBenchmark,
+// which measures the buffering alone.
+template <typename Digest>
+unsigned int append(unsigned int iters, size_t nThreads) {
+  iters = 1000000;
+  std::unique_ptr<Digest> digest;
+  auto barrier = std::make_shared<folly::test::Barrier>(nThreads + 1);
+
+  std::vector<std::thread> threads;
+  threads.reserve(nThreads);
+  BENCHMARK_SUSPEND {
+    digest = std::make_unique<Digest>(
+        TDigest::kDefaultBufferSize, TDigest::kDefaultMaxSize);
+    for (size_t i = 0; i < nThreads; ++i) {
+      threads.emplace_back([&, i]() {
+        barrier->wait();
+        for (size_t iter = 0; iter < iters; ++iter) {
+          digest->append((iter * 7919 + i) % 100000);
+        }
+        barrier->wait();
+      });
+    }
+    barrier->wait();
+  }
+  barrier->wait();
+
+  BENCHMARK_SUSPEND {
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    doNotOptimizeAway(digest->build().count());
+  }
+  return iters;
+}
+
+unsigned int digestBuilderAppend(unsigned int iters, size_t nThreads) {
+  return append<DigestBuilder<TDigest>>(iters, nThreads);
+}
+
+unsigned int concurrentTDigestAppend(unsigned int iters, size_t nThreads) {
+  return append<ConcurrentTDigest>(iters, nThreads);
+}
+
+BENCHMARK_NAMED_PARAM_MULTI(digestBuilderAppend, 1, 1)
+BENCHMARK_RELATIVE_NAMED_PARAM_MULTI(concurrentTDigestAppend, 1, 1)
+BENCHMARK_NAMED_PARAM_MULTI(digestBuilderAppend, 4, 4)
+BENCHMARK_RELATIVE_NAMED_PARAM_MULTI(concurrentTDigestAppend, 4, 4)
+BENCHMARK_NAMED_PARAM_MULTI(digestBuilderAppend, 16, 16)
+BENCHMARK_RELATIVE_NAMED_PARAM_MULTI(concurrentTDigestAppend, 16, 16)
+BENCHMARK_NAMED_PARAM_MULTI(digestBuilderAppend, 32, 32)
+BENCHMARK_RELATIVE_NAMED_PARAM_MULTI(concurrentTDigestAppend, 32, 32)
+BENCHMARK_DRAW_LINE();
+
+// Merging digests received from other processes, as a metrics agent does at
+// scrape time: all at once with TDigest::merge(), or as they arrive with
+// ConcurrentTDigest::merge().
+std::vector<std::string> serializedDigests(size_t n) {
+  std::vector<std::string> ret;
+  std::vector<double> values(TDigest::kDefaultBufferSize);
+  for (size_t i = 0; i < n; ++i) {
+    for (size_t j = 0; j < values.size(); ++j) {
+      values[j] = (i * values.size() + j) * 7919 % 100000;
+    }
+    ret.push_back(TDigest().merge(values).serialize());
+  }
+  return ret;
+}
+
+void tdigestMergeAll(size_t iters, size_t nDigests) {
+  std::vector<std::string> serialized;
+  BENCHMARK_SUSPEND {
+    serialized = serializedDigests(nDigests);
+  }
+  for (size_t i = 0; i < iters; ++i) {
+    std::vector<TDigest> digests;
+    digests.reserve(serialized.size());
+    for (const auto& s : serialized) {
+      digests.push_back(TDigest::deserialize(StringPiece(s)));
+    }
+    doNotOptimizeAway(TDigest::merge(digests).count());
+  }
+}
+
+void concurrentTDigestMerge(size_t iters, size_t nDigests) {
+  std::vector<std::string> serialized;
+  BENCHMARK_SUSPEND {
+    serialized = serializedDigests(nDigests);
+  }
+  ConcurrentTDigest digest;
+  for (size_t i = 0; i < iters; ++i) {
+    for (const auto& s : serialized) {
+      digest.merge(TDigest::deserialize(StringPiece(s)));
+    }
+    doNotOptimizeAway(digest.build().count());
+  }
+}
+
+BENCHMARK_NAMED_PARAM(tdigestMergeAll, 100, 100)
+BENCHMARK_RELATIVE_NAMED_PARAM(concurrentTDigestMerge, 100, 100)
+BENCHMARK_NAMED_PARAM(tdigestMergeAll, 1000, 1000)
+BENCHMARK_RELATIVE_NAMED_PARAM(concurrentTDigestMerge, 1000, 1000)
+
+int main(int argc, char* argv[]) {
+  folly::gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
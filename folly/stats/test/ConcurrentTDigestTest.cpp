@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/stats/ConcurrentTDigest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+
+TEST(ConcurrentTDigest, Empty) {
+  ConcurrentTDigest digest;
+  auto result = digest.build();
+  EXPECT_TRUE(result.empty());
+  EXPECT_EQ(0, result.count());
+  EXPECT_EQ(100, result.maxSize());
+}
+
+TEST(ConcurrentTDigest, SingleThread) {
+  ConcurrentTDigest digest(1000, 100);
+  for (int i = 1; i <= 10000; ++i) {
+    digest.append(i);
+  }
+  auto result = digest.build();
+  EXPECT_EQ(10000, result.count());
+  EXPECT_EQ(50005000, result.sum());
+  EXPECT_EQ(1, result.min());
+  EXPECT_EQ(10000, result.max());
+  EXPECT_NEAR(5000, result.estimateQuantile(0.5), 50);
+  EXPECT_NEAR(9900, result.estimateQuantile(0.99), 10);
+  EXPECT_LE(result.getCentroids().size(), 100);
+}
+
+TEST(ConcurrentTDigest, BuildDrains) {
+  ConcurrentTDigest digest(1000, 100);
+  for (int i = 0; i < 10; ++i) {
+    digest.append(i);
+  }
+  EXPECT_EQ(10, digest.build().count());
+  EXPECT_TRUE(digest.build().empty());
+
+  for (int i = 0; i < 5000; ++i) {
+    digest.append(i);
+  }
+  EXPECT_EQ(5000, digest.build().count());
+  EXPECT_TRUE(digest.build().empty());
+}
+
+TEST(ConcurrentTDigest, Merge) {
+  ConcurrentTDigest digest(1000, 100);
+  std::vector<double> values;
+  for (int i = 1; i <= 100; ++i) {
+    values.push_back(i);
+  }
+  // Enough digests to be merged in batches as they are queued.
+  for (int i = 0; i < 100; ++i) {
+    digest.merge(TDigest(100).merge(values));
+  }
+  for (int i = 1; i <= 100; ++i) {
+    digest.append(i);
+  }
+  auto result = digest.build();
+  EXPECT_EQ(10100, result.count());
+  EXPECT_EQ(510050, result.sum());
+  EXPECT_EQ(1, result.min());
+  EXPECT_EQ(100, result.max());
+  EXPECT_NEAR(50.5, result.estimateQuantile(0.5), 1);
+}
+
+TEST(ConcurrentTDigest, MergeSerialized) {
+  std::vector<double> values;
+  for (int i = 1; i <= 1000; ++i) {
+    values.push_back(i);
+  }
+  auto serialized = TDigest(100).merge(values).serialize();
+
+  ConcurrentTDigest digest(1000, 100);
+  digest.merge(TDigest::deserialize(StringPiece(serialized)));
+  digest.merge(TDigest::deserialize(StringPiece(serialized)));
+  auto result = digest.build();
+  EXPECT_EQ(2000, result.count());
+  EXPECT_EQ(1001000, result.sum());
+  EXPECT_NEAR(500, result.estimateQuantile(0.5), 10);
+}
+
+TEST(ConcurrentTDigest, MultipleThreads) {
+  ConcurrentTDigest digest(1000, 100);
+  constexpr int kNumThreads = 16;
+  constexpr int kNumValues = 20000;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([&digest]() {
+      for (int j = 1; j <= kNumValues; ++j) {
+        digest.append(j);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  auto result = digest.build();
+  EXPECT_EQ(kNumThreads * kNumValues, result.count());
+  EXPECT_EQ(
+      double(kNumThreads) * kNumValues * (kNumValues + 1) / 2, result.sum());
+  EXPECT_EQ(1, result.min());
+  EXPECT_EQ(kNumValues, result.max());
+  EXPECT_NEAR(kNumValues / 2, result.estimateQuantile(0.5), kNumValues / 100);
+}
+
+TEST(ConcurrentTDigest, BuildWhileAppending) {
+  ConcurrentTDigest digest(100, 100);
+  constexpr int kNumThreads = 8;
+  constexpr int kNumValues = 50000;
+  std::atomic<int> running{kNumThreads};
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([&]() {
+      for (int j = 0; j < kNumValues; ++j) {
+        digest.append(1);
+      }
+      --running;
+    });
+  }
+
+  // Every value ends up in exactly one build().
+  double count = 0;
+  while (running.load() > 0) {
+    count += digest.build().count();
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  count += digest.build().count();
+  EXPECT_EQ(kNumThreads * kNumValues, count);
+}
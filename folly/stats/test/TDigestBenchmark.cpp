@@ -97,6 +97,54 @@ void merge(unsigned int iters, size_t maxSize, size_t bufSize) {
   }
 }
 
+// Values merged per second, for batches of 1K to 1M values: sorted, unsorted,
+// and unsorted in buffers of bufSize values, merged one buffer at a time or all
+// at once with the batched merge(). Batching pays off for small buffers, where
+// walking the centroids once per buffer dominates.
+enum class BatchMode { Sorted, Unsorted, Buffers, BatchedBuffers };
+
+unsigned int mergeBatch(
+    unsigned int iters, size_t batchSize, size_t bufSize, BatchMode mode) {
+  TDigest digest(100);
+  std::vector<double> values;
+  std::vector<folly::Range<const double*>> buffers;
+
+  BENCHMARK_SUSPEND {
+    std::default_random_engine generator;
+    std::lognormal_distribution<double> distribution(0.0, 1.0);
+    for (size_t i = 0; i < batchSize; ++i) {
+      values.push_back(distribution(generator));
+    }
+    if (mode == BatchMode::Sorted) {
+      std::sort(values.begin(), values.end());
+    }
+    for (size_t i = 0; i < batchSize; i += bufSize) {
+      buffers.emplace_back(
+          values.data() + i, values.data() + std::min(i + bufSize, batchSize));
+    }
+  }
+
+  for (size_t i = 0; i < iters; ++i) {
+    switch (mode) {
+      case BatchMode::Sorted:
+        digest = digest.merge(folly::sorted_equivalent, values);
+        break;
+      case BatchMode::Unsorted:
+        digest = digest.merge(values);
+        break;
+      case BatchMode::Buffers:
+        for (const auto& buffer : buffers) {
+          digest = digest.merge(buffer);
+        }
+        break;
+      case BatchMode::BatchedBuffers:
+        digest = digest.merge(buffers);
+        break;
+    }
+  }
+  return iters * batchSize;
+}
+
 void mergeDigests(unsigned int iters, size_t maxSize, size_t nDigests) {
   std::vector<TDigest> digests;
   BENCHMARK_SUSPEND {
@@ -165,6 +213,44 @@ BENCHMARK_RELATIVE_NAMED_PARAM(merge, 1000x1, 1000, 1000)
 BENCHMARK_RELATIVE_NAMED_PARAM(merge, 1000x5, 1000, 5000)
 BENCHMARK_RELATIVE_NAMED_PARAM(merge, 1000x10, 1000, 10000)
 
+BENCHMARK_DRAW_LINE();
+BENCHMARK_NAMED_PARAM_MULTI(
+    mergeBatch, sorted_1k, 1000, 1000, BatchMode::Sorted)
+BENCHMARK_NAMED_PARAM_MULTI(
+    mergeBatch, sorted_10k, 10000, 10000, BatchMode::Sorted)
+BENCHMARK_NAMED_PARAM_MULTI(
+    mergeBatch, sorted_100k, 100000, 100000, BatchMode::Sorted)
+BENCHMARK_NAMED_PARAM_MULTI(
+    mergeBatch, sorted_1m, 1000000, 1000000, BatchMode::Sorted)
+BENCHMARK_NAMED_PARAM_MULTI(
+    mergeBatch, unsorted_1k, 1000, 1000, BatchMode::Unsorted)
+BENCHMARK_NAMED_PARAM_MULTI(
+    mergeBatch, unsorted_10k, 10000, 10000, BatchMode::Unsorted)
+BENCHMARK_NAMED_PARAM_MULTI(
+    mergeBatch, unsorted_100k, 100000, 100000, BatchMode::Unsorted)
+BENCHMARK_NAMED_PARAM_MULTI(
+    mergeBatch, unsorted_1m, 1000000, 1000000, BatchMode::Unsorted)
+BENCHMARK_NAMED_PARAM_MULTI(
+    mergeBatch, buffers_100x100, 10000, 100, BatchMode::Buffers)
+BENCHMARK_RELATIVE_NAMED_PARAM_MULTI(
+    mergeBatch, batched_buffers_100x100, 10000, 100, BatchMode::BatchedBuffers)
+BENCHMARK_NAMED_PARAM_MULTI(
+    mergeBatch, buffers_1000x100, 100000, 100, BatchMode::Buffers)
+BENCHMARK_RELATIVE_NAMED_PARAM_MULTI(
+    mergeBatch,
+    batched_buffers_1000x100,
+    100000,
+    100,
+    BatchMode::BatchedBuffers)
+BENCHMARK_NAMED_PARAM_MULTI(
+    mergeBatch, buffers_100x1000, 100000, 1000, BatchMode::Buffers)
+BENCHMARK_RELATIVE_NAMED_PARAM_MULTI(
+    mergeBatch,
+    batched_buffers_100x1000,
+    100000,
+    1000,
+    BatchMode::BatchedBuffers)
+
 BENCHMARK_DRAW_LINE();
 // mergeImpl N x K sweep (K digests of N centroids). K=2 uses merge2Impl.
 BENCHMARK_NAMED_PARAM(mergeDigests, 100x2, 100, 2)
@@ -397,6 +397,187 @@ TEST(TDigest, InlineMerge) {
   }
 }
 
+namespace {
+
+// A digest of sorted values with a centroid of weight 1 for each of them.
+// Merging it into a digest is how merge() used to merge the values.
+TDigest valuesAsCentroids(const std::vector<double>& sortedValues) {
+  std::vector<TDigest::Centroid> centroids;
+  double sum = 0;
+  for (auto value : sortedValues) {
+    centroids.emplace_back(value, 1.0);
+    sum += value;
+  }
+  return TDigest(
+      std::move(centroids),
+      sum,
+      sortedValues.size(),
+      sortedValues.back(),
+      sortedValues.front(),
+      sortedValues.size());
+}
+
+} // namespace
+
+TEST(TDigest, MergeValuesMatchesMergeCentroids) {
+  // Merging values appends runs of them in bulk; the result must be the same
+  // as merging the values one by one, as centroids of weight 1. Whole numbers
+  // keep the sums exact, and repeat so that values tie with centroids.
+  std::default_random_engine generator(kSeed);
+  std::uniform_int_distribution<int> distribution(0, 300);
+  TDigest digest(100);
+  for (int i = 0; i < 20; ++i) {
+    std::vector<double> values;
+    for (int j = 0; j < 1000; ++j) {
+      values.push_back(distribution(generator));
+    }
+    std::sort(values.begin(), values.end());
+
+    auto merged = digest.merge(sorted_equivalent, values);
+    auto expected = TDigest::merge(digest, valuesAsCentroids(values));
+    EXPECT_EQ(expected.sum(), merged.sum());
+    EXPECT_EQ(expected.count(), merged.count());
+    EXPECT_EQ(expected.min(), merged.min());
+    EXPECT_EQ(expected.max(), merged.max());
+    ASSERT_EQ(expected.getCentroids().size(), merged.getCentroids().size());
+    for (size_t j = 0; j < expected.getCentroids().size(); ++j) {
+      EXPECT_EQ(
+          expected.getCentroids()[j].mean(), merged.getCentroids()[j].mean());
+      EXPECT_EQ(
+          expected.getCentroids()[j].weight(),
+          merged.getCentroids()[j].weight());
+    }
+    digest = merged;
+  }
+}
+
+TEST(TDigest, MergeValuesQuantilesMatchMergeCentroids) {
+  // With arbitrary doubles, summing runs of values in bulk rounds differently
+  // from adding them one by one, so means may differ in their last bits, and
+  // that can move a later value to the other side of a centroid. Quantiles
+  // must still agree with merging the values one by one to within 1e-9 of
+  // the range of the values.
+  constexpr double kTolerance = 1e-9;
+  std::default_random_engine generator(kSeed);
+  std::lognormal_distribution<double> distribution(0.0, 1.0);
+  TDigest digest(100);
+  TDigest expected(100);
+  for (int i = 0; i < 50; ++i) {
+    std::vector<double> values;
+    for (int j = 0; j < 1000; ++j) {
+      values.push_back(distribution(generator));
+    }
+    std::sort(values.begin(), values.end());
+    digest = digest.merge(sorted_equivalent, values);
+    expected = TDigest::merge(expected, valuesAsCentroids(values));
+  }
+
+  EXPECT_EQ(expected.count(), digest.count());
+  EXPECT_EQ(expected.min(), digest.min());
+  EXPECT_EQ(expected.max(), digest.max());
+  EXPECT_NEAR(expected.sum(), digest.sum(), kTolerance * expected.sum());
+  auto range = expected.max() - expected.min();
+  for (auto q : {0.001, 0.01, 0.1, 0.25, 0.5, 0.75, 0.9, 0.99, 0.999}) {
+    EXPECT_NEAR(
+        expected.estimateQuantile(q),
+        digest.estimateQuantile(q),
+        kTolerance * range)
+        << q;
+  }
+}
+
+TEST(TDigest, MergeBuffers) {
+  std::vector<double> all;
+  std::vector<std::vector<double>> buffers(10);
+  for (size_t i = 0; i < buffers.size(); ++i) {
+    // Sizes on both sides of the radix sort threshold.
+    for (size_t j = 0; j < i * 50; ++j) {
+      buffers[i].push_back((j * 7919 + i) % 1000);
+      all.push_back(buffers[i].back());
+    }
+  }
+  std::vector<Range<const double*>> ranges(buffers.begin(), buffers.end());
+
+  TDigest digest(100);
+  digest = digest.merge(std::vector<double>{-1, 5000});
+  auto merged = digest.merge(ranges);
+  auto expected = digest.merge(all);
+  EXPECT_EQ(expected.sum(), merged.sum());
+  EXPECT_EQ(expected.count(), merged.count());
+  EXPECT_EQ(-1, merged.min());
+  EXPECT_EQ(5000, merged.max());
+  ASSERT_EQ(expected.getCentroids().size(), merged.getCentroids().size());
+  for (size_t i = 0; i < expected.getCentroids().size(); ++i) {
+    EXPECT_EQ(
+        expected.getCentroids()[i].mean(), merged.getCentroids()[i].mean());
+  }
+
+  EXPECT_EQ(
+      digest.count(),
+      digest.merge(Range<const Range<const double*>*>()).count());
+}
+
+TEST(TDigest, Serialize) {
+  std::vector<double> values;
+  for (int i = 1; i <= 1000; ++i) {
+    values.push_back(i * 0.5);
+  }
+  auto digest = TDigest(100).merge(values);
+
+  auto serialized = digest.serialize();
+  auto deserialized = TDigest::deserialize(StringPiece(serialized));
+  EXPECT_EQ(digest.sum(), deserialized.sum());
+  EXPECT_EQ(digest.count(), deserialized.count());
+  EXPECT_EQ(digest.min(), deserialized.min());
+  EXPECT_EQ(digest.max(), deserialized.max());
+  EXPECT_EQ(digest.maxSize(), deserialized.maxSize());
+  ASSERT_EQ(digest.getCentroids().size(), deserialized.getCentroids().size());
+  for (size_t i = 0; i < digest.getCentroids().size(); ++i) {
+    EXPECT_EQ(
+        digest.getCentroids()[i].mean(), deserialized.getCentroids()[i].mean());
+    EXPECT_EQ(
+        digest.getCentroids()[i].weight(),
+        deserialized.getCentroids()[i].weight());
+  }
+  // Whole number weights are encoded as varints.
+  EXPECT_LT(
+      serialized.size(), digest.getCentroids().size() * 2 * sizeof(double));
+
+  // Fractional weights round trip too.
+  auto weighted = TDigest(
+      {TDigest::Centroid(1, 0.5), TDigest::Centroid(2, 1.5)}, 3.5, 2, 2, 1);
+  auto weightedRoundTrip =
+      TDigest::deserialize(StringPiece(weighted.serialize()));
+  ASSERT_EQ(2, weightedRoundTrip.getCentroids().size());
+  EXPECT_EQ(0.5, weightedRoundTrip.getCentroids()[0].weight());
+  EXPECT_EQ(1.5, weightedRoundTrip.getCentroids()[1].weight());
+
+  auto empty = TDigest::deserialize(StringPiece(TDigest(10).serialize()));
+  EXPECT_TRUE(empty.empty());
+  EXPECT_EQ(10, empty.maxSize());
+  EXPECT_TRUE(std::isnan(empty.min()));
+}
+
+TEST(TDigest, DeserializeInvalid) {
+  std::vector<double> values{1, 2, 3};
+  auto serialized = TDigest(100).merge(values).serialize();
+
+  EXPECT_THROW(TDigest::deserialize(ByteRange()), std::invalid_argument);
+  for (size_t size = 1; size < serialized.size(); ++size) {
+    EXPECT_THROW(
+        TDigest::deserialize(StringPiece(serialized.data(), size)),
+        std::invalid_argument);
+  }
+  EXPECT_THROW(
+      TDigest::deserialize(StringPiece(serialized + "x")),
+      std::invalid_argument);
+
+  auto badVersion = serialized;
+  badVersion[0] = 2;
+  EXPECT_THROW(
+      TDigest::deserialize(StringPiece(badVersion)), std::invalid_argument);
+}
+
 class DistributionTest
     : public ::testing::TestWithParam<
           std::tuple<std::pair<bool, size_t>, double, bool>> {};
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/system/NumaTopology.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <filesystem>
+#include <map>
+#include <stdexcept>
+#include <string>
+
+#include <fmt/format.h>
+
+#include <folly/Conv.h>
+#include <folly/FileUtil.h>
+#include <folly/String.h>
+#include <folly/portability/Sched.h>
+#include <folly/system/HardwareConcurrency.h>
+
+namespace folly {
+
+NumaTopology::NumaTopology(std::vector<std::vector<size_t>> cpus)
+    : cpusByNode(std::move(cpus)) {
+  for (size_t node = 0; node < cpusByNode.size(); ++node) {
+    auto& nodeCpus = cpusByNode[node];
+    std::sort(nodeCpus.begin(), nodeCpus.end());
+    if (!nodeCpus.empty() && nodeCpus.back() >= nodeByCpu.size()) {
+      nodeByCpu.resize(nodeCpus.back() + 1, kUnknownNode);
+    }
+    for (auto cpu : nodeCpus) {
+      nodeByCpu[cpu] = node;
+    }
+  }
+}
+
+bool NumaTopology::pinCurrentThreadToNode(size_t node) const {
+#if defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (auto cpu : cpusByNode.at(node)) {
+    if (cpu < CPU_SETSIZE) {
+      CPU_SET(cpu, &set);
+    }
+  }
+  return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+  (void)node;
+  errno = ENOTSUP;
+  return false;
+#endif
+}
+
+const NumaTopology& NumaTopology::system() {
+  static const NumaTopology topology = [] {
+    try {
+      return readFromSysfsTree();
+    } catch (...) {
+      // Not Linux, or no NUMA support in the kernel: one node.
+      return uniform(std::max(1u, available_concurrency()));
+    }
+  }();
+  return topology;
+}
+
+NumaTopology NumaTopology::readFromSysfsTree(std::string_view root) {
+  auto nodeRoot = std::filesystem::path(root) / "sys/devices/system/node";
+  // Sorted by kernel node id, which need not be dense.
+  std::map<size_t, std::vector<size_t>> cpusByNodeId;
+  std::error_code ec;
+  for (auto& entry : std::filesystem::directory_iterator(nodeRoot, ec)) {
+    auto name = entry.path().filename().string();
+    if (name.size() <= 4 || name.compare(0, 4, "node") != 0) {
+      continue;
+    }
+    auto id = tryTo<size_t>(std::string_view(name).substr(4));
+    std::string list;
+    if (!id || !readFile((entry.path() / "cpulist").c_str(), list)) {
+      continue;
+    }
+    auto cpus = parseCpuList(list);
+    if (!cpus.empty()) {
+      cpusByNodeId.emplace(*id, std::move(cpus));
+    }
+  }
+  if (cpusByNodeId.empty()) {
+    throw std::runtime_error(
+        fmt::format("no NUMA nodes with cpus under {}", nodeRoot.string()));
+  }
+
+  std::vector<std::vector<size_t>> cpus;
+  cpus.reserve(cpusByNodeId.size());
+  for (auto& [id, nodeCpus] : cpusByNodeId) {
+    cpus.push_back(std::move(nodeCpus));
+  }
+  return NumaTopology(std::move(cpus));
+}
+
+NumaTopology NumaTopology::uniform(size_t numCpus, size_t numNodes) {
+  numNodes = std::clamp<size_t>(numNodes, 1, std::max<size_t>(numCpus, 1));
+  std::vector<std::vector<size_t>> cpus(numNodes);
+  for (size_t cpu = 0; cpu < numCpus; ++cpu) {
+    cpus[cpu * numNodes / numCpus].push_back(cpu);
+  }
+  return NumaTopology(std::move(cpus));
+}
+
+std::vector<size_t> NumaTopology::parseCpuList(std::string_view list) {
+  std::vector<size_t> cpus;
+  std::vector<std::string_view> ranges;
+  split(',', trimWhitespace(list), ranges);
+  for (auto range : ranges) {
+    if (range.empty()) {
+      continue;
+    }
+    std::string_view first;
+    std::string_view last;
+    if (!split('-', range, first, last)) {
+      first = last = range;
+    }
+    auto lo = tryTo<size_t>(first);
+    auto hi = tryTo<size_t>(last);
+    if (!lo || !hi || *lo > *hi) {
+      throw std::runtime_error(
+          fmt::format("error parsing cpu list '{}'", list));
+    }
+    for (auto cpu = *lo; cpu <= *hi; ++cpu) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+} // namespace folly
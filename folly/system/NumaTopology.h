@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+namespace folly {
+
+/// NumaTopology
+///
+/// Which cpus (as returned by sched_getcpu or SO_INCOMING_CPU) belong to which
+/// NUMA node. Nodes are numbered densely from 0 in the order of their kernel
+/// ids, and nodes without cpus (memory-only nodes) are left out.
+struct NumaTopology {
+  static constexpr size_t kUnknownNode = static_cast<size_t>(-1);
+
+  /// The cpus of each node, in increasing order.
+  std::vector<std::vector<size_t>> cpusByNode;
+
+  /// A map from cpu to node, with 1 more entry than the largest cpu. cpus
+  /// that are not in any node (offline, say) map to kUnknownNode.
+  std::vector<size_t> nodeByCpu;
+
+  NumaTopology() = default;
+  explicit NumaTopology(std::vector<std::vector<size_t>> cpus);
+
+  size_t numNodes() const { return cpusByNode.size(); }
+
+  /// The node of `cpu`, or kUnknownNode.
+  size_t nodeOf(size_t cpu) const {
+    return cpu < nodeByCpu.size() ? nodeByCpu[cpu] : kUnknownNode;
+  }
+
+  /// Restricts the calling thread to the cpus of `node`. Returns false, with
+  /// errno set, if that fails (for instance for a simulated topology with
+  /// more cpus than the machine), and where thread affinity is unsupported.
+  bool pinCurrentThreadToNode(size_t node) const;
+
+  /// Returns the topology of the current system, read once and cached.
+  /// Systems without NUMA information in sysfs are a single node of all the
+  /// cpus.
+  static const NumaTopology& system();
+
+  /// Reads the topology from a tree structured like sysfs, i.e. from
+  /// /sys/devices/system/node/node*/cpulist under `root`. Throws if there
+  /// is no node with cpus.
+  static NumaTopology readFromSysfsTree(std::string_view root = "/");
+
+  /// A topology of `numNodes` nodes that split `numCpus` cpus into
+  /// contiguous, (nearly) equal ranges. Useful for testing, and to simulate
+  /// a multi-node system on a single-node one.
+  static NumaTopology uniform(size_t numCpus, size_t numNodes = 1);
+
+  /// Parses a sysfs cpu list, such as "0-3,8,10-11". Throws on malformed
+  /// input.
+  static std::vector<size_t> parseCpuList(std::string_view list);
+};
+
+} // namespace folly
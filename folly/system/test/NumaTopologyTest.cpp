@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/system/NumaTopology.h>
+
+#include <filesystem>
+#include <stdexcept>
+
+#include <folly/FileUtil.h>
+#include <folly/portability/GTest.h>
+#include <folly/testing/TestUtil.h>
+
+using folly::NumaTopology;
+
+using Cpus = std::vector<size_t>;
+
+TEST(NumaTopology, ParseCpuList) {
+  EXPECT_EQ(
+      NumaTopology::parseCpuList("0-3,8,10-11\n"),
+      Cpus({0, 1, 2, 3, 8, 10, 11}));
+  EXPECT_EQ(NumaTopology::parseCpuList("5"), Cpus({5}));
+  EXPECT_EQ(NumaTopology::parseCpuList("\n"), Cpus());
+  EXPECT_THROW(NumaTopology::parseCpuList("3-1"), std::runtime_error);
+  EXPECT_THROW(NumaTopology::parseCpuList("a"), std::runtime_error);
+}
+
+TEST(NumaTopology, Uniform) {
+  auto topology = NumaTopology::uniform(6, 2);
+  ASSERT_EQ(topology.numNodes(), 2);
+  EXPECT_EQ(topology.cpusByNode[0], Cpus({0, 1, 2}));
+  EXPECT_EQ(topology.cpusByNode[1], Cpus({3, 4, 5}));
+  EXPECT_EQ(topology.nodeOf(4), 1);
+  EXPECT_EQ(topology.nodeOf(6), NumaTopology::kUnknownNode);
+
+  // No more nodes than cpus.
+  EXPECT_EQ(NumaTopology::uniform(2, 4).numNodes(), 2);
+}
+
+TEST(NumaTopology, ReadFromSysfsTree) {
+  folly::test::TemporaryDirectory root;
+  auto nodes =
+      std::filesystem::path(root.path().string()) / "sys/devices/system/node";
+  auto addNode = [&](const char* name, const char* cpulist) {
+    std::filesystem::create_directories(nodes / name);
+    ASSERT_TRUE(folly::writeFile(
+        std::string(cpulist), (nodes / name / "cpulist").c_str()));
+  };
+  // Sparse node ids, a memory-only node, and non-node entries.
+  addNode("node0", "0-1,4-5\n");
+  addNode("node1", "\n");
+  addNode("node3", "2-3,6-7\n");
+  std::filesystem::create_directories(nodes / "power");
+  ASSERT_TRUE(
+      folly::writeFile(std::string("0-1\n"), (nodes / "online").c_str()));
+
+  auto topology = NumaTopology::readFromSysfsTree(root.path().string());
+  ASSERT_EQ(topology.numNodes(), 2);
+  EXPECT_EQ(topology.cpusByNode[0], Cpus({0, 1, 4, 5}));
+  EXPECT_EQ(topology.cpusByNode[1], Cpus({2, 3, 6, 7}));
+  EXPECT_EQ(topology.nodeOf(5), 0);
+  EXPECT_EQ(topology.nodeOf(6), 1);
+}
+
+TEST(NumaTopology, ReadFromEmptySysfsTree) {
+  folly::test::TemporaryDirectory root;
+  EXPECT_THROW(
+      NumaTopology::readFromSysfsTree(root.path().string()),
+      std::runtime_error);
+}
+
+TEST(NumaTopology, System) {
+  auto& topology = NumaTopology::system();
+  ASSERT_GE(topology.numNodes(), 1);
+  EXPECT_FALSE(topology.cpusByNode[0].empty());
+}